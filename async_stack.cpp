@@ -0,0 +1,227 @@
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+#include "async_stack.hpp"
+#include "timer.hpp"
+#include "when_all.hpp"
+
+#ifdef CORO_ASYNC_STACKS
+#include <csignal>
+#include <thread>
+#include <sys/time.h>
+#endif
+
+//////////////////////
+// async_frame_info
+
+async_frame_info::async_frame_info(const char * function, std::span<const char * const> sites,
+                                   __coroutine_state::__destroy_fn * destroy, __coroutine_state::__resume_fn * resume,
+                                   suspend_point_fn * suspend_point, continuation_fn * continuation) noexcept
+    : function(function)
+    , sites(sites)
+    , destroy(destroy)
+    , resume(resume)
+    , suspend_point(suspend_point)
+    , continuation(continuation)
+{
+    next_ = registered_.load(std::memory_order_relaxed);
+    while(!registered_.compare_exchange_weak(next_, this, std::memory_order_release, std::memory_order_relaxed)){
+    }
+}
+
+const async_frame_info * async_frame_info::find(const __coroutine_state * frame) noexcept
+{
+    for(const async_frame_info * info = registered_.load(std::memory_order_acquire); info != nullptr; info = info->next_){
+        if(info->destroy != nullptr ? __destroy_fn_of(frame) == info->destroy : __resume_fn_of(frame) == info->resume){
+            return info;
+        }
+    }
+    return nullptr;
+}
+
+namespace
+{
+    std::coroutine_handle<> parent_of_slot(const __coroutine_state * s) noexcept
+    {
+        return static_cast<const __when_all_slot *>(s)->counter->parent();
+    }
+
+    // The continuations when_all / when_any install in their children.
+    const async_frame_info when_all_slot_info {"when_all", {}, nullptr, &__when_all_counter::resume_slot, nullptr, &parent_of_slot};
+    const async_frame_info when_any_slot_info {"when_any", {}, nullptr, &__when_any_counter::resume_slot, nullptr, &parent_of_slot};
+
+    std::coroutine_handle<> parent_of_timeout(const __coroutine_state * s) noexcept
+    {
+        return static_cast<const __timeout_frame *>(s)->state->parent();
+    }
+
+    // The continuation with_timeout installs in its task.
+    const async_frame_info with_timeout_info {"with_timeout", {}, nullptr, &__timeout_state::resume_completion, nullptr, &parent_of_timeout};
+}
+
+//////////////////////
+// async_stack
+
+std::size_t async_stack::walk(std::coroutine_handle<> h, std::span<async_stack_frame> out) noexcept
+{
+    std::size_t depth = 0;
+    while(depth < out.size() && h && h != std::noop_coroutine()){
+        const auto * frame = static_cast<const __coroutine_state *>(h.address());
+        const async_frame_info * info = async_frame_info::find(frame);
+
+        out[depth++] = {frame, info, info != nullptr && info->suspend_point != nullptr ? info->suspend_point(frame) : 0};
+
+        if(info == nullptr || info->continuation == nullptr){
+            break;
+        }
+        h = info->continuation(frame);
+    }
+    return depth;
+}
+
+void async_stack::print(std::ostream & out, std::coroutine_handle<> h, std::size_t max_depth)
+{
+    std::vector<async_stack_frame> frames(max_depth);
+    frames.resize(walk(h, frames));
+
+    for(std::size_t i = 0; i < frames.size(); ++i){
+        const async_stack_frame & f = frames[i];
+        out << '#' << i << ' ' << static_cast<const void *>(f.frame) << ' ' << (f.function() != nullptr ? f.function() : "??");
+        if(f.site() != nullptr){
+            out << " at " << f.site();
+        }
+        else if(f.info != nullptr && !f.info->sites.empty()){
+            out << " at suspend-point " << f.suspend_point;
+        }
+        out << '\n';
+    }
+}
+
+extern "C" void coro_print_async_stack(void * frame)
+{
+    async_stack::print(std::cerr, std::coroutine_handle<>::from_address(frame));
+    std::cerr.flush();
+}
+
+#ifdef CORO_ASYNC_STACKS
+//////////////////////
+// async_profiler
+
+async_profiler::async_profiler(std::size_t max_samples)
+    : samples_(std::make_unique_for_overwrite<sample[]>(max_samples))
+    , capacity_(max_samples)
+{
+}
+
+async_profiler::~async_profiler()
+{
+    stop();
+}
+
+void async_profiler::on_sigprof(int) noexcept
+{
+    // stop() waits for in_handler_ to drop back to zero after clearing active_,
+    // so a profiler seen here stays alive until we return.
+    in_handler_.fetch_add(1, std::memory_order_seq_cst);
+
+    if(async_profiler * self = active_.load(std::memory_order_seq_cst)){
+        const std::size_t i = self->taken_.fetch_add(1, std::memory_order_relaxed);
+        if(i < self->capacity_){
+            async_stack_frame frames[max_depth];
+            sample & s = self->samples_[i];
+
+            s.depth = static_cast<std::uint32_t>(async_stack::walk(async_stack::running(), frames));
+            for(std::uint32_t d = 0; d < s.depth; ++d){
+                s.infos [d] = frames[d].info;
+                s.points[d] = frames[d].suspend_point;
+            }
+        }
+    }
+
+    in_handler_.fetch_sub(1, std::memory_order_release);
+}
+
+// Whoever handled SIGPROF before start(), put back by stop(). Only one profiler
+// runs at a time, so one is enough.
+static struct sigaction previous_sigprof;
+
+bool async_profiler::start(std::chrono::microseconds interval)
+{
+    async_profiler * expected = nullptr;
+    if(!active_.compare_exchange_strong(expected, this, std::memory_order_seq_cst)){
+        return false;
+    }
+
+    struct sigaction action {};
+    action.sa_handler = &on_sigprof;
+    action.sa_flags   = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGPROF, &action, &previous_sigprof);
+
+    const auto us = interval.count();
+    itimerval timer {};
+    timer.it_interval.tv_sec  = us / 1'000'000;
+    timer.it_interval.tv_usec = us % 1'000'000;
+    timer.it_value            = timer.it_interval;
+    setitimer(ITIMER_PROF, &timer, nullptr);
+    return true;
+}
+
+void async_profiler::stop() noexcept
+{
+    async_profiler * expected = this;
+    if(!active_.compare_exchange_strong(expected, nullptr, std::memory_order_seq_cst)){
+        return;
+    }
+
+    itimerval timer {};
+    setitimer(ITIMER_PROF, &timer, nullptr);
+
+    // A signal still pending afterwards finds no profiler and returns.
+    while(in_handler_.load(std::memory_order_acquire) != 0){
+        std::this_thread::yield();
+    }
+    sigaction(SIGPROF, &previous_sigprof, nullptr);
+}
+
+std::size_t async_profiler::samples() const noexcept
+{
+    return std::min(taken_.load(std::memory_order_relaxed), capacity_);
+}
+
+void async_profiler::write_folded(std::ostream & out) const
+{
+    std::map<std::string, std::size_t> stacks;
+
+    for(std::size_t i = 0, n = samples(); i < n; ++i){
+        const sample & s = samples_[i];
+
+        std::string key;
+        for(std::uint32_t d = s.depth; d-- > 0;){
+            const async_frame_info * info = s.infos[d];
+            key += info != nullptr ? info->function : "[unregistered frame]";
+            if(const char * site = info != nullptr ? info->site(s.points[d]) : nullptr){
+                key += " [";
+                key += site;
+                key += ']';
+            }
+            if(d != 0){
+                key += ';';
+            }
+        }
+        ++stacks[s.depth == 0 ? std::string("[no coroutine]") : std::move(key)];
+    }
+
+    std::vector<std::pair<std::size_t, const std::string *>> sorted;
+    for(const auto & [stack, count]: stacks){
+        sorted.emplace_back(count, &stack);
+    }
+    std::stable_sort(sorted.begin(), sorted.end(), [](const auto & a, const auto & b){ return a.first > b.first; });
+
+    for(const auto & [count, stack]: sorted){
+        out << *stack << ' ' << count << '\n';
+    }
+}
+#endif
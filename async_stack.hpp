@@ -0,0 +1,240 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Async stack traces
+//
+// A suspended coroutine is not on any thread's stack, gdb only shows the loop in
+// coroutine_handle<void>::resume() that is about to run it. Its logical callers
+// are reachable though: task::promise_type::continuation_ is the coroutine that
+// awaits it, whose continuation_ is the one awaiting that, and so on up to the
+// root. async_stack::walk() follows these links from any coroutine_handle<>:
+//
+//   #0 0x5555555592c0 f(int x) at initial suspend
+//   #1 0x555555559270 g(int x) at co_await f(x)
+//   #2 0x5555555591f0 thread_pool::spawn
+//
+// Frames are named through an async_frame_info that every lowered coroutine
+// registers next to its destroy function, describing its suspend-points:
+//
+//   static constexpr const char * __g_sites[] = {"initial suspend", "co_await f(x)", "final suspend"};
+//   static const lowered_frame_info<__g_state> __g_frame_info{&__g_destroy, "g(int x)", __g_sites};
+//
+// A frame is recognised by its __destroy, which unlike __resume is not cleared
+// at the final suspend-point (for a compact frame, by its vtable's, see
+// "Compact frames" in defs.hpp). when_all / when_any slots all share the noop
+// destroy function, they are recognised by __resume instead. Walking stops at
+// the noop coroutine (the root of task::execute()), at a frame without a
+// continuation (a generator) and at an unregistered frame.
+//
+// walk() only reads the frames, it doesn't lock or allocate, so it may be called
+// from a signal handler, as long as no other thread can free the frames it
+// walks meanwhile. From gdb:
+//
+//   (gdb) call coro_print_async_stack(handle.state_)
+//
+// Sampling profiler
+//
+// Built with -DCORO_ASYNC_STACKS the trampoline in coroutine_handle<>::resume()
+// records in a thread_local which frame it is running. async_profiler samples
+// that on SIGPROF and writes the async stacks it found in the folded format of
+// flamegraph.pl / speedscope, outermost frame first:
+//
+//   sum_all(calls) [co_await when_all(std::move(calls))];when_all;hop(pool, n) [co_await pool.schedule()] 812
+//
+// The innermost frame is running and shows the suspend-point it was last resumed
+// from, the others are suspended in the await named.
+
+#include<atomic>
+#include<chrono>
+#include<cstdint>
+#include<iosfwd>
+#include<memory>
+#include<span>
+#include "defs.hpp"
+
+class async_frame_info
+{
+    public:
+        using suspend_point_fn = std::uint32_t           (const __coroutine_state *) noexcept;
+        using continuation_fn  = std::coroutine_handle<> (const __coroutine_state *) noexcept;
+
+        const char *                      function;
+        std::span<const char * const>     sites;          // indexed by suspend-point
+        __coroutine_state::__destroy_fn * destroy;        // recognised by __destroy,
+        __coroutine_state::__resume_fn  * resume;         // or by __resume if destroy is null
+        suspend_point_fn *                suspend_point;  // null if it has a single one
+        continuation_fn  *                continuation;   // null for the end of a chain
+
+    private:
+        const async_frame_info * next_ = nullptr;
+
+        static inline std::atomic<const async_frame_info *> registered_ {nullptr};
+
+    public:
+        // Registers for the lifetime of the program, so meant for objects with
+        // static storage duration.
+        async_frame_info(const char * function, std::span<const char * const> sites,
+                         __coroutine_state::__destroy_fn * destroy, __coroutine_state::__resume_fn * resume,
+                         suspend_point_fn * suspend_point, continuation_fn * continuation) noexcept;
+
+        async_frame_info            (const async_frame_info &) = delete;
+        async_frame_info & operator=(const async_frame_info &) = delete;
+
+    public:
+        // The registered description of `frame`, or null.
+        static const async_frame_info * find(const __coroutine_state * frame) noexcept;
+
+        // Name of suspend-point `point`, or null if there is none.
+        const char * site(std::uint32_t point) const noexcept
+        {
+            return point < sites.size() ? sites[point] : nullptr;
+        }
+};
+
+// async_frame_info of a lowered task or generator coroutine-state.
+template<typename State> class lowered_frame_info : public async_frame_info
+{
+    private:
+        static const State * state_of(const __coroutine_state * s) noexcept
+        {
+            if constexpr (std::derived_from<State, __compact_coroutine_state>){
+                return __compact_coroutine_state::__from_handle<State>(s);
+            }
+            else{
+                return static_cast<const State *>(s);
+            }
+        }
+
+        static std::uint32_t suspend_point_of(const __coroutine_state * s) noexcept
+        {
+            if constexpr (std::derived_from<State, __compact_coroutine_state>){
+                return state_of(s)->__suspend_point();
+            }
+            else{
+                return static_cast<std::uint32_t>(state_of(s)->__suspend_point);
+            }
+        }
+
+        static std::coroutine_handle<> continuation_of(const __coroutine_state * s) noexcept
+        {
+            return state_of(s)->__promise.continuation();
+        }
+
+        static constexpr continuation_fn * continuation_fn_of() noexcept
+        {
+            if constexpr (std::derived_from<std::remove_cvref_t<decltype(std::declval<const State &>().__promise)>, __task_promise_base>){
+                return &continuation_of;
+            }
+            else{
+                return nullptr;
+            }
+        }
+
+    public:
+        lowered_frame_info(__coroutine_state::__destroy_fn * destroy, const char * function, std::span<const char * const> sites,
+                           suspend_point_fn * suspend_point = &suspend_point_of) noexcept
+            : async_frame_info(function, sites, destroy, nullptr, suspend_point, continuation_fn_of())
+        {}
+};
+
+struct async_stack_frame
+{
+    const __coroutine_state * frame;
+    const async_frame_info  * info;           // null if the frame isn't registered
+    std::uint32_t             suspend_point;
+
+    const char * function() const noexcept { return info != nullptr ? info->function            : nullptr; }
+    const char * site    () const noexcept { return info != nullptr ? info->site(suspend_point) : nullptr; }
+};
+
+class async_stack
+{
+    public:
+        // Fills `out` from h outwards, returns the number of frames stored.
+        // Async-signal-safe if h and the frames awaiting it stay alive, see
+        // async_profiler below.
+        static std::size_t walk(std::coroutine_handle<> h, std::span<async_stack_frame> out) noexcept;
+
+        // One line per frame as in the example at the top.
+        static void print(std::ostream & out, std::coroutine_handle<> h, std::size_t max_depth = 64);
+
+#ifdef CORO_ASYNC_STACKS
+        // The frame whose resume function runs on this thread, the null handle
+        // outside of coroutine_handle<>::resume() and once that frame suspended.
+        static std::coroutine_handle<> running() noexcept
+        {
+            return std::coroutine_handle<>::from_address(__running_frame);
+        }
+#endif
+};
+
+extern "C" void coro_print_async_stack(void * frame);
+
+#ifdef CORO_ASYNC_STACKS
+//////////////////////
+// async_profiler
+//
+//   async_profiler profiler;
+//   profiler.start(std::chrono::microseconds(500));
+//   ...
+//   profiler.stop();
+//   profiler.write_folded(std::cout);
+//
+// SIGPROF fires on whichever thread is using CPU (ITIMER_PROF counts the whole
+// process), so the samples cover the workers of a thread_pool too. Samples
+// taken outside of a coroutine are counted as "[no coroutine]". At most one
+// profiler runs at a time.
+//
+// The walk must not reach a frame another thread may have freed: find() reads
+// the frame before it knows what it is, and frames from the global heap or a
+// std::pmr resource can be unmapped once freed. So a resume function calls
+// __release_running_frame() before its frame can be resumed or freed elsewhere,
+// i.e. before every await_suspend() and before it deletes itself; a sample
+// taken from there until the trampoline resumes the next frame counts as
+// "[no coroutine]". The frames above the running one are suspended awaiting
+// it, and stay alive until it finishes.
+
+class async_profiler
+{
+    public:
+        static constexpr std::size_t max_depth = 32;
+
+    private:
+        struct sample
+        {
+            std::uint32_t            depth;
+            const async_frame_info * infos [max_depth];
+            std::uint32_t            points[max_depth];
+        };
+
+        std::unique_ptr<sample[]> samples_;
+        std::size_t               capacity_;
+        std::atomic<std::size_t>  taken_ {0};
+
+        static inline std::atomic<async_profiler *> active_  {nullptr};
+        static inline std::atomic<int>              in_handler_ {0};
+
+        static void on_sigprof(int) noexcept;
+
+    public:
+        explicit async_profiler(std::size_t max_samples = 1 << 16);
+        ~async_profiler();
+
+        async_profiler            (const async_profiler &) = delete;
+        async_profiler & operator=(const async_profiler &) = delete;
+
+    public:
+        // False if another profiler is running.
+        bool start(std::chrono::microseconds interval = std::chrono::milliseconds(1));
+
+        // Returns once no handler is writing samples any more, with the SIGPROF
+        // handler from before start() back in place.
+        void stop() noexcept;
+
+        // Samples kept, ones beyond max_samples are dropped.
+        std::size_t samples() const noexcept;
+
+        // One line per distinct async stack with its sample count, most frequent
+        // first. Call after stop().
+        void write_folded(std::ostream & out) const;
+};
+#endif
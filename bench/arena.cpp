@@ -0,0 +1,53 @@
+// Per-request frame allocation: request(std::allocator_arg, resource, n) and the
+// n chain(i) calls it awaits, 1 + n(n+1)/2 frames, all allocated from `resource`.
+//
+//   request/frame_allocator/n=N  - resource = nullptr: the default frame_allocator,
+//                                  every frame is freed when it is destroyed
+//   request/new_delete/n=N       - std::pmr::new_delete_resource(): global
+//                                  operator new and delete per frame
+//   request/monotonic/n=N        - a std::pmr::monotonic_buffer_resource over a
+//                                  stack buffer: frees are no-ops and the whole
+//                                  request is released in one go at the end
+//
+// ns_per_op is per frame.
+
+#include <memory_resource>
+#include "bench.hpp"
+#include "../request.hpp"
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+    constexpr long frames = 4'000'000;
+
+    for(int n: {4, 16}){
+        const long per_request = 1 + n * (n + 1) / 2;
+        const long requests    = frames / per_request;
+        const std::string suffix = "/n=" + std::to_string(n);
+
+        r.measure("request/frame_allocator" + suffix, requests * per_request, [&]
+        {
+            for(long i = 0; i < requests; ++i){
+                bench::do_not_optimize(request(std::allocator_arg, nullptr, n).execute());
+            }
+        });
+
+        r.measure("request/new_delete" + suffix, requests * per_request, [&]
+        {
+            for(long i = 0; i < requests; ++i){
+                bench::do_not_optimize(request(std::allocator_arg, std::pmr::new_delete_resource(), n).execute());
+            }
+        });
+
+        alignas(std::max_align_t) static std::byte buffer[32 * 1024];
+        r.measure("request/monotonic" + suffix, requests * per_request, [&]
+        {
+            std::pmr::monotonic_buffer_resource arena(buffer, sizeof buffer);
+            for(long i = 0; i < requests; ++i){
+                bench::do_not_optimize(request(std::allocator_arg, &arena, n).execute());
+                arena.release();
+            }
+        });
+    }
+    return 0;
+}
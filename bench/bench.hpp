@@ -0,0 +1,108 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Minimal benchmark harness shared by the programs in bench/
+//
+// Every benchmark binary reports one row per case:
+//
+//   commit,impl,case,iterations,ns_per_op
+//
+// either as CSV (--format=csv, the default) or as JSON Lines (--format=json),
+// so the output of several binaries and several commits can simply be
+// concatenated and compared. Each case is repeated (--repetitions=N, default 5)
+// and the median is reported.
+//
+// This header must not include defs.hpp: bench/native.cpp uses it together
+// with the real <coroutine> header.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace bench
+{
+    // Keep the optimiser from discarding a computed value.
+    template<typename T> inline void do_not_optimize(const T & value)
+    {
+        asm volatile("" : : "r,m"(value) : "memory");
+    }
+
+    class reporter
+    {
+        private:
+            std::string impl_;
+            std::string commit_      = "unknown";
+            bool        json_        = false;
+            int         repetitions_ = 5;
+
+        public:
+            reporter(int argc, char *argv[], std::string impl)
+                : impl_(std::move(impl))
+            {
+                bool header = false;
+                for(int i = 1; i < argc; ++i){
+                    const std::string_view arg = argv[i];
+
+                    if     (arg == "--format=json"          ){ json_ = true;                                        }
+                    else if(arg == "--format=csv"           ){ json_ = false;                                       }
+                    else if(arg == "--header"               ){ header = true;                                       }
+                    else if(arg.starts_with("--commit=")     ){ commit_ = arg.substr(9);                            }
+                    else if(arg.starts_with("--repetitions=")){ repetitions_ = std::max(1, std::atoi(argv[i] + 14)); }
+                }
+
+                if(header && !json_){
+                    std::printf("commit,impl,case,iterations,ns_per_op\n");
+                }
+            }
+
+        public:
+            // `fn()` performs `ops` operations itself.
+            template<typename Fn> void measure(std::string_view name, long ops, Fn && fn)
+            {
+                std::vector<double> samples;
+                samples.reserve(repetitions_);
+
+                for(int r = 0; r < repetitions_; ++r){
+                    const auto start = std::chrono::steady_clock::now();
+                    fn();
+                    const auto stop = std::chrono::steady_clock::now();
+                    samples.push_back(std::chrono::duration<double, std::nano>(stop - start).count() / ops);
+                }
+
+                std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+                emit(name, ops, samples[samples.size() / 2]);
+            }
+
+            // `fn()` performs one operation, called `iterations` times after a short warm-up.
+            template<typename Fn> void run(std::string_view name, long iterations, Fn && fn)
+            {
+                for(long i = 0; i < iterations / 10; ++i){
+                    fn();
+                }
+
+                measure(name, iterations, [&]
+                {
+                    for(long i = 0; i < iterations; ++i){
+                        fn();
+                    }
+                });
+            }
+
+            // Report a value the caller measured itself.
+            void emit(std::string_view name, long iterations, double ns_per_op)
+            {
+                if(json_){
+                    std::printf("{\"commit\":\"%s\",\"impl\":\"%s\",\"case\":\"%.*s\",\"iterations\":%ld,\"ns_per_op\":%.3f}\n",
+                            commit_.c_str(), impl_.c_str(), static_cast<int>(name.size()), name.data(), iterations, ns_per_op);
+                }
+                else{
+                    std::printf("%s,%s,%.*s,%ld,%.3f\n",
+                            commit_.c_str(), impl_.c_str(), static_cast<int>(name.size()), name.data(), iterations, ns_per_op);
+                }
+                std::fflush(stdout);
+            }
+    };
+}
@@ -0,0 +1,84 @@
+// Throughput of channel<long, 64> between produce() and consume() tasks on a
+// thread_pool (pipeline.cpp).
+//
+//   1x1/recv/threads=T        - one producer, one consumer taking a value per
+//                               co_await ch.recv()
+//   1x1/recv_many/threads=T   - the same, the consumer taking up to 16 values
+//                               per co_await ch.recv_many(batch)
+//   4x4/.../threads=T         - four producers and four consumers on one channel
+//   queue/uncontended         - a send and a recv that don't suspend, on one thread
+//
+// ns_per_op is per value sent. --threads=N sets the largest pool size
+// (default: hardware_concurrency()).
+
+#include <thread>
+#include "bench.hpp"
+#include "../pipeline.hpp"
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+
+    unsigned max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for(int i = 1; i < argc; ++i){
+        if(std::string_view(argv[i]).starts_with("--threads=")){
+            max_threads = std::max(std::atoi(argv[i] + 10), 1);
+        }
+    }
+
+    constexpr long iterations = 10'000'000;
+    constexpr long values     = 1'000'000;
+
+    {
+        thread_pool  pool(1);
+        pipe_channel ch(pool);
+        long         v = 0;
+        r.run("queue/uncontended", iterations, [&]
+        {
+            auto send = ch.send(v);
+            auto recv = ch.recv();
+            bench::do_not_optimize(send.await_ready());
+            bench::do_not_optimize(recv.await_ready());
+            v = *recv.await_resume();
+        });
+    }
+
+    for(unsigned threads = 1;; threads = std::min(threads * 2, max_threads)){
+        const std::string suffix = "/threads=" + std::to_string(threads);
+        thread_pool pool(threads);
+
+        for(int tasks: {1, 4}){
+            for(bool batched: {false, true}){
+                const std::string name = std::to_string(tasks) + "x" + std::to_string(tasks) + (batched ? "/recv_many" : "/recv") + suffix;
+
+                std::atomic<long> total {0};
+                bool              lost  = false;
+                r.measure(name, values, [&]
+                {
+                    pipe_channel     ch(pool);
+                    std::atomic<int> producers {tasks};
+
+                    total.store(0, std::memory_order_relaxed);
+                    for(int i = 0; i < tasks; ++i){
+                        pool.spawn(batched ? consume_batched(ch, total) : consume(ch, total));
+                    }
+                    for(int i = 0; i < tasks; ++i){
+                        pool.spawn(produce(ch, producers, i * (values / tasks), values / tasks));
+                    }
+                    pool.wait_idle();
+
+                    lost |= total.load(std::memory_order_relaxed) != values * (values - 1) / 2;
+                });
+                if(lost){
+                    std::fprintf(stderr, "%s: values were lost or duplicated\n", name.c_str());
+                    return 1;
+                }
+            }
+        }
+
+        if(threads == max_threads){
+            break;
+        }
+    }
+    return 0;
+}
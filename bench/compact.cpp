@@ -0,0 +1,116 @@
+// Classic vs compact frames ("Compact frames" in defs.hpp): the same coroutine,
+// park(e, x) and park_compact(e, x) (park.cpp), parked a million times on an
+// async_event.
+//
+//   classic/start, compact/start       - call the ramp and resume the frame
+//                                        until it parks on the event
+//   classic/resume, compact/resume     - e.set(): resume every frame through
+//                                        coroutine_handle<>::resume() up to
+//                                        its final suspend-point
+//   classic/destroy, compact/destroy   - destroy the finished frames
+//
+// ns_per_op is per frame. The heap each layout takes per frame (the frame, the
+// frame allocator's and malloc's headers, as mallinfo2() counts it) and the
+// difference per million frames go to stderr. --frames=N sets the count
+// (default 1000000).
+
+#include <malloc.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <vector>
+#include "bench.hpp"
+#include "../park.hpp"
+
+#ifndef CORO_COMPACT_FRAMES
+#error "bench/compact.cpp needs -DCORO_COMPACT_FRAMES"
+#endif
+
+namespace
+{
+    std::size_t heap_in_use()
+    {
+        return mallinfo2().uordblks;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+
+    long frames = 1'000'000;
+    for(int i = 1; i < argc; ++i){
+        if(std::string_view(argv[i]).starts_with("--frames=")){
+            frames = std::max(std::atol(argv[i] + 9), 1l);
+        }
+    }
+
+    // The first round grows the heap, which takes longer than the frames
+    // themselves. Keep what it freed for the rounds that are reported.
+    mallopt(M_TRIM_THRESHOLD, std::numeric_limits<int>::max());
+    bool warming_up = true;
+
+    auto phase = [&](std::string_view name, auto && fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto stop = std::chrono::steady_clock::now();
+        if(!warming_up){
+            r.emit(name, frames, std::chrono::duration<double, std::nano>(stop - start).count() / frames);
+        }
+    };
+
+    // Returns the heap bytes per parked frame.
+    auto layout = [&](std::string_view name, task<int> (*coroutine)(async_event &, int)) -> double
+    {
+        async_event                          e;
+        std::vector<task<int>>               tasks;
+        std::vector<std::coroutine_handle<>> handles;
+        tasks  .reserve(frames);
+        handles.reserve(frames);
+
+        const std::size_t before = heap_in_use();
+        phase(std::string(name) + "/start", [&]
+        {
+            for(long i = 0; i < frames; ++i){
+                tasks.push_back(coroutine(e, static_cast<int>(i)));
+                handles.push_back(std::move(tasks.back()).operator co_await().start(std::noop_coroutine(), {}, nullptr, nullptr));
+                handles.back().resume();
+            }
+        });
+        const std::size_t parked = heap_in_use();
+
+        phase(std::string(name) + "/resume", [&]
+        {
+            e.set();
+        });
+
+        long done = 0;
+        for(std::coroutine_handle<> h: handles){
+            done += h.done();
+        }
+        if(done != frames){
+            std::fprintf(stderr, "%.*s: %ld of %ld frames finished\n", static_cast<int>(name.size()), name.data(), done, frames);
+            std::exit(1);
+        }
+
+        phase(std::string(name) + "/destroy", [&]
+        {
+            tasks.clear();
+        });
+
+        return double(parked - before) / frames;
+    };
+
+    layout("classic", &park);
+    warming_up = false;
+
+    const double classic = layout("classic", &park);
+    const double compact = layout("compact", &park_compact);
+
+    std::fprintf(stderr, "frame size: classic %zu, compact %zu bytes\n", sizeof(__park_state), sizeof(__park_compact_state));
+    std::fprintf(stderr, "heap per frame: classic %.1f, compact %.1f bytes\n", classic, compact);
+    std::fprintf(stderr, "saved per million frames: %.2f MiB\n", (classic - compact) * 1e6 / (1 << 20));
+    return 0;
+}
@@ -0,0 +1,37 @@
+// Coroutine-local context (context.hpp): what inheriting it costs.
+//
+//   chain/depth=D           - chain(D).execute(), D + 1 frames, no context
+//   tagged/depth=D          - tagged(D).execute() with a context on the root:
+//                             the same frames, every co_await copies the
+//                             pointer and the leaf reads the request id
+//                             through its own promise
+
+#include "bench.hpp"
+#include "../chain.hpp"
+#include "../tagged.hpp"
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+    constexpr long iterations = 2'000'000;
+
+    task_context context;
+    context.request_id = 42;
+
+    for(int depth: {1, 8}){
+        const std::string suffix = "/depth=" + std::to_string(depth);
+
+        r.run("chain" + suffix, iterations, [&]
+        {
+            bench::do_not_optimize(chain(depth).execute());
+        });
+
+        r.run("tagged" + suffix, iterations, [&]
+        {
+            task<std::uint64_t> t = tagged(depth);
+            t.set_context(&context);
+            bench::do_not_optimize(t.execute());
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,70 @@
+// Hardware performance counters per coroutine type and suspend-point
+// (perf_counters.hpp), built with -DCORO_PERF_COUNTERS:
+//
+//   make counters                    # $(BENCH_DIR)/counters.txt
+//   build/bench/counters out.txt [iterations]
+//
+// Runs each workload once to warm up, drops the rows, runs them `iterations`
+// times (10000 by default) and writes the report:
+//
+//   g(x)                 - g -> f -> g by symmetric transfer
+//   chain(8)             - 9 nested frames
+//   iota(64)             - a generator resumed once per value
+//   sum_all(hop(pool))   - when_all over 16 children that each hop through the
+//                          pool, so their rows are summed over the workers
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "../chain.hpp"
+#include "../g.hpp"
+#include "../gather.hpp"
+#include "../hop.hpp"
+#include "../iota.hpp"
+#include "../perf_counters.hpp"
+
+#ifndef CORO_PERF_COUNTERS
+#error "bench/counters.cpp needs -DCORO_PERF_COUNTERS"
+#endif
+
+int main(int argc, char *argv[])
+{
+    const char * path       = argc > 1 ? argv[1] : "counters.txt";
+    const int    iterations = argc > 2 ? std::atoi(argv[2]) : 10000;
+
+    thread_pool pool(std::max(std::thread::hardware_concurrency(), 2u));
+
+    long result = 0;
+    auto run = [&]
+    {
+        result += g(1).execute();
+        result += chain(8).execute();
+        for(int i: iota(64)){
+            result += i;
+        }
+
+        std::vector<task<int>> calls;
+        for(int i = 0; i < 16; ++i){
+            calls.push_back(hop(pool, 2));
+        }
+        pool.spawn(sum_all(std::move(calls)));
+        pool.wait_idle();
+    };
+
+    run();
+    perf_counters::clear();
+    for(int i = 0; i < iterations; ++i){
+        run();
+    }
+
+    std::ofstream out(path);
+    perf_counters::write_report(out);
+    perf_counters::write_report(std::cout);
+    if(!out){
+        std::fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    std::printf("%ld, report written to %s\n", result, path);
+    return 0;
+}
@@ -0,0 +1,120 @@
+// Resume dispatch of a coroutine with 16 suspend-points: the __suspend_point
+// switch of steps.cpp against the per-suspend-point entry points of
+// steps_direct.cpp. ns_per_op is per resume. Also built with
+// -DCORO_COMPACT_FRAMES (lowered-compact), for what telling the two frame
+// layouts apart costs a classic frame's resume.
+//
+//   dispatch/sequential/*   - one coroutine driven from start to finish, so
+//                             consecutive resumes hit suspend-points in order
+//   dispatch/interleaved/*  - 1024 live coroutines resumed in random order,
+//                             so every resume lands on an unpredictable
+//                             suspend-point
+
+#include <cstdio>
+#include <vector>
+#include "bench.hpp"
+#include "../steps_direct.hpp"
+
+#ifdef CORO_COMPACT_FRAMES
+static constexpr const char *impl = "lowered-compact";
+#else
+static constexpr const char *impl = "lowered";
+#endif
+
+namespace
+{
+    using ramp_t = task<int> (*)(int, std::coroutine_handle<> *);
+
+    // A started steps() coroutine, parked at one of its suspend-points.
+    struct running
+    {
+        std::coroutine_handle<>                        slot;
+        task<int>                                      t;
+        task<int>::awaiter                             awaiter;
+        std::coroutine_handle<task<int>::promise_type> coro;
+
+        running(ramp_t ramp, int x)
+            : t(ramp(x, &slot))
+            , awaiter(std::move(t).operator co_await())
+            , coro(awaiter.await_suspend(std::noop_coroutine()))
+        {
+            coro.resume();
+        }
+
+        running            (const running &) = delete;
+        running & operator=(const running &) = delete;
+    };
+
+    constexpr long resumes_per_coroutine = 17;
+
+    int run(ramp_t ramp, int x)
+    {
+        running c(ramp, x);
+        while(!c.coro.done()){
+            c.slot.resume();
+        }
+        return c.awaiter.await_resume();
+    }
+
+    void sequential(bench::reporter & r, const char * name, ramp_t ramp, long iterations)
+    {
+        int x = 0;
+        r.measure(name, iterations * resumes_per_coroutine, [&]
+        {
+            for(long i = 0; i < iterations; ++i){
+                running c(ramp, ++x);
+                while(!c.coro.done()){
+                    c.slot.resume();
+                }
+                bench::do_not_optimize(c.awaiter.await_resume());
+            }
+        });
+    }
+
+    void interleaved(bench::reporter & r, const char * name, ramp_t ramp, long resumes)
+    {
+        constexpr std::size_t live = 1024;
+
+        r.measure(name, resumes, [&]
+        {
+            std::vector<std::unique_ptr<running>> coros;
+            for(std::size_t i = 0; i < live; ++i){
+                coros.push_back(std::make_unique<running>(ramp, static_cast<int>(i)));
+            }
+
+            std::uint64_t rng = 0x9e3779b97f4a7c15ull;
+            for(long i = 0; i < resumes; ++i){
+                rng ^= rng << 13;
+                rng ^= rng >> 7;
+                rng ^= rng << 17;
+
+                auto & c = coros[rng % live];
+                c->slot.resume();
+
+                if(c->coro.done()){
+                    bench::do_not_optimize(c->awaiter.await_resume());
+                    c = std::make_unique<running>(ramp, static_cast<int>(i));
+                }
+            }
+        });
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, impl);
+    constexpr long iterations = 500'000;
+
+    for(int x = -100; x < 100; ++x){
+        if(run(&steps, x) != run(&steps_direct, x)){
+            std::fprintf(stderr, "steps(%d) and steps_direct(%d) differ\n", x, x);
+            return 1;
+        }
+    }
+
+    sequential (r, "dispatch/sequential/switch" , &steps       , iterations);
+    sequential (r, "dispatch/sequential/direct" , &steps_direct, iterations);
+    interleaved(r, "dispatch/interleaved/switch", &steps       , iterations * resumes_per_coroutine);
+    interleaved(r, "dispatch/interleaved/direct", &steps_direct, iterations * resumes_per_coroutine);
+    return 0;
+}
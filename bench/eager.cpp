@@ -0,0 +1,93 @@
+// Synchronous completion of an eager_task (lookup.cpp) against lazy tasks.
+//
+//   execute_f               - f(x).execute(): one lazy frame, resumed once
+//   execute_lookup/hit      - lookup(...).execute() on a hit: ramp, body and
+//                             final suspend in one go, the result is read out
+//   execute_g               - g(x).execute(): the lazy f(x) costs a suspend of g,
+//                             a transfer g -> f and one back f -> g (f's frame
+//                             is embedded in g's)
+//   chain/depth=1           - the same with two allocated frames
+//   execute_cached_square/hit
+//                           - cached_square(...).execute() on a hit: the same
+//                             two frames as execute_g, but the co_await takes
+//                             the non-suspending branch
+//   pool/cached_square/hit=P%
+//                           - detached cached_square() tasks on a 1-thread pool
+//                             with P% hits, a miss continues lookup() on the
+//                             pool and resumes cached_square from there
+//
+// The synchronous cases check every result against x, x * x or 1; the pool
+// case then awaits a hit and a miss through sync_wait() and checks those.
+
+#include <cstdio>
+#include <vector>
+#include "bench.hpp"
+#include "../chain.hpp"
+#include "../g.hpp"
+#include "../lookup.hpp"
+#include "../sync_wait.hpp"
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+    constexpr long iterations = 5'000'000;
+    constexpr long tasks      = 200'000;
+
+    std::vector<int> cache(256);
+    for(std::size_t i = 0; i < cache.size(); ++i){
+        cache[i] = static_cast<int>(i);
+    }
+
+    thread_pool pool(1);
+
+    int x = 0;
+    bool wrong = false;
+    r.run("execute_f", iterations, [&]
+    {
+        const int key = ++x & 0xff;
+        wrong |= f(key).execute() != key;
+    });
+
+    r.run("execute_lookup/hit", iterations, [&]
+    {
+        const int key = ++x & 0xff;
+        wrong |= lookup(cache, pool, key).execute() != key;
+    });
+
+    r.run("execute_g", iterations, [&]
+    {
+        const int key = ++x & 0xff;
+        wrong |= g(key).execute() != key * key;
+    });
+
+    r.run("chain/depth=1", iterations, [&]
+    {
+        wrong |= chain(1).execute() != 1;
+    });
+
+    r.run("execute_cached_square/hit", iterations, [&]
+    {
+        const int key = ++x & 0xff;
+        wrong |= cached_square(cache, pool, key).execute() != key * key;
+    });
+    if(wrong){
+        std::fprintf(stderr, "execute: a task returned the wrong value\n");
+        return 1;
+    }
+
+    for(int hits: {100, 90, 0}){
+        r.measure("pool/cached_square/hit=" + std::to_string(hits) + "%", tasks, [&]
+        {
+            for(long i = 0; i < tasks; ++i){
+                const bool hit = i % 100 < hits;
+                pool.spawn(cached_square(cache, pool, hit ? static_cast<int>(i & 0xff) : 256));
+            }
+            pool.wait_idle();
+        });
+    }
+    if(sync_wait(cached_square(cache, pool, 7)) != 49 || sync_wait(cached_square(cache, pool, 256)) != 256 * 256){
+        std::fprintf(stderr, "pool/cached_square: a hit or a miss returned the wrong value\n");
+        return 1;
+    }
+    return 0;
+}
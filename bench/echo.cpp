@@ -0,0 +1,100 @@
+// Loopback TCP echo through the epoll reactor, server and clients on one thread.
+//
+// C connections each send R requests of 64 bytes and wait for the echo before
+// sending the next one (see echo.cpp for the coroutines).
+//
+//   echo/conns=C          - ns_per_op is the wall time per request, i.e.
+//                           1e9 / requests-per-second
+//   echo/conns=C/p50      - median round-trip latency of one request in ns
+//   echo/conns=C/p99      - 99th percentile round-trip latency in ns
+//
+// A human-readable summary with requests/sec goes to stderr.
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <cstdint>
+#include <string>
+#include "bench.hpp"
+#include "../echo.hpp"
+
+namespace
+{
+    int listen_loopback(sockaddr_in & addr)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+
+        addr = {};
+        addr.sin_family      = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port        = 0;
+
+        socklen_t len = sizeof addr;
+        if(fd < 0
+                || ::bind(fd, reinterpret_cast<sockaddr *>(&addr), sizeof addr) < 0
+                || ::listen(fd, SOMAXCONN) < 0
+                || ::getsockname(fd, reinterpret_cast<sockaddr *>(&addr), &len) < 0){
+            std::perror("listen");
+            std::exit(1);
+        }
+        return fd;
+    }
+
+    // The listen backlog completes the handshake, so a blocking connect returns
+    // right away even though the server only accepts once the reactor runs.
+    int connect_loopback(const sockaddr_in & addr)
+    {
+        int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr *>(&addr), sizeof addr) < 0){
+            std::perror("connect");
+            std::exit(1);
+        }
+        return fd;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+    constexpr long total_requests = 200'000;
+
+    for(int conns: {1, 16, 64}){
+        const int requests = static_cast<int>(total_requests / conns);
+        std::vector<std::int64_t> latencies(static_cast<std::size_t>(conns) * requests);
+
+        reactor io;
+        sockaddr_in addr;
+        async_fd listener(io, listen_loopback(addr));
+
+        io.spawn(echo_server(listener, conns));
+        for(int c = 0; c < conns; ++c){
+            io.spawn(echo_client(async_fd(io, connect_loopback(addr)), requests, latencies.data() + static_cast<std::size_t>(c) * requests));
+        }
+
+        const auto start = std::chrono::steady_clock::now();
+        io.run();
+        const auto stop = std::chrono::steady_clock::now();
+
+        const long   n       = static_cast<long>(latencies.size());
+        const double elapsed = std::chrono::duration<double, std::nano>(stop - start).count();
+
+        auto percentile = [&](double p)
+        {
+            auto at = latencies.begin() + static_cast<long>(p * (n - 1));
+            std::nth_element(latencies.begin(), at, latencies.end());
+            return static_cast<double>(*at);
+        };
+        const double p50 = percentile(0.50);
+        const double p99 = percentile(0.99);
+
+        const std::string name = "echo/conns=" + std::to_string(conns);
+        r.emit(name,          n, elapsed / n);
+        r.emit(name + "/p50", n, p50);
+        r.emit(name + "/p99", n, p99);
+
+        std::fprintf(stderr, "echo conns=%d: %.0f requests/s, p50 %.1f us, p99 %.1f us\n",
+                conns, n * 1e9 / elapsed, p50 / 1e3, p99 / 1e3);
+    }
+    return 0;
+}
@@ -0,0 +1,65 @@
+// Cost of failing, with exceptions and in exception-free mode.
+//
+// checked_square(x).execute() where the awaited checked(x) fails for negative
+// x, so a failure crosses two frames: the leaf reports it, the parent passes
+// it on, the caller observes it.
+//
+//   errors/fail=0       - the error-free path
+//   errors/fail=1/16    - every 16th call fails
+//   errors/fail=1       - every call fails
+//
+// `make bench` builds this twice: as is (throw, catch(...) in both frames,
+// std::rethrow_exception in both awaiters) and with -fno-exceptions, where the
+// error_code is stored in the promise and checked after every co_await.
+
+#include <string>
+#include "bench.hpp"
+#include "../checked.hpp"
+
+#ifdef CORO_NO_EXCEPTIONS
+static constexpr const char *impl = "lowered-no-exceptions";
+#else
+static constexpr const char *impl = "lowered";
+#endif
+
+namespace
+{
+    // Returns the result of checked_square(x), or -1 if it failed.
+    int run_checked_square(int x)
+    {
+#ifdef CORO_NO_EXCEPTIONS
+        auto result = checked_square(x).try_execute();
+        return result ? *result : -1;
+#else
+        try{
+            return checked_square(x).execute();
+        }
+        catch(const std::system_error &){
+            return -1;
+        }
+#endif
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, impl);
+    constexpr long iterations = 2'000'000;
+
+    struct fail_rate
+    {
+        const char *name;
+        int         mask;   // call i fails when (i & mask) == 0, -1 never fails
+    };
+
+    for(fail_rate rate: {fail_rate{"0", -1}, fail_rate{"1/16", 15}, fail_rate{"1", 0}}){
+        int i = 0;
+        r.run(std::string("errors/fail=") + rate.name, iterations, [&]
+        {
+            ++i;
+            const bool fail = rate.mask >= 0 && (i & rate.mask) == 0;
+            bench::do_not_optimize(run_checked_square(fail ? -1 : (i & 0xff)));
+        });
+    }
+    return 0;
+}
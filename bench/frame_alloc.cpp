@@ -0,0 +1,71 @@
+// Compares the coroutine-frame allocation strategies on a tight `g(x).execute()` loop.
+//
+// The same source is built twice by `make bench`, once with the default
+// frame_allocator and once with -DCORO_NO_FRAME_ALLOCATOR so every frame goes
+// through the global operator new/delete.
+
+#include <thread>
+#include <vector>
+#include "bench.hpp"
+#include "../g.hpp"
+
+#ifdef CORO_NO_FRAME_ALLOCATOR
+static constexpr const char *impl = "lowered-global-new";
+#else
+static constexpr const char *impl = "lowered";
+#endif
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, impl);
+
+    constexpr long iterations = 5'000'000;
+    constexpr long batch      = 1'000;
+
+    // One g frame is allocated and freed per iteration, the awaited f is embedded in it.
+    int x = 0;
+    r.run("alloc/execute_loop", iterations, [&]
+    {
+        bench::do_not_optimize(g(++x & 0xff).execute());
+    });
+
+    // Keep a batch of suspended g frames alive before running them, so frees
+    // don't always hit the block that was allocated last.
+    r.measure("alloc/batched_execute", iterations, [&]
+    {
+        std::vector<task<int>> tasks;
+        tasks.reserve(batch);
+
+        for(long i = 0; i < iterations; i += batch){
+            for(long j = 0; j < batch; ++j){
+                tasks.push_back(g(static_cast<int>(j & 0xff)));
+            }
+            for(auto & t: tasks){
+                bench::do_not_optimize(t.execute());
+            }
+            tasks.clear();
+        }
+    });
+
+    // Frames are created on this thread and destroyed on another one, the
+    // frame_allocator returns them to their owner through the remote free-lists.
+    r.measure("alloc/cross_thread_free", iterations / 10, [&]
+    {
+        for(long i = 0; i < iterations / 10; i += batch){
+            std::vector<task<int>> tasks;
+            tasks.reserve(batch);
+
+            for(long j = 0; j < batch; ++j){
+                tasks.push_back(g(static_cast<int>(j & 0xff)));
+            }
+            std::thread([&]
+            {
+                for(auto & t: tasks){
+                    bench::do_not_optimize(t.execute());
+                }
+                tasks.clear();
+            }).join();
+        }
+    });
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Persistent frames (frame_region.hpp): restarting 1M in-flight workflows.
+//
+// Every journey() (journey.cpp) is three frames in the region: its own, the
+// leg() it awaits and the continuation spawn() gives it. Each phase runs once
+// over all of them, ns_per_op is per workflow.
+//
+//   region/spawn            - spawn() and resume every parked leg once: the
+//                             cost of rebuilding the workflows from scratch,
+//                             without whatever work they did to get there
+//   region/checkpoint       - stamp the type ids and msync() the file
+//   region/reopen           - unmap, then map the file again and restore the
+//                             function pointers: a restart without the exec
+//   region/finish           - resume the recovered legs until every journey
+//                             has finished
+//
+// The file goes to $TMPDIR (/tmp by default) and is removed afterwards.
+
+#include <unistd.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include "bench.hpp"
+#include "../journey.hpp"
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+    constexpr long workflows = 1'000'000;
+
+    const char * tmp = std::getenv("TMPDIR");
+    const std::string path = std::string(tmp != nullptr ? tmp : "/tmp") + "/frame_region." + std::to_string(::getpid());
+    std::remove(path.c_str());
+
+    auto phase = [&](std::string_view name, auto && fn)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        fn();
+        const auto stop = std::chrono::steady_clock::now();
+        r.emit(name, workflows, std::chrono::duration<double, std::nano>(stop - start).count() / workflows);
+    };
+
+    auto region = std::make_unique<frame_region>(path.c_str(), std::size_t(1) << 30);
+
+    phase("region/spawn", [&]
+    {
+        for(long i = 0; i < workflows; ++i){
+            region->spawn(journey(std::allocator_arg, region.get(), static_cast<int>(i)));
+        }
+        for(std::coroutine_handle<> h: region->take_parked()){
+            h.resume();
+        }
+    });
+
+    phase("region/checkpoint", [&]
+    {
+        bench::do_not_optimize(region->checkpoint());
+    });
+
+    phase("region/reopen", [&]
+    {
+        region.reset();
+        region = std::make_unique<frame_region>(path.c_str(), 0);
+    });
+
+    phase("region/finish", [&]
+    {
+        for(auto parked = region->take_parked(); !parked.empty(); parked = region->take_parked()){
+            for(std::coroutine_handle<> h: parked){
+                h.resume();
+            }
+        }
+    });
+
+    const std::size_t left = region->running();
+    region.reset();
+    std::remove(path.c_str());
+
+    if(left != 0){
+        std::fprintf(stderr, "%zu workflows did not finish\n", left);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,84 @@
+// generator<T> against a std::ranges pipeline over the same sequence.
+//
+// Sum of the squares of the even numbers in [0, n):
+//
+//   generator/n=N          - range-for over iota(n), one resume per element
+//   generator_batched/n=N  - range-for over iota_batched(n), one resume per 64
+//   ranges/n=N             - views::iota | views::filter | views::transform
+//
+// ns_per_op is per element of [0, n). The generator frame comes from the
+// frame_allocator, so after the first repetition no case touches malloc.
+// Every round's sum is checked against the ranges pipeline's.
+
+#include <cstdio>
+#include <ranges>
+#include <string>
+#include "bench.hpp"
+#include "../iota.hpp"
+
+namespace
+{
+    long sum_generator(generator<int> g)
+    {
+        long sum = 0;
+        for(int i: g){
+            if(i % 2 == 0){
+                sum += long(i) * i;
+            }
+        }
+        return sum;
+    }
+
+    long sum_ranges(int n)
+    {
+        long sum = 0;
+        for(long v: std::views::iota(0, n)
+                  | std::views::filter([](int i) { return i % 2 == 0; })
+                  | std::views::transform([](int i) { return long(i) * i; })){
+            sum += v;
+        }
+        return sum;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+    constexpr long elements = 4'000'000;
+
+    for(int n: {16, 1024, 1'000'000}){
+        const long rounds = elements / n;
+        const std::string suffix = "/n=" + std::to_string(n);
+
+        // Read back every round so the ranges sum is not folded at compile time.
+        volatile int bound = n;
+        const long expected = sum_ranges(n);
+        bool wrong = false;
+
+        r.measure("ranges" + suffix, rounds * n, [&]
+        {
+            for(long k = 0; k < rounds; ++k){
+                wrong |= sum_ranges(bound) != expected;
+            }
+        });
+
+        r.measure("generator" + suffix, rounds * n, [&]
+        {
+            for(long k = 0; k < rounds; ++k){
+                wrong |= sum_generator(iota(bound)) != expected;
+            }
+        });
+
+        r.measure("generator_batched" + suffix, rounds * n, [&]
+        {
+            for(long k = 0; k < rounds; ++k){
+                wrong |= sum_generator(iota_batched(bound)) != expected;
+            }
+        });
+        if(wrong){
+            std::fprintf(stderr, "n=%d: a sum differs from the ranges pipeline's %ld\n", n, expected);
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,72 @@
+// Cost of the hand-lowered coroutines, see bench/native.cpp for the same cases
+// compiled as real C++20 coroutines. Both are built and run by `make bench`,
+// this one also with -DCORO_TRACE (lowered-traced) for the cost of tracing.
+//
+//   ramp_destroy        - call the ramp of f(x) and destroy the suspended task
+//   execute_f           - ramp, resume, final suspend and destroy of f(x)
+//   execute_g           - g(x).execute(): adds one co_await with symmetric
+//                         transfer g -> f -> g
+//   sync_wait_g         - sync_wait(g(x)): the same finishing synchronously,
+//                         plus the sync_wait_frame handshake
+//   chain/depth=N       - chain(N).execute(): N+1 nested frames, N transfers
+//                         down and N back up
+//   frame_alloc/size=N  - allocate and free a coroutine frame of N bytes
+
+#include "bench.hpp"
+#include "../chain.hpp"
+#include "../g.hpp"
+#include "../sync_wait.hpp"
+
+#if defined(CORO_NO_FRAME_ALLOCATOR)
+static constexpr const char *impl = "lowered-global-new";
+#elif defined(CORO_TRACE)
+static constexpr const char *impl = "lowered-traced";
+#else
+static constexpr const char *impl = "lowered";
+#endif
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, impl);
+    constexpr long iterations = 5'000'000;
+
+    int x = 0;
+    r.run("ramp_destroy", iterations, [&]
+    {
+        auto t = f(++x & 0xff);
+        bench::do_not_optimize(t);
+    });
+
+    r.run("execute_f", iterations, [&]
+    {
+        bench::do_not_optimize(f(++x & 0xff).execute());
+    });
+
+    r.run("execute_g", iterations, [&]
+    {
+        bench::do_not_optimize(g(++x & 0xff).execute());
+    });
+
+    r.run("sync_wait_g", iterations, [&]
+    {
+        bench::do_not_optimize(sync_wait(g(++x & 0xff)));
+    });
+
+    for(int depth: {1, 8, 64, 512}){
+        r.run("chain/depth=" + std::to_string(depth), iterations / depth, [&]
+        {
+            bench::do_not_optimize(chain(depth).execute());
+        });
+    }
+
+    using frame_t = __coroutine_state_with_promise<task<int>::promise_type>;
+    for(std::size_t size: {64, 256}){
+        r.run("frame_alloc/size=" + std::to_string(size), iterations, [&]
+        {
+            void *p = frame_t::operator new(size);
+            bench::do_not_optimize(p);
+            frame_t::operator delete(p, size);
+        });
+    }
+    return 0;
+}
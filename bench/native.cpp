@@ -0,0 +1,192 @@
+// The coroutines of bench/lowered.cpp written with real co_await/co_return and
+// compiled natively. This file includes <coroutine> and therefore must never be
+// linked together with anything that includes defs.hpp.
+//
+// native::task<T> mirrors task<T> from defs.hpp: lazily started, symmetric
+// transfer to the continuation at the final suspend point, and the result
+// constructed in place in the promise.
+
+#include <coroutine>
+#include <exception>
+#include <memory>
+#include <utility>
+#include "bench.hpp"
+
+namespace native
+{
+    template<typename T> class task
+    {
+        public:
+            class promise_type
+            {
+                private:
+                    friend task;
+                    enum class result_state : unsigned char { empty, value, exception };
+
+                    std::coroutine_handle<> continuation_;
+                    result_state state_ = result_state::empty;
+                    union
+                    {
+                        T value_;
+                        std::exception_ptr exception_;
+                    };
+
+                public:
+                    /**/  promise_type() noexcept {}
+                    /**/ ~promise_type()
+                    {
+                        switch(state_){
+                            case result_state::value    : std::destroy_at(std::addressof(value_    )); break;
+                            case result_state::exception: std::destroy_at(std::addressof(exception_)); break;
+                            default                     :                                              break;
+                        }
+                    }
+
+                public:
+                    struct final_awaiter
+                    {
+                        bool                    await_ready  ()                                      noexcept { return false; }
+                        std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept { return h.promise().continuation_; }
+                        void                    await_resume ()                                      noexcept {}
+                    };
+
+                    task get_return_object() noexcept
+                    {
+                        return task{std::coroutine_handle<promise_type>::from_promise(*this)};
+                    }
+
+                    std::suspend_always initial_suspend() noexcept { return {}; }
+                    final_awaiter         final_suspend() noexcept { return {}; }
+
+                    template<typename U> void return_value(U && value)
+                    {
+                        ::new (static_cast<void *>(std::addressof(value_))) T(std::forward<U>(value));
+                        state_ = result_state::value;
+                    }
+
+                    void unhandled_exception() noexcept
+                    {
+                        ::new (static_cast<void *>(std::addressof(exception_))) std::exception_ptr(std::current_exception());
+                        state_ = result_state::exception;
+                    }
+            };
+
+        private:
+            std::coroutine_handle<promise_type> coro_;
+
+            explicit task(std::coroutine_handle<promise_type> h) noexcept
+                : coro_(h)
+            {}
+
+        public:
+            task(task && t) noexcept
+                : coro_(std::exchange(t.coro_, {}))
+            {}
+
+            ~task()
+            {
+                if(coro_){
+                    coro_.destroy();
+                }
+            }
+
+        public:
+            struct awaiter
+            {
+                std::coroutine_handle<promise_type> coro_;
+
+                bool await_ready() noexcept
+                {
+                    return false;
+                }
+
+                std::coroutine_handle<promise_type> await_suspend(std::coroutine_handle<> h) noexcept
+                {
+                    coro_.promise().continuation_ = h;
+                    return coro_;
+                }
+
+                T await_resume()
+                {
+                    if(coro_.promise().state_ != promise_type::result_state::value) [[unlikely]] {
+                        std::rethrow_exception(coro_.promise().exception_);
+                    }
+                    return std::move(coro_.promise().value_);
+                }
+            };
+
+            awaiter operator co_await() && noexcept
+            {
+                return awaiter{coro_};
+            }
+
+            T execute()
+            {
+                awaiter{coro_}.await_suspend(std::noop_coroutine());
+                coro_.resume();
+                return awaiter{coro_}.await_resume();
+            }
+    };
+
+    [[gnu::noinline]] task<int> f(int x)
+    {
+        co_return x;
+    }
+
+    [[gnu::noinline]] task<int> g(int x)
+    {
+        int fx = co_await f(x);
+        co_return fx * fx;
+    }
+
+    [[gnu::noinline]] task<int> chain(int n)
+    {
+        if(n == 0){
+            co_return 0;
+        }
+        int r = co_await chain(n - 1);
+        co_return r + 1;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "native");
+    constexpr long iterations = 5'000'000;
+
+    int x = 0;
+    r.run("ramp_destroy", iterations, [&]
+    {
+        auto t = native::f(++x & 0xff);
+        bench::do_not_optimize(t);
+    });
+
+    r.run("execute_f", iterations, [&]
+    {
+        bench::do_not_optimize(native::f(++x & 0xff).execute());
+    });
+
+    r.run("execute_g", iterations, [&]
+    {
+        bench::do_not_optimize(native::g(++x & 0xff).execute());
+    });
+
+    for(int depth: {1, 8, 64, 512}){
+        r.run("chain/depth=" + std::to_string(depth), iterations / depth, [&]
+        {
+            bench::do_not_optimize(native::chain(depth).execute());
+        });
+    }
+
+    // Without a promise operator new the compiler allocates frames with the
+    // global operator new.
+    for(std::size_t size: {64, 256}){
+        r.run("frame_alloc/size=" + std::to_string(size), iterations, [&]
+        {
+            void *p = ::operator new(size);
+            bench::do_not_optimize(p);
+            ::operator delete(p, size);
+        });
+    }
+    return 0;
+}
@@ -0,0 +1,86 @@
+// Async stack traces and the SIGPROF profiler of async_stack.hpp, built with
+// -DCORO_ASYNC_STACKS:
+//
+//   make profile                     # $(BENCH_DIR)/profile.folded
+//   build/bench/profile out.folded
+//
+// First prints the async stacks of two coroutines parked inside a when_all,
+// then samples sum_all() over hop(pool, n) children on a thread_pool for half a
+// second and writes the folded stacks, which flamegraph.pl or speedscope.app
+// render as a flame graph.
+
+#include <fstream>
+#include <iostream>
+#include <thread>
+#include "../async_stack.hpp"
+#include "../gather.hpp"
+#include "../hop.hpp"
+#include "../steps_direct.hpp"
+
+#ifndef CORO_ASYNC_STACKS
+#error "bench/profile.cpp needs -DCORO_ASYNC_STACKS"
+#endif
+
+int main(int argc, char *argv[])
+{
+    const char *path = argc > 1 ? argv[1] : "profile.folded";
+
+    {
+        std::coroutine_handle<> slots[2];
+        std::vector<task<int>> calls;
+        calls.push_back(steps(1, &slots[0]));
+        calls.push_back(steps_direct(2, &slots[1]));
+
+        task<long> t = sum_all(std::move(calls));
+        auto awaiter = std::move(t).operator co_await();
+        auto coro = awaiter.await_suspend(std::noop_coroutine());
+        coro.resume();
+
+        // Both park at every one of their 16 suspend-points.
+        for(int step = 0; step < 3; ++step){
+            slots[0].resume();
+        }
+
+        for(std::coroutine_handle<> h: slots){
+            async_stack::print(std::cout, h);
+            std::cout << '\n';
+        }
+
+        for(int step = 3; step < 16; ++step){
+            slots[0].resume();
+        }
+        for(int step = 0; step < 16; ++step){
+            slots[1].resume();
+        }
+        std::cout << "sum_all: " << (coro.done() ? awaiter.await_resume() : -1) << "\n\n";
+    }
+
+    const unsigned threads = std::max(std::thread::hardware_concurrency(), 2u);
+    thread_pool pool(threads);
+
+    async_profiler profiler;
+    if(!profiler.start(std::chrono::microseconds(200))){
+        return 1;
+    }
+
+    const auto until = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    while(std::chrono::steady_clock::now() < until){
+        std::vector<task<int>> calls;
+        for(int i = 0; i < 64; ++i){
+            calls.push_back(hop(pool, 16));
+        }
+        pool.spawn(sum_all(std::move(calls)));
+        pool.wait_idle();
+    }
+
+    profiler.stop();
+
+    std::ofstream out(path);
+    profiler.write_folded(out);
+    if(!out){
+        std::fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    std::printf("%zu samples written to %s\n", profiler.samples(), path);
+    return 0;
+}
@@ -0,0 +1,85 @@
+// Throughput of the work-stealing thread_pool from 1 to N worker threads.
+//
+//   pool/spawn_g/threads=T  - detached g(x) tasks spawned from outside the pool
+//   pool/hop/threads=T      - detached hop(pool, 64) tasks, each re-scheduling
+//                             itself 64 times through `co_await pool.schedule()`
+//   pool/cancel/threads=T   - endless hop() tasks sharing one cancellation token:
+//                             time from request_cancellation() until all of them
+//                             are destroyed, per task
+//   pool/sync_wait/threads=T
+//                           - sync_wait(hop(pool, 1)) from outside the pool:
+//                             the round trip to a worker and the futex wake-up
+//                             of the blocked caller
+//
+// --threads=N sets the largest pool size (default: hardware_concurrency()).
+
+#include <limits>
+#include <thread>
+#include "bench.hpp"
+#include "../hop.hpp"
+#include "../sync_wait.hpp"
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+
+    unsigned max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for(int i = 1; i < argc; ++i){
+        if(std::string_view(argv[i]).starts_with("--threads=")){
+            max_threads = std::max(std::atoi(argv[i] + 10), 1);
+        }
+    }
+
+    constexpr long tasks = 200'000;
+    constexpr int  hops  = 64;
+
+    for(unsigned threads = 1;; threads = std::min(threads * 2, max_threads)){
+        thread_pool pool(threads);
+
+        r.measure("pool/spawn_g/threads=" + std::to_string(threads), tasks, [&]
+        {
+            for(long i = 0; i < tasks; ++i){
+                pool.spawn(g(static_cast<int>(i & 0xff)));
+            }
+            pool.wait_idle();
+        });
+
+        r.measure("pool/hop/threads=" + std::to_string(threads), tasks / 10 * hops, [&]
+        {
+            for(long i = 0; i < tasks / 10; ++i){
+                pool.spawn(hop(pool, hops));
+            }
+            pool.wait_idle();
+        });
+
+        {
+            cancellation_source cancel;
+            for(long i = 0; i < tasks / 10; ++i){
+                auto t = hop(pool, std::numeric_limits<int>::max());
+                t.set_cancellation_token(cancel.token());
+                pool.spawn(std::move(t));
+            }
+
+            const auto start = std::chrono::steady_clock::now();
+            cancel.request_cancellation();
+            pool.wait_idle();
+            const auto stop = std::chrono::steady_clock::now();
+
+            r.emit("pool/cancel/threads=" + std::to_string(threads), tasks / 10,
+                    std::chrono::duration<double, std::nano>(stop - start).count() / (tasks / 10));
+        }
+
+        r.measure("pool/sync_wait/threads=" + std::to_string(threads), tasks / 10, [&]
+        {
+            sync_wait_frame frame;
+            for(long i = 0; i < tasks / 10; ++i){
+                bench::do_not_optimize(sync_wait(hop(pool, 1), frame));
+            }
+        });
+
+        if(threads == max_threads){
+            break;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,126 @@
+// Contention on async_mutex / async_semaphore from coroutines on a thread_pool.
+//
+//   mutex/uncontended              - try_lock() + unlock() on one thread
+//   mutex/contend/threads=T        - 256 contend() tasks on a T-worker pool, each
+//                                    taking the mutex 1000 times; waiters queue
+//                                    in their frames and unlock(pool) hands over
+//                                    by symmetric transfer
+//   std_mutex/threads=T            - the same number of increments by T threads
+//                                    under a std::mutex, for comparison
+//   semaphore/permits=P/threads=T  - 256 throttled() tasks, P holders at a time
+//
+// ns_per_op is per acquisition. --threads=N sets the largest pool size
+// (default: hardware_concurrency()). Every case checks that the counter it
+// guards saw each increment exactly once, and the semaphore cases that all the
+// permits are back afterwards.
+
+#include <cstdio>
+#include <mutex>
+#include <thread>
+#include "bench.hpp"
+#include "../contend.hpp"
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+
+    unsigned max_threads = std::max(std::thread::hardware_concurrency(), 1u);
+    for(int i = 1; i < argc; ++i){
+        if(std::string_view(argv[i]).starts_with("--threads=")){
+            max_threads = std::max(std::atoi(argv[i] + 10), 1);
+        }
+    }
+
+    constexpr long iterations = 10'000'000;
+    constexpr int  tasks      = 256;
+    constexpr int  per_task   = 1000;
+
+    {
+        async_mutex m;
+        r.run("mutex/uncontended", iterations, [&]
+        {
+            bench::do_not_optimize(m.try_lock());
+            m.unlock().resume();
+        });
+    }
+
+    for(unsigned threads = 1;; threads = std::min(threads * 2, max_threads)){
+        const std::string suffix = "/threads=" + std::to_string(threads);
+        thread_pool pool(threads);
+
+        async_mutex m;
+        long counter = 0;
+        bool lost    = false;
+        r.measure("mutex/contend" + suffix, long(tasks) * per_task, [&]
+        {
+            counter = 0;
+            for(int i = 0; i < tasks; ++i){
+                pool.spawn(contend(m, pool, counter, per_task));
+            }
+            pool.wait_idle();
+            lost |= counter != long(tasks) * per_task || !m.try_lock() || m.unlock() != std::noop_coroutine();
+        });
+        if(lost){
+            std::fprintf(stderr, "mutex/contend%s: increments were lost or the mutex is still held\n", suffix.c_str());
+            return 1;
+        }
+
+        std::mutex sm;
+        r.measure("std_mutex" + suffix, long(tasks) * per_task, [&]
+        {
+            counter = 0;
+            std::vector<std::thread> workers;
+            for(unsigned t = 0; t < threads; ++t){
+                workers.emplace_back([&]
+                {
+                    for(long i = 0; i < long(tasks) * per_task / threads; ++i){
+                        std::lock_guard lock(sm);
+                        ++counter;
+                    }
+                });
+            }
+            for(std::thread & w: workers){
+                w.join();
+            }
+            lost |= counter != long(threads) * (long(tasks) * per_task / threads);
+        });
+        if(lost){
+            std::fprintf(stderr, "std_mutex%s: increments were lost\n", suffix.c_str());
+            return 1;
+        }
+
+        for(unsigned permits: {1u, 4u, 16u}){
+            const std::string name = "semaphore/permits=" + std::to_string(permits) + suffix;
+
+            async_semaphore   s(permits);
+            std::atomic<long> acquired {0};
+            r.measure(name, long(tasks) * per_task, [&]
+            {
+                acquired.store(0, std::memory_order_relaxed);
+                for(int i = 0; i < tasks; ++i){
+                    pool.spawn(throttled(s, pool, acquired, per_task));
+                }
+                pool.wait_idle();
+
+                // Exactly `permits` left to take.
+                unsigned left = 0;
+                while(s.try_acquire()){
+                    ++left;
+                }
+                for(unsigned i = 0; i < left; ++i){
+                    lost |= !s.release().empty();
+                }
+                lost |= acquired.load(std::memory_order_relaxed) != long(tasks) * per_task || left != permits;
+            });
+            if(lost){
+                std::fprintf(stderr, "%s: acquisitions or permits were lost\n", name.c_str());
+                return 1;
+            }
+        }
+
+        if(threads == max_threads){
+            break;
+        }
+    }
+    return 0;
+}
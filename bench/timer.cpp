@@ -0,0 +1,120 @@
+// The timing wheel (timer.hpp) and with_timeout (nap.cpp for the coroutines).
+//
+//   timer/arm_cancel        - arm 1M timers with deadlines spread over a minute,
+//                             then cancel them, 10 rounds: 10M timers, the
+//                             life of a timeout that doesn't fire
+//   timer/arm_expire        - arm 1M timers spread over 64K ticks and advance a
+//                             synthetic clock tick by tick until all expired,
+//                             ns per timer including every cascade
+//   execute_nap             - nap(timers, 0).execute(): no sleep, the baseline
+//   execute_nap_within      - nap_within(timers, 0, 1000).execute(): the same
+//                             nap under with_timeout, whose timer is armed and
+//                             cancelled again
+//   reactor/nap_within=N    - N tasks spawned on a reactor, each naps 1-20 ms
+//                             under a 10 ms timeout, so about half time out;
+//                             ns per task, mostly the wall time of 20 ms
+//
+// Each case checks the wheel afterwards: no timer left armed, and for
+// arm_expire that every advance() expired exactly the timers due at that tick.
+
+#include <cstdio>
+#include <vector>
+#include "bench.hpp"
+#include "../nap.hpp"
+#include "../reactor.hpp"
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+    constexpr long timers     = 1'000'000;
+    constexpr long rounds     = 10;
+    constexpr long iterations = 5'000'000;
+    constexpr long naps       = 10'000;
+
+    using namespace std::chrono_literals;
+
+    std::vector<timer_node> nodes(timers);
+    const auto origin = timer_wheel::clock::now();
+
+    // A multiplicative hash spreads the deadlines over 64K values.
+    const auto spread = [](long i)
+    {
+        return static_cast<int>(static_cast<std::uint32_t>(i * 2654435761u) >> 16);
+    };
+
+    bool wrong = false;
+    r.measure("timer/arm_cancel", timers * rounds, [&]
+    {
+        timer_wheel wheel(1ms, origin);
+
+        for(long round = 0; round < rounds; ++round){
+            for(long i = 0; i < timers; ++i){
+                wheel.arm(nodes[i], origin + std::chrono::microseconds(spread(i)));
+            }
+            for(long i = 0; i < timers; ++i){
+                wheel.cancel(nodes[i]);
+            }
+        }
+        wrong |= wheel.size() != 0 || nodes[0].armed() || nodes[timers - 1].armed();
+    });
+    if(wrong){
+        std::fprintf(stderr, "timer/arm_cancel: timers still armed after cancel()\n");
+        return 1;
+    }
+
+    // How many timers each tick expires.
+    std::vector<std::size_t> due(1 << 16);
+    for(long i = 0; i < timers; ++i){
+        due[spread(i)]++;
+    }
+
+    r.measure("timer/arm_expire", timers, [&]
+    {
+        timer_wheel wheel(1ms, origin);
+
+        for(long i = 0; i < timers; ++i){
+            nodes[i].waiter = std::noop_coroutine();
+            wheel.arm(nodes[i], origin + 1ms * spread(i));
+        }
+
+        std::size_t tick = 0;
+        for(auto now = origin; wheel.size() != 0; now += 1ms, ++tick){
+            wrong |= tick >= due.size() || wheel.advance(now) != due[tick];
+        }
+        wrong |= tick != due.size();
+    });
+    if(wrong){
+        std::fprintf(stderr, "timer/arm_expire: a timer expired more than once or not at its tick\n");
+        return 1;
+    }
+
+    timer_wheel wheel;
+    r.run("execute_nap", iterations, [&]
+    {
+        wrong |= nap(wheel, 0).execute() != 0;
+    });
+
+    r.run("execute_nap_within", iterations, [&]
+    {
+        wrong |= nap_within(wheel, 0, 1000).execute() != 0;
+    });
+    if(wrong || wheel.size() != 0){
+        std::fprintf(stderr, "execute_nap: a wrong result, or a timer left armed\n");
+        return 1;
+    }
+
+    r.measure("reactor/nap_within=" + std::to_string(naps), naps, [&]
+    {
+        reactor loop;
+        for(long i = 0; i < naps; ++i){
+            loop.spawn(nap_within(loop.timers(), 1 + static_cast<int>(i % 20), 10));
+        }
+        loop.run();
+        wrong |= loop.timers().size() != 0;
+    });
+    if(wrong){
+        std::fprintf(stderr, "reactor/nap_within: a timer left armed\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,50 @@
+// Writes a Chrome trace of a few small workloads, built with -DCORO_TRACE:
+//
+//   make trace                       # $(BENCH_DIR)/trace.json
+//   build/bench/trace out.json
+//
+// and open the file in ui.perfetto.dev. The workloads:
+//
+//   g(x)                 - g -> f -> g by symmetric transfer on this thread
+//   chain(8)             - 9 nested frames
+//   sum_all(hop(pool))   - when_all over 16 children that each hop through the
+//                          pool, so their resume slices land on the workers
+
+#include <fstream>
+#include <thread>
+#include "../chain.hpp"
+#include "../g.hpp"
+#include "../gather.hpp"
+#include "../hop.hpp"
+
+#ifndef CORO_TRACE
+#error "bench/trace.cpp needs -DCORO_TRACE"
+#endif
+
+int main(int argc, char *argv[])
+{
+    const char *path = argc > 1 ? argv[1] : "trace.json";
+
+    int result = g(1).execute();
+    result += chain(8).execute();
+
+    {
+        thread_pool pool(std::max(std::thread::hardware_concurrency(), 2u));
+
+        std::vector<task<int>> calls;
+        for(int i = 0; i < 16; ++i){
+            calls.push_back(hop(pool, 2));
+        }
+        pool.spawn(sum_all(std::move(calls)));
+        pool.wait_idle();
+    }
+
+    std::ofstream out(path);
+    tracer::write_chrome_json(out);
+    if(!out){
+        std::fprintf(stderr, "cannot write %s\n", path);
+        return 1;
+    }
+    std::printf("%d, trace written to %s\n", result, path);
+    return 0;
+}
@@ -0,0 +1,105 @@
+// Fan-out / fan-in through when_all and when_any.
+//
+//   sequential/n=N            - f(i).execute() for each of N calls, the baseline
+//   when_all/n=N              - sum_all() over N f(i) calls that complete inline
+//   when_any/n=N              - first_of() over N f(i) calls: the first wins, the
+//                               other N-1 start cancelled and unwind at once
+//   when_all/pool/n=N/threads=T
+//                           - sum_all() over N hop(pool, 1) calls, each child
+//                             finishing on a worker, the last one resuming the
+//                             parent; 1000 of them in flight
+//
+// ns_per_op is per child task. Every case checks its results against the
+// sequential sum, and when_any that the first child won.
+
+#include <cstdio>
+#include <thread>
+#include "bench.hpp"
+#include "../gather.hpp"
+#include "../hop.hpp"
+#include "../sync_wait.hpp"
+
+int main(int argc, char *argv[])
+{
+    bench::reporter r(argc, argv, "lowered");
+    constexpr long children = 2'000'000;
+
+    for(int n: {4, 128, 1024}){
+        const long rounds = children / n;
+        const std::string suffix = "/n=" + std::to_string(n);
+
+        // f(i) returns i.
+        const long expected = long(n) * (n - 1) / 2;
+        bool       wrong    = false;
+
+        r.measure("sequential" + suffix, rounds * n, [&]
+        {
+            for(long k = 0; k < rounds; ++k){
+                long sum = 0;
+                for(int i = 0; i < n; ++i){
+                    sum += f(i).execute();
+                }
+                wrong |= sum != expected;
+            }
+        });
+
+        r.measure("when_all" + suffix, rounds * n, [&]
+        {
+            for(long k = 0; k < rounds; ++k){
+                std::vector<task<int>> calls;
+                calls.reserve(n);
+                for(int i = 0; i < n; ++i){
+                    calls.push_back(f(i));
+                }
+                wrong |= sum_all(std::move(calls)).execute() != expected;
+            }
+        });
+
+        r.measure("when_any" + suffix, rounds * n, [&]
+        {
+            for(long k = 0; k < rounds; ++k){
+                std::vector<task<int>> calls;
+                calls.reserve(n);
+                for(int i = 0; i < n; ++i){
+                    calls.push_back(f(i));
+                }
+                // f(0) completes as it starts, the others start cancelled.
+                wrong |= first_of(std::move(calls)).execute() != 0;
+            }
+        });
+
+        if(wrong){
+            std::fprintf(stderr, "n=%d: a result differs from the sequential run\n", n);
+            return 1;
+        }
+    }
+
+    const unsigned threads = std::max(std::thread::hardware_concurrency(), 1u);
+    thread_pool pool(threads);
+
+    constexpr int  n         = 128;
+    constexpr long in_flight = 1000;
+    r.measure("when_all/pool/n=" + std::to_string(n) + "/threads=" + std::to_string(threads), in_flight * n, [&]
+    {
+        for(long k = 0; k < in_flight; ++k){
+            std::vector<task<int>> calls;
+            calls.reserve(n);
+            for(int i = 0; i < n; ++i){
+                calls.push_back(hop(pool, 1));
+            }
+            pool.spawn(sum_all(std::move(calls)));
+        }
+        pool.wait_idle();
+    });
+
+    // hop(pool, 1) returns 1.
+    std::vector<task<int>> calls;
+    for(int i = 0; i < n; ++i){
+        calls.push_back(hop(pool, 1));
+    }
+    if(const long sum = sync_wait(sum_all(std::move(calls))); sum != n){
+        std::fprintf(stderr, "when_all/pool: sum %ld instead of %d\n", sum, n);
+        return 1;
+    }
+    return 0;
+}
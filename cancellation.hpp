@@ -0,0 +1,77 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Cooperative cancellation
+//
+// A cancellation_source owns one flag, its cancellation_tokens point at it.
+// A task carries a token in its promise and the task::awaiter hands it down
+// to every child it awaits, so a whole continuation chain shares one token and
+// cancelling a request is a single store. Checking is a single load: a token
+// that was never attached points at a flag that is never set, so there is no
+// null test either.
+//
+// The source must outlive every task holding one of its tokens, no reference
+// counting is done.
+
+#include<atomic>
+
+class cancellation_token;
+
+class cancellation_source
+{
+    private:
+        std::atomic<bool> requested_ {false};
+
+    public:
+        cancellation_source() noexcept = default;
+
+        cancellation_source            (const cancellation_source &) = delete;
+        cancellation_source & operator=(const cancellation_source &) = delete;
+
+    public:
+        // Callable from any thread, every holder of a token notices at its next check.
+        void request_cancellation() noexcept
+        {
+            requested_.store(true, std::memory_order_relaxed);
+        }
+
+        bool is_cancellation_requested() const noexcept
+        {
+            return requested_.load(std::memory_order_relaxed);
+        }
+
+        cancellation_token token() const noexcept;
+};
+
+class cancellation_token
+{
+    private:
+        friend class cancellation_source;
+
+        static constinit inline const std::atomic<bool> never_ {false};
+
+        const std::atomic<bool> * requested_ = &never_;
+
+        explicit cancellation_token(const std::atomic<bool> * requested) noexcept
+            : requested_(requested)
+        {}
+
+    public:
+        cancellation_token() noexcept = default;
+
+    public:
+        bool is_cancellation_requested() const noexcept
+        {
+            return requested_->load(std::memory_order_relaxed);
+        }
+
+        // False for a default-constructed token.
+        bool can_be_cancelled() const noexcept
+        {
+            return requested_ != &never_;
+        }
+};
+
+inline cancellation_token cancellation_source::token() const noexcept
+{
+    return cancellation_token{&requested_};
+}
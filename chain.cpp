@@ -0,0 +1,169 @@
+#include "chain.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of chain(int n)
+//
+// task<int> chain(int n) {
+//   if(n == 0) {
+//     co_return 0;
+//   }
+//   int r = co_await chain(n - 1);
+//   co_return r + 1;
+// }
+//
+// A chain of n + 1 nested frames: every level suspends into the next one via
+// symmetric transfer and is resumed by its final_awaiter on the way back up.
+// The recursion means the child frame can't be embedded, so each level is
+// allocated separately.
+
+/////
+// The "ramp" function
+
+task<int> chain(int n)
+{
+    std::unique_ptr<__chain_state> state(new __chain_state(static_cast<int &&>(n)));
+    return __ramp(std::move(state), &__chain_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __chain_cancellable = __cancellation_points<std::suspend_always, task<int>::awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__chain_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__chain_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __chain_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  if(n == 0) co_return 0;
+        if(state->n == 0){
+            state->__promise.return_value(0);
+            goto final_suspend;
+        }
+
+        //  int r = co_await chain(n - 1);
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return chain(state->n - 1);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            state->__tmp3().construct_from([&]()
+            {
+                return static_cast<task<int> &&>(state->__tmp2().get()).operator co_await();
+            });
+            destructor_guard tmp3_dtor{state->__tmp3()};
+
+            if(!state->__tmp3().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp3().get().await_suspend(std::coroutine_handle<__chain_promise_t>::from_promise(state->__promise));
+
+                tmp3_dtor.cancel();
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+
+            tmp3_dtor.cancel();
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        // The child was cancelled, see g.cpp.
+        if(state->__tmp3().get().cancelled()) [[unlikely]] {
+            return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+        }
+#ifdef CORO_NO_EXCEPTIONS
+        // The awaited task failed, see g.cpp.
+        if(std::error_code ec = state->__tmp3().get().error()) [[unlikely]] {
+            state->__tmp3().destroy();
+            state->__tmp2().destroy();
+            state->__promise.set_error(ec);
+            goto final_suspend;
+        }
+#endif
+        int r = [&]() -> decltype(auto)
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            destructor_guard tmp3_dtor{state->__tmp3()};
+            return state->__tmp3().get().await_resume();
+        }();
+
+        //  co_return r + 1;
+        state->__promise.return_value(r + 1);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp4(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __chain_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__chain_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp3().destroy();
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp4().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __chain_sites[] = {"initial suspend", "co_await chain(n - 1)", "final suspend"};
+static const lowered_frame_info<__chain_state> __chain_frame_info{&__chain_destroy, "chain(int n)", __chain_sites};
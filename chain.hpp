@@ -0,0 +1,53 @@
+#pragma once
+#include "defs.hpp"
+//////////////////////
+// Coroutine-state of chain(int n), see chain.cpp for the lowering.
+
+task<int> chain(int n);
+
+using __chain_promise_t = std::coroutine_traits<task<int>, int>::promise_type;
+
+__coroutine_state * __chain_resume (__coroutine_state *);
+void                __chain_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definition
+
+struct __chain_state : __coroutine_state_with_promise<__chain_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    int n;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                          // initial suspend
+        frame_scope<manual_lifetime<task<int>>,                                     // int r = co_await chain(n - 1);
+                    manual_lifetime<task<int>::awaiter>>,
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;      // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<1, 1>(); }
+    auto & __tmp4() noexcept { return __frame.get<2, 0>(); }
+
+    __chain_state(int && n)
+        : n(static_cast<int &&>(n))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __chain_resume;
+            this->__destroy = &__chain_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __chain_promise_t(construct_promise<__chain_promise_t>(this->n));
+    }
+
+    ~__chain_state()
+    {
+        this->__promise.~__chain_promise_t();
+    }
+};
@@ -0,0 +1,560 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// channel<T, N>: a bounded channel between coroutines on a thread_pool
+//
+//   channel<long, 64> ch(pool);
+//
+//   co_await ch.send(v);                               // producers
+//   ch.close();                                        // after the last send
+//
+//   std::optional<long> v = co_await ch.recv();        // consumers, nullopt
+//   std::size_t n = co_await ch.recv_many(batch);      // or 0 once closed and drained
+//
+// The values go through a ring of N cells, the bounded MPMC queue of Dmitry
+// Vyukov: a cell's sequence number says whether it is free for the push or
+// ready for the pop at a given position, so a send or receive that finds room
+// or a value is one CAS on the tail or head and never takes a lock. Any number
+// of producers and consumers may use a channel, one of each included.
+//
+// A send on a full ring or a receive on an empty one parks the coroutine in a
+// FIFO list of waiters. The list nodes are in the awaiters, which are
+// temporaries of the co_await expression in the waiting coroutine's frame, as
+// in sync.hpp, so parking doesn't allocate. The lists are kept under a mutex,
+// taken only to park or to wake a waiter. A counter per list tells the lock-free
+// side whether it has to: a pop reads the count of waiting senders after it
+// freed its cell, a parking sender counts itself before it tries the ring once
+// more, and a seq_cst fence on both sides ensures that one of them sees the
+// other.
+//
+// The side that wakes a waiter completes the waiter's operation for it, then
+// hands over the way handoff_awaiter does: its await_suspend() returns the woken
+// coroutine for symmetric transfer, and the waking one is enqueued on the pool.
+// A send that finds a consumer waiting on the empty ring skips the ring and
+// moves the value into that consumer's awaiter, so a value travels from
+// producer to consumer without touching a cell or a thread.
+//
+// recv_many(span) waits for one value like recv(), then takes whatever else the
+// ring holds, up to the size of the span, without suspending again. A consumer
+// that keeps up with its producers is then woken once per batch rather than
+// once per value.
+//
+// A channel must outlive every operation on it. close() resumes the parked
+// consumers with nothing and makes those that come later drain the ring first;
+// sending to a closed channel, or closing one with producers parked, is an
+// error, asserted in debug builds. Like in sync.hpp, a parked coroutine must not
+// be destroyed. A receiver woken with a value doesn't stop at its cancellation
+// point, which would drop the value (recv_awaiter::hands_over, see
+// "Cancellation" in defs.hpp).
+
+#include<atomic>
+#include<cassert>
+#include<cstddef>
+#include<cstdint>
+#include<mutex>
+#include<optional>
+#include<span>
+#include<utility>
+#include "scheduler.hpp"
+
+template<typename T, std::size_t N> class channel
+{
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "the capacity must be a power of two");
+
+    public:
+        class send_awaiter;
+        class recv_awaiter;
+        class recv_many_awaiter;
+
+    private:
+        // A parked coroutine, embedded in the awaiter it waits in.
+        struct waiter
+        {
+            waiter *                next = nullptr;
+            std::coroutine_handle<> coro;
+        };
+
+        struct sender : waiter
+        {
+            T value;
+
+            explicit sender(T && value)
+                : value(std::move(value))
+            {}
+        };
+
+        // Given the value it waited for, or nothing if the channel was closed.
+        struct receiver : waiter
+        {
+            std::optional<T> value;
+        };
+
+        // FIFO, only touched under lock_.
+        struct waiter_list
+        {
+            waiter *  head = nullptr;
+            waiter ** tail = &head;
+
+            bool empty() const noexcept
+            {
+                return head == nullptr;
+            }
+
+            void push_back(waiter * w) noexcept
+            {
+                w->next = nullptr;
+                *tail = w;
+                tail = &w->next;
+            }
+
+            waiter * pop_front() noexcept
+            {
+                waiter * w = head;
+                head = w->next;
+                if(head == nullptr){
+                    tail = &head;
+                }
+                return w;
+            }
+        };
+
+        struct cell
+        {
+            // pos: free for the push at pos, pos + 1: holds the value for the pop at pos.
+            std::atomic<std::size_t> sequence;
+            manual_lifetime<T>       value;
+        };
+
+        struct parked
+        {
+            waiter * woken;       // whom our operation or our parking woke
+            bool     completed;   // false: we wait in a list
+        };
+
+    private:
+        alignas(64) std::atomic<std::size_t>   head_ {0};   // the next pop
+        alignas(64) std::atomic<std::size_t>   tail_ {0};   // the next push
+
+        alignas(64) std::atomic<std::uint32_t> senders_waiting_   {0};
+        std::atomic<std::uint32_t>             receivers_waiting_ {0};
+
+        alignas(64) std::mutex lock_;
+        waiter_list            senders_;
+        waiter_list            receivers_;
+        std::atomic<bool>      closed_ {false};   // set under lock_, but send_awaiter asserts on it without
+
+        thread_pool &          pool_;
+
+        alignas(64) cell       cells_[N];
+
+    public:
+        explicit channel(thread_pool & pool) noexcept
+            : pool_(pool)
+        {
+            for(std::size_t i = 0; i < N; ++i){
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        ~channel()
+        {
+            const std::size_t tail = tail_.load(std::memory_order_relaxed);
+            for(std::size_t pos = head_.load(std::memory_order_relaxed); pos != tail; ++pos){
+                cells_[pos & (N - 1)].value.destroy();
+            }
+        }
+
+        channel            (const channel &) = delete;
+        channel & operator=(const channel &) = delete;
+
+    public:
+        static constexpr std::size_t capacity() noexcept
+        {
+            return N;
+        }
+
+        send_awaiter      send(T value) noexcept(std::is_nothrow_move_constructible_v<T>);
+        recv_awaiter      recv() noexcept;
+
+        // `out` must not be empty.
+        recv_many_awaiter recv_many(std::span<T> out) noexcept;
+
+        // No more sends: the parked consumers are resumed with nothing.
+        void close()
+        {
+            waiter * woken;
+            {
+                std::lock_guard lock(lock_);
+                assert(senders_.empty() && "close with producers parked");
+                closed_.store(true, std::memory_order_relaxed);
+                woken   = balance();
+                while(!receivers_.empty()){
+                    waiter * r = receivers_.pop_front();
+                    r->next = woken;
+                    woken = r;
+                }
+                receivers_waiting_.store(0, std::memory_order_relaxed);
+            }
+            thread_pool & pool = pool_;
+            while(woken != nullptr){
+                waiter * following = woken->next;
+                pool.enqueue(woken->coro);
+                woken = following;
+            }
+        }
+
+    private:
+        bool try_push(T & value) noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            std::size_t pos = tail_.load(std::memory_order_relaxed);
+            for(;;){
+                cell & c = cells_[pos & (N - 1)];
+                const auto diff = static_cast<std::ptrdiff_t>(c.sequence.load(std::memory_order_acquire) - pos);
+                if(diff == 0){
+                    if(tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                        c.value.construct_from([&]{ return std::move(value); });
+                        c.sequence.store(pos + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if(diff < 0){
+                    return false;    // full, or the pop N behind us hasn't finished yet
+                }
+                else{
+                    pos = tail_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        // `take(T &&)` gets the oldest value.
+        template<typename Take> bool try_pop(Take && take)
+        {
+            std::size_t pos = head_.load(std::memory_order_relaxed);
+            for(;;){
+                cell & c = cells_[pos & (N - 1)];
+                const auto diff = static_cast<std::ptrdiff_t>(c.sequence.load(std::memory_order_acquire) - (pos + 1));
+                if(diff == 0){
+                    if(head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)){
+                        take(std::move(c.value.get()));
+                        c.value.destroy();
+                        c.sequence.store(pos + N, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if(diff < 0){
+                    return false;    // empty, or the push into it hasn't finished yet
+                }
+                else{
+                    pos = head_.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        bool try_pop(std::optional<T> & out)
+        {
+            return try_pop([&](T && value){ out.emplace(std::move(value)); });
+        }
+
+        // Under lock_: moves values from the ring to parked receivers and from
+        // parked senders to the ring while it can. Returns the waiters whose
+        // operation it completed, unlinked and chained through `next`.
+        waiter * balance()
+        {
+            waiter *  woken = nullptr;
+            waiter ** last  = &woken;
+            auto wake = [&](waiter_list & list, std::atomic<std::uint32_t> & waiting)
+            {
+                waiter * w = list.pop_front();
+                waiting.fetch_sub(1, std::memory_order_relaxed);
+                w->next = nullptr;
+                *last = w;
+                last = &w->next;
+            };
+
+            for(bool moved = true; moved;){
+                moved = false;
+                while(!receivers_.empty() && try_pop(static_cast<receiver *>(receivers_.head)->value)){
+                    wake(receivers_, receivers_waiting_);
+                    moved = true;
+                }
+                while(!senders_.empty() && try_push(static_cast<sender *>(senders_.head)->value)){
+                    wake(senders_, senders_waiting_);
+                    moved = true;
+                }
+            }
+            return woken;
+        }
+
+        // After a push or pop outside lock_: wakes whoever it made room or a
+        // value for. `waiting` is the other side's count.
+        waiter * after(std::atomic<std::uint32_t> & waiting)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(waiting.load(std::memory_order_relaxed) == 0){
+                return nullptr;
+            }
+            std::lock_guard lock(lock_);
+            return balance();
+        }
+
+        // A consumer is parked on the empty ring: give it the value directly.
+        waiter * hand_over(sender & s)
+        {
+            std::lock_guard lock(lock_);
+            if(receivers_.empty() || head_.load(std::memory_order_acquire) != tail_.load(std::memory_order_acquire)){
+                return nullptr;
+            }
+            waiter * r = receivers_.pop_front();
+            receivers_waiting_.fetch_sub(1, std::memory_order_relaxed);
+            static_cast<receiver *>(r)->value.emplace(std::move(s.value));
+            r->next = nullptr;
+            return r;
+        }
+
+        // Tries the ring once more, counted as waiting, and parks `s` if it's still full.
+        parked park(sender & s)
+        {
+            std::lock_guard lock(lock_);
+            senders_waiting_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if(try_push(s.value)){
+                senders_waiting_.fetch_sub(1, std::memory_order_relaxed);
+                return {balance(), true};
+            }
+            senders_.push_back(&s);
+            return {nullptr, false};
+        }
+
+        // The same for `r` and an empty ring, which on a closed channel is the end.
+        parked park(receiver & r)
+        {
+            std::lock_guard lock(lock_);
+            receivers_waiting_.fetch_add(1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if(try_pop(r.value) || closed_.load(std::memory_order_relaxed)){
+                receivers_waiting_.fetch_sub(1, std::memory_order_relaxed);
+                return {r.value ? balance() : nullptr, true};
+            }
+            receivers_.push_back(&r);
+            return {nullptr, false};
+        }
+
+        // The handle for await_suspend() of `self` to return: itself if its
+        // operation completed and it woke nobody, else the first one it woke,
+        // with the others and (if it completed) itself enqueued on `pool`.
+        // Once `self` is parked or enqueued it may run elsewhere and its
+        // awaiter, or the channel, be gone: callers read the pool beforehand.
+        static std::coroutine_handle<> handoff(thread_pool & pool, waiter * woken, std::coroutine_handle<> self, bool completed)
+        {
+            std::coroutine_handle<> next = std::noop_coroutine();
+            while(woken != nullptr){
+                waiter * following = woken->next;
+                if(next == std::noop_coroutine()){
+                    next = woken->coro;
+                }
+                else{
+                    pool.enqueue(woken->coro);
+                }
+                woken = following;
+            }
+
+            if(completed){
+                if(next == std::noop_coroutine()){
+                    return self;
+                }
+                pool.enqueue(self);
+            }
+            return next;
+        }
+};
+
+//////////////////////
+// The awaiters
+
+template<typename T, std::size_t N> class channel<T, N>::send_awaiter
+{
+    private:
+        channel &  channel_;
+        sender     node_;
+        waiter *   woken_ = nullptr;   // by await_ready()
+
+    public:
+        send_awaiter(channel & ch, T && value) noexcept(std::is_nothrow_move_constructible_v<T>)
+            : channel_(ch)
+            , node_(std::move(value))
+        {}
+
+        send_awaiter            (const send_awaiter &) = delete;
+        send_awaiter & operator=(const send_awaiter &) = delete;
+
+    public:
+        bool await_ready()
+        {
+            assert(!channel_.closed_.load(std::memory_order_relaxed) && "send on a closed channel");
+
+            if(channel_.receivers_waiting_.load(std::memory_order_relaxed) != 0){
+                woken_ = channel_.hand_over(node_);
+                if(woken_ != nullptr){
+                    return false;
+                }
+            }
+            if(!channel_.try_push(node_.value)){
+                return false;
+            }
+            woken_ = channel_.after(channel_.receivers_waiting_);
+            return woken_ == nullptr;
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h)
+        {
+            thread_pool & pool = channel_.pool_;
+            if(woken_ != nullptr){
+                return handoff(pool, woken_, h, true);
+            }
+
+            node_.coro = h;
+            const parked p = channel_.park(node_);
+            return handoff(pool, p.woken, h, p.completed);
+        }
+
+        void await_resume() noexcept {}
+};
+
+template<typename T, std::size_t N> class channel<T, N>::recv_awaiter
+{
+    private:
+        channel &  channel_;
+        receiver   node_;
+        waiter *   woken_ = nullptr;   // by await_ready()
+
+    public:
+        // Resumed holding the value, so not cancelled there, see "Cancellation" in defs.hpp.
+        static constexpr bool hands_over = true;
+
+    public:
+        explicit recv_awaiter(channel & ch) noexcept
+            : channel_(ch)
+        {}
+
+        recv_awaiter            (const recv_awaiter &) = delete;
+        recv_awaiter & operator=(const recv_awaiter &) = delete;
+
+    public:
+        bool await_ready()
+        {
+            if(!channel_.try_pop(node_.value)){
+                return false;
+            }
+            woken_ = channel_.after(channel_.senders_waiting_);
+            return woken_ == nullptr;
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h)
+        {
+            thread_pool & pool = channel_.pool_;
+            if(woken_ != nullptr){
+                return handoff(pool, woken_, h, true);
+            }
+
+            node_.coro = h;
+            const parked p = channel_.park(node_);
+            return handoff(pool, p.woken, h, p.completed);
+        }
+
+        // Nothing if the channel was closed and drained.
+        std::optional<T> await_resume() noexcept(std::is_nothrow_move_constructible_v<T>)
+        {
+            return std::move(node_.value);
+        }
+};
+
+template<typename T, std::size_t N> class channel<T, N>::recv_many_awaiter
+{
+    private:
+        channel &     channel_;
+        std::span<T>  out_;
+        std::size_t   count_ = 0;
+        receiver      node_;
+        waiter *      woken_ = nullptr;   // by await_ready()
+
+    public:
+        // Resumed holding the values, so not cancelled there, see "Cancellation" in defs.hpp.
+        static constexpr bool hands_over = true;
+
+    public:
+        recv_many_awaiter(channel & ch, std::span<T> out) noexcept
+            : channel_(ch)
+            , out_(out)
+        {}
+
+        recv_many_awaiter            (const recv_many_awaiter &) = delete;
+        recv_many_awaiter & operator=(const recv_many_awaiter &) = delete;
+
+    public:
+        bool await_ready()
+        {
+            if(!top_up()){
+                return false;
+            }
+            woken_ = channel_.after(channel_.senders_waiting_);
+            return woken_ == nullptr;
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h)
+        {
+            thread_pool & pool = channel_.pool_;
+            if(woken_ != nullptr){
+                return handoff(pool, woken_, h, true);
+            }
+
+            node_.coro = h;
+            const parked p = channel_.park(node_);
+            return handoff(pool, p.woken, h, p.completed);
+        }
+
+        // The number of values written to the front of the span, 0 if the
+        // channel was closed and drained.
+        std::size_t await_resume()
+        {
+            if(node_.value){
+                // Woken with one: take the rest of the batch from the ring, and
+                // let the producers that made room for it run on the pool.
+                out_[count_++] = std::move(*node_.value);
+                if(top_up()){
+                    for(waiter * w = channel_.after(channel_.senders_waiting_); w != nullptr;){
+                        waiter * following = w->next;
+                        channel_.pool_.enqueue(w->coro);
+                        w = following;
+                    }
+                }
+            }
+            return count_;
+        }
+
+    private:
+        // Pops while there is room and a value, true if it popped any.
+        bool top_up()
+        {
+            const std::size_t before = count_;
+            while(count_ < out_.size() && channel_.try_pop([&](T && value){ out_[count_] = std::move(value); })){
+                ++count_;
+            }
+            return count_ != before;
+        }
+};
+
+template<typename T, std::size_t N> inline auto channel<T, N>::send(T value) noexcept(std::is_nothrow_move_constructible_v<T>) -> send_awaiter
+{
+    return send_awaiter{*this, std::move(value)};
+}
+
+template<typename T, std::size_t N> inline auto channel<T, N>::recv() noexcept -> recv_awaiter
+{
+    return recv_awaiter{*this};
+}
+
+template<typename T, std::size_t N> inline auto channel<T, N>::recv_many(std::span<T> out) noexcept -> recv_many_awaiter
+{
+    return recv_many_awaiter{*this, out};
+}
@@ -0,0 +1,268 @@
+#include "checked.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of checked(int x)
+//
+// task<int> checked(int x) {
+//   if(x < 0) {
+//     throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+//   }
+//   co_return x;
+// }
+//
+// In exception-free mode (see defs.hpp) the throw is spelled
+//
+//     co_return std::unexpected(std::make_error_code(std::errc::invalid_argument));
+
+/////
+// The "ramp" function
+
+task<int> checked(int x)
+{
+    std::unique_ptr<__checked_state> state(new __checked_state(static_cast<int &&>(x)));
+    return __ramp(std::move(state), &__checked_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __checked_cancellable = __cancellation_points<std::suspend_always, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__checked_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__checked_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __checked_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  if(x < 0) throw / co_return std::unexpected(...);
+        if(state->x < 0){
+#ifndef CORO_NO_EXCEPTIONS
+            throw std::system_error(std::make_error_code(std::errc::invalid_argument));
+#else
+            state->__promise.return_value(std::unexpected(std::make_error_code(std::errc::invalid_argument)));
+            goto final_suspend;
+#endif
+        }
+
+        //  co_return x;
+        state->__promise.return_value(state->x);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp2(), 1);
+}
+
+/////
+// The "destroy" function
+
+void __checked_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__checked_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __checked_sites[] = {"initial suspend", "final suspend"};
+static const lowered_frame_info<__checked_state> __checked_frame_info{&__checked_destroy, "checked(int x)", __checked_sites};
+
+//////////////////////
+// Begin lowering of checked_square(int x)
+//
+// task<int> checked_square(int x) {
+//   int v = co_await checked(x);
+//   co_return v * v;
+// }
+
+/////
+// The "ramp" function
+
+task<int> checked_square(int x)
+{
+    std::unique_ptr<__checked_square_state> state(new __checked_square_state(static_cast<int &&>(x)));
+    return __ramp(std::move(state), &__checked_square_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __checked_square_cancellable = __cancellation_points<std::suspend_always, task<int>::awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__checked_square_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__checked_square_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __checked_square_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  int v = co_await checked(x);
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return checked(state->x);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            state->__tmp3().construct_from([&]()
+            {
+                return static_cast<task<int> &&>(state->__tmp2().get()).operator co_await();
+            });
+            destructor_guard tmp3_dtor{state->__tmp3()};
+
+            if(!state->__tmp3().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp3().get().await_suspend(std::coroutine_handle<__checked_square_promise_t>::from_promise(state->__promise));
+
+                tmp3_dtor.cancel();
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+
+            tmp3_dtor.cancel();
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        // The child was cancelled, see g.cpp.
+        if(state->__tmp3().get().cancelled()) [[unlikely]] {
+            return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+        }
+#ifdef CORO_NO_EXCEPTIONS
+        // The awaited task failed, see g.cpp.
+        if(std::error_code ec = state->__tmp3().get().error()) [[unlikely]] {
+            state->__tmp3().destroy();
+            state->__tmp2().destroy();
+            state->__promise.set_error(ec);
+            goto final_suspend;
+        }
+#endif
+        int v = [&]() -> decltype(auto)
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            destructor_guard tmp3_dtor{state->__tmp3()};
+            return state->__tmp3().get().await_resume();
+        }();
+
+        //  co_return v * v;
+        state->__promise.return_value(v * v);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp4(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __checked_square_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__checked_square_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp3().destroy();
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp4().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __checked_square_sites[] = {"initial suspend", "co_await checked(x)", "final suspend"};
+static const lowered_frame_info<__checked_square_state> __checked_square_frame_info{&__checked_square_destroy, "checked_square(int x)", __checked_square_sites};
@@ -0,0 +1,97 @@
+#pragma once
+#include<system_error>
+#include "defs.hpp"
+//////////////////////
+// Coroutine-states of checked(int x) and checked_square(int x), see checked.cpp
+// for the lowering. A leaf that fails for negative input and a parent that
+// passes the failure on, to measure error propagation with and without
+// exceptions (bench/errors.cpp).
+
+task<int> checked(int x);
+task<int> checked_square(int x);
+
+using __checked_promise_t        = std::coroutine_traits<task<int>, int>::promise_type;
+using __checked_square_promise_t = std::coroutine_traits<task<int>, int>::promise_type;
+
+__coroutine_state * __checked_resume (__coroutine_state *);
+void                __checked_destroy(__coroutine_state *);
+
+__coroutine_state * __checked_square_resume (__coroutine_state *);
+void                __checked_square_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definitions
+
+struct __checked_state : __coroutine_state_with_promise<__checked_promise_t>
+{
+    __suspend_index_t<2> __suspend_point = 0;
+
+    // Argument copies
+    int x;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                        // initial suspend
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+
+    __checked_state(int && x)
+        : x(static_cast<int &&>(x))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __checked_resume;
+            this->__destroy = &__checked_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __checked_promise_t(construct_promise<__checked_promise_t>(this->x));
+    }
+
+    ~__checked_state()
+    {
+        this->__promise.~__checked_promise_t();
+    }
+};
+
+struct __checked_square_state : __coroutine_state_with_promise<__checked_square_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    int x;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                        // initial suspend
+        frame_scope<manual_lifetime<task<int>>,                                   // int v = co_await checked(x);
+                    manual_lifetime<task<int>::awaiter>>,
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<1, 1>(); }
+    auto & __tmp4() noexcept { return __frame.get<2, 0>(); }
+
+    __checked_square_state(int && x)
+        : x(static_cast<int &&>(x))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __checked_square_resume;
+            this->__destroy = &__checked_square_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __checked_square_promise_t(construct_promise<__checked_square_promise_t>(this->x));
+    }
+
+    ~__checked_square_state()
+    {
+        this->__promise.~__checked_square_promise_t();
+    }
+};
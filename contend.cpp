@@ -0,0 +1,371 @@
+#include "contend.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of contend(async_mutex & m, thread_pool & pool, long & counter, int n)
+//
+// task<int> contend(async_mutex & m, thread_pool & pool, long & counter, int n) {
+//   for(int i = 0; i < n; ++i) {
+//     co_await m.lock();
+//     ++counter;
+//     co_await m.unlock(pool);
+//   }
+//   co_return n;
+// }
+//
+// lock_awaiter::await_suspend() returns bool: false means the mutex was
+// released while we were queueing and is ours, so we carry on without
+// suspending. unlock(pool) returns the next owner for symmetric transfer.
+//
+// One resumed by unlock() already owns the mutex, and giving up there would
+// leave it locked for good: lock_awaiter and acquire_awaiter are hands_over,
+// so __contend_cancellable has no cancellation point at suspend-point 1.
+
+/////
+// The "ramp" function
+
+task<int> contend(async_mutex & m, thread_pool & pool, long & counter, int n)
+{
+    std::unique_ptr<__contend_state> state(new __contend_state(m, pool, counter, static_cast<int &&>(n)));
+    return __ramp(std::move(state), &__contend_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __contend_cancellable = __cancellation_points<std::suspend_always, async_mutex::lock_awaiter, handoff_awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__contend_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__contend_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __contend_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            case 2: goto suspend_point_2;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  for(int i = 0; i < n; ++i)
+        state->i = 0;
+
+loop_condition:
+        if(!(state->i < state->n)){
+            goto loop_end;
+        }
+
+        //  co_await m.lock();
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return state->m.lock();
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                if(state->__tmp2().get().await_suspend(std::coroutine_handle<__contend_promise_t>::from_promise(state->__promise))){
+                    // bool-returning await_suspend: true means we are queued, return to whoever resumed us.
+                    tmp2_dtor.cancel();
+                    return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+                }
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  ++counter;
+        ++state->counter;
+
+        //  co_await m.unlock(pool);
+        {
+            state->__tmp3().construct_from([&]()
+            {
+                return state->m.unlock(state->pool);
+            });
+            destructor_guard tmp3_dtor{state->__tmp3()};
+
+            if(!state->__tmp3().get().await_ready()){
+                state->__suspend_point = 2;
+                CORO_TRACE_EVENT(suspend, state, 2);
+                __release_running_frame();
+                auto h = state->__tmp3().get().await_suspend(std::coroutine_handle<__contend_promise_t>::from_promise(state->__promise));
+
+                tmp3_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+            tmp3_dtor.cancel();
+        }
+
+suspend_point_2:
+        {
+            destructor_guard tmp3_dtor{state->__tmp3()};
+            state->__tmp3().get().await_resume();
+        }
+
+        ++state->i;
+        goto loop_condition;
+
+loop_end:
+        //  co_return n;
+        state->__promise.return_value(state->n);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp4(), 3);
+}
+
+/////
+// The "destroy" function
+
+void __contend_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__contend_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        case 3: goto suspend_point_3;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+suspend_point_3:
+    state->__tmp4().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __contend_sites[] = {"initial suspend", "co_await m.lock()", "co_await m.unlock(pool)", "final suspend"};
+static const lowered_frame_info<__contend_state> __contend_frame_info{&__contend_destroy, "contend(m, pool, counter, n)", __contend_sites};
+
+//////////////////////
+// Begin lowering of throttled(async_semaphore & s, thread_pool & pool, std::atomic<long> & counter, int n)
+//
+// task<int> throttled(async_semaphore & s, thread_pool & pool, std::atomic<long> & counter, int n) {
+//   for(int i = 0; i < n; ++i) {
+//     co_await s.acquire();
+//     counter.fetch_add(1, std::memory_order_relaxed);
+//     co_await s.release(pool);
+//   }
+//   co_return n;
+// }
+
+/////
+// The "ramp" function
+
+task<int> throttled(async_semaphore & s, thread_pool & pool, std::atomic<long> & counter, int n)
+{
+    std::unique_ptr<__throttled_state> state(new __throttled_state(s, pool, counter, static_cast<int &&>(n)));
+    return __ramp(std::move(state), &__throttled_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __throttled_cancellable = __cancellation_points<std::suspend_always, async_semaphore::acquire_awaiter, handoff_awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__throttled_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__throttled_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __throttled_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            case 2: goto suspend_point_2;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  for(int i = 0; i < n; ++i)
+        state->i = 0;
+
+loop_condition:
+        if(!(state->i < state->n)){
+            goto loop_end;
+        }
+
+        //  co_await s.acquire();
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return state->s.acquire();
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                if(state->__tmp2().get().await_suspend(std::coroutine_handle<__throttled_promise_t>::from_promise(state->__promise))){
+                    // bool-returning await_suspend: true means we are queued, return to whoever resumed us.
+                    tmp2_dtor.cancel();
+                    return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+                }
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  counter.fetch_add(1, std::memory_order_relaxed);
+        state->counter.fetch_add(1, std::memory_order_relaxed);
+
+        //  co_await s.release(pool);
+        {
+            state->__tmp3().construct_from([&]()
+            {
+                return state->s.release(state->pool);
+            });
+            destructor_guard tmp3_dtor{state->__tmp3()};
+
+            if(!state->__tmp3().get().await_ready()){
+                state->__suspend_point = 2;
+                CORO_TRACE_EVENT(suspend, state, 2);
+                __release_running_frame();
+                auto h = state->__tmp3().get().await_suspend(std::coroutine_handle<__throttled_promise_t>::from_promise(state->__promise));
+
+                tmp3_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+            tmp3_dtor.cancel();
+        }
+
+suspend_point_2:
+        {
+            destructor_guard tmp3_dtor{state->__tmp3()};
+            state->__tmp3().get().await_resume();
+        }
+
+        ++state->i;
+        goto loop_condition;
+
+loop_end:
+        //  co_return n;
+        state->__promise.return_value(state->n);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp4(), 3);
+}
+
+/////
+// The "destroy" function
+
+void __throttled_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__throttled_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        case 3: goto suspend_point_3;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+suspend_point_3:
+    state->__tmp4().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __throttled_sites[] = {"initial suspend", "co_await s.acquire()", "co_await s.release(pool)", "final suspend"};
+static const lowered_frame_info<__throttled_state> __throttled_frame_info{&__throttled_destroy, "throttled(s, pool, counter, n)", __throttled_sites};
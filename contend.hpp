@@ -0,0 +1,118 @@
+#pragma once
+#include<atomic>
+#include "sync.hpp"
+//////////////////////
+// Coroutine-states of contend(m, pool, counter, n) and throttled(s, pool,
+// counter, n), see contend.cpp for the lowering. Many of them running on a
+// thread_pool make the contention benchmark (bench/sync.cpp).
+
+task<int> contend  (async_mutex     & m, thread_pool & pool, long              & counter, int n);
+task<int> throttled(async_semaphore & s, thread_pool & pool, std::atomic<long> & counter, int n);
+
+using __contend_promise_t   = std::coroutine_traits<task<int>, async_mutex &,     thread_pool &, long &,              int>::promise_type;
+using __throttled_promise_t = std::coroutine_traits<task<int>, async_semaphore &, thread_pool &, std::atomic<long> &, int>::promise_type;
+
+__coroutine_state * __contend_resume (__coroutine_state *);
+void                __contend_destroy(__coroutine_state *);
+
+__coroutine_state * __throttled_resume (__coroutine_state *);
+void                __throttled_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definitions
+
+struct __contend_state : __coroutine_state_with_promise<__contend_promise_t>
+{
+    __suspend_index_t<4> __suspend_point = 0;
+
+    // Argument copies
+    async_mutex & m;
+    thread_pool & pool;
+    long & counter;
+    int n;
+
+    // Local variables that live across a suspend-point
+    int i;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                          // initial suspend
+        frame_scope<manual_lifetime<async_mutex::lock_awaiter>>,                    // co_await m.lock();
+        frame_scope<manual_lifetime<handoff_awaiter>>,                              // co_await m.unlock(pool);
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;      // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+    auto & __tmp4() noexcept { return __frame.get<3, 0>(); }
+
+    __contend_state(async_mutex & m, thread_pool & pool, long & counter, int && n)
+        : m(m)
+        , pool(pool)
+        , counter(counter)
+        , n(static_cast<int &&>(n))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __contend_resume;
+            this->__destroy = &__contend_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __contend_promise_t(construct_promise<__contend_promise_t>(this->m, this->pool, this->counter, this->n));
+    }
+
+    ~__contend_state()
+    {
+        this->__promise.~__contend_promise_t();
+    }
+};
+
+struct __throttled_state : __coroutine_state_with_promise<__throttled_promise_t>
+{
+    __suspend_index_t<4> __suspend_point = 0;
+
+    // Argument copies
+    async_semaphore & s;
+    thread_pool & pool;
+    std::atomic<long> & counter;
+    int n;
+
+    // Local variables that live across a suspend-point
+    int i;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                          // initial suspend
+        frame_scope<manual_lifetime<async_semaphore::acquire_awaiter>>,             // co_await s.acquire();
+        frame_scope<manual_lifetime<handoff_awaiter>>,                              // co_await s.release(pool);
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;      // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+    auto & __tmp4() noexcept { return __frame.get<3, 0>(); }
+
+    __throttled_state(async_semaphore & s, thread_pool & pool, std::atomic<long> & counter, int && n)
+        : s(s)
+        , pool(pool)
+        , counter(counter)
+        , n(static_cast<int &&>(n))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __throttled_resume;
+            this->__destroy = &__throttled_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __throttled_promise_t(construct_promise<__throttled_promise_t>(this->s, this->pool, this->counter, this->n));
+    }
+
+    ~__throttled_state()
+    {
+        this->__promise.~__throttled_promise_t();
+    }
+};
@@ -0,0 +1,49 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Coroutine-local context
+//
+// What a request carries along through every task that works on it: its id,
+// its deadline, the tracing span it is in. thread_locals don't do for that, a
+// task resumes on whichever thread its awaitable resumes it on, and every
+// access is a TLS lookup.
+//
+// A task's promise holds a pointer to a task_context instead. The root gets
+// one with task::set_context() before it starts, and task::awaiter hands the
+// pointer down to every child it awaits, as it does the cancellation token,
+// unless the child was given a context of its own. So one request shares one
+// object, inheriting it is a pointer copy, and any frame reaches it through
+// its promise in one load:
+//
+//   const task_context * ctx = promise.context();        // null if none was set
+//
+// To change something for a subtree, copy the context into the frame, change
+// the copy and hand it to the child:
+//
+//   task_context span = ctx->child(next_span_id());
+//   task<int> t = lookup(key);
+//   t.set_context(&span);
+//   co_await t;
+//
+// No reference counting is done, a context must outlive every task that sees
+// it: the awaiting frame or the caller of sync_wait() is the natural owner.
+// It is immutable once shared.
+
+#include<chrono>
+#include<cstdint>
+
+struct task_context
+{
+    std::uint64_t                         request_id  = 0;
+    std::chrono::steady_clock::time_point deadline    = std::chrono::steady_clock::time_point::max();
+    std::uint64_t                         span        = 0;
+    std::uint64_t                         parent_span = 0;
+
+    // A copy for a nested span.
+    task_context child(std::uint64_t child_span) const noexcept
+    {
+        task_context c = *this;
+        c.parent_span = span;
+        c.span        = child_span;
+        return c;
+    }
+};
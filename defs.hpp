@@ -1,3 +1,4 @@
+#pragma once
 ////////////////////////////////////////////////////////////////////////////////////////
 // Supporting code for blog post "C++ Coroutines: Understanding the Compiler Transform"
 //
@@ -8,11 +9,11 @@
 // This code sample shows the lowering of the following simple coroutine into equivalent
 // non-coroutine C++ code.
 //
-//   task f(int x) {
+//   task<int> f(int x) {
 //     co_return x;
 //   }
 //
-//   task g(int x) {
+//   task<int> g(int x) {
 //     int fx = co_await f(x);
 //     co_return fx * fx;
 //   }
@@ -26,6 +27,8 @@
 // to these methods as they won't be inlined.
 
 #include<cstddef>
+#include<cstdint>
+#include<cstring>
 #include<concepts>
 #include<type_traits>
 #include<memory>
@@ -63,8 +66,177 @@ inline const __coroutine_state __coroutine_state::__noop_coroutine
     &__coroutine_state::__noop_destroy
 };
 
-template<typename Promise> struct __coroutine_state_with_promise: __coroutine_state
+//////////////////////
+// Compact frames
+//
+// The header above costs every frame two function pointers, and the lowering
+// adds its __suspend_point next to it. A coroutine-state can instead derive
+// from __compact_coroutine_state, whose header is a single word:
+//
+//   bit 63       always set: a compact frame (see below)
+//   bit 62       done, set at the final suspend-point instead of clearing __resume
+//   bits 48..61  the suspend-point index
+//   bits  0..47  the address of the coroutine type's __coroutine_vtable
+//
+// The vtable is a static constant per coroutine type holding what the header
+// held, plus the frame size and a name for tools. User-space addresses on
+// x86-64 and AArch64 Linux fit in 48 bits, so the top 16 are free.
+//
+// A compact frame's handle points one word before the frame, where a classic
+// frame has __resume. That puts the promise 16 bytes past the handle in both
+// layouts: coroutine_handle<Promise>::promise() and from_promise() need no
+// change, and a promise type can live in frames of either layout. The header
+// word then sits where a classic frame has __destroy, a function pointer whose
+// top bit is clear, which is how coroutine_handle<>::resume(), destroy() and
+// done() tell the two apart. The lowering converts between handle and state
+// with __from_handle() / __handle().
+//
+// The promise must not need more than pointer alignment, or it would not start
+// right after the header.
+//
+// Telling the layouts apart costs every resume, destroy and done() a load of
+// the second word and a branch, classic frames included, so it is only built
+// in with -DCORO_COMPACT_FRAMES (bench/compact.cpp, and bench/dispatch.cpp
+// rebuilt as dispatch_compact to measure that cost). Without it a compact
+// frame doesn't compile.
+
+struct __coroutine_vtable
+{
+    __coroutine_state::__resume_fn  * resume;
+    __coroutine_state::__destroy_fn * destroy;
+    std::size_t                       size;
+    const char *                      name;
+};
+
+struct __compact_coroutine_state
 {
+    std::uintptr_t __header;
+
+    static constexpr std::uintptr_t __compact_bit   = std::uintptr_t(1) << 63;
+    static constexpr std::uintptr_t __done_bit      = std::uintptr_t(1) << 62;
+    static constexpr int            __index_shift   = 48;
+    static constexpr std::uintptr_t __index_mask    = ((std::uintptr_t(1) << 14) - 1) << __index_shift;
+    static constexpr std::uintptr_t __vtable_mask   = (std::uintptr_t(1) << __index_shift) - 1;
+    static constexpr std::size_t    __handle_offset = sizeof(void *);
+
+    static std::uintptr_t __make_header(const __coroutine_vtable & vtable) noexcept
+    {
+        return reinterpret_cast<std::uintptr_t>(&vtable) | __compact_bit;
+    }
+
+    // The header of the frame behind `s`, or 0 if it has the classic layout.
+    static std::uintptr_t __header_of(const __coroutine_state * s) noexcept
+    {
+        std::uintptr_t word;
+        std::memcpy(&word, reinterpret_cast<const void *>(reinterpret_cast<std::uintptr_t>(s) + __handle_offset), sizeof word);
+        return word & __compact_bit ? word : 0;
+    }
+
+    static const __coroutine_vtable * __vtable_of(std::uintptr_t header) noexcept
+    {
+        return reinterpret_cast<const __coroutine_vtable *>(header & __vtable_mask);
+    }
+
+    std::uint32_t __suspend_point() const noexcept
+    {
+        return static_cast<std::uint32_t>((__header & __index_mask) >> __index_shift);
+    }
+
+    void __set_suspend_point(std::uint32_t point) noexcept
+    {
+        __header = (__header & ~__index_mask) | std::uintptr_t(point) << __index_shift;
+    }
+
+    // Marks the final suspend-point.
+    void __set_done() noexcept
+    {
+        __header |= __done_bit;
+    }
+
+    // The handle lies outside the allocation, so it is computed as an integer:
+    // pointer arithmetic would leave the object, and the compiler would see a
+    // frame freed through a pointer into its middle.
+    __coroutine_state * __handle() noexcept
+    {
+        return reinterpret_cast<__coroutine_state *>(reinterpret_cast<std::uintptr_t>(this) - __handle_offset);
+    }
+
+    template<typename State> static State * __from_handle(__coroutine_state * s) noexcept
+    {
+        return static_cast<State *>(reinterpret_cast<__compact_coroutine_state *>(reinterpret_cast<std::uintptr_t>(s) + __handle_offset));
+    }
+
+    template<typename State> static const State * __from_handle(const __coroutine_state * s) noexcept
+    {
+        return static_cast<const State *>(reinterpret_cast<const __compact_coroutine_state *>(reinterpret_cast<std::uintptr_t>(s) + __handle_offset));
+    }
+};
+
+// The resume and destroy functions and the done flag of the frame behind a
+// handle, of either layout with -DCORO_COMPACT_FRAMES.
+inline __coroutine_state::__resume_fn * __resume_fn_of(const __coroutine_state * s) noexcept
+{
+#ifdef CORO_COMPACT_FRAMES
+    if(const std::uintptr_t header = __compact_coroutine_state::__header_of(s)){
+        return __compact_coroutine_state::__vtable_of(header)->resume;
+    }
+#endif
+    return s->__resume;
+}
+
+inline __coroutine_state::__destroy_fn * __destroy_fn_of(const __coroutine_state * s) noexcept
+{
+#ifdef CORO_COMPACT_FRAMES
+    if(const std::uintptr_t header = __compact_coroutine_state::__header_of(s)){
+        return __compact_coroutine_state::__vtable_of(header)->destroy;
+    }
+#endif
+    return s->__destroy;
+}
+
+inline bool __done(const __coroutine_state * s) noexcept
+{
+#ifdef CORO_COMPACT_FRAMES
+    if(const std::uintptr_t header = __compact_coroutine_state::__header_of(s)){
+        return header & __compact_coroutine_state::__done_bit;
+    }
+#endif
+    return s->__resume == nullptr;
+}
+
+#ifdef CORO_ASYNC_STACKS
+// The frame the trampoline in coroutine_handle<>::resume() is running on this
+// thread, read by the sampling profiler in async_stack.hpp.
+inline thread_local __coroutine_state * __running_frame = nullptr;
+#endif
+
+// Called by a resume function before its frame may be resumed or freed by
+// someone else: the awaiter it suspends on, operator delete, a thread it wakes.
+// From then on the profiler must not walk the frame.
+inline void __release_running_frame() noexcept
+{
+#ifdef CORO_ASYNC_STACKS
+    __running_frame = nullptr;
+#endif
+}
+
+#ifdef CORO_PERF_COUNTERS
+// Call the resume / destroy function of s between two reads of the hardware counters,
+// see perf_counters.hpp.
+__coroutine_state * __perf_counted_resume (__coroutine_state *s);
+void                __perf_counted_destroy(__coroutine_state *s);
+#endif
+
+// Header is __coroutine_state, or __compact_coroutine_state for a compact frame.
+template<typename Promise, typename Header = __coroutine_state> struct __coroutine_state_with_promise: Header
+{
+    static_assert(std::is_same_v<Header, __coroutine_state> || alignof(Promise) <= alignof(void *),
+                  "the promise of a compact frame must follow its header, see \"Compact frames\"");
+#ifndef CORO_COMPACT_FRAMES
+    static_assert(std::is_same_v<Header, __coroutine_state>,
+                  "a compact frame needs -DCORO_COMPACT_FRAMES, see \"Compact frames\"");
+#endif
+
     union
     {
         Promise __promise;
@@ -72,6 +244,52 @@ template<typename Promise> struct __coroutine_state_with_promise: __coroutine_st
 
     /**/  __coroutine_state_with_promise() noexcept {}
     /**/ ~__coroutine_state_with_promise()          {}
+
+    // The coroutine-state is allocated with the promise's operator new/delete if
+    // it declares them, otherwise with the global ones. Declaring them here means
+    // the `new __X_state` / `delete state` in the lowering picks them up for free.
+
+    static void * operator new(std::size_t size)
+    {
+        if constexpr (requires { Promise::operator new(size); }){
+            return Promise::operator new(size);
+        }
+        else{
+            return ::operator new(size);
+        }
+    }
+
+    // A ramp passes the coroutine's parameters too, so a promise can take its
+    // memory from them (see "Frame allocation" below).
+    template<typename... Args>
+        requires requires(std::size_t size, Args &... args) { Promise::operator new(size, args...); }
+    static void * operator new(std::size_t size, Args &... args)
+    {
+        return Promise::operator new(size, args...);
+    }
+
+    static void * operator new(std::size_t size, std::align_val_t align)
+    {
+        return ::operator new(size, align);
+    }
+
+    static void operator delete(void *ptr, std::size_t size) noexcept
+    {
+        if constexpr (requires { Promise::operator delete(ptr, size); }){
+            Promise::operator delete(ptr, size);
+        }
+        else if constexpr (requires { Promise::operator delete(ptr); }){
+            Promise::operator delete(ptr);
+        }
+        else{
+            ::operator delete(ptr, size);
+        }
+    }
+
+    static void operator delete(void *ptr, std::size_t size, std::align_val_t align) noexcept
+    {
+        ::operator delete(ptr, size, align);
+    }
 };
 
 namespace std
@@ -118,20 +336,39 @@ namespace std
             void resume() const
             {
                 __coroutine_state *s = state_;
+#ifdef CORO_ASYNC_STACKS
+                __coroutine_state *outer = __running_frame;
                 do{
-                    s = s->__resume(s);
+                    __running_frame = s;
+                    s = __resume_fn_of(s)(s);
                 }
                 while(s != &__coroutine_state::__noop_coroutine);
+                __running_frame = outer;
+#elif defined(CORO_PERF_COUNTERS)
+                do{
+                    s = __perf_counted_resume(s);
+                }
+                while(s != &__coroutine_state::__noop_coroutine);
+#else
+                do{
+                    s = __resume_fn_of(s)(s);
+                }
+                while(s != &__coroutine_state::__noop_coroutine);
+#endif
             }
 
             void destroy() const
             {
-                state_->__destroy(state_);
+#ifdef CORO_PERF_COUNTERS
+                __perf_counted_destroy(state_);
+#else
+                __destroy_fn_of(state_)(state_);
+#endif
             }
 
             bool done() const
             {
-                return state_->__resume == nullptr;
+                return __done(state_);
             }
     };
 
@@ -187,7 +424,8 @@ namespace std
 
                 // We know the address of the __promise member
                 // so calculate the address of the coroutine-state by subtracting the offset of the __promise field from this address
-                h.state_ = reinterpret_cast<state_t *>(reinterpret_cast<unsigned char *>(std::addressof(promise)) - offsetof(state_t, __promise));
+                // (as an integer: for a compact frame the result lies before the allocation, see __compact_coroutine_state::__handle())
+                h.state_ = reinterpret_cast<state_t *>(reinterpret_cast<std::uintptr_t>(std::addressof(promise)) - offsetof(state_t, __promise));
                 return h;
             }
 
@@ -270,52 +508,537 @@ namespace std
         constexpr void await_suspend(coroutine_handle<>) const noexcept {}
         constexpr void await_resume ()                   const noexcept {}
     };
+
+    struct suspend_never
+    {
+        constexpr suspend_never() noexcept = default;
+
+        constexpr bool await_ready  ()                   const noexcept { return true; }
+        constexpr void await_suspend(coroutine_handle<>) const noexcept {}
+        constexpr void await_resume ()                   const noexcept {}
+    };
 }
 
 ////////////////////////////////////////////////////////////////////////
 // Definition of the 'task' coroutine type used by this example
-
-#include<variant>
+//
+// task<T> produces one value of type T (or a reference for task<T &>, nothing
+// for task<void>). The result is constructed in place inside the promise, i.e.
+// inside the coroutine frame, by return_value() and moved out to the awaiter by
+// await_resume(), so move-only and large payloads are never copied.
+//
+// Exception-free mode
+//
+// With -fno-exceptions (or -DCORO_NO_EXCEPTIONS) the lowered resume functions
+// have no try/catch. A task fails with `co_return std::unexpected(ec)`, which
+// stores the std::error_code in the promise where the exception_ptr would go.
+// After every `co_await` of a task the lowering checks the awaiter's error():
+// a set error is copied into the awaiting coroutine's promise and it leaves
+// through its final suspend-point, so the error travels up the continuation
+// chain the way an exception would unwind it. The root observes it through
+// task::try_execute().
+//
+// Cancellation
+//
+// The promise carries a cancellation_token that task::awaiter passes on to the
+// child it awaits. Every lowered task's resume function starts with a
+// cancellation point: if the token is set the coroutine does not continue, it
+// marks its promise cancelled and transfers straight to its continuation. The
+// frame stays parked at the suspend-point it was resumed from, so when the
+// owning task is destroyed the ordinary __X_destroy path for that
+// suspend-point cleans it up; nothing is thrown. A coroutine resumed by a
+// cancelled child does the same, up to the root, where execute() reports
+// std::errc::operation_canceled. The exceptions are steps.cpp and
+// steps_direct.cpp, which bench/dispatch.cpp uses to time the bare dispatch:
+// they have no cancellation point and ignore the token.
+//
+// Some awaiters complete their operation on the coroutine's behalf before they
+// resume it, handing it a lock or a value. They declare `static constexpr bool
+// hands_over = true`, and a coroutine resumed out of one does not stop at the
+// cancellation point, which would strand what it was given. Each lowering
+// lists the awaiter of every suspend-point in a table next to the resume
+// function,
+//
+//   static constexpr auto & __f_cancellable = __cancellation_points<std::suspend_always, ...>;
+//
+// and its cancellation point reads the entry of the suspend-point it resumes
+// from, once the token is set.
+//
+// Context
+//
+// The promise also carries a pointer to a task_context (request id, deadline,
+// tracing span), inherited the same way as the token, see context.hpp.
+//
+// Frame allocation
+//
+// By default task frames come from frame_allocator. A coroutine whose leading
+// parameters are (std::allocator_arg_t, std::pmr::memory_resource *) gets its
+// frame from that resource instead, the way the compiler would pick the
+// promise's operator new(size, args...) over operator new(size):
+//
+//   task<int> request(std::allocator_arg_t, std::pmr::memory_resource *, int n);
+//
+// and the promise keeps the resource for its children: every lowered resume
+// function opens a __frame_resource_scope, so the ramps called from the body
+// allocate from the same resource, and task::awaiter (also through start(),
+// for when_all() and the like) passes it on to an awaited task created
+// elsewhere. A whole request can then live in one
+// std::pmr::monotonic_buffer_resource that is released in one go once the
+// request is done. The resource is stored behind each frame for operator delete.
+//
+// Children of a when_all() that hop onto different thread_pool workers
+// allocate and free from the resource at the same time, and neither
+// monotonic_buffer_resource nor unsynchronized_pool_resource is safe for that.
+// Keep such a request on one thread, or give it a synchronized resource
+// (std::pmr::synchronized_pool_resource, or an unsynchronized one behind a lock).
+
+#if !defined(CORO_NO_EXCEPTIONS) && !defined(__cpp_exceptions)
+#define CORO_NO_EXCEPTIONS
+#endif
+
+#include<system_error>
+#ifdef CORO_NO_EXCEPTIONS
+#include<cstdlib>
+#include<expected>
+#else
 #include<exception>
+#endif
+#include<cstring>
+#include<memory_resource>
+#include "cancellation.hpp"
+#include "context.hpp"
+#include "frame_allocator.hpp"
+
+// The default allocation of frames and of the frame-like states of
+// thread_pool::spawn() and reactor::spawn(): frame_allocator's free-lists, or
+// the global heap when built with -DCORO_NO_FRAME_ALLOCATOR.
+inline void * __allocate_frame(std::size_t size)
+{
+#ifndef CORO_NO_FRAME_ALLOCATOR
+    return frame_allocator::allocate(size);
+#else
+    return ::operator new(size);
+#endif
+}
 
-class task
+inline void __deallocate_frame(void * ptr, std::size_t size) noexcept
 {
+#ifndef CORO_NO_FRAME_ALLOCATOR
+    frame_allocator::deallocate(ptr, size);
+#else
+    ::operator delete(ptr, size);
+#endif
+}
+
+// Whether a coroutine resumed out of a co_await on Awaiter may stop at its
+// cancellation point, and one entry of that per suspend-point, see "Cancellation".
+template<typename Awaiter> inline constexpr bool __cancellable_resume = !requires { requires Awaiter::hands_over; };
+
+template<typename... Awaiters> inline constexpr bool __cancellation_points[] = {__cancellable_resume<Awaiters>...};
+
+template<typename T = void> class task;
+template<typename T = void> class eager_task;
+
+// Parts of task<T>::promise_type that don't depend on T.
+class __task_promise_base
+{
+    private:
+        template<typename T> friend class task;
+        template<typename T> friend class eager_task;
+        std::coroutine_handle<> continuation_;
+        cancellation_token      token_;
+        const task_context *    context_   = nullptr;
+        bool                    cancelled_ = false;
+
     public:
-        struct awaiter;
+        struct final_awaiter
+        {
+            bool await_ready() noexcept { return false; }
+
+            template<typename Promise> std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+            {
+                return h.promise().continuation_;
+            }
+
+            void await_resume() noexcept {}
+        };
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        final_awaiter         final_suspend() noexcept { return {}; }
 
     public:
-        class promise_type
+        // O(1), for the lowering's cancellation points and for awaitables that
+        // want to give up early: await_suspend(coroutine_handle<Promise> h) can
+        // ask h.promise().
+        bool cancellation_requested() const noexcept
         {
-            private:
-                friend task::awaiter;
-                std::coroutine_handle<> continuation_;
-                std::variant<std::monostate, int, std::exception_ptr> result_;
+            return token_.is_cancellation_requested();
+        }
+
+        const cancellation_token & token() const noexcept
+        {
+            return token_;
+        }
+
+        // O(1) as well, null if the root was given none. See context.hpp.
+        const task_context * context() const noexcept
+        {
+            return context_;
+        }
+
+        // The coroutine awaiting this one, see async_stack.hpp.
+        std::coroutine_handle<> continuation() const noexcept
+        {
+            return continuation_;
+        }
+
+        // Called by the lowering instead of continuing the body. Returns the
+        // coroutine to transfer to, the frame is left suspended as it is.
+        std::coroutine_handle<> cancel() noexcept
+        {
+            cancelled_ = true;
+            return continuation_;
+        }
+
+    private:
+        friend class __frame_resource_scope;
+
+        // Where the frames of the coroutines called by this one come from, null
+        // for the default. See "Frame allocation" above.
+        std::pmr::memory_resource * resource_ = current_resource_;
+
+        // resource_ of the task whose resume function runs on this thread.
+        static inline thread_local std::pmr::memory_resource * current_resource_ = nullptr;
+
+    protected:
+        __task_promise_base() noexcept = default;
+
+        explicit __task_promise_base(std::pmr::memory_resource * resource) noexcept
+            : resource_(resource)
+        {}
+
+    public:
+        std::pmr::memory_resource * resource() const noexcept
+        {
+            return resource_;
+        }
+
+        // For a frame reopened from a file (frame_region.hpp): drops what
+        // pointed into the previous process, the continuation stays.
+        void __rebind(std::pmr::memory_resource * resource) noexcept
+        {
+            token_    = {};
+            context_  = nullptr;
+            resource_ = resource;
+        }
+
+    public:
+        static void * operator new(std::size_t size)
+        {
+            return allocate_frame(size, current_resource_);
+        }
+
+        // Picked by a ramp whose coroutine has leading (std::allocator_arg, resource) parameters.
+        template<typename... Args> static void * operator new(std::size_t size, std::allocator_arg_t, std::pmr::memory_resource * resource, Args &...)
+        {
+            return allocate_frame(size, resource);
+        }
+
+        static void operator delete(void *ptr, std::size_t size) noexcept
+        {
+            std::pmr::memory_resource * resource;
+            std::memcpy(&resource, static_cast<char *>(ptr) + size, sizeof resource);
+
+            if(resource != nullptr){
+                resource->deallocate(ptr, size + sizeof resource, alignof(std::max_align_t));
+            }
+            else{
+                __deallocate_frame(ptr, size + sizeof resource);
+            }
+        }
+
+    private:
+        // The resource is stored behind the frame, where operator delete finds it.
+        static void * allocate_frame(std::size_t size, std::pmr::memory_resource * resource)
+        {
+            void * frame;
+            if(resource != nullptr){
+                frame = resource->allocate(size + sizeof resource, alignof(std::max_align_t));
+            }
+            else{
+                frame = __allocate_frame(size + sizeof resource);
+            }
+            std::memcpy(static_cast<char *>(frame) + size, &resource, sizeof resource);
+            return frame;
+        }
+};
+
+// Entered by every lowered resume function of a task: while it runs, the ramps
+// it calls allocate from its promise's memory resource, see "Frame allocation".
+class __frame_resource_scope
+{
+    private:
+        std::pmr::memory_resource * outer_;
+        bool                        changed_;
+
+    public:
+        // Usually both are null, then it's a load and a compare.
+        explicit __frame_resource_scope(const __task_promise_base & promise) noexcept
+            : outer_(__task_promise_base::current_resource_)
+            , changed_(promise.resource_ != outer_)
+        {
+            if(changed_) [[unlikely]] {
+                __task_promise_base::current_resource_ = promise.resource_;
+            }
+        }
 
+        ~__frame_resource_scope()
+        {
+            if(changed_) [[unlikely]] {
+                __task_promise_base::current_resource_ = outer_;
+            }
+        }
+
+        __frame_resource_scope            (const __frame_resource_scope &) = delete;
+        __frame_resource_scope & operator=(const __frame_resource_scope &) = delete;
+};
+
+// Result storage with manual lifetime: `state_` records which member of the
+// union is alive. The success path of result() tests that single byte.
+#ifndef CORO_NO_EXCEPTIONS
+template<typename T> class __task_result
+{
+    private:
+        enum class result_state : unsigned char { empty, value, exception };
+
+        result_state state_ = result_state::empty;
+        union
+        {
+            T value_;
+            std::exception_ptr exception_;
+        };
+
+    public:
+        /**/  __task_result() noexcept {}
+        /**/ ~__task_result()
+        {
+            switch(state_){
+                case result_state::value    : std::destroy_at(std::addressof(value_    )); break;
+                case result_state::exception: std::destroy_at(std::addressof(exception_)); break;
+                default                     :                                              break;
+            }
+        }
+
+    public:
+        template<typename U = T>
+            requires std::constructible_from<T, U &&>
+        void return_value(U && value) noexcept(std::is_nothrow_constructible_v<T, U &&>)
+        {
+            ::new (static_cast<void *>(std::addressof(value_))) T(std::forward<U>(value));
+            state_ = result_state::value;
+        }
+
+        void unhandled_exception() noexcept
+        {
+            ::new (static_cast<void *>(std::addressof(exception_))) std::exception_ptr(std::current_exception());
+            state_ = result_state::exception;
+        }
+
+        T result() &&
+        {
+            if(state_ != result_state::value) [[unlikely]] {
+                std::rethrow_exception(std::move(exception_));
+            }
+            return std::move(value_);
+        }
+};
+
+template<typename T> class __task_result<T &>
+{
+    private:
+        T * value_ = nullptr;
+        std::exception_ptr exception_;
+
+    public:
+        void return_value(T & value) noexcept
+        {
+            value_ = std::addressof(value);
+        }
+
+        void unhandled_exception() noexcept
+        {
+            exception_ = std::current_exception();
+        }
+
+        T & result() &&
+        {
+            if(value_ == nullptr) [[unlikely]] {
+                std::rethrow_exception(std::move(exception_));
+            }
+            return *value_;
+        }
+};
+
+template<> class __task_result<void>
+{
+    private:
+        std::exception_ptr exception_;
+
+    public:
+        void return_void() noexcept {}
+
+        void unhandled_exception() noexcept
+        {
+            exception_ = std::current_exception();
+        }
+
+        void result() &&
+        {
+            if(exception_) [[unlikely]] {
+                std::rethrow_exception(std::move(exception_));
+            }
+        }
+};
+#else
+// Same layout with a std::error_code in place of the exception_ptr. It is
+// trivially copyable, so setting and propagating it costs two stores and no
+// reference counting. result() may only be called when error() is not set.
+template<typename T> class __task_result
+{
+    private:
+        enum class result_state : unsigned char { empty, value, error };
+
+        result_state state_ = result_state::empty;
+        union
+        {
+            T value_;
+            std::error_code error_;
+        };
+
+    public:
+        /**/  __task_result() noexcept {}
+        /**/ ~__task_result()
+        {
+            if(state_ == result_state::value){
+                std::destroy_at(std::addressof(value_));
+            }
+        }
+
+    public:
+        template<typename U = T>
+            requires std::constructible_from<T, U &&>
+        void return_value(U && value) noexcept(std::is_nothrow_constructible_v<T, U &&>)
+        {
+            ::new (static_cast<void *>(std::addressof(value_))) T(std::forward<U>(value));
+            state_ = result_state::value;
+        }
+
+        void return_value(std::unexpected<std::error_code> e) noexcept
+        {
+            set_error(e.error());
+        }
+
+        void set_error(std::error_code ec) noexcept
+        {
+            ::new (static_cast<void *>(std::addressof(error_))) std::error_code(ec);
+            state_ = result_state::error;
+        }
+
+        std::error_code error() const noexcept
+        {
+            return state_ == result_state::error ? error_ : std::error_code{};
+        }
+
+        T result() && noexcept
+        {
+            return std::move(value_);
+        }
+};
+
+template<typename T> class __task_result<T &>
+{
+    private:
+        T * value_ = nullptr;
+        std::error_code error_;
+
+    public:
+        void return_value(T & value) noexcept
+        {
+            value_ = std::addressof(value);
+        }
+
+        void return_value(std::unexpected<std::error_code> e) noexcept
+        {
+            set_error(e.error());
+        }
+
+        void set_error(std::error_code ec) noexcept
+        {
+            error_ = ec;
+        }
+
+        std::error_code error() const noexcept
+        {
+            return error_;
+        }
+
+        T & result() && noexcept
+        {
+            return *value_;
+        }
+};
+
+// A task<void> can't `co_return std::unexpected(...)` (a promise has either
+// return_void or return_value), it fails by propagating the error of a child.
+template<> class __task_result<void>
+{
+    private:
+        std::error_code error_;
+
+    public:
+        void return_void() noexcept {}
+
+        void set_error(std::error_code ec) noexcept
+        {
+            error_ = ec;
+        }
+
+        std::error_code error() const noexcept
+        {
+            return error_;
+        }
+
+        void result() && noexcept {}
+};
+#endif
+
+template<typename T> class task
+{
+    public:
+        struct awaiter;
+
+    public:
+        class promise_type: public __task_promise_base, public __task_result<T>
+        {
             public:
                 /**/  promise_type() noexcept {}
                 /**/ ~promise_type()          {}
 
-            public:
-                struct final_awaiter
-                {
-                    bool                    await_ready  ()                                      noexcept { return false; }
-                    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept { return h.promise().continuation_; }
-                    void                    await_resume ()                                      noexcept {}
-                };
+                // For coroutines with leading (std::allocator_arg, resource) parameters.
+                template<typename... Args> promise_type(std::allocator_arg_t, std::pmr::memory_resource * resource, Args &...) noexcept
+                    : __task_promise_base(resource)
+                {}
 
+            public:
                 task get_return_object() noexcept
                 {
-                    return task{std::coroutine_handle<task::promise_type>::from_promise(*this)};
+                    return task{std::coroutine_handle<promise_type>::from_promise(*this)};
                 }
-
-                std::suspend_always initial_suspend() noexcept { return {}; }
-                final_awaiter         final_suspend() noexcept { return {}; }
-
-                void return_value       (int result) noexcept { result_ = result;                   }
-                void unhandled_exception()           noexcept { result_ = std::current_exception(); }
         };
 
     private:
+        friend class frame_region;
+
         std::coroutine_handle<promise_type> coro_;
 
     public:
@@ -354,21 +1077,67 @@ class task
                     return false;
                 }
 
-                std::coroutine_handle<promise_type> await_suspend(std::coroutine_handle<> h) noexcept
+                template<typename Promise>
+                std::coroutine_handle<promise_type> await_suspend(std::coroutine_handle<Promise> h) noexcept
                 {
-                    coro_.promise().continuation_ = h;
+                    promise_type & child = coro_.promise();
+                    child.continuation_ = h;
+
+                    // The child shares the awaiting task's token, context and
+                    // memory resource unless it was given its own.
+                    if constexpr (std::derived_from<Promise, __task_promise_base>){
+                        if(!child.token_.can_be_cancelled()){
+                            child.token_ = h.promise().token_;
+                        }
+                        if(child.context_ == nullptr){
+                            child.context_ = h.promise().context_;
+                        }
+                        if(child.resource_ == nullptr){
+                            child.resource_ = h.promise().resource_;
+                        }
+                    }
                     return coro_;
                 }
 
-                int await_resume()
+                // await_suspend() for combinators that await several tasks at
+                // once (see when_all.hpp): `continuation` is resumed instead of
+                // an awaiting coroutine. Returns the child, ready to be resumed.
+                std::coroutine_handle<promise_type> start(std::coroutine_handle<> continuation, const cancellation_token & token, const task_context * context,
+                                                          std::pmr::memory_resource * resource) noexcept
                 {
-                    if(coro_.promise().result_.index() == 2){
-                        std::rethrow_exception(std::get<2>(std::move(coro_.promise().result_)));
+                    promise_type & child = coro_.promise();
+                    child.continuation_ = continuation;
+
+                    if(!child.token_.can_be_cancelled()){
+                        child.token_ = token;
                     }
-                    else{
-                        return std::get<1>(coro_.promise().result_);
+                    if(child.context_ == nullptr){
+                        child.context_ = context;
                     }
+                    if(child.resource_ == nullptr){
+                        child.resource_ = resource;
+                    }
+                    return coro_;
+                }
+
+                T await_resume()
+                {
+                    return std::move(coro_.promise()).result();
+                }
+
+                // Checked by the lowering before await_resume(), a cancelled child has no result.
+                bool cancelled() const noexcept
+                {
+                    return coro_.promise().cancelled_;
+                }
+
+#ifdef CORO_NO_EXCEPTIONS
+                // Checked by the lowering before await_resume(), see "Exception-free mode" above.
+                std::error_code error() const noexcept
+                {
+                    return coro_.promise().error();
                 }
+#endif
         };
 
         awaiter operator co_await() && noexcept
@@ -382,20 +1151,71 @@ class task
         {}
 
     public:
-        int execute()
+        // Attach a token before the task starts, children it awaits inherit it.
+        void set_cancellation_token(cancellation_token token) noexcept
+        {
+            coro_.promise().token_ = token;
+        }
+
+        // Likewise for the context, which must outlive the task, see context.hpp.
+        void set_context(const task_context * context) noexcept
+        {
+            coro_.promise().context_ = context;
+        }
+
+        T execute()
         {
             // add this member function to access result from a non-coroutine
             // need to setup continuation_ to describe what to do after task finished, it's noop_coroutine since execute() is not a coroutine
+            // so the task must finish on this thread, see sync_wait.hpp for one that may not
 
             awaiter{coro_}.await_suspend(std::noop_coroutine());
             coro_.resume();
+#ifdef CORO_NO_EXCEPTIONS
+            // An error or cancellation nobody handled, the equivalent of an uncaught exception.
+            if(awaiter{coro_}.cancelled() || awaiter{coro_}.error()) [[unlikely]] {
+                std::abort();
+            }
+#else
+            // The frames unwound without throwing, only the root reports it.
+            if(awaiter{coro_}.cancelled()) [[unlikely]] {
+                throw std::system_error(std::make_error_code(std::errc::operation_canceled));
+            }
+#endif
             return awaiter{coro_}.await_resume();
         }
+
+#ifdef CORO_NO_EXCEPTIONS
+        // Like execute() but hands an error back to the caller.
+        template<typename U = T>
+            requires (!std::is_reference_v<U>)
+        std::expected<U, std::error_code> try_execute()
+        {
+            awaiter{coro_}.await_suspend(std::noop_coroutine());
+            coro_.resume();
+
+            if(awaiter{coro_}.cancelled()) [[unlikely]] {
+                return std::unexpected(std::make_error_code(std::errc::operation_canceled));
+            }
+            if(std::error_code ec = awaiter{coro_}.error()) [[unlikely]] {
+                return std::unexpected(ec);
+            }
+            if constexpr (std::is_void_v<U>){
+                return {};
+            }
+            else{
+                return awaiter{coro_}.await_resume();
+            }
+        }
+#endif
 };
 
 //////////////////////
 // Helpers used by Coroutine Lowering
 
+#include "frame_layout.hpp"
+#include "trace.hpp"
+
 template<typename T> struct manual_lifetime
 {
     private:
@@ -468,6 +1288,24 @@ struct destructor_guard<T>
 // Class-template argument deduction to simplify usage
 template<typename T> destructor_guard(manual_lifetime<T>& obj) -> destructor_guard<T>;
 
+// Storage for a coroutine-state that is embedded in another object instead of
+// being heap-allocated, e.g. a child frame inside the frame of the coroutine that
+// awaits it, or a root frame on the stack of the code calling task::execute().
+template<typename State> struct frame_slot
+{
+    alignas(State) std::byte storage[sizeof(State)];
+};
+
+// Deleter used by the placement ramp functions, the storage belongs to the
+// caller so only the coroutine-state's destructor is run.
+struct __inline_frame_deleter
+{
+    template<typename State> void operator()(State *state) const noexcept
+    {
+        std::destroy_at(state);
+    }
+};
+
 template<typename Promise, typename... Params> Promise construct_promise([[maybe_unused]] Params &... params)
 {
     if constexpr (std::constructible_from<Promise, Params &...>){
@@ -478,7 +1316,181 @@ template<typename Promise, typename... Params> Promise construct_promise([[maybe
     }
 }
 
+//////
+// Prologue and epilogue of the lowered functions
+//
+// Every lowering starts its ramp and resume functions and ends its final
+// suspend-point the same way, so those parts live here instead of in each
+// lowered file:
+//
+//   task<int> f(int x)
+//   {
+//       std::unique_ptr<__f_state> state(new __f_state(...));
+//       return __ramp(std::move(state), &__f_resume);
+//   }
+//
+//   __coroutine_state *__f_resume(__coroutine_state *s)
+//   {
+//       auto *state = static_cast<__f_state *>(s);
+//       __resume_scope resume_scope(state);
+//
+//       if(auto *next = __cancellation_point(state, __f_cancellable)) [[unlikely]] {
+//           return next;
+//       }
+//       ... the body ...
+//   final_suspend:
+//       return __final_suspend(state, state->__tmp2(), 1);
+//   }
+//
+// They take a coroutine-state of either layout, see "Compact frames".
+
+// The address a handle to `state` holds.
+template<typename State> __coroutine_state * __frame_of(State * state) noexcept
+{
+    if constexpr (std::derived_from<State, __compact_coroutine_state>){
+        return state->__handle();
+    }
+    else{
+        return state;
+    }
+}
+
+template<typename State> std::uint32_t __suspend_point_of(const State * state) noexcept
+{
+    if constexpr (std::derived_from<State, __compact_coroutine_state>){
+        return state->__suspend_point();
+    }
+    else{
+        return state->__suspend_point;
+    }
+}
+
+template<typename State> auto __promise_handle(State * state) noexcept
+{
+    return std::coroutine_handle<decltype(State::__promise)>::from_promise(state->__promise);
+}
+
+// The rest of a ramp function once the coroutine-state is constructed: get the
+// return object and run the initial suspend, then either leave the coroutine
+// parked at suspend-point 0 or pass the frame to `start`, which runs the body.
+template<typename State, typename Deleter, typename Start>
+auto __ramp(std::unique_ptr<State, Deleter> state, Start start)
+{
+    CORO_TRACE_EVENT(ramp, __frame_of(state.get()), 0);
+    decltype(auto) return_obj = state->__promise.get_return_object();
+
+    state->__tmp1().construct_from([&]() -> decltype(auto)
+    {
+        return state->__promise.initial_suspend();
+    });
+
+    if(!state->__tmp1().get().await_ready()){
+        state->__tmp1().get().await_suspend(__promise_handle(state.get()));
+        CORO_TRACE_EVENT(initial_suspend, __frame_of(state.get()), 0);
+        state.release();
+    }
+    else{
+        // Coroutine did not suspend. Start executing the body immediately.
+        start(__frame_of(state.release()));
+    }
+    return return_obj;
+}
+
+// Opened first thing by the resume function of a task: traces the resume, and
+// the ramps called from the body allocate from the promise's memory resource.
+class __resume_scope
+{
+    private:
+        __frame_resource_scope resource_scope_;
+
+    public:
+        template<typename State> explicit __resume_scope(State * state) noexcept
+            : resource_scope_(state->__promise)
+        {
+            CORO_TRACE_EVENT(resume, __frame_of(state), __suspend_point_of(state));
+        }
+};
+
+// The cancellation point of a resume function, see "Cancellation": the frame to
+// transfer to if the coroutine stops here, null if it carries on.
+template<typename State, std::size_t N>
+__coroutine_state * __cancellation_point(State * state, const bool (& cancellable)[N]) noexcept
+{
+    if(state->__promise.cancellation_requested() && cancellable[__suspend_point_of(state)]) [[unlikely]] {
+        return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+    }
+    return nullptr;
+}
+
+// Frees the coroutine-state at the end of a resume or destroy function. A frame
+// started by a placement ramp only has its destructor run.
+template<typename State> void __delete_state(State * state) noexcept
+{
+    if constexpr (requires { state->__inline_frame; }){
+        if(state->__inline_frame){
+            std::destroy_at(state);
+            return;
+        }
+    }
+    delete state;
+}
+
+// `co_await promise.final_suspend()` at suspend-point `point`, with the final
+// awaiter in `tmp`. Returns the frame to transfer to; if the awaiter doesn't
+// suspend, execution flows off the end and the coroutine-state is destroyed.
+template<typename State, typename Awaiter>
+__coroutine_state * __final_suspend(State * state, manual_lifetime<Awaiter> & tmp, std::uint32_t point)
+{
+    {
+        tmp.construct_from([&]() noexcept
+        {
+            return state->__promise.final_suspend();
+        });
+        destructor_guard tmp_dtor{tmp};
+
+        if(!tmp.get().await_ready()){
+            // Mark as final suspend-point.
+            if constexpr (std::derived_from<State, __compact_coroutine_state>){
+                state->__set_suspend_point(point);
+                state->__set_done();
+            }
+            else{
+                state->__suspend_point = static_cast<decltype(state->__suspend_point)>(point);
+                state->__resume = nullptr;
+            }
+            CORO_TRACE_EVENT(final_suspend, __frame_of(state), point);
+            __release_running_frame();
+
+            // The frame may be destroyed by its owner as soon as the awaiter has
+            // handed it over, so nothing touches it after await_suspend().
+            if constexpr (std::is_void_v<decltype(tmp.get().await_suspend(__promise_handle(state)))>){
+                tmp.get().await_suspend(__promise_handle(state));
+                tmp_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            else{
+                auto h = tmp.get().await_suspend(__promise_handle(state));
+                tmp_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+        }
+        tmp.get().await_resume();
+    }
+
+    //  Destroy coroutine-state if execution flows off end of coroutine
+    CORO_TRACE_EVENT(destroy, __frame_of(state), point);
+    __release_running_frame();
+    __delete_state(state);
+
+    return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+}
+
 
 // Forward declaration of a function called by the function we are lowering.
-task f(int x);
-task g(int x);
+task<int> f(int x);
+task<int> g(int x);
+
+// Placement ramps: construct the coroutine-state in caller-provided storage of
+// at least sizeof(__f_state) / sizeof(__g_state) bytes, see f.hpp and g.hpp.
+task<int> f(std::in_place_t, void *slot, int x);
+task<int> g(std::in_place_t, void *slot, int x);
@@ -0,0 +1,251 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// eager_task<T>: a task that starts running in its ramp
+//
+//   eager_task<int> lookup(std::span<const int> cache, thread_pool & pool, int key) {
+//     if(key < cache.size())
+//       co_return cache[key];      // hit: finished before the ramp returns
+//     co_await pool.schedule();    // miss: really suspends
+//     co_return key;
+//   }
+//
+//   int v = co_await lookup(cache, pool, key);
+//
+// task<T> always suspends at its initial suspend-point, so awaiting even a
+// child that has nothing to wait for costs a suspend of the parent, a transfer
+// into the child, a transfer back from its final suspend-point and a re-entry
+// of the parent through its switch. eager_task's initial_suspend() is
+// suspend_never: the ramp runs the body until its first real suspend-point,
+// or to the end. In the latter case awaiter::await_ready() returns true and
+// the awaiting coroutine takes the non-suspending branch of the co_await, it
+// calls await_resume() straight away.
+//
+// Since the body may still be running on another thread when it is awaited,
+// the handover is a small state machine in the promise:
+//
+//   running --await_suspend()--> awaited --final suspend--> completed: resumes the continuation
+//   running --final suspend----> completed --await_ready() / await_suspend()--> carry on without suspending
+//
+// The frame stays at its final suspend-point until the eager_task is destroyed,
+// the result lives in it.
+//
+// Going to completed takes an atomic exchange, which would be most of the cost
+// of a body that never suspends. But until the ramp returns nobody holds the
+// eager_task to await it, so the ramp opens an __eager_ramp_scope around the
+// body and a final suspend-point reached inside it stores completed without
+// the read-modify-write.
+//
+// An eager task is already running when it could be handed a cancellation
+// token, so it has none: it is never cancelled itself and neither are the
+// tasks it awaits, unless they were given a token of their own. The coroutine
+// awaiting it still stops at its own cancellation points. For the same reason
+// it has no context (see context.hpp). The memory resource
+// is inherited as usual, from the task whose resume function calls the ramp
+// (see "Frame allocation" in defs.hpp).
+
+#include<atomic>
+#include "defs.hpp"
+
+// Marks, for the calling thread, the frame whose eager ramp is running.
+class __eager_ramp_scope
+{
+    private:
+        const __coroutine_state * outer_;
+
+        static inline thread_local const __coroutine_state * current_ = nullptr;
+
+    public:
+        explicit __eager_ramp_scope(const __coroutine_state * frame) noexcept
+            : outer_(current_)
+        {
+            current_ = frame;
+        }
+
+        ~__eager_ramp_scope()
+        {
+            current_ = outer_;
+        }
+
+        __eager_ramp_scope            (const __eager_ramp_scope &) = delete;
+        __eager_ramp_scope & operator=(const __eager_ramp_scope &) = delete;
+
+    public:
+        // True if `frame`'s ramp hasn't returned yet, so nothing can be awaiting it.
+        static bool in_ramp(const __coroutine_state * frame) noexcept
+        {
+            return current_ == frame;
+        }
+};
+
+template<typename T> class eager_task
+{
+    public:
+        struct awaiter;
+
+    public:
+        class promise_type: public __task_promise_base, public __task_result<T>
+        {
+            private:
+                friend class eager_task;
+
+                enum class phase : unsigned char { running, awaited, completed };
+                std::atomic<phase> phase_ {phase::running};
+
+                // The body is done: the awaiting coroutine to transfer to, if
+                // there is one already.
+                std::coroutine_handle<> complete() noexcept
+                {
+                    if(__eager_ramp_scope::in_ramp(static_cast<__coroutine_state *>(std::coroutine_handle<promise_type>::from_promise(*this).address()))){
+                        phase_.store(phase::completed, std::memory_order_relaxed);
+                        return std::noop_coroutine();
+                    }
+                    if(phase_.exchange(phase::completed, std::memory_order_acq_rel) == phase::awaited){
+                        return continuation();
+                    }
+                    return std::noop_coroutine();
+                }
+
+            public:
+                /**/  promise_type() noexcept {}
+                /**/ ~promise_type()          {}
+
+                // For coroutines with leading (std::allocator_arg, resource) parameters.
+                template<typename... Args> promise_type(std::allocator_arg_t, std::pmr::memory_resource * resource, Args &...) noexcept
+                    : __task_promise_base(resource)
+                {}
+
+            public:
+                struct final_awaiter
+                {
+                    bool await_ready() noexcept { return false; }
+
+                    std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept
+                    {
+                        return h.promise().complete();
+                    }
+
+                    void await_resume() noexcept {}
+                };
+
+                std::suspend_never initial_suspend() noexcept { return {}; }
+                final_awaiter        final_suspend() noexcept { return {}; }
+
+                // Unlike a task, an eager task may give up before anyone awaits it.
+                std::coroutine_handle<> cancel() noexcept
+                {
+                    __task_promise_base::cancel();
+                    return complete();
+                }
+
+                eager_task get_return_object() noexcept
+                {
+                    return eager_task{std::coroutine_handle<promise_type>::from_promise(*this)};
+                }
+        };
+
+    private:
+        std::coroutine_handle<promise_type> coro_;
+
+    public:
+        eager_task(eager_task && t) noexcept
+            : coro_(std::exchange(t.coro_, {}))
+        {}
+
+        // Must not be destroyed while the body is still running somewhere.
+        ~eager_task()
+        {
+            if(coro_){
+                coro_.destroy();
+            }
+        }
+
+        eager_task & operator=(eager_task && t) noexcept
+        {
+            eager_task tmp = std::move(t);
+            using std::swap;
+
+            swap(coro_, tmp.coro_);
+            return *this;
+        }
+
+        struct awaiter
+        {
+            private:
+                std::coroutine_handle<promise_type> coro_;
+
+            public:
+                explicit awaiter(std::coroutine_handle<promise_type> h) noexcept
+                    : coro_(h)
+                {}
+
+                // True once the body has finished, typically already in the ramp.
+                bool await_ready() noexcept
+                {
+                    return coro_.promise().phase_.load(std::memory_order_acquire) == promise_type::phase::completed;
+                }
+
+                // False if the body finished after await_ready(): then it didn't
+                // see us, and we carry on without suspending.
+                bool await_suspend(std::coroutine_handle<> h) noexcept
+                {
+                    promise_type & child = coro_.promise();
+                    child.continuation_ = h;
+
+                    auto expected = promise_type::phase::running;
+                    return child.phase_.compare_exchange_strong(expected, promise_type::phase::awaited,
+                                                                std::memory_order_acq_rel, std::memory_order_acquire);
+                }
+
+                T await_resume()
+                {
+                    return std::move(coro_.promise()).result();
+                }
+
+                // Checked by the lowering before await_resume(), a cancelled child has no result.
+                bool cancelled() const noexcept
+                {
+                    return coro_.promise().cancelled_;
+                }
+
+#ifdef CORO_NO_EXCEPTIONS
+                // Checked by the lowering before await_resume(), see "Exception-free mode" in defs.hpp.
+                std::error_code error() const noexcept
+                {
+                    return coro_.promise().error();
+                }
+#endif
+        };
+
+        awaiter operator co_await() && noexcept
+        {
+            return awaiter{coro_};
+        }
+
+    private:
+        explicit eager_task(std::coroutine_handle<promise_type> h) noexcept
+            : coro_(h)
+        {}
+
+    public:
+        // Whether the body has finished.
+        bool ready() const noexcept
+        {
+            return awaiter{coro_}.await_ready();
+        }
+
+        // The result for a caller that is not a coroutine. Only valid once
+        // ready(), e.g. when the body never suspended; sync_wait() waits for it.
+        T execute()
+        {
+#ifdef CORO_NO_EXCEPTIONS
+            if(awaiter{coro_}.cancelled() || awaiter{coro_}.error()) [[unlikely]] {
+                std::abort();
+            }
+#else
+            if(awaiter{coro_}.cancelled()) [[unlikely]] {
+                throw std::system_error(std::make_error_code(std::errc::operation_canceled));
+            }
+#endif
+            return awaiter{coro_}.await_resume();
+        }
+};
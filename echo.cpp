@@ -0,0 +1,564 @@
+#include "echo.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of echo_session(async_fd conn)
+//
+// task<void> echo_session(async_fd conn) {
+//   char buffer[256];
+//   for(;;) {
+//     io_result r = co_await async_read(conn, buffer, sizeof buffer);
+//     if(r.error || r.bytes == 0) break;
+//     io_result w = co_await async_write(conn, buffer, r.bytes);
+//     if(w.error) break;
+//   }
+// }
+//
+// The I/O awaiters' await_suspend() returns void, like schedule_awaiter in
+// hop.cpp: after parking on the reactor we return to whoever resumed us.
+
+/////
+// The "ramp" function
+
+task<void> echo_session(async_fd conn)
+{
+    std::unique_ptr<__echo_session_state> state(new __echo_session_state(static_cast<async_fd &&>(conn)));
+    return __ramp(std::move(state), &__echo_session_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __echo_session_cancellable = __cancellation_points<std::suspend_always, read_awaiter, write_awaiter, task<void>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__echo_session_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__echo_session_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __echo_session_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            case 2: goto suspend_point_2;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+loop_start:
+        //  io_result r = co_await async_read(conn, buffer, sizeof buffer);
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return async_read(state->conn, state->buffer, sizeof state->buffer);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__echo_session_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            io_result r = [&]() -> decltype(auto)
+            {
+                destructor_guard tmp2_dtor{state->__tmp2()};
+                return state->__tmp2().get().await_resume();
+            }();
+
+            //  if(r.error || r.bytes == 0) break;
+            if(r.error || r.bytes == 0){
+                goto loop_end;
+            }
+
+            //  io_result w = co_await async_write(conn, buffer, r.bytes);
+            state->__tmp3().construct_from([&]()
+            {
+                return async_write(state->conn, state->buffer, r.bytes);
+            });
+            destructor_guard tmp3_dtor{state->__tmp3()};
+
+            if(!state->__tmp3().get().await_ready()){
+                state->__suspend_point = 2;
+                CORO_TRACE_EVENT(suspend, state, 2);
+                __release_running_frame();
+                state->__tmp3().get().await_suspend(std::coroutine_handle<__echo_session_promise_t>::from_promise(state->__promise));
+
+                tmp3_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp3_dtor.cancel();
+        }
+
+suspend_point_2:
+        {
+            io_result w = [&]() -> decltype(auto)
+            {
+                destructor_guard tmp3_dtor{state->__tmp3()};
+                return state->__tmp3().get().await_resume();
+            }();
+
+            //  if(w.error) break;
+            if(w.error){
+                goto loop_end;
+            }
+        }
+        goto loop_start;
+
+loop_end:
+        //  flowing off the end
+        state->__promise.return_void();
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp4(), 3);
+}
+
+/////
+// The "destroy" function
+
+void __echo_session_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__echo_session_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        case 3: goto suspend_point_3;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+suspend_point_3:
+    state->__tmp4().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __echo_session_sites[] = {"initial suspend", "co_await async_read(conn, buffer, sizeof buffer)", "co_await async_write(conn, buffer, r.bytes)", "final suspend"};
+static const lowered_frame_info<__echo_session_state> __echo_session_frame_info{&__echo_session_destroy, "echo_session(async_fd conn)", __echo_session_sites};
+
+//////////////////////
+// Begin lowering of echo_client(async_fd conn, int requests, std::int64_t *latencies)
+//
+// task<void> echo_client(async_fd conn, int requests, std::int64_t *latencies) {
+//   char buffer[64] = {};
+//   for(int i = 0; i < requests; ++i) {
+//     auto start = std::chrono::steady_clock::now();
+//     io_result w = co_await async_write(conn, buffer, sizeof buffer);
+//     if(w.error) co_return;
+//     for(std::size_t got = 0; got < sizeof buffer;) {
+//       io_result r = co_await async_read(conn, buffer + got, sizeof buffer - got);
+//       if(r.error || r.bytes == 0) co_return;
+//       got += r.bytes;
+//     }
+//     latencies[i] = (std::chrono::steady_clock::now() - start).count();
+//   }
+// }
+
+/////
+// The "ramp" function
+
+task<void> echo_client(async_fd conn, int requests, std::int64_t *latencies)
+{
+    std::unique_ptr<__echo_client_state> state(new __echo_client_state(static_cast<async_fd &&>(conn), static_cast<int &&>(requests), static_cast<std::int64_t * &&>(latencies)));
+    return __ramp(std::move(state), &__echo_client_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __echo_client_cancellable = __cancellation_points<std::suspend_always, write_awaiter, read_awaiter, task<void>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__echo_client_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__echo_client_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __echo_client_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            case 2: goto suspend_point_2;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  for(int i = 0; i < requests; ++i)
+        state->i = 0;
+
+loop_condition:
+        if(!(state->i < state->requests)){
+            goto loop_end;
+        }
+
+        //  auto start = std::chrono::steady_clock::now();
+        state->start = std::chrono::steady_clock::now();
+
+        //  io_result w = co_await async_write(conn, buffer, sizeof buffer);
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return async_write(state->conn, state->buffer, sizeof state->buffer);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__echo_client_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            io_result w = [&]() -> decltype(auto)
+            {
+                destructor_guard tmp2_dtor{state->__tmp2()};
+                return state->__tmp2().get().await_resume();
+            }();
+
+            //  if(w.error) co_return;
+            if(w.error){
+                state->__promise.return_void();
+                goto final_suspend;
+            }
+        }
+
+        //  for(std::size_t got = 0; got < sizeof buffer;)
+        state->got = 0;
+
+read_loop_condition:
+        if(!(state->got < sizeof state->buffer)){
+            goto read_loop_end;
+        }
+
+        //  io_result r = co_await async_read(conn, buffer + got, sizeof buffer - got);
+        {
+            state->__tmp3().construct_from([&]()
+            {
+                return async_read(state->conn, state->buffer + state->got, sizeof state->buffer - state->got);
+            });
+            destructor_guard tmp3_dtor{state->__tmp3()};
+
+            if(!state->__tmp3().get().await_ready()){
+                state->__suspend_point = 2;
+                CORO_TRACE_EVENT(suspend, state, 2);
+                __release_running_frame();
+                state->__tmp3().get().await_suspend(std::coroutine_handle<__echo_client_promise_t>::from_promise(state->__promise));
+
+                tmp3_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp3_dtor.cancel();
+        }
+
+suspend_point_2:
+        {
+            io_result r = [&]() -> decltype(auto)
+            {
+                destructor_guard tmp3_dtor{state->__tmp3()};
+                return state->__tmp3().get().await_resume();
+            }();
+
+            //  if(r.error || r.bytes == 0) co_return;
+            if(r.error || r.bytes == 0){
+                state->__promise.return_void();
+                goto final_suspend;
+            }
+
+            //  got += r.bytes;
+            state->got += r.bytes;
+        }
+        goto read_loop_condition;
+
+read_loop_end:
+        //  latencies[i] = (std::chrono::steady_clock::now() - start).count();
+        state->latencies[state->i] = (std::chrono::steady_clock::now() - state->start).count();
+
+        ++state->i;
+        goto loop_condition;
+
+loop_end:
+        //  flowing off the end
+        state->__promise.return_void();
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp4(), 3);
+}
+
+/////
+// The "destroy" function
+
+void __echo_client_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__echo_client_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        case 3: goto suspend_point_3;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+suspend_point_3:
+    state->__tmp4().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __echo_client_sites[] = {"initial suspend", "co_await async_write(conn, buffer, sizeof buffer)", "co_await async_read(conn, buffer + got, sizeof buffer - got)", "final suspend"};
+static const lowered_frame_info<__echo_client_state> __echo_client_frame_info{&__echo_client_destroy, "echo_client(conn, requests, latencies)", __echo_client_sites};
+
+//////////////////////
+// Begin lowering of echo_server(async_fd &listener, int connections)
+//
+// task<int> echo_server(async_fd &listener, int connections) {
+//   for(int i = 0; i < connections; ++i) {
+//     accept_result a = co_await async_accept(listener);
+//     if(a.error) co_return i;
+//     listener.context().spawn(echo_session(std::move(a.socket)));
+//   }
+//   co_return connections;
+// }
+
+/////
+// The "ramp" function
+
+task<int> echo_server(async_fd &listener, int connections)
+{
+    std::unique_ptr<__echo_server_state> state(new __echo_server_state(listener, static_cast<int &&>(connections)));
+    return __ramp(std::move(state), &__echo_server_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __echo_server_cancellable = __cancellation_points<std::suspend_always, accept_awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__echo_server_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__echo_server_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __echo_server_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  for(int i = 0; i < connections; ++i)
+        state->i = 0;
+
+loop_condition:
+        if(!(state->i < state->connections)){
+            goto loop_end;
+        }
+
+        //  accept_result a = co_await async_accept(listener);
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return async_accept(state->listener);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__echo_server_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            accept_result a = [&]() -> decltype(auto)
+            {
+                destructor_guard tmp2_dtor{state->__tmp2()};
+                return state->__tmp2().get().await_resume();
+            }();
+
+            //  if(a.error) co_return i;
+            if(a.error){
+                state->__promise.return_value(state->i);
+                goto final_suspend;
+            }
+
+            //  listener.context().spawn(echo_session(std::move(a.socket)));
+            state->listener.context().spawn(echo_session(std::move(a.socket)));
+        }
+
+        ++state->i;
+        goto loop_condition;
+
+loop_end:
+        //  co_return connections;
+        state->__promise.return_value(state->connections);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __echo_server_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__echo_server_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __echo_server_sites[] = {"initial suspend", "co_await async_accept(listener)", "final suspend"};
+static const lowered_frame_info<__echo_server_state> __echo_server_frame_info{&__echo_server_destroy, "echo_server(listener, connections)", __echo_server_sites};
@@ -0,0 +1,159 @@
+#pragma once
+#include<chrono>
+#include "reactor.hpp"
+//////////////////////
+// Coroutine-states of the loopback echo server and client, see echo.cpp for
+// the lowering and bench/echo.cpp for the benchmark driving them.
+
+task<void> echo_session(async_fd conn);
+task<void> echo_client (async_fd conn, int requests, std::int64_t *latencies);
+task<int>  echo_server (async_fd &listener, int connections);
+
+using __echo_session_promise_t = std::coroutine_traits<task<void>, async_fd>::promise_type;
+using __echo_client_promise_t  = std::coroutine_traits<task<void>, async_fd, int, std::int64_t *>::promise_type;
+using __echo_server_promise_t  = std::coroutine_traits<task<int>, async_fd &, int>::promise_type;
+
+__coroutine_state * __echo_session_resume (__coroutine_state *);
+void                __echo_session_destroy(__coroutine_state *);
+
+__coroutine_state * __echo_client_resume (__coroutine_state *);
+void                __echo_client_destroy(__coroutine_state *);
+
+__coroutine_state * __echo_server_resume (__coroutine_state *);
+void                __echo_server_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definitions
+
+struct __echo_session_state : __coroutine_state_with_promise<__echo_session_promise_t>
+{
+    __suspend_index_t<4> __suspend_point = 0;
+
+    // Argument copies
+    async_fd conn;
+
+    // Local variables that live across a suspend-point
+    char buffer[256];
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                         // initial suspend
+        frame_scope<manual_lifetime<read_awaiter>>,                                // co_await async_read(...)
+        frame_scope<manual_lifetime<write_awaiter>>,                               // co_await async_write(...)
+        frame_scope<manual_lifetime<task<void>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+    auto & __tmp4() noexcept { return __frame.get<3, 0>(); }
+
+    __echo_session_state(async_fd && conn)
+        : conn(static_cast<async_fd &&>(conn))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __echo_session_resume;
+            this->__destroy = &__echo_session_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __echo_session_promise_t(construct_promise<__echo_session_promise_t>(this->conn));
+    }
+
+    ~__echo_session_state()
+    {
+        this->__promise.~__echo_session_promise_t();
+    }
+};
+
+struct __echo_client_state : __coroutine_state_with_promise<__echo_client_promise_t>
+{
+    __suspend_index_t<4> __suspend_point = 0;
+
+    // Argument copies
+    async_fd       conn;
+    int            requests;
+    std::int64_t * latencies;
+
+    // Local variables that live across a suspend-point
+    char                                  buffer[64] = {};
+    int                                   i;
+    std::chrono::steady_clock::time_point start;
+    std::size_t                           got;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                         // initial suspend
+        frame_scope<manual_lifetime<write_awaiter>>,                               // co_await async_write(...)
+        frame_scope<manual_lifetime<read_awaiter>>,                                // co_await async_read(...)
+        frame_scope<manual_lifetime<task<void>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+    auto & __tmp4() noexcept { return __frame.get<3, 0>(); }
+
+    __echo_client_state(async_fd && conn, int && requests, std::int64_t * && latencies)
+        : conn(static_cast<async_fd &&>(conn))
+        , requests(static_cast<int &&>(requests))
+        , latencies(static_cast<std::int64_t * &&>(latencies))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __echo_client_resume;
+            this->__destroy = &__echo_client_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __echo_client_promise_t(construct_promise<__echo_client_promise_t>(this->conn, this->requests, this->latencies));
+    }
+
+    ~__echo_client_state()
+    {
+        this->__promise.~__echo_client_promise_t();
+    }
+};
+
+struct __echo_server_state : __coroutine_state_with_promise<__echo_server_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    async_fd & listener;
+    int connections;
+
+    // Local variables that live across a suspend-point
+    int i;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                        // initial suspend
+        frame_scope<manual_lifetime<accept_awaiter>>,                             // co_await async_accept(listener)
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __echo_server_state(async_fd & listener, int && connections)
+        : listener(listener)
+        , connections(static_cast<int &&>(connections))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __echo_server_resume;
+            this->__destroy = &__echo_server_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __echo_server_promise_t(construct_promise<__echo_server_promise_t>(this->listener, this->connections));
+    }
+
+    ~__echo_server_state()
+    {
+        this->__promise.~__echo_server_promise_t();
+    }
+};
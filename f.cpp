@@ -1,74 +1,38 @@
-#include "defs.hpp"
+#include "f.hpp"
+#include "async_stack.hpp"
 //////////////////////
 // Begin lowering of f(int x)
 //
-// task f(int x) {
+// task<int> f(int x) {
 //   co_return x;
 // }
 
-using __f_promise_t = std::coroutine_traits<task, int>::promise_type;
-
-__coroutine_state * __f_resume (__coroutine_state *);
-void                __f_destroy(__coroutine_state *);
-
 /////
-// The coroutine-state definition
+// The "ramp" function
 
-struct __f_state : __coroutine_state_with_promise<__f_promise_t>
+task<int> f(int x)
 {
-    int __suspend_point = 0;
-
-    // Argument copies
-    int x;
-
-    union
-    {
-        manual_lifetime<std::suspend_always> __tmp1;
-        manual_lifetime<task::promise_type::final_awaiter> __tmp4;
-    };
-
-    __f_state(int && x)
-        : x(static_cast<int &&>(x))
-    {
-            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
-            this-> __resume = & __f_resume;
-            this->__destroy = &__f_destroy;
-
-            // Use placement-new to initialise the promise object in the base-class
-            // after we've initialised the argument copies.
-            ::new ((void *)std::addressof(this->__promise)) __f_promise_t(construct_promise<__f_promise_t>(this->x));
-    }
-
-    ~__f_state()
-    {
-        this->__promise.~__f_promise_t();
-    }
-};
+    std::unique_ptr<__f_state> state(new __f_state(static_cast<int &&>(x)));
+    return __ramp(std::move(state), &__f_resume);
+}
 
 /////
-// The "ramp" function
+// The placement "ramp" function
+//
+// Same as above but the coroutine-state is constructed in `slot`, which must be
+// suitably sized and aligned for __f_state (see frame_slot) and outlive the task.
 
-task f(int x)
+task<int> f(std::in_place_t, void *slot, int x)
 {
-    std::unique_ptr<__f_state> state(new __f_state(static_cast<int &&>(x)));
-    decltype(auto) return_obj = state->__promise.get_return_object();
+    std::unique_ptr<__f_state, __inline_frame_deleter> state(::new (slot) __f_state(static_cast<int &&>(x)));
+    state->__inline_frame = true;
+    return __ramp(std::move(state), &__f_resume);
+}
 
-    state->__tmp1.construct_from([&]() -> decltype(auto)
-    {
-        return state->__promise.initial_suspend();
-    });
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
 
-    if(!state->__tmp1.get().await_ready()){
-        state->__tmp1.get().await_suspend(std::coroutine_handle<__f_promise_t>::from_promise(state->__promise));
-        state.release();
-        // fall through to return statement below.
-    }
-    else{
-        // Coroutine did not suspend. Start executing the body immediately.
-        __f_resume(state.release());
-    }
-    return return_obj;
-}
+static constexpr auto & __f_cancellable = __cancellation_points<std::suspend_always, task<int>::promise_type::final_awaiter>;
 
 /////
 //  The "resume" function
@@ -76,9 +40,17 @@ task f(int x)
 __coroutine_state *__f_resume(__coroutine_state *s)
 {
     auto *state = static_cast<__f_state *>(s);
-    std::coroutine_handle<void> coro_to_resume;
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __f_cancellable)) [[unlikely]] {
+        return next;
+    }
 
+#ifndef CORO_NO_EXCEPTIONS
     try{
+#else
+    {
+#endif
         switch(state->__suspend_point){
             case 0: goto suspend_point_0;
             default: std::unreachable();
@@ -86,44 +58,23 @@ __coroutine_state *__f_resume(__coroutine_state *s)
 
 suspend_point_0:
         {
-            destructor_guard tmp1_dtor{state->__tmp1};
-            state->__tmp1.get().await_resume();
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
         }
 
         //  co_return x;
         state->__promise.return_value(state->x);
         goto final_suspend;
     }
+#ifndef CORO_NO_EXCEPTIONS
     catch(...){
         state->__promise.unhandled_exception();
         goto final_suspend;
     }
+#endif
 
 final_suspend:
-    // co_await promise.final_suspend
-    {
-        state->__tmp4.construct_from([&]() noexcept
-        {
-            return state->__promise.final_suspend();
-        });
-        destructor_guard tmp4_dtor{state->__tmp4};
-
-        if(!state->__tmp4.get().await_ready()){
-            state->__suspend_point = 1;
-            state->__resume = nullptr; // mark as final suspend-point
-
-            auto h = state->__tmp4.get().await_suspend(std::coroutine_handle<__f_promise_t>::from_promise(state->__promise));
-
-            tmp4_dtor.cancel();
-            return static_cast<__coroutine_state *>(h.address());
-        }
-        state->__tmp4.get().await_resume();
-    }
-
-    //  Destroy coroutine-state if execution flows off end of coroutine
-    delete state;
-
-    return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+    return __final_suspend(state, state->__tmp2(), 1);
 }
 
 /////
@@ -132,6 +83,7 @@ final_suspend:
 void __f_destroy(__coroutine_state *s)
 {
     auto *state = static_cast<__f_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
 
     switch(state->__suspend_point){
         case 0: goto suspend_point_0;
@@ -140,13 +92,19 @@ void __f_destroy(__coroutine_state *s)
     }
 
 suspend_point_0:
-    state->__tmp1.destroy();
+    state->__tmp1().destroy();
     goto destroy_state;
 
 suspend_point_1:
-    state->__tmp4.destroy();
+    state->__tmp2().destroy();
     goto destroy_state;
 
 destroy_state:
-    delete state;
+    __delete_state(state);
 }
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __f_sites[] = {"initial suspend", "final suspend"};
+static const lowered_frame_info<__f_state> __f_frame_info{&__f_destroy, "f(int x)", __f_sites};
@@ -0,0 +1,56 @@
+#pragma once
+#include "defs.hpp"
+//////////////////////
+// Coroutine-state of f(int x), see f.cpp for the lowering.
+//
+// Kept in a header so callers can embed the frame in their own storage,
+// e.g. frame_slot<__f_state>, and start it through the placement ramp.
+
+using __f_promise_t = std::coroutine_traits<task<int>, int>::promise_type;
+
+__coroutine_state * __f_resume (__coroutine_state *);
+void                __f_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definition
+
+struct __f_state : __coroutine_state_with_promise<__f_promise_t>
+{
+    __suspend_index_t<2> __suspend_point = 0;
+
+    // Set by the placement ramp when the coroutine-state lives in storage owned by
+    // the caller, the final suspend and destroy paths then skip the deallocation.
+    bool __inline_frame = false;
+
+    // Argument copies
+    int x;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                        // initial suspend
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+
+    __f_state(int && x)
+        : x(static_cast<int &&>(x))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __f_resume;
+            this->__destroy = &__f_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __f_promise_t(construct_promise<__f_promise_t>(this->x));
+    }
+
+    ~__f_state()
+    {
+        this->__promise.~__f_promise_t();
+    }
+};
+
+static_assert(frame_report<__f_state>::suspend_index_size == 1);
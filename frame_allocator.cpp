@@ -0,0 +1,132 @@
+#include <mutex>
+#include <utility>
+#include "frame_allocator.hpp"
+
+// Caches of exited threads, handed to the next thread that needs one so the
+// blocks still owned by them keep a live home to return to.
+struct frame_allocator::orphan_pool
+{
+    static inline std::mutex lock;
+    static inline thread_cache * list = nullptr;
+};
+
+struct frame_allocator::thread_guard
+{
+    static inline thread_local bool torn_down = false;
+
+    ~thread_guard()
+    {
+        frame_allocator::detach();
+    }
+};
+
+frame_allocator::thread_cache * frame_allocator::attach()
+{
+    static thread_local thread_guard guard;
+    (void)guard;
+
+    thread_cache * cache = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(orphan_pool::lock);
+        if(orphan_pool::list != nullptr){
+            cache = std::exchange(orphan_pool::list, orphan_pool::list->next_orphan_);
+        }
+    }
+
+    if(cache == nullptr){
+        cache = new thread_cache;
+    }
+    else{
+        cache->next_orphan_ = nullptr;
+        for(auto & remote: cache->remote_){
+            remote.store(nullptr, std::memory_order_release);
+        }
+    }
+    return cache_ = cache;
+}
+
+void frame_allocator::detach() noexcept
+{
+    thread_cache * cache = std::exchange(cache_, nullptr);
+    thread_guard::torn_down = true;
+
+    if(cache == nullptr){
+        return;
+    }
+
+    for(std::size_t c = 0; c < size_classes; ++c){
+        for(block_header * b = std::exchange(cache->free_[c], nullptr); b != nullptr;){
+            ::operator delete(static_cast<void *>(std::exchange(b, b->next)), block_size(c));
+        }
+        cache->count_[c] = 0;
+
+        // From now on other threads free blocks of this cache straight to the heap.
+        for(block_header * b = cache->remote_[c].exchange(thread_cache::orphaned(), std::memory_order_acquire); b != nullptr;){
+            ::operator delete(static_cast<void *>(std::exchange(b, b->next)), block_size(c));
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(orphan_pool::lock);
+    cache->next_orphan_ = std::exchange(orphan_pool::list, cache);
+}
+
+void frame_allocator::trim() noexcept
+{
+    if(thread_cache * cache = cache_; cache != nullptr){
+        for(std::size_t c = 0; c < size_classes; ++c){
+            for(block_header * b = std::exchange(cache->free_[c], nullptr); b != nullptr;){
+                ::operator delete(static_cast<void *>(std::exchange(b, b->next)), block_size(c));
+            }
+            cache->count_[c] = 0;
+        }
+    }
+}
+
+void * frame_allocator::allocate_slow(std::size_t c)
+{
+    thread_cache * cache = cache_;
+    if(cache == nullptr && !thread_guard::torn_down){
+        cache = attach();
+    }
+
+    if(cache != nullptr && cache->remote_[c].load(std::memory_order_relaxed) != nullptr){
+        // Adopt everything other threads have given back since we last looked,
+        // hand out the first block and keep the rest on the local free-list.
+        block_header * b = cache->remote_[c].exchange(nullptr, std::memory_order_acquire);
+        for(block_header * p = b->next; p != nullptr;){
+            block_header * next = p->next;
+            p->next = cache->free_[c];
+            cache->free_[c] = p;
+            cache->count_[c]++;
+            p = next;
+        }
+        return static_cast<void *>(b + 1);
+    }
+
+    // Frames allocated while the thread is being torn down have no cache to go
+    // back to, a null owner sends them to the global heap when they are freed.
+    auto * b = static_cast<block_header *>(::operator new(block_size(c)));
+    b->owner = cache;
+    return static_cast<void *>(b + 1);
+}
+
+void frame_allocator::deallocate_slow(block_header * b, std::size_t c) noexcept
+{
+    thread_cache * owner = b->owner;
+    if(owner == nullptr || owner == cache_){
+        // Ownerless block, or our own free-list for this class is already full.
+        ::operator delete(static_cast<void *>(b), block_size(c));
+        return;
+    }
+
+    std::atomic<block_header *> & remote = owner->remote_[c];
+    block_header * head = remote.load(std::memory_order_relaxed);
+    do{
+        if(head == thread_cache::orphaned()){
+            ::operator delete(static_cast<void *>(b), block_size(c));
+            return;
+        }
+        b->next = head;
+    }
+    while(!remote.compare_exchange_weak(head, b, std::memory_order_release, std::memory_order_relaxed));
+}
@@ -0,0 +1,127 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Thread-local size-class allocator for coroutine frames
+//
+// Every call to a lowered ramp function allocates one coroutine-state and every
+// final suspend / destroy frees it again. Those frames come in a handful of
+// fixed sizes, so instead of going through malloc/free each time we keep a
+// per-thread free-list for each 16-byte size class:
+//
+//   - allocate() pops the most recently freed block of the right class, so a
+//     frame is handed out again while it is still warm in cache (LIFO reuse),
+//   - deallocate() on the owning thread pushes the block back onto the local
+//     free-list with no atomic operations,
+//   - deallocate() on any other thread pushes the block onto a lock-free list
+//     of its owner, the owner adopts these blocks the next time its local
+//     free-list for that class runs dry.
+//
+// Each block is preceded by a small header recording the owning thread-cache.
+// Requests larger than the biggest size class go straight to the global heap.
+
+#include<atomic>
+#include<cstddef>
+#include<cstdint>
+#include<new>
+
+class frame_allocator
+{
+    public:
+        static constexpr std::size_t granularity  = 16;
+        static constexpr std::size_t size_classes = 64;  // blocks up to 1 KiB
+        static constexpr std::size_t max_size     = granularity * size_classes;
+        static constexpr std::size_t max_cached   = 256; // per size class and thread
+
+    private:
+        class thread_cache;
+
+        struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) block_header
+        {
+            thread_cache * owner; // never changes while the block exists
+            block_header * next;  // only meaningful while the block is on a free-list
+        };
+
+        static_assert(sizeof(block_header) % __STDCPP_DEFAULT_NEW_ALIGNMENT__ == 0);
+
+        class thread_cache
+        {
+            public:
+                block_header * free_[size_classes] = {};
+                std::uint32_t count_[size_classes] = {};
+
+                // Blocks released by other threads, one multi-producer list per class.
+                // Set to orphaned() once the owning thread has exited.
+                std::atomic<block_header *> remote_[size_classes] = {};
+
+                // Link in the pool of caches left behind by exited threads.
+                thread_cache * next_orphan_ = nullptr;
+
+            public:
+                static block_header * orphaned() noexcept
+                {
+                    return reinterpret_cast<block_header *>(alignof(block_header));
+                }
+        };
+
+        static inline thread_local thread_cache * cache_ = nullptr;
+
+    public:
+        static void * allocate(std::size_t size)
+        {
+            if(size == 0 || size > max_size){
+                return ::operator new(size);
+            }
+
+            const std::size_t c = size_class(size);
+            if(thread_cache * cache = cache_; cache != nullptr){
+                if(block_header * b = cache->free_[c]; b != nullptr){
+                    cache->free_[c] = b->next;
+                    cache->count_[c]--;
+                    return static_cast<void *>(b + 1);
+                }
+            }
+            return allocate_slow(c);
+        }
+
+        static void deallocate(void * ptr, std::size_t size) noexcept
+        {
+            if(size == 0 || size > max_size){
+                ::operator delete(ptr, size);
+                return;
+            }
+
+            const std::size_t c = size_class(size);
+            block_header * b = static_cast<block_header *>(ptr) - 1;
+
+            if(thread_cache * cache = cache_; cache != nullptr && b->owner == cache && cache->count_[c] < max_cached){
+                b->next = cache->free_[c];
+                cache->free_[c] = b;
+                cache->count_[c]++;
+                return;
+            }
+            deallocate_slow(b, c);
+        }
+
+    public:
+        // Return every block cached by the calling thread to the global heap.
+        static void trim() noexcept;
+
+    private:
+        static constexpr std::size_t size_class(std::size_t size) noexcept
+        {
+            return (size - 1) / granularity;
+        }
+
+        static constexpr std::size_t block_size(std::size_t c) noexcept
+        {
+            return sizeof(block_header) + (c + 1) * granularity;
+        }
+
+        static void * allocate_slow(std::size_t c);
+        static void deallocate_slow(block_header * b, std::size_t c) noexcept;
+
+        struct thread_guard;
+        struct orphan_pool;
+
+        static thread_cache * attach();
+        static void detach() noexcept;
+};
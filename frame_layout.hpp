@@ -0,0 +1,149 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Compile-time coroutine frame layout
+//
+// A coroutine-state holds the temporaries and locals that live across a
+// suspend-point. Temporaries of different scopes are never alive at the same
+// time, so they can share storage. Instead of overlapping them by hand with a
+// union, the lowering declares the scopes and what lives in each of them:
+//
+//   using __frame_t = frame_storage<
+//       frame_scope<manual_lifetime<std::suspend_always>>,            // scope 0
+//       frame_scope<manual_lifetime<task<int>>, frame_slot<__f_state>>, // scope 1
+//       ...>;
+//
+// and frame_storage computes the overlapped layout:
+//
+//   - within a scope members are placed in order of decreasing alignment, which
+//     minimises the padding between them,
+//   - all scopes start at offset 0 of one buffer, sized and aligned for the
+//     largest scope,
+//
+// and member I of scope S is accessed with `get<S, I>()`.
+//
+// __suspend_index_t<N> is the smallest unsigned integer that can hold N
+// suspend-point indices, and frame_report<State> exposes sizeof/alignof and
+// the breakdown of a coroutine-state as constants that can be static_assert'ed.
+
+#include<algorithm>
+#include<array>
+#include<cstddef>
+#include<cstdint>
+#include<new>
+#include<tuple>
+#include<type_traits>
+
+template<typename... Ts> struct frame_scope
+{
+    static constexpr std::size_t count = sizeof...(Ts);
+
+    template<std::size_t I> using type = std::tuple_element_t<I, std::tuple<Ts...>>;
+
+    static constexpr std::size_t align = std::max({alignof(std::byte), alignof(Ts)...});
+
+    // Byte offset of each member from the start of the scope.
+    static constexpr std::array<std::size_t, count> offsets = []
+    {
+        constexpr std::array<std::size_t, count> sizes  {sizeof (Ts)...};
+        constexpr std::array<std::size_t, count> aligns {alignof(Ts)...};
+
+        // Insertion sort, stable and usable in a constant expression.
+        std::array<std::size_t, count> order{};
+        for(std::size_t i = 0; i < count; ++i){
+            std::size_t j = i;
+            for(; j > 0 && aligns[order[j - 1]] < aligns[i]; --j){
+                order[j] = order[j - 1];
+            }
+            order[j] = i;
+        }
+
+        std::array<std::size_t, count> result{};
+        std::size_t offset = 0;
+        for(std::size_t i: order){
+            offset = (offset + aligns[i] - 1) / aligns[i] * aligns[i];
+            result[i] = offset;
+            offset += sizes[i];
+        }
+        return result;
+    }();
+
+    static constexpr std::size_t size = []
+    {
+        constexpr std::array<std::size_t, count> sizes {sizeof(Ts)...};
+
+        std::size_t end = 0;
+        for(std::size_t i = 0; i < count; ++i){
+            end = std::max(end, offsets[i] + sizes[i]);
+        }
+        return (end + align - 1) / align * align;
+    }();
+};
+
+template<typename... Scopes> class frame_storage
+{
+    public:
+        static constexpr std::size_t size  = std::max({std::size_t(1), Scopes::size ...});
+        static constexpr std::size_t align = std::max({alignof(std::byte), Scopes::align...});
+
+        // What the temporaries would take up if every scope had its own storage.
+        static constexpr std::size_t unoverlapped_size = (std::size_t(0) + ... + Scopes::size);
+
+        template<std::size_t S> using scope = std::tuple_element_t<S, std::tuple<Scopes...>>;
+
+    private:
+        alignas(align) std::byte storage_[size];
+
+    public:
+        template<std::size_t S, std::size_t I> typename scope<S>::template type<I> & get() noexcept
+        {
+            using T = typename scope<S>::template type<I>;
+            static_assert(std::is_trivially_default_constructible_v<T> && std::is_trivially_destructible_v<T>,
+                    "frame_storage members must manage their own lifetime, e.g. manual_lifetime<T>");
+
+            return *std::launder(reinterpret_cast<T *>(storage_ + scope<S>::offsets[I]));
+        }
+};
+
+template<std::size_t N> using __suspend_index_t =
+    std::conditional_t<(N <= UINT8_MAX ), std::uint8_t ,
+    std::conditional_t<(N <= UINT16_MAX), std::uint16_t,
+                                          std::uint32_t>>;
+
+template<typename State> struct frame_report
+{
+    static constexpr std::size_t size  = sizeof (State);
+    static constexpr std::size_t align = alignof(State);
+
+    static constexpr std::size_t promise_size = sizeof(State::__promise);
+
+    static constexpr std::size_t suspend_index_size = []
+    {
+        if constexpr (requires { State::__suspend_point; }){
+            return sizeof(State::__suspend_point);
+        }
+        else{
+            return std::size_t(0);
+        }
+    }();
+
+    // Storage of the temporaries, and what it would be without any overlapping.
+    static constexpr std::size_t temporaries_size = []
+    {
+        if constexpr (requires { typename State::__frame_t; }){
+            return State::__frame_t::size;
+        }
+        else{
+            return std::size_t(0);
+        }
+    }();
+
+    static constexpr std::size_t temporaries_unoverlapped_size = []
+    {
+        if constexpr (requires { typename State::__frame_t; }){
+            return State::__frame_t::unoverlapped_size;
+        }
+        else{
+            return std::size_t(0);
+        }
+    }();
+};
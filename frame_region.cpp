@@ -0,0 +1,390 @@
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "async_stack.hpp"
+#include "frame_region.hpp"
+
+namespace
+{
+    // Setup failures and frames that can't be saved or restored, as in reactor.cpp.
+    [[noreturn]] void fail(const char * what, int error = errno)
+    {
+#ifdef CORO_NO_EXCEPTIONS
+        errno = error;
+        std::perror(what);
+        std::abort();
+#else
+        throw std::system_error(error, std::system_category(), what);
+#endif
+    }
+
+    [[noreturn]] void out_of_memory()
+    {
+#ifdef CORO_NO_EXCEPTIONS
+        std::abort();
+#else
+        throw std::bad_alloc();
+#endif
+    }
+}
+
+//////////////////////
+// persistent_frame_info
+
+persistent_frame_info::persistent_frame_info(const char * name, std::size_t size,
+                                             __coroutine_state::__resume_fn * resume, __coroutine_state::__destroy_fn * destroy,
+                                             continuation_fn * continuation, rebind_fn * rebind) noexcept
+    : id(id_of(name, size))
+    , name(name)
+    , size(size)
+    , resume(resume)
+    , destroy(destroy)
+    , continuation(continuation)
+    , rebind(rebind)
+{
+    next_ = registered_.load(std::memory_order_relaxed);
+    while(!registered_.compare_exchange_weak(next_, this, std::memory_order_release, std::memory_order_relaxed)){
+    }
+}
+
+const persistent_frame_info * persistent_frame_info::find(std::uint64_t id) noexcept
+{
+    for(const persistent_frame_info * info = registered_.load(std::memory_order_acquire); info != nullptr; info = info->next_){
+        if(info->id == id){
+            return info;
+        }
+    }
+    return nullptr;
+}
+
+const persistent_frame_info * persistent_frame_info::find(const __coroutine_state * frame) noexcept
+{
+    for(const persistent_frame_info * info = registered_.load(std::memory_order_acquire); info != nullptr; info = info->next_){
+        if(frame->__destroy == info->destroy){
+            return info;
+        }
+    }
+    return nullptr;
+}
+
+//////////////////////
+// The file
+//
+// A header, then blocks of multiples of 16 bytes, each a block header and a
+// frame. Blocks are carved off at `top` and recycled through one free-list per
+// size, as frame_allocator does; the lists are offsets so they survive too.
+
+struct frame_region::header
+{
+    static constexpr std::uint64_t magic_v1 = 0x3176'6e67'7246'6f72;  // "roFrgnv1"
+    static constexpr std::size_t   granule  = 16;
+    static constexpr std::size_t   classes  = 256;                    // blocks up to 4 KiB
+
+    std::uint64_t magic;
+    std::uint64_t base;          // where every process maps the file
+    std::uint64_t capacity;
+    std::uint64_t top;           // offset of the first byte never allocated
+    std::uint64_t running;       // spawned tasks that haven't finished
+    std::uint64_t checkpointed;  // nothing allocated or freed since checkpoint()
+    std::uint64_t free[classes]; // offset of the first free block per size, 0 if none
+
+    static constexpr std::size_t first_block() noexcept;
+};
+
+struct frame_region::block
+{
+    enum : std::uint32_t { free_block = 0, live = 1, awaited = 2 };
+
+    std::uint64_t type;   // persistent_frame_info::id, stamped by checkpoint()
+    std::uint32_t size;   // header included
+    std::uint32_t state;
+
+    static_assert(sizeof(std::uint64_t) + 2 * sizeof(std::uint32_t) == alignof(std::max_align_t), "frames must stay aligned");
+
+    __coroutine_state * frame() noexcept
+    {
+        return reinterpret_cast<__coroutine_state *>(this + 1);
+    }
+
+    static block * of(void * frame) noexcept
+    {
+        return static_cast<block *>(frame) - 1;
+    }
+};
+
+constexpr std::size_t frame_region::header::first_block() noexcept
+{
+    return (sizeof(header) + granule - 1) / granule * granule;
+}
+
+//////////////////////
+// Spawned tasks
+
+struct frame_region::root_frame : __coroutine_state
+{
+    frame_region *      region;
+    __coroutine_state * task;
+
+    root_frame(frame_region & region, __coroutine_state * task) noexcept
+        : region(&region)
+        , task(task)
+    {
+        this-> __resume = & resume;
+        this->__destroy = &destroy;
+    }
+
+    // The task finished: free both.
+    static __coroutine_state * resume(__coroutine_state * s) noexcept
+    {
+        __release_running_frame();
+        destroy(s);
+        return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+    }
+
+    static void destroy(__coroutine_state * s) noexcept
+    {
+        auto *         root   = static_cast<root_frame *>(s);
+        frame_region & region = *root->region;
+
+        std::coroutine_handle<>::from_address(root->task).destroy();
+        region.deallocate(root, sizeof(root_frame), alignof(root_frame));
+        region.header_->running--;
+    }
+
+    static void rebind(__coroutine_state * s, frame_region & region) noexcept
+    {
+        static_cast<root_frame *>(s)->region = &region;
+    }
+
+    static const persistent_frame_info persistent;
+    static const async_frame_info      frame_info;
+};
+
+const persistent_frame_info frame_region::root_frame::persistent {"frame_region::spawn", sizeof(root_frame), &resume, &destroy, nullptr, &rebind};
+
+// The bottom of a spawned task's async stack, see async_stack.hpp.
+const async_frame_info frame_region::root_frame::frame_info {"frame_region::spawn", {}, &destroy, nullptr, nullptr, nullptr};
+
+__coroutine_state * frame_region::adopt(void * task)
+{
+    if(!contains(task)){
+        fail("frame_region::spawn: the task's frame is not in the region", EINVAL);
+    }
+    auto * root = ::new (allocate(sizeof(root_frame), alignof(root_frame))) root_frame(*this, static_cast<__coroutine_state *>(task));
+    header_->running++;
+    return root;
+}
+
+std::size_t frame_region::running() const noexcept
+{
+    return header_->running;
+}
+
+//////////////////////
+// Opening, saving and restoring
+
+frame_region::frame_region(const char * path, std::size_t capacity)
+    : frame_region(capacity)
+{
+    fd_ = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+    if(fd_ < 0){
+        fail("open");
+    }
+
+    struct stat st;
+    if(::fstat(fd_, &st) < 0){
+        fail("fstat");
+    }
+
+    if(st.st_size == 0){
+        if(capacity_ <= header::first_block()){
+            fail("frame_region: capacity", EINVAL);
+        }
+        if(::ftruncate(fd_, static_cast<off_t>(capacity_)) < 0){
+            fail("ftruncate");
+        }
+
+        void * p = ::mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+        if(p == MAP_FAILED){
+            fail("mmap");
+        }
+        header_ = ::new (p) header{};
+        header_->magic    = header::magic_v1;
+        header_->base     = reinterpret_cast<std::uintptr_t>(p);
+        header_->capacity = capacity_;
+        header_->top      = header::first_block();
+        return;
+    }
+
+    header h;
+    if(::pread(fd_, &h, sizeof h, 0) != static_cast<ssize_t>(sizeof h) || h.magic != header::magic_v1){
+        fail("frame_region: not a frame region", EINVAL);
+    }
+
+    // Where it was before, or the pointers between the frames are wrong.
+    capacity_ = h.capacity;
+    void * p = ::mmap(reinterpret_cast<void *>(h.base), capacity_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED_NOREPLACE, fd_, 0);
+    if(p == MAP_FAILED){
+        fail("mmap");
+    }
+    if(p != reinterpret_cast<void *>(h.base)){
+        // A kernel before 4.17 treats the flag as a hint.
+        ::munmap(p, capacity_);
+        fail("mmap", EEXIST);
+    }
+    header_ = static_cast<header *>(p);
+    recover();
+}
+
+frame_region::~frame_region()
+{
+    if(header_ != nullptr){
+        ::munmap(header_, capacity_);
+    }
+    if(fd_ >= 0){
+        ::close(fd_);
+    }
+}
+
+std::size_t frame_region::checkpoint()
+{
+    char * const base = reinterpret_cast<char *>(header_);
+    const persistent_frame_info * info = nullptr;
+
+    std::size_t frames = 0;
+    for(std::uint64_t at = header::first_block(); at < header_->top; at += reinterpret_cast<block *>(base + at)->size){
+        auto & b = *reinterpret_cast<block *>(base + at);
+        if(b.state == block::free_block){
+            continue;
+        }
+
+        __coroutine_state * frame = b.frame();
+#ifdef CORO_COMPACT_FRAMES
+        std::uintptr_t first;
+        std::memcpy(&first, frame, sizeof first);
+        if(first & __compact_coroutine_state::__compact_bit){
+            fail("frame_region::checkpoint: a frame with the compact layout", ENOTSUP);
+        }
+#endif
+
+        if(info == nullptr || frame->__destroy != info->destroy){
+            info = persistent_frame_info::find(frame);
+        }
+        if(info == nullptr){
+            fail("frame_region::checkpoint: a frame of an unregistered type", ENOTSUP);
+        }
+        if(frame->__resume == nullptr){
+            fail("frame_region::checkpoint: a task at its final suspend-point", ENOTSUP);
+        }
+        if(info->continuation != nullptr && !contains(info->continuation(frame).address())){
+            fail("frame_region::checkpoint: a task awaited from outside the region", ENOTSUP);
+        }
+
+        b.type = info->id;
+        ++frames;
+    }
+
+    header_->checkpointed = 1;
+    if(::msync(header_, header_->top, MS_SYNC) < 0){
+        fail("msync");
+    }
+    return frames;
+}
+
+void frame_region::recover()
+{
+    if(header_->running != 0 && !header_->checkpointed){
+        fail("frame_region: frames were allocated or freed after the last checkpoint", EINVAL);
+    }
+
+    char * const base = reinterpret_cast<char *>(header_);
+    const persistent_frame_info * info = nullptr;
+
+    // Restore the function pointers, and mark the frames something awaits.
+    for(std::uint64_t at = header::first_block(); at < header_->top; at += reinterpret_cast<block *>(base + at)->size){
+        auto & b = *reinterpret_cast<block *>(base + at);
+        if(b.state == block::free_block){
+            continue;
+        }
+
+        if(info == nullptr || info->id != b.type){
+            info = persistent_frame_info::find(b.type);
+        }
+        if(info == nullptr){
+            fail("frame_region: a frame of a type this program doesn't register", ENOTSUP);
+        }
+
+        __coroutine_state * frame = b.frame();
+        frame-> __resume = info-> resume;
+        frame->__destroy = info->destroy;
+        info->rebind(frame, *this);
+
+        if(info->continuation != nullptr){
+            block::of(info->continuation(frame).address())->state |= block::awaited;
+        }
+    }
+
+    // The tasks nothing awaits were parked.
+    for(std::uint64_t at = header::first_block(); at < header_->top; at += reinterpret_cast<block *>(base + at)->size){
+        auto & b = *reinterpret_cast<block *>(base + at);
+        if(b.state == block::live){
+            if(info->id != b.type){
+                info = persistent_frame_info::find(b.type);
+            }
+            if(info->continuation != nullptr){
+                parked_.push_back(std::coroutine_handle<>::from_address(b.frame()));
+            }
+        }
+        b.state &= ~block::awaited;
+    }
+}
+
+//////////////////////
+// std::pmr::memory_resource
+
+void * frame_region::do_allocate(std::size_t bytes, std::size_t alignment)
+{
+    const std::size_t size = (bytes + sizeof(block) + header::granule - 1) / header::granule * header::granule;
+    const std::size_t c    = size / header::granule - 1;
+    if(alignment > alignof(std::max_align_t) || c >= header::classes){
+        out_of_memory();
+    }
+
+    char * const base = reinterpret_cast<char *>(header_);
+    block * b;
+    if(header_->free[c] != 0){
+        b = reinterpret_cast<block *>(base + header_->free[c]);
+        std::memcpy(&header_->free[c], b->frame(), sizeof(std::uint64_t));
+    }
+    else{
+        if(size > capacity_ - header_->top){
+            out_of_memory();
+        }
+        b = reinterpret_cast<block *>(base + header_->top);
+        b->size = static_cast<std::uint32_t>(size);
+        header_->top += size;
+    }
+
+    b->type  = 0;
+    b->state = block::live;
+    header_->checkpointed = 0;
+    return b->frame();
+}
+
+void frame_region::do_deallocate(void * p, std::size_t, std::size_t)
+{
+    block & b = *block::of(p);
+    const std::size_t c = b.size / header::granule - 1;
+
+    // The next free block's offset goes where the frame was.
+    b.state = block::free_block;
+    std::memcpy(p, &header_->free[c], sizeof(std::uint64_t));
+    header_->free[c] = static_cast<std::uint64_t>(reinterpret_cast<char *>(&b) - reinterpret_cast<char *>(header_));
+    header_->checkpointed = 0;
+}
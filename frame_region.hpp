@@ -0,0 +1,262 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Persistent coroutine frames: a memory-mapped file that outlives the process
+//
+//   frame_region region("/var/lib/svc/frames", 1 << 30);     // creates or reopens
+//   for(std::coroutine_handle<> h: region.take_parked()){   // resumed where they stopped
+//       h.resume();
+//   }
+//   region.spawn(journey(std::allocator_arg, &region, x));  // new workflows
+//   ...
+//   region.checkpoint();                                    // before exiting
+//
+// A suspended lowered frame is a plain struct: the suspend-point, the argument
+// copies, the locals and the manual_lifetime slots of its temporaries. If none
+// of them points outside the frames of its own workflow, the frame is as good
+// in a file as in memory. frame_region is a std::pmr::memory_resource over such
+// a file, so a coroutine taking (std::allocator_arg, &region) gets its frame
+// from it and so do the tasks it awaits (see "Frame allocation" in defs.hpp).
+// The file is mapped at the same address in every process, which keeps the
+// pointers between frames valid: a task's continuation, the task<T> handles in
+// its temporaries.
+//
+// What doesn't survive a restart is everything outside the file:
+//
+//   - __resume and __destroy point into the program's code. A frame type that
+//     opts in registers a persistent_frame_type next to its lowering, with a
+//     name that stays the same across builds:
+//
+//       static const persistent_frame_type<__leg_state> __leg_persistent{&__leg_resume, &__leg_destroy, "leg(int x)"};
+//
+//     checkpoint() stores the type's id (a hash of name and frame size) in the
+//     header of each frame's block, and reopening writes the new program's
+//     function pointers back from it. A frame of an unregistered type makes
+//     checkpoint() fail, an id the program doesn't know makes reopening fail.
+//     So does a compact frame (defs.hpp), whose vtable pointer isn't restored.
+//
+//   - The promise's cancellation token and context (context.hpp) are reset,
+//     its memory resource, and the one stored behind the frame for operator
+//     delete, become the new frame_region.
+//
+//   - Whatever the frame's coroutine was suspended on. A workflow that is to
+//     survive parks in co_await persistent_park{}: nothing is left in the frame
+//     then, the region keeps the handle until take_parked() hands it out.
+//     Reopening the file parks every frame that no other frame awaits again.
+//
+// So the opt-in is a promise of the coroutine's author that the frame is
+// trivially relocatable in that sense: no references, pointers or resources
+// outside the region among the arguments and locals it uses after suspending
+// (the (allocator_arg, resource) arguments are only used by the ramp), no
+// when_all, with_timeout or other awaitable keeping state elsewhere, and
+// results that are plain values. Tasks are started with spawn(), whose
+// hand-written continuation frame lives in the region as well; their results
+// are dropped, as with thread_pool::spawn().
+//
+// checkpoint() is the consistent state: reopening expects the frames as it
+// left them, so take it when no frame runs, typically on shutdown. Allocating
+// or freeing a frame after it makes the file unrecoverable until the next one.
+// Like the reactor a region belongs to one thread.
+
+#include<atomic>
+#include<cstddef>
+#include<cstdint>
+#include<cstring>
+#include<memory_resource>
+#include<string_view>
+#include<utility>
+#include<vector>
+#include "defs.hpp"
+
+class frame_region;
+
+//////////////////////
+// Registered frame types
+
+class persistent_frame_info
+{
+    public:
+        using continuation_fn = std::coroutine_handle<> (const __coroutine_state *) noexcept;
+        using rebind_fn       = void                    (__coroutine_state *, frame_region &) noexcept;
+
+        std::uint64_t                     id;
+        const char *                      name;
+        std::size_t                       size;           // of the frame, a different layout has another id
+        __coroutine_state::__resume_fn  * resume;
+        __coroutine_state::__destroy_fn * destroy;        // recognised by __destroy, as in async_stack.hpp
+        continuation_fn *                 continuation;   // null for frames without a promise
+        rebind_fn *                       rebind;         // points the frame at a reopened region
+
+    private:
+        const persistent_frame_info * next_ = nullptr;
+
+        static inline std::atomic<const persistent_frame_info *> registered_ {nullptr};
+
+    public:
+        // Registers for the lifetime of the program, so meant for objects with
+        // static storage duration.
+        persistent_frame_info(const char * name, std::size_t size,
+                              __coroutine_state::__resume_fn * resume, __coroutine_state::__destroy_fn * destroy,
+                              continuation_fn * continuation, rebind_fn * rebind) noexcept;
+
+        persistent_frame_info            (const persistent_frame_info &) = delete;
+        persistent_frame_info & operator=(const persistent_frame_info &) = delete;
+
+    public:
+        // Null if there is none.
+        static const persistent_frame_info * find(std::uint64_t id) noexcept;
+        static const persistent_frame_info * find(const __coroutine_state * frame) noexcept;
+
+        // FNV-1a of the name, then of the size.
+        static constexpr std::uint64_t id_of(std::string_view name, std::size_t size) noexcept
+        {
+            std::uint64_t h = 0xcbf29ce484222325;
+            for(char c: name){
+                h = (h ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+            }
+            for(std::size_t i = 0; i < sizeof size; ++i){
+                h = (h ^ (size >> (8 * i) & 0xff)) * 0x100000001b3;
+            }
+            return h;
+        }
+};
+
+// persistent_frame_info of a lowered task coroutine-state.
+template<typename State> class persistent_frame_type : public persistent_frame_info
+{
+    private:
+        static std::coroutine_handle<> continuation_of(const __coroutine_state * s) noexcept
+        {
+            return static_cast<const State *>(s)->__promise.continuation();
+        }
+
+        // The resource pointer stored behind the frame, see allocate_frame() in defs.hpp.
+        static void rebind(__coroutine_state * s, frame_region & region) noexcept;
+
+    public:
+        persistent_frame_type(__coroutine_state::__resume_fn * resume, __coroutine_state::__destroy_fn * destroy, const char * name) noexcept
+            : persistent_frame_info(name, sizeof(State), resume, destroy, &continuation_of, &rebind)
+        {}
+};
+
+//////////////////////
+// The region
+
+class frame_region final : public std::pmr::memory_resource
+{
+    private:
+        struct header;
+        struct block;
+
+        // Continuation of a spawned task, see thread_pool::detached_state. In
+        // the region as well, registered like a lowered frame.
+        struct root_frame;
+
+        header *    header_ = nullptr;
+        std::size_t capacity_;
+        int         fd_     = -1;
+
+        std::vector<std::coroutine_handle<>> parked_;
+
+        // Delegated to by the public constructor, so that once it has run, a
+        // failure further on still unmaps and closes through ~frame_region().
+        explicit frame_region(std::size_t capacity) noexcept
+            : capacity_(capacity)
+        {}
+
+    public:
+        // Opens `path`, creating it with room for `capacity` bytes of frames if
+        // it doesn't exist or is empty. Otherwise maps it where it was mapped
+        // before and readies its frames to be resumed, see take_parked().
+        frame_region(const char * path, std::size_t capacity);
+
+        // Unmaps the file, the frames in it stay as they are.
+        ~frame_region();
+
+        frame_region            (const frame_region &) = delete;
+        frame_region & operator=(const frame_region &) = delete;
+
+    public:
+        // Runs `t`, whose frame must come from this region, up to its first
+        // suspend-point. The region owns it from then on.
+        template<typename T> void spawn(task<T> t);
+
+        // The frames parked since the last call, in no particular order.
+        std::vector<std::coroutine_handle<>> take_parked() noexcept
+        {
+            return std::exchange(parked_, {});
+        }
+
+        // Stamps every frame with its type id and flushes the file. Returns the
+        // number of frames.
+        std::size_t checkpoint();
+
+        // Number of spawned tasks that haven't finished.
+        std::size_t running() const noexcept;
+
+        bool contains(const void * p) const noexcept
+        {
+            const auto * c = static_cast<const char *>(p);
+            return c >= reinterpret_cast<const char *>(header_) && c < reinterpret_cast<const char *>(header_) + capacity_;
+        }
+
+    private:
+        friend struct persistent_park;
+
+        void park(std::coroutine_handle<> h)
+        {
+            parked_.push_back(h);
+        }
+
+        // The file was there: fix up its frames and park the leaves.
+        void recover();
+
+        // Allocates the continuation of a spawned task, which then owns it.
+        __coroutine_state * adopt(void * task);
+
+        void * do_allocate  (std::size_t bytes, std::size_t alignment) override;
+        void   do_deallocate(void * p, std::size_t bytes, std::size_t alignment) override;
+
+        bool do_is_equal(const std::pmr::memory_resource & other) const noexcept override
+        {
+            return this == &other;
+        }
+};
+
+template<typename T> void frame_region::spawn(task<T> t)
+{
+    __coroutine_state * root = adopt(t.coro_.address());
+    auto awaiter = std::move(t).operator co_await();
+    t.coro_ = {};
+
+    awaiter.await_suspend(std::coroutine_handle<>::from_address(root)).resume();
+}
+
+template<typename State> void persistent_frame_type<State>::rebind(__coroutine_state * s, frame_region & region) noexcept
+{
+    auto * state = static_cast<State *>(s);
+    state->__promise.__rebind(&region);
+
+    std::pmr::memory_resource * resource = &region;
+    std::memcpy(reinterpret_cast<char *>(state) + sizeof(State), &resource, sizeof resource);
+}
+
+//////////////////////
+// persistent_park
+
+// Suspends until frame_region::take_parked() hands the frame out and it is
+// resumed. Empty, so it doesn't keep the frame from being relocatable; the
+// region is found through the promise's memory resource.
+struct persistent_park
+{
+    bool await_ready() noexcept
+    {
+        return false;
+    }
+
+    template<typename Promise> void await_suspend(std::coroutine_handle<Promise> h)
+    {
+        static_cast<frame_region *>(h.promise().resource())->park(h);
+    }
+
+    void await_resume() noexcept {}
+};
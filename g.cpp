@@ -1,83 +1,39 @@
-#include "defs.hpp"
+#include "g.hpp"
+#include "async_stack.hpp"
 //////////////////////
 // Begin lowering of g(int x)
 //
-// task g(int x) {
+// task<int> g(int x) {
 //   int fx = co_await f(x);
 //   co_return fx * fx;
 // }
 
-using __g_promise_t = std::coroutine_traits<task, int>::promise_type;
-
-__coroutine_state * __g_resume (__coroutine_state *);
-void                __g_destroy(__coroutine_state *);
-
 /////
-// The coroutine-state definition
+// The "ramp" function
 
-struct __g_state : __coroutine_state_with_promise<__g_promise_t>
+task<int> g(int x)
 {
-    int __suspend_point = 0;
-
-    // Argument copies
-    int x;
-
-    // Local variables/temporaries
-    struct __scope1
-    {
-        manual_lifetime<task         > __tmp2;
-        manual_lifetime<task::awaiter> __tmp3;
-    };
-
-    union
-    {
-        manual_lifetime<std::suspend_always> __tmp1;
-        __scope1 __s1;
-        manual_lifetime<task::promise_type::final_awaiter> __tmp4;
-    };
-
-    __g_state(int && x)
-        : x(static_cast<int &&>(x))
-    {
-            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
-            this-> __resume = & __g_resume;
-            this->__destroy = &__g_destroy;
-
-            // Use placement-new to initialise the promise object in the base-class
-            // after we've initialised the argument copies.
-            ::new ((void *)std::addressof(this->__promise)) __g_promise_t(construct_promise<__g_promise_t>(this->x));
-    }
-
-    ~__g_state()
-    {
-        this->__promise.~__g_promise_t();
-    }
-};
+    std::unique_ptr<__g_state> state(new __g_state(static_cast<int &&>(x)));
+    return __ramp(std::move(state), &__g_resume);
+}
 
 /////
-// The "ramp" function
+// The placement "ramp" function
+//
+// Same as above but the coroutine-state is constructed in `slot`, which must be
+// suitably sized and aligned for __g_state (see frame_slot) and outlive the task.
 
-task g(int x)
+task<int> g(std::in_place_t, void *slot, int x)
 {
-    std::unique_ptr<__g_state> state(new __g_state(static_cast<int &&>(x)));
-    decltype(auto) return_obj = state->__promise.get_return_object();
+    std::unique_ptr<__g_state, __inline_frame_deleter> state(::new (slot) __g_state(static_cast<int &&>(x)));
+    state->__inline_frame = true;
+    return __ramp(std::move(state), &__g_resume);
+}
 
-    state->__tmp1.construct_from([&]() -> decltype(auto)
-    {
-        return state->__promise.initial_suspend();
-    });
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
 
-    if(!state->__tmp1.get().await_ready()){
-        state->__tmp1.get().await_suspend(std::coroutine_handle<__g_promise_t>::from_promise(state->__promise));
-        state.release();
-        // fall through to return statement below.
-    }
-    else{
-        // Coroutine did not suspend. Start executing the body immediately.
-        __g_resume(state.release());
-    }
-    return return_obj;
-}
+static constexpr auto & __g_cancellable = __cancellation_points<std::suspend_always, task<int>::awaiter, task<int>::promise_type::final_awaiter>;
 
 /////
 //  The "resume" function
@@ -85,38 +41,48 @@ task g(int x)
 __coroutine_state *__g_resume(__coroutine_state *s)
 {
     auto *state = static_cast<__g_state *>(s);
-    std::coroutine_handle<void> coro_to_resume;
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __g_cancellable)) [[unlikely]] {
+        return next;
+    }
 
+#ifndef CORO_NO_EXCEPTIONS
     try{
+#else
+    {
+#endif
         switch(state->__suspend_point){
             case 0: goto suspend_point_0;
-            case 1: goto suspend_point_1; // <-- add new jump-table entry
+            case 1: goto suspend_point_1;
             default: std::unreachable();
         }
 
 suspend_point_0:
         {
-            destructor_guard tmp1_dtor{state->__tmp1};
-            state->__tmp1.get().await_resume();
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
         }
 
         //  int fx = co_await f(x);
         {
-            state->__s1.__tmp2.construct_from([&]()
+            state->__tmp2().construct_from([&]()
             {
-                return f(state->x);
+                return f(std::in_place, &state->__f_frame(), state->x);
             });
-            destructor_guard tmp2_dtor{state->__s1.__tmp2};
+            destructor_guard tmp2_dtor{state->__tmp2()};
 
-            state->__s1.__tmp3.construct_from([&]()
+            state->__tmp3().construct_from([&]()
             {
-                return static_cast<task &&>(state->__s1.__tmp2.get()).operator co_await();
+                return static_cast<task<int> &&>(state->__tmp2().get()).operator co_await();
             });
-            destructor_guard tmp3_dtor{state->__s1.__tmp3};
+            destructor_guard tmp3_dtor{state->__tmp3()};
 
-            if(!state->__s1.__tmp3.get().await_ready()){
+            if(!state->__tmp3().get().await_ready()){
                 state->__suspend_point = 1;
-                auto h = state->__s1.__tmp3.get().await_suspend(std::coroutine_handle<__g_promise_t>::from_promise(state->__promise));
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp3().get().await_suspend(std::coroutine_handle<__g_promise_t>::from_promise(state->__promise));
 
                 // A coroutine suspends without exiting scopes - so cancel the destructor-guards.
                 tmp3_dtor.cancel();
@@ -133,47 +99,41 @@ suspend_point_0:
         }
 
 suspend_point_1:
+        // The child was cancelled (through a token of its own, a shared one
+        // stops us at the cancellation point above): pass it on the same way.
+        if(state->__tmp3().get().cancelled()) [[unlikely]] {
+            return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+        }
+#ifdef CORO_NO_EXCEPTIONS
+        // The awaited task failed: take over its error and leave through the
+        // final suspend-point, destroying the temporaries of this scope on the way.
+        if(std::error_code ec = state->__tmp3().get().error()) [[unlikely]] {
+            state->__tmp3().destroy();
+            state->__tmp2().destroy();
+            state->__promise.set_error(ec);
+            goto final_suspend;
+        }
+#endif
         int fx = [&]() -> decltype(auto)
         {
-            destructor_guard tmp2_dtor{state->__s1.__tmp2};
-            destructor_guard tmp3_dtor{state->__s1.__tmp3};
-            return state->__s1.__tmp3.get().await_resume();
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            destructor_guard tmp3_dtor{state->__tmp3()};
+            return state->__tmp3().get().await_resume();
         }();
 
         //  co_return fx * fx;
         state->__promise.return_value(fx * fx);
         goto final_suspend;
     }
+#ifndef CORO_NO_EXCEPTIONS
     catch(...){
         state->__promise.unhandled_exception();
         goto final_suspend;
     }
+#endif
 
 final_suspend:
-    // co_await promise.final_suspend
-    {
-        state->__tmp4.construct_from([&]() noexcept
-        {
-            return state->__promise.final_suspend();
-        });
-        destructor_guard tmp4_dtor{state->__tmp4};
-
-        if(!state->__tmp4.get().await_ready()){
-            state->__suspend_point = 2;
-            state->__resume = nullptr; // mark as final suspend-point
-
-            auto h = state->__tmp4.get().await_suspend(std::coroutine_handle<__g_promise_t>::from_promise(state->__promise));
-
-            tmp4_dtor.cancel();
-            return static_cast<__coroutine_state *>(h.address());
-        }
-        state->__tmp4.get().await_resume();
-    }
-
-    //  Destroy coroutine-state if execution flows off end of coroutine
-    delete state;
-
-    return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+    return __final_suspend(state, state->__tmp4(), 2);
 }
 
 /////
@@ -182,6 +142,7 @@ final_suspend:
 void __g_destroy(__coroutine_state *s)
 {
     auto *state = static_cast<__g_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
 
     switch(state->__suspend_point){
         case 0: goto suspend_point_0;
@@ -191,18 +152,24 @@ void __g_destroy(__coroutine_state *s)
     }
 
 suspend_point_0:
-    state->__tmp1.destroy();
+    state->__tmp1().destroy();
     goto destroy_state;
 
 suspend_point_1:
-    state->__s1.__tmp3.destroy();
-    state->__s1.__tmp2.destroy();
+    state->__tmp3().destroy();
+    state->__tmp2().destroy();
     goto destroy_state;
 
 suspend_point_2:
-    state->__tmp4.destroy();
+    state->__tmp4().destroy();
     goto destroy_state;
 
 destroy_state:
-    delete state;
+    __delete_state(state);
 }
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __g_sites[] = {"initial suspend", "co_await f(x)", "final suspend"};
+static const lowered_frame_info<__g_state> __g_frame_info{&__g_destroy, "g(int x)", __g_sites};
@@ -0,0 +1,65 @@
+#pragma once
+#include "f.hpp"
+//////////////////////
+// Coroutine-state of g(int x), see g.cpp for the lowering.
+//
+// Kept in a header so callers can embed the frame in their own storage,
+// e.g. frame_slot<__g_state>, and start it through the placement ramp.
+
+using __g_promise_t = std::coroutine_traits<task<int>, int>::promise_type;
+
+__coroutine_state * __g_resume (__coroutine_state *);
+void                __g_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definition
+
+struct __g_state : __coroutine_state_with_promise<__g_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Set by the placement ramp when the coroutine-state lives in storage owned by
+    // the caller, the final suspend and destroy paths then skip the deallocation.
+    bool __inline_frame = false;
+
+    // Argument copies
+    int x;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                        // initial suspend
+        frame_scope<manual_lifetime<task<int>>,                                   // int fx = co_await f(x);
+                    manual_lifetime<task<int>::awaiter>,
+                    frame_slot<__f_state>>,                                       // heap elision, see f.hpp
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1   () noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2   () noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3   () noexcept { return __frame.get<1, 1>(); }
+    auto & __f_frame() noexcept { return __frame.get<1, 2>(); }
+    auto & __tmp4   () noexcept { return __frame.get<2, 0>(); }
+
+    __g_state(int && x)
+        : x(static_cast<int &&>(x))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __g_resume;
+            this->__destroy = &__g_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __g_promise_t(construct_promise<__g_promise_t>(this->x));
+    }
+
+    ~__g_state()
+    {
+        this->__promise.~__g_promise_t();
+    }
+};
+
+// The three scopes share storage, the f frame embedded in scope 1 dominates it.
+static_assert(frame_report<__g_state>::suspend_index_size == 1);
+static_assert(frame_report<__g_state>::temporaries_size < frame_report<__g_state>::temporaries_unoverlapped_size);
+static_assert(frame_report<__g_state>::temporaries_size >= sizeof(frame_slot<__f_state>));
@@ -0,0 +1,299 @@
+#include "gather.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of sum_all(std::vector<task<int>> calls)
+//
+// task<long> sum_all(std::vector<task<int>> calls) {
+//   std::vector<int> results = co_await when_all(std::move(calls));
+//   long sum = 0;
+//   for(int r: results) sum += r;
+//   co_return sum;
+// }
+
+/////
+// The "ramp" function
+
+task<long> sum_all(std::vector<task<int>> calls)
+{
+    std::unique_ptr<__sum_all_state> state(new __sum_all_state(static_cast<std::vector<task<int>> &&>(calls)));
+    return __ramp(std::move(state), &__sum_all_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __sum_all_cancellable = __cancellation_points<std::suspend_always, when_all_range_awaiter<int>, task<long>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__sum_all_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__sum_all_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __sum_all_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  std::vector<int> results = co_await when_all(std::move(calls));
+        {
+            // when_all() returns the awaiter itself, there is no operator co_await().
+            state->__tmp2().construct_from([&]()
+            {
+                return when_all(std::move(state->calls));
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp2().get().await_suspend(std::coroutine_handle<__sum_all_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        // A child was cancelled, see g.cpp.
+        if(state->__tmp2().get().cancelled()) [[unlikely]] {
+            return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+        }
+#ifdef CORO_NO_EXCEPTIONS
+        // A child failed, see g.cpp.
+        if(std::error_code ec = state->__tmp2().get().error()) [[unlikely]] {
+            state->__tmp2().destroy();
+            state->__promise.set_error(ec);
+            goto final_suspend;
+        }
+#endif
+        std::vector<int> results = [&]() -> decltype(auto)
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            return state->__tmp2().get().await_resume();
+        }();
+
+        //  long sum = 0;
+        //  for(int r: results) sum += r;
+        long sum = 0;
+        for(int r: results){
+            sum += r;
+        }
+
+        //  co_return sum;
+        state->__promise.return_value(sum);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __sum_all_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__sum_all_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __sum_all_sites[] = {"initial suspend", "co_await when_all(std::move(calls))", "final suspend"};
+static const lowered_frame_info<__sum_all_state> __sum_all_frame_info{&__sum_all_destroy, "sum_all(calls)", __sum_all_sites};
+
+//////////////////////
+// Begin lowering of first_of(std::vector<task<int>> calls)
+//
+// task<int> first_of(std::vector<task<int>> calls) {
+//   auto [index, value] = co_await when_any(std::move(calls));
+//   co_return value;
+// }
+
+/////
+// The "ramp" function
+
+task<int> first_of(std::vector<task<int>> calls)
+{
+    std::unique_ptr<__first_of_state> state(new __first_of_state(static_cast<std::vector<task<int>> &&>(calls)));
+    return __ramp(std::move(state), &__first_of_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __first_of_cancellable = __cancellation_points<std::suspend_always, when_any_awaiter<int>, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__first_of_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__first_of_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __first_of_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  auto [index, value] = co_await when_any(std::move(calls));
+        {
+            // when_any() returns the awaiter itself, there is no operator co_await().
+            state->__tmp2().construct_from([&]()
+            {
+                return when_any(std::move(state->calls));
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp2().get().await_suspend(std::coroutine_handle<__first_of_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        // The winner was cancelled, see g.cpp.
+        if(state->__tmp2().get().cancelled()) [[unlikely]] {
+            return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+        }
+#ifdef CORO_NO_EXCEPTIONS
+        // The winner failed, see g.cpp.
+        if(std::error_code ec = state->__tmp2().get().error()) [[unlikely]] {
+            state->__tmp2().destroy();
+            state->__promise.set_error(ec);
+            goto final_suspend;
+        }
+#endif
+        auto [index, value] = [&]() -> decltype(auto)
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            return state->__tmp2().get().await_resume();
+        }();
+        (void)index;
+
+        //  co_return value;
+        state->__promise.return_value(value);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __first_of_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__first_of_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __first_of_sites[] = {"initial suspend", "co_await when_any(std::move(calls))", "final suspend"};
+static const lowered_frame_info<__first_of_state> __first_of_frame_info{&__first_of_destroy, "first_of(calls)", __first_of_sites};
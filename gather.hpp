@@ -0,0 +1,96 @@
+#pragma once
+#include<vector>
+#include "when_all.hpp"
+//////////////////////
+// Coroutine-states of sum_all(calls) and first_of(calls), see gather.cpp for
+// the lowering. Scatter-gather over a batch of already created tasks, the
+// pattern when_all / when_any exist for (bench/when_all.cpp).
+
+task<long> sum_all (std::vector<task<int>> calls);
+task<int>  first_of(std::vector<task<int>> calls);
+
+using __sum_all_promise_t  = std::coroutine_traits<task<long>, std::vector<task<int>>>::promise_type;
+using __first_of_promise_t = std::coroutine_traits<task<int>,  std::vector<task<int>>>::promise_type;
+
+__coroutine_state * __sum_all_resume (__coroutine_state *);
+void                __sum_all_destroy(__coroutine_state *);
+
+__coroutine_state * __first_of_resume (__coroutine_state *);
+void                __first_of_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definitions
+
+struct __sum_all_state : __coroutine_state_with_promise<__sum_all_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    std::vector<task<int>> calls;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                         // initial suspend
+        frame_scope<manual_lifetime<when_all_range_awaiter<int>>>,                 // co_await when_all(std::move(calls));
+        frame_scope<manual_lifetime<task<long>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __sum_all_state(std::vector<task<int>> && calls)
+        : calls(static_cast<std::vector<task<int>> &&>(calls))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __sum_all_resume;
+            this->__destroy = &__sum_all_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __sum_all_promise_t(construct_promise<__sum_all_promise_t>(this->calls));
+    }
+
+    ~__sum_all_state()
+    {
+        this->__promise.~__sum_all_promise_t();
+    }
+};
+
+struct __first_of_state : __coroutine_state_with_promise<__first_of_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    std::vector<task<int>> calls;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                        // initial suspend
+        frame_scope<manual_lifetime<when_any_awaiter<int>>>,                      // co_await when_any(std::move(calls));
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __first_of_state(std::vector<task<int>> && calls)
+        : calls(static_cast<std::vector<task<int>> &&>(calls))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __first_of_resume;
+            this->__destroy = &__first_of_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __first_of_promise_t(construct_promise<__first_of_promise_t>(this->calls));
+    }
+
+    ~__first_of_state()
+    {
+        this->__promise.~__first_of_promise_t();
+    }
+};
@@ -0,0 +1,195 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// generator<T>: a lazily evaluated sequence of T
+//
+//   generator<int> iota(int n) {
+//     for(int i = 0; i < n; ++i)
+//       co_yield i;
+//   }
+//
+//   for(int i: iota(10)) { ... }
+//
+// co_yield does not copy the value. The promise only records where the
+// yielded object lives, which is inside the coroutine frame (a local, or the
+// temporary of the co_yield expression), and the iterator reads it through
+// that pointer while the generator is suspended.
+//
+// A generator can also yield a whole batch, `co_yield std::span<const T>(...)`.
+// The iterator then walks the span and resumes the coroutine only once it is
+// exhausted, one __resume call per batch instead of per element. Both forms
+// are the same thing to the consumer: a single value is a span of one.
+
+#include<cstddef>
+#include<iterator>
+#include<span>
+#include "defs.hpp"
+
+template<typename T> class generator
+{
+    public:
+        class promise_type;
+        class iterator;
+
+    private:
+        std::coroutine_handle<promise_type> coro_;
+
+    public:
+        generator(generator && g) noexcept
+            : coro_(std::exchange(g.coro_, {}))
+        {}
+
+        ~generator()
+        {
+            if(coro_){
+                coro_.destroy();
+            }
+        }
+
+        generator & operator=(generator && g) noexcept
+        {
+            generator tmp = std::move(g);
+            using std::swap;
+
+            swap(coro_, tmp.coro_);
+            return *this;
+        }
+
+    private:
+        explicit generator(std::coroutine_handle<promise_type> h) noexcept
+            : coro_(h)
+        {}
+
+    public:
+        // Runs the coroutine up to its first co_yield.
+        iterator begin()
+        {
+            iterator it{coro_};
+            it.next();
+            return it;
+        }
+
+        std::default_sentinel_t end() noexcept
+        {
+            return {};
+        }
+};
+
+template<typename T> class generator<T>::promise_type
+{
+    private:
+        friend class generator;
+
+        // The values of the last co_yield, [first_, last_) inside the frame.
+        const T * first_ = nullptr;
+        const T * last_  = nullptr;
+
+#ifndef CORO_NO_EXCEPTIONS
+        std::exception_ptr exception_;
+#endif
+
+    public:
+        generator get_return_object() noexcept
+        {
+            return generator{std::coroutine_handle<promise_type>::from_promise(*this)};
+        }
+
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_always   final_suspend() noexcept { return {}; }
+
+        std::suspend_always yield_value(const T & value) noexcept
+        {
+            first_ = std::addressof(value);
+            last_  = first_ + 1;
+            return {};
+        }
+
+        std::suspend_always yield_value(std::span<const T> values) noexcept
+        {
+            first_ = values.data();
+            last_  = values.data() + values.size();
+            return {};
+        }
+
+        void return_void() noexcept {}
+
+#ifndef CORO_NO_EXCEPTIONS
+        void unhandled_exception() noexcept
+        {
+            exception_ = std::current_exception();
+        }
+#endif
+
+    public:
+        // See __task_promise_base.
+        static void * operator new   (std::size_t size)                     { return __allocate_frame(size); }
+        static void   operator delete(void *ptr, std::size_t size) noexcept { __deallocate_frame(ptr, size); }
+};
+
+template<typename T> class generator<T>::iterator
+{
+    private:
+        friend class generator;
+
+        std::coroutine_handle<promise_type> coro_;
+
+        // Copy of the promise's [first_, last_) while walking it, both null at the end.
+        const T * current_ = nullptr;
+        const T * last_    = nullptr;
+
+        explicit iterator(std::coroutine_handle<promise_type> h) noexcept
+            : coro_(h)
+        {}
+
+    public:
+        using value_type      = T;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() noexcept = default;
+
+    public:
+        const T & operator*() const noexcept
+        {
+            return *current_;
+        }
+
+        iterator & operator++()
+        {
+            if(++current_ == last_){
+                next();
+            }
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++*this;
+        }
+
+        friend bool operator==(const iterator & it, std::default_sentinel_t) noexcept
+        {
+            return it.current_ == it.last_;
+        }
+
+    private:
+        // Resume until the next non-empty co_yield or the end of the coroutine.
+        void next()
+        {
+            promise_type & p = coro_.promise();
+            do{
+                coro_.resume();
+                if(coro_.done()){
+                    current_ = last_ = nullptr;
+#ifndef CORO_NO_EXCEPTIONS
+                    if(p.exception_) [[unlikely]] {
+                        std::rethrow_exception(std::move(p.exception_));
+                    }
+#endif
+                    return;
+                }
+            }
+            while(p.first_ == p.last_);
+
+            current_ = p.first_;
+            last_    = p.last_;
+        }
+};
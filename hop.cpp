@@ -0,0 +1,148 @@
+#include "hop.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of hop(thread_pool &pool, int n)
+//
+// task<int> hop(thread_pool &pool, int n) {
+//   for(int i = 0; i < n; ++i) {
+//     co_await pool.schedule();
+//   }
+//   co_return n;
+// }
+//
+// Unlike task::awaiter, schedule_awaiter::await_suspend() returns void, so after
+// calling it we return to the resumer via the noop-coroutine.
+
+/////
+// The "ramp" function
+
+task<int> hop(thread_pool &pool, int n)
+{
+    std::unique_ptr<__hop_state> state(new __hop_state(pool, static_cast<int &&>(n)));
+    return __ramp(std::move(state), &__hop_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __hop_cancellable = __cancellation_points<std::suspend_always, thread_pool::schedule_awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__hop_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__hop_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __hop_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  for(int i = 0; i < n; ++i)
+        state->i = 0;
+
+loop_condition:
+        if(!(state->i < state->n)){
+            goto loop_end;
+        }
+
+        //  co_await pool.schedule();
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return state->pool.schedule();
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__hop_promise_t>::from_promise(state->__promise));
+
+                // void-returning await_suspend: suspend and return to whoever resumed us.
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        ++state->i;
+        goto loop_condition;
+
+loop_end:
+        //  co_return n;
+        state->__promise.return_value(state->n);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __hop_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__hop_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __hop_sites[] = {"initial suspend", "co_await pool.schedule()", "final suspend"};
+static const lowered_frame_info<__hop_state> __hop_frame_info{&__hop_destroy, "hop(pool, n)", __hop_sites};
@@ -0,0 +1,56 @@
+#pragma once
+#include "scheduler.hpp"
+//////////////////////
+// Coroutine-state of hop(thread_pool &pool, int n), see hop.cpp for the lowering.
+
+task<int> hop(thread_pool &pool, int n);
+
+using __hop_promise_t = std::coroutine_traits<task<int>, thread_pool &, int>::promise_type;
+
+__coroutine_state * __hop_resume (__coroutine_state *);
+void                __hop_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definition
+
+struct __hop_state : __coroutine_state_with_promise<__hop_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    thread_pool & pool;
+    int n;
+
+    // Local variables that live across a suspend-point
+    int i;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                          // initial suspend
+        frame_scope<manual_lifetime<thread_pool::schedule_awaiter>>,                // co_await pool.schedule();
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;      // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __hop_state(thread_pool & pool, int && n)
+        : pool(pool)
+        , n(static_cast<int &&>(n))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __hop_resume;
+            this->__destroy = &__hop_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __hop_promise_t(construct_promise<__hop_promise_t>(this->pool, this->n));
+    }
+
+    ~__hop_state()
+    {
+        this->__promise.~__hop_promise_t();
+    }
+};
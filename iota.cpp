@@ -0,0 +1,283 @@
+#include <algorithm>
+#include "iota.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of iota(int n)
+//
+// generator<int> iota(int n) {
+//   for(int i = 0; i < n; ++i)
+//     co_yield i;
+// }
+//
+// `co_yield i` is `co_await promise.yield_value(i)`: the promise keeps a
+// pointer to state->i and the consumer reads the value from the frame.
+
+/////
+// The "ramp" function
+
+generator<int> iota(int n)
+{
+    std::unique_ptr<__iota_state> state(new __iota_state(static_cast<int &&>(n)));
+    return __ramp(std::move(state), &__iota_resume);
+}
+
+/////
+//  The "resume" function
+
+__coroutine_state *__iota_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__iota_state *>(s);
+    CORO_TRACE_EVENT(resume, state, state->__suspend_point);
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  for(int i = 0; i < n; ++i)
+        state->i = 0;
+
+loop_condition:
+        if(!(state->i < state->n)){
+            goto loop_end;
+        }
+
+        //  co_yield i;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return state->__promise.yield_value(state->i);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__iota_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        ++state->i;
+        goto loop_condition;
+
+loop_end:
+        //  flowing off the end
+        state->__promise.return_void();
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __iota_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__iota_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __iota_sites[] = {"initial suspend", "co_yield i", "final suspend"};
+static const lowered_frame_info<__iota_state> __iota_frame_info{&__iota_destroy, "iota(int n)", __iota_sites};
+
+//////////////////////
+// Begin lowering of iota_batched(int n)
+//
+// generator<int> iota_batched(int n) {
+//   int buffer[64];
+//   for(int i = 0; i < n; i += 64) {
+//     int count = std::min(64, n - i);
+//     for(int j = 0; j < count; ++j)
+//       buffer[j] = i + j;
+//     co_yield std::span<const int>(buffer, count);
+//   }
+// }
+//
+// Same sequence as iota(n), yielded 64 values per resume.
+
+/////
+// The "ramp" function
+
+generator<int> iota_batched(int n)
+{
+    std::unique_ptr<__iota_batched_state> state(new __iota_batched_state(static_cast<int &&>(n)));
+    return __ramp(std::move(state), &__iota_batched_resume);
+}
+
+/////
+//  The "resume" function
+
+__coroutine_state *__iota_batched_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__iota_batched_state *>(s);
+    CORO_TRACE_EVENT(resume, state, state->__suspend_point);
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  for(int i = 0; i < n; i += 64)
+        state->i = 0;
+
+loop_condition:
+        if(!(state->i < state->n)){
+            goto loop_end;
+        }
+
+        //  co_yield std::span<const int>(buffer, count);
+        {
+            //  int count = std::min(64, n - i);
+            //  for(int j = 0; j < count; ++j) buffer[j] = i + j;
+            const int count = std::min(__iota_batched_state::batch, state->n - state->i);
+            for(int j = 0; j < count; ++j){
+                state->buffer[j] = state->i + j;
+            }
+
+            state->__tmp2().construct_from([&]()
+            {
+                return state->__promise.yield_value(std::span<const int>(state->buffer, count));
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__iota_batched_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        state->i += __iota_batched_state::batch;
+        goto loop_condition;
+
+loop_end:
+        //  flowing off the end
+        state->__promise.return_void();
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __iota_batched_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__iota_batched_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __iota_batched_sites[] = {"initial suspend", "co_yield std::span<const int>(buffer, count)", "final suspend"};
+static const lowered_frame_info<__iota_batched_state> __iota_batched_frame_info{&__iota_batched_destroy, "iota_batched(int n)", __iota_batched_sites};
@@ -0,0 +1,103 @@
+#pragma once
+#include "generator.hpp"
+//////////////////////
+// Coroutine-states of iota(int n) and iota_batched(int n), see iota.cpp for
+// the lowering.
+
+generator<int> iota        (int n);
+generator<int> iota_batched(int n);
+
+using __iota_promise_t         = std::coroutine_traits<generator<int>, int>::promise_type;
+using __iota_batched_promise_t = std::coroutine_traits<generator<int>, int>::promise_type;
+
+__coroutine_state * __iota_resume (__coroutine_state *);
+void                __iota_destroy(__coroutine_state *);
+
+__coroutine_state * __iota_batched_resume (__coroutine_state *);
+void                __iota_batched_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definitions
+
+struct __iota_state : __coroutine_state_with_promise<__iota_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    int n;
+
+    // Local variables that live across a suspend-point
+    int i;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,    // initial suspend
+        frame_scope<manual_lifetime<std::suspend_always>>,    // co_yield i;
+        frame_scope<manual_lifetime<std::suspend_always>>>;   // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __iota_state(int && n)
+        : n(static_cast<int &&>(n))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __iota_resume;
+            this->__destroy = &__iota_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __iota_promise_t(construct_promise<__iota_promise_t>(this->n));
+    }
+
+    ~__iota_state()
+    {
+        this->__promise.~__iota_promise_t();
+    }
+};
+
+struct __iota_batched_state : __coroutine_state_with_promise<__iota_batched_promise_t>
+{
+    static constexpr int batch = 64;
+
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    int n;
+
+    // Local variables that live across a suspend-point
+    int buffer[batch];
+    int i;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,    // initial suspend
+        frame_scope<manual_lifetime<std::suspend_always>>,    // co_yield std::span<const int>(buffer, count);
+        frame_scope<manual_lifetime<std::suspend_always>>>;   // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __iota_batched_state(int && n)
+        : n(static_cast<int &&>(n))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __iota_batched_resume;
+            this->__destroy = &__iota_batched_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __iota_batched_promise_t(construct_promise<__iota_batched_promise_t>(this->n));
+    }
+
+    ~__iota_batched_state()
+    {
+        this->__promise.~__iota_batched_promise_t();
+    }
+};
@@ -0,0 +1,397 @@
+#include "journey.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of leg(int x)
+//
+// task<int> leg(int x) {
+//   co_await persistent_park{};
+//   x = x * 3 + 1;
+//   co_await persistent_park{};
+//   co_return x ^ (x >> 2);
+// }
+//
+// Parks twice in its frame_region: the driver resumes it from take_parked(),
+// in this process or, after a restart, in the next one.
+
+/////
+// The "ramp" function
+
+task<int> leg(int x)
+{
+    std::unique_ptr<__leg_state> state(new __leg_state(static_cast<int &&>(x)));
+    return __ramp(std::move(state), &__leg_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __leg_cancellable = __cancellation_points<std::suspend_always, persistent_park, persistent_park, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__leg_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__leg_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __leg_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            case 2: goto suspend_point_2;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  co_await persistent_park{};
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return persistent_park{};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__leg_promise_t>::from_promise(state->__promise));
+
+                // void-returning await_suspend: suspend and return to whoever resumed us.
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 3 + 1;
+        state->x = state->x * 3 + 1;
+
+        //  co_await persistent_park{};
+        {
+            state->__tmp3().construct_from([&]()
+            {
+                return persistent_park{};
+            });
+            destructor_guard tmp3_dtor{state->__tmp3()};
+
+            if(!state->__tmp3().get().await_ready()){
+                state->__suspend_point = 2;
+                CORO_TRACE_EVENT(suspend, state, 2);
+                __release_running_frame();
+                state->__tmp3().get().await_suspend(std::coroutine_handle<__leg_promise_t>::from_promise(state->__promise));
+
+                tmp3_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp3_dtor.cancel();
+        }
+
+suspend_point_2:
+        {
+            destructor_guard tmp3_dtor{state->__tmp3()};
+            state->__tmp3().get().await_resume();
+        }
+
+        //  co_return x ^ (x >> 2);
+        state->__promise.return_value(state->x ^ (state->x >> 2));
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp4(), 3);
+}
+
+/////
+// The "destroy" function
+
+void __leg_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__leg_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        case 3: goto suspend_point_3;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+suspend_point_3:
+    state->__tmp4().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __leg_sites[] = {"initial suspend", "co_await persistent_park{}", "x = x * 3 + 1; co_await persistent_park{}", "final suspend"};
+static const lowered_frame_info<__leg_state> __leg_frame_info{&__leg_destroy, "leg(int x)", __leg_sites};
+
+/////
+// Persistence, see frame_region.hpp
+
+static const persistent_frame_type<__leg_state> __leg_persistent{&__leg_resume, &__leg_destroy, "leg(int x)"};
+
+//////////////////////
+// Begin lowering of journey(std::allocator_arg_t, std::pmr::memory_resource *resource, int x)
+//
+// task<int> journey(std::allocator_arg_t, std::pmr::memory_resource *resource, int x) {
+//   int a = co_await leg(x);
+//   int b = co_await leg(a);
+//   co_return a + b;
+// }
+//
+// With resource = &region every frame of the workflow is in the region: the
+// ramp allocates this one through the promise's operator new, see request.cpp,
+// and the legs come from the same resource through __frame_resource_scope.
+// `resource` itself points into the process that called the ramp and is not
+// used by the body, which keeps the frame relocatable, see frame_region.hpp.
+
+/////
+// The "ramp" function
+
+task<int> journey(std::allocator_arg_t alloc_tag, std::pmr::memory_resource *resource, int x)
+{
+    std::unique_ptr<__journey_state> state(new (alloc_tag, resource, x) __journey_state(static_cast<std::allocator_arg_t &&>(alloc_tag), static_cast<std::pmr::memory_resource *&&>(resource), static_cast<int &&>(x)));
+    return __ramp(std::move(state), &__journey_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __journey_cancellable = __cancellation_points<std::suspend_always, task<int>::awaiter, task<int>::awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__journey_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__journey_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __journey_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            case 2: goto suspend_point_2;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  int a = co_await leg(x);
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return leg(state->x);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            state->__tmp3().construct_from([&]()
+            {
+                return static_cast<task<int> &&>(state->__tmp2().get()).operator co_await();
+            });
+            destructor_guard tmp3_dtor{state->__tmp3()};
+
+            if(!state->__tmp3().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp3().get().await_suspend(std::coroutine_handle<__journey_promise_t>::from_promise(state->__promise));
+
+                tmp3_dtor.cancel();
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+
+            tmp3_dtor.cancel();
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        // The child was cancelled, see g.cpp.
+        if(state->__tmp3().get().cancelled()) [[unlikely]] {
+            return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+        }
+#ifdef CORO_NO_EXCEPTIONS
+        // The awaited task failed, see g.cpp.
+        if(std::error_code ec = state->__tmp3().get().error()) [[unlikely]] {
+            state->__tmp3().destroy();
+            state->__tmp2().destroy();
+            state->__promise.set_error(ec);
+            goto final_suspend;
+        }
+#endif
+        state->a = [&]() -> decltype(auto)
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            destructor_guard tmp3_dtor{state->__tmp3()};
+            return state->__tmp3().get().await_resume();
+        }();
+
+        //  int b = co_await leg(a);
+        {
+            state->__tmp4().construct_from([&]()
+            {
+                return leg(state->a);
+            });
+            destructor_guard tmp4_dtor{state->__tmp4()};
+
+            state->__tmp5().construct_from([&]()
+            {
+                return static_cast<task<int> &&>(state->__tmp4().get()).operator co_await();
+            });
+            destructor_guard tmp5_dtor{state->__tmp5()};
+
+            if(!state->__tmp5().get().await_ready()){
+                state->__suspend_point = 2;
+                CORO_TRACE_EVENT(suspend, state, 2);
+                __release_running_frame();
+                auto h = state->__tmp5().get().await_suspend(std::coroutine_handle<__journey_promise_t>::from_promise(state->__promise));
+
+                tmp5_dtor.cancel();
+                tmp4_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+
+            tmp5_dtor.cancel();
+            tmp4_dtor.cancel();
+        }
+
+suspend_point_2:
+        if(state->__tmp5().get().cancelled()) [[unlikely]] {
+            return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+        }
+#ifdef CORO_NO_EXCEPTIONS
+        if(std::error_code ec = state->__tmp5().get().error()) [[unlikely]] {
+            state->__tmp5().destroy();
+            state->__tmp4().destroy();
+            state->__promise.set_error(ec);
+            goto final_suspend;
+        }
+#endif
+        int b = [&]() -> decltype(auto)
+        {
+            destructor_guard tmp4_dtor{state->__tmp4()};
+            destructor_guard tmp5_dtor{state->__tmp5()};
+            return state->__tmp5().get().await_resume();
+        }();
+
+        //  co_return a + b;
+        state->__promise.return_value(state->a + b);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp6(), 3);
+}
+
+/////
+// The "destroy" function
+
+void __journey_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__journey_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        case 3: goto suspend_point_3;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp3().destroy();
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp5().destroy();
+    state->__tmp4().destroy();
+    goto destroy_state;
+
+suspend_point_3:
+    state->__tmp6().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __journey_sites[] = {"initial suspend", "co_await leg(x)", "co_await leg(a)", "final suspend"};
+static const lowered_frame_info<__journey_state> __journey_frame_info{&__journey_destroy, "journey(std::allocator_arg, resource, x)", __journey_sites};
+
+/////
+// Persistence, see frame_region.hpp
+
+static const persistent_frame_type<__journey_state> __journey_persistent{&__journey_resume, &__journey_destroy, "journey(std::allocator_arg, resource, x)"};
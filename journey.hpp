@@ -0,0 +1,110 @@
+#pragma once
+#include "frame_region.hpp"
+//////////////////////
+// Coroutine-states of leg(x) and journey(std::allocator_arg, resource, x), see
+// journey.cpp for the lowering. Workflows whose frames live in a frame_region
+// and survive a restart (bench/frame_region.cpp).
+
+task<int> leg    (int x);
+task<int> journey(std::allocator_arg_t, std::pmr::memory_resource *resource, int x);
+
+using __leg_promise_t     = std::coroutine_traits<task<int>, int>::promise_type;
+using __journey_promise_t = std::coroutine_traits<task<int>, std::allocator_arg_t, std::pmr::memory_resource *, int>::promise_type;
+
+__coroutine_state * __leg_resume (__coroutine_state *);
+void                __leg_destroy(__coroutine_state *);
+
+__coroutine_state * __journey_resume (__coroutine_state *);
+void                __journey_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definitions
+
+struct __leg_state : __coroutine_state_with_promise<__leg_promise_t>
+{
+    __suspend_index_t<4> __suspend_point = 0;
+
+    // Argument copies
+    int x;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                        // initial suspend
+        frame_scope<manual_lifetime<persistent_park>>,                            // co_await persistent_park{};
+        frame_scope<manual_lifetime<persistent_park>>,                            // co_await persistent_park{};
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+    auto & __tmp4() noexcept { return __frame.get<3, 0>(); }
+
+    __leg_state(int && x)
+        : x(static_cast<int &&>(x))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __leg_resume;
+            this->__destroy = &__leg_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __leg_promise_t(construct_promise<__leg_promise_t>(this->x));
+    }
+
+    ~__leg_state()
+    {
+        this->__promise.~__leg_promise_t();
+    }
+};
+
+struct __journey_state : __coroutine_state_with_promise<__journey_promise_t>
+{
+    __suspend_index_t<4> __suspend_point = 0;
+
+    // Argument copies
+    std::allocator_arg_t alloc_tag;
+    std::pmr::memory_resource *resource;
+    int x;
+
+    // Local variables that live across a suspend-point
+    int a;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                       // initial suspend
+        frame_scope<manual_lifetime<task<int>>,                                  // int a = co_await leg(x);
+                    manual_lifetime<task<int>::awaiter>>,
+        frame_scope<manual_lifetime<task<int>>,                                  // int b = co_await leg(a);
+                    manual_lifetime<task<int>::awaiter>>,
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<1, 1>(); }
+    auto & __tmp4() noexcept { return __frame.get<2, 0>(); }
+    auto & __tmp5() noexcept { return __frame.get<2, 1>(); }
+    auto & __tmp6() noexcept { return __frame.get<3, 0>(); }
+
+    __journey_state(std::allocator_arg_t && alloc_tag, std::pmr::memory_resource *&& resource, int && x)
+        : alloc_tag(static_cast<std::allocator_arg_t &&>(alloc_tag))
+        , resource(static_cast<std::pmr::memory_resource *&&>(resource))
+        , x(static_cast<int &&>(x))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __journey_resume;
+            this->__destroy = &__journey_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __journey_promise_t(construct_promise<__journey_promise_t>(this->alloc_tag, this->resource, this->x));
+    }
+
+    ~__journey_state()
+    {
+        this->__promise.~__journey_promise_t();
+    }
+};
@@ -0,0 +1,316 @@
+#include "lookup.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of lookup(std::span<const int> cache, thread_pool & pool, int key)
+//
+// eager_task<int> lookup(std::span<const int> cache, thread_pool & pool, int key) {
+//   if(static_cast<std::size_t>(key) < cache.size())
+//     co_return cache[key];
+//   co_await pool.schedule();
+//   co_return key;
+// }
+//
+// The initial suspend is suspend_never, so the ramp goes straight on into the
+// body. It does so through the trampoline in coroutine_handle<>::resume()
+// rather than by calling __lookup_resume() itself: the body may transfer to
+// other coroutines, which the trampoline runs until it gets the noop coroutine
+// back. Suspend-point 0 is therefore never suspended at. The __eager_ramp_scope
+// around it lets a hit complete without an atomic read-modify-write, see
+// eager_task.hpp.
+//
+// A miss stands in for fetching the value elsewhere: the coroutine continues
+// on a worker of `pool`, and whoever awaits it by then is resumed from there.
+
+/////
+// The "ramp" function
+
+eager_task<int> lookup(std::span<const int> cache, thread_pool & pool, int key)
+{
+    std::unique_ptr<__lookup_state> state(new __lookup_state(static_cast<std::span<const int> &&>(cache), pool, static_cast<int &&>(key)));
+    return __ramp(std::move(state), [](__coroutine_state *frame)
+    {
+        // Run the body up to its first suspend-point or its end.
+        __eager_ramp_scope ramp_scope(frame);
+        std::coroutine_handle<>::from_address(frame).resume();
+    });
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __lookup_cancellable = __cancellation_points<std::suspend_never, thread_pool::schedule_awaiter, eager_task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__lookup_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__lookup_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __lookup_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  if(static_cast<std::size_t>(key) < cache.size())
+        //    co_return cache[key];
+        if(static_cast<std::size_t>(state->key) < state->cache.size()){
+            state->__promise.return_value(state->cache[state->key]);
+            goto final_suspend;
+        }
+
+        //  co_await pool.schedule();
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return state->pool.schedule();
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__lookup_promise_t>::from_promise(state->__promise));
+
+                // void-returning await_suspend: return to whoever resumed us, a
+                // worker of the pool resumes us at suspend-point 1.
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  co_return key;
+        state->__promise.return_value(state->key);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __lookup_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__lookup_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    // No case 0: the ramp resumes through the initial suspend-point.
+    switch(state->__suspend_point){
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __lookup_sites[] = {"initial suspend", "co_await pool.schedule()", "final suspend"};
+static const lowered_frame_info<__lookup_state> __lookup_frame_info{&__lookup_destroy, "lookup(cache, pool, key)", __lookup_sites};
+
+//////////////////////
+// Begin lowering of cached_square(std::span<const int> cache, thread_pool & pool, int key)
+//
+// task<int> cached_square(std::span<const int> cache, thread_pool & pool, int key) {
+//   int v = co_await lookup(cache, pool, key);
+//   co_return v * v;
+// }
+//
+// eager_task::awaiter::await_ready() is true when lookup() finished in its
+// ramp: we then skip the suspend and go on to await_resume() in this same
+// call. Otherwise its await_suspend() returns bool, false if lookup() finished
+// in the meantime, which takes the same non-suspending branch.
+
+/////
+// The "ramp" function
+
+task<int> cached_square(std::span<const int> cache, thread_pool & pool, int key)
+{
+    std::unique_ptr<__cached_square_state> state(new __cached_square_state(static_cast<std::span<const int> &&>(cache), pool, static_cast<int &&>(key)));
+    return __ramp(std::move(state), &__cached_square_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __cached_square_cancellable = __cancellation_points<std::suspend_always, eager_task<int>::awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__cached_square_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__cached_square_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __cached_square_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  int v = co_await lookup(cache, pool, key);
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return lookup(state->cache, state->pool, state->key);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            state->__tmp3().construct_from([&]()
+            {
+                return static_cast<eager_task<int> &&>(state->__tmp2().get()).operator co_await();
+            });
+            destructor_guard tmp3_dtor{state->__tmp3()};
+
+            if(!state->__tmp3().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                if(state->__tmp3().get().await_suspend(std::coroutine_handle<__cached_square_promise_t>::from_promise(state->__promise))){
+                    // bool-returning await_suspend: true means lookup() resumes us when it's done, return to whoever resumed us.
+                    tmp3_dtor.cancel();
+                    tmp2_dtor.cancel();
+                    return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+                }
+            }
+
+            // The result is there already: no suspend, no transfer, straight
+            // on to await_resume() below.
+            tmp3_dtor.cancel();
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        // A cancelled lookup() (through a token of its own, e.g. of a task it awaits): pass it on.
+        if(state->__tmp3().get().cancelled()) [[unlikely]] {
+            return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+        }
+#ifdef CORO_NO_EXCEPTIONS
+        // The awaited task failed: take over its error and leave through the
+        // final suspend-point, destroying the temporaries of this scope on the way.
+        if(std::error_code ec = state->__tmp3().get().error()) [[unlikely]] {
+            state->__tmp3().destroy();
+            state->__tmp2().destroy();
+            state->__promise.set_error(ec);
+            goto final_suspend;
+        }
+#endif
+        int v = [&]() -> decltype(auto)
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            destructor_guard tmp3_dtor{state->__tmp3()};
+            return state->__tmp3().get().await_resume();
+        }();
+
+        //  co_return v * v;
+        state->__promise.return_value(v * v);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp4(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __cached_square_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__cached_square_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp3().destroy();
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp4().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __cached_square_sites[] = {"initial suspend", "co_await lookup(cache, pool, key)", "final suspend"};
+static const lowered_frame_info<__cached_square_state> __cached_square_frame_info{&__cached_square_destroy, "cached_square(cache, pool, key)", __cached_square_sites};
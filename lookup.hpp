@@ -0,0 +1,108 @@
+#pragma once
+#include<span>
+#include "eager_task.hpp"
+#include "scheduler.hpp"
+//////////////////////
+// Coroutine-states of lookup(cache, pool, key) and cached_square(cache, pool,
+// key), see lookup.cpp for the lowering. lookup() is an eager_task that
+// finishes in its ramp on a cache hit, bench/eager.cpp compares the two paths
+// with the lazy g(x).
+
+eager_task<int> lookup       (std::span<const int> cache, thread_pool & pool, int key);
+task<int>       cached_square(std::span<const int> cache, thread_pool & pool, int key);
+
+using __lookup_promise_t        = std::coroutine_traits<eager_task<int>, std::span<const int>, thread_pool &, int>::promise_type;
+using __cached_square_promise_t = std::coroutine_traits<task<int>,       std::span<const int>, thread_pool &, int>::promise_type;
+
+__coroutine_state * __lookup_resume (__coroutine_state *);
+void                __lookup_destroy(__coroutine_state *);
+
+__coroutine_state * __cached_square_resume (__coroutine_state *);
+void                __cached_square_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definitions
+
+struct __lookup_state : __coroutine_state_with_promise<__lookup_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    std::span<const int> cache;
+    thread_pool & pool;
+    int key;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_never>>,                             // initial suspend
+        frame_scope<manual_lifetime<thread_pool::schedule_awaiter>>,                  // co_await pool.schedule();
+        frame_scope<manual_lifetime<eager_task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __lookup_state(std::span<const int> && cache, thread_pool & pool, int && key)
+        : cache(static_cast<std::span<const int> &&>(cache))
+        , pool(pool)
+        , key(static_cast<int &&>(key))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __lookup_resume;
+            this->__destroy = &__lookup_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __lookup_promise_t(construct_promise<__lookup_promise_t>(this->cache, this->pool, this->key));
+    }
+
+    ~__lookup_state()
+    {
+        this->__promise.~__lookup_promise_t();
+    }
+};
+
+struct __cached_square_state : __coroutine_state_with_promise<__cached_square_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    std::span<const int> cache;
+    thread_pool & pool;
+    int key;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                        // initial suspend
+        frame_scope<manual_lifetime<eager_task<int>>,                             // int v = co_await lookup(cache, pool, key);
+                    manual_lifetime<eager_task<int>::awaiter>>,
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<1, 1>(); }
+    auto & __tmp4() noexcept { return __frame.get<2, 0>(); }
+
+    __cached_square_state(std::span<const int> && cache, thread_pool & pool, int && key)
+        : cache(static_cast<std::span<const int> &&>(cache))
+        , pool(pool)
+        , key(static_cast<int &&>(key))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __cached_square_resume;
+            this->__destroy = &__cached_square_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __cached_square_promise_t(construct_promise<__cached_square_promise_t>(this->cache, this->pool, this->key));
+    }
+
+    ~__cached_square_state()
+    {
+        this->__promise.~__cached_square_promise_t();
+    }
+};
@@ -0,0 +1,1175 @@
+#include "lower.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstddef>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+namespace lower
+{
+    namespace
+    {
+        //////////////////////
+        // Text
+
+        std::string_view trim(std::string_view s)
+        {
+            while(!s.empty() && std::isspace(static_cast<unsigned char>(s.front()))){
+                s.remove_prefix(1);
+            }
+            while(!s.empty() && std::isspace(static_cast<unsigned char>(s.back()))){
+                s.remove_suffix(1);
+            }
+            return s;
+        }
+
+        bool is_identifier_char(char c)
+        {
+            return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
+        }
+
+        bool is_identifier(std::string_view s)
+        {
+            return !s.empty() && !std::isdigit(static_cast<unsigned char>(s.front())) && std::all_of(s.begin(), s.end(), is_identifier_char);
+        }
+
+        // Splits at the commas outside of (), <>, [] and {}.
+        std::vector<std::string_view> split_top_level(std::string_view s)
+        {
+            std::vector<std::string_view> parts;
+            int depth = 0;
+            std::size_t start = 0;
+            for(std::size_t i = 0; i < s.size(); ++i){
+                switch(s[i]){
+                    case '(': case '<': case '[': case '{': ++depth; break;
+                    case ')': case '>': case ']': case '}': --depth; break;
+                    case ',':
+                        if(depth == 0){
+                            parts.push_back(trim(s.substr(start, i - start)));
+                            start = i + 1;
+                        }
+                        break;
+                }
+            }
+            if(!trim(s).empty()){
+                parts.push_back(trim(s.substr(start)));
+            }
+            return parts;
+        }
+
+        // `type name`, where type may end in * or &.
+        bool split_declarator(std::string_view s, std::string & type, std::string & name)
+        {
+            s = trim(s);
+            std::size_t i = s.size();
+            while(i > 0 && is_identifier_char(s[i - 1])){
+                --i;
+            }
+            const std::string_view t = trim(s.substr(0, i));
+            if(t.empty() || !is_identifier(s.substr(i))){
+                return false;
+            }
+            for(char c: t){
+                if(!is_identifier_char(c) && std::string_view(":<>,*& ").find(c) == std::string_view::npos){
+                    return false;
+                }
+            }
+            type = t;
+            name = s.substr(i);
+            return true;
+        }
+
+        std::string pad(std::string s, std::size_t width)
+        {
+            s.resize(std::max(width, s.size()), ' ');
+            return s;
+        }
+
+        std::string quote(std::string_view s)
+        {
+            std::string q = "\"";
+            for(char c: s){
+                if(c == '"' || c == '\\'){
+                    q += '\\';
+                }
+                q += c;
+            }
+            return q + "\"";
+        }
+
+        //////////////////////
+        // The input
+
+        struct param
+        {
+            std::string type;
+            std::string name;
+
+            // int x, std::pmr::memory_resource *resource
+            std::string declaration() const
+            {
+                return type.ends_with('*') || type.ends_with('&') ? type + name : type + " " + name;
+            }
+
+            std::string rvalue_type() const
+            {
+                return type.ends_with('*') || type.ends_with('&') ? type + "&&" : type + " &&";
+            }
+        };
+
+        struct coroutine
+        {
+            std::string        result;        // task<int>, generator<int>
+            std::string        name;
+            std::string        params_text;   // as written
+            std::vector<param> params;
+
+            bool is_generator() const
+            {
+                return result.starts_with("generator<");
+            }
+
+            // T of task<T>
+            std::string value_type() const
+            {
+                const std::size_t open = result.find('<');
+                return result.substr(open + 1, result.size() - open - 2);
+            }
+
+            bool allocator_arg() const
+            {
+                return !params.empty() && params.front().type == "std::allocator_arg_t";
+            }
+        };
+
+        struct statement
+        {
+            enum kind_t { expression, declaration, block, await_task, await_value, yield, return_ };
+
+            kind_t      kind;
+            int         line;
+            std::string source;   // trimmed, as written
+            std::string type;     // of a declared local, also the result of an await
+            std::string name;
+            std::string expr;     // initialiser, co_await / co_yield operand, co_return value
+
+            std::vector<statement> body;
+
+            // Set by the analysis.
+            bool        member        = false;
+            int         suspend_point = 0;
+            std::size_t scope         = 0;
+            std::string callee        = {};
+        };
+
+        //////////////////////
+        // The coroutine-state
+
+        struct slot
+        {
+            std::string type;       // frame_scope element
+            std::string accessor;   // __tmpN or __<callee>_frame
+            bool        temporary;  // manual_lifetime, destroyed by the destroy function
+            std::string comment   = {};
+        };
+
+        struct scope
+        {
+            std::string       comment;
+            std::vector<slot> slots;
+        };
+
+        class lowering
+        {
+            private:
+                std::string file_;
+
+                std::vector<std::string>          includes_;
+                bool                              placement_ = false;
+                bool                              declared_  = false;
+                std::set<std::string>             embeds_;
+                std::map<std::string, coroutine>  awaitables_;
+
+                coroutine                co_;
+                std::vector<std::string> echo_;
+                std::vector<statement>   body_;
+                std::vector<std::string> trailer_;
+                int                      end_line_ = 0;
+
+                std::vector<param>       locals_;
+                std::vector<scope>       scopes_;
+                std::vector<std::string> sites_;
+                std::vector<std::string> awaiters_;     // of each suspend-point, for the cancellation points
+                int                      tmps_           = 0;
+                int                      suspend_points_ = 0;
+                std::map<std::string, int> frames_;
+
+                std::string out_;
+
+            public:
+                explicit lowering(std::string_view file)
+                    : file_(file)
+                {}
+
+                output run(std::string_view input)
+                {
+                    parse(input);
+                    analyse();
+
+                    output o;
+                    o.name   = co_.name;
+                    o.header = header();
+                    o.source = source();
+                    return o;
+                }
+
+            private:
+                [[noreturn]] void fail(int line, const std::string & what) const
+                {
+                    throw error(file_ + ":" + std::to_string(line) + ": " + what);
+                }
+
+                //////////////////////
+                // Parsing
+
+                void parse(std::string_view input)
+                {
+                    std::vector<std::string_view> lines;
+                    for(std::size_t start = 0; start < input.size();){
+                        std::size_t end = input.find('\n', start);
+                        if(end == std::string_view::npos){
+                            end = input.size();
+                        }
+                        lines.push_back(input.substr(start, end - start));
+                        start = end + 1;
+                    }
+
+                    std::size_t i = 0;
+                    for(; i < lines.size(); ++i){
+                        const std::string_view l = trim(lines[i]);
+                        const int line = static_cast<int>(i + 1);
+                        if(l.empty() || l.starts_with("//")){
+                            continue;
+                        }
+                        if(l.starts_with("#include")){
+                            includes_.emplace_back(l);
+                        }
+                        else if(l.starts_with("#pragma lower ")){
+                            pragma(line, trim(l.substr(14)));
+                        }
+                        else if(l.ends_with(";")){
+                            coroutine c = signature(line, l.substr(0, l.size() - 1));
+                            awaitables_[c.name] = c;
+                        }
+                        else if(l.ends_with("{")){
+                            co_ = signature(line, trim(l.substr(0, l.size() - 1)));
+                            break;
+                        }
+                        else{
+                            fail(line, "expected #include, #pragma lower, a declaration or the coroutine");
+                        }
+                    }
+                    if(i == lines.size()){
+                        fail(static_cast<int>(i), "no coroutine definition");
+                    }
+                    for(const std::string & e: embeds_){
+                        if(!awaitables_.contains(e)){
+                            fail(static_cast<int>(i + 1), "#pragma lower embed " + e + ": no declaration of " + e);
+                        }
+                    }
+                    if(placement_ && co_.allocator_arg()){
+                        fail(static_cast<int>(i + 1), "a placement ramp doesn't take an allocator");
+                    }
+
+                    echo_.emplace_back(trim(lines[i]));
+                    std::vector<std::vector<statement> *> blocks{&body_};
+                    for(++i; i < lines.size(); ++i){
+                        const std::string_view raw = lines[i];
+                        const std::string_view l   = trim(raw);
+                        const int line = static_cast<int>(i + 1);
+
+                        echo_.emplace_back(raw.substr(0, raw.find_last_not_of(" \t\r") + 1));
+                        if(l.empty() || l.starts_with("//")){
+                            continue;
+                        }
+                        if(l == "}"){
+                            blocks.pop_back();
+                            if(blocks.empty()){
+                                end_line_ = line;
+                                break;
+                            }
+                        }
+                        else if(l == "{"){
+                            blocks.back()->push_back(statement{statement::block, line, "{", {}, {}, {}, {}});
+                            blocks.push_back(&blocks.back()->back().body);
+                        }
+                        else{
+                            blocks.back()->push_back(parse_statement(line, l));
+                        }
+                    }
+                    if(i == lines.size()){
+                        fail(static_cast<int>(i), "the coroutine's closing } is missing");
+                    }
+
+                    std::size_t first = i + 1, last = lines.size();
+                    while(first < last && trim(lines[first]).empty()){
+                        ++first;
+                    }
+                    while(last > first && trim(lines[last - 1]).empty()){
+                        --last;
+                    }
+                    for(; first < last; ++first){
+                        trailer_.emplace_back(lines[first]);
+                    }
+                }
+
+                void pragma(int line, std::string_view p)
+                {
+                    if(p == "placement"){
+                        placement_ = true;
+                    }
+                    else if(p == "declared"){
+                        declared_ = true;
+                    }
+                    else if(p.starts_with("embed ") && is_identifier(trim(p.substr(6)))){
+                        embeds_.emplace(trim(p.substr(6)));
+                    }
+                    else{
+                        fail(line, "unknown #pragma lower " + std::string(p));
+                    }
+                }
+
+                // task<int> g(int x)
+                coroutine signature(int line, std::string_view s)
+                {
+                    const std::size_t open = s.find('('), close = s.rfind(')');
+                    if(open == std::string_view::npos || close != s.size() - 1){
+                        fail(line, "expected task<T> name(params) or generator<T> name(params)");
+                    }
+
+                    coroutine c;
+                    if(!split_declarator(s.substr(0, open), c.result, c.name)){
+                        fail(line, "expected a return type and a name");
+                    }
+                    if(!(c.result.starts_with("task<") || c.result.starts_with("generator<")) || !c.result.ends_with(">")){
+                        fail(line, "only task<T> and generator<T> coroutines can be lowered");
+                    }
+
+                    c.params_text = s.substr(open + 1, close - open - 1);
+                    for(std::string_view p: split_top_level(c.params_text)){
+                        param q;
+                        if(p == "std::allocator_arg_t" && c.params.empty()){
+                            q = {"std::allocator_arg_t", "alloc_tag"};
+                        }
+                        else if(!split_declarator(p, q.type, q.name)){
+                            fail(line, "parameter `" + std::string(p) + "` needs a type and a name");
+                        }
+                        c.params.push_back(q);
+                    }
+                    return c;
+                }
+
+                statement parse_statement(int line, std::string_view l)
+                {
+                    statement s{statement::expression, line, std::string(l), {}, {}, {}, {}};
+                    if(!l.ends_with(";")){
+                        fail(line, "one statement per line, ending in ;");
+                    }
+                    const std::string_view text = trim(l.substr(0, l.size() - 1));
+
+                    if(text == "co_return" || text.starts_with("co_return ")){
+                        s.kind = statement::return_;
+                        s.expr = trim(text.substr(9));
+                        if(s.expr.find("co_await") != std::string::npos){
+                            fail(line, "co_await in co_return, give its value a name first");
+                        }
+                        return s;
+                    }
+                    if(text.starts_with("co_yield ")){
+                        s.kind = statement::yield;
+                        s.expr = trim(text.substr(9));
+                        if(!co_.is_generator()){
+                            fail(line, "co_yield in a task");
+                        }
+                        return s;
+                    }
+
+                    // [T v =] rest
+                    std::string_view rest = text;
+                    if(const std::size_t eq = text.find('='); eq != std::string_view::npos && eq + 1 < text.size() && text[eq + 1] != '='
+                       && eq > 0 && std::string_view("=!<>+-*/%&|^").find(text[eq - 1]) == std::string_view::npos
+                       && split_declarator(text.substr(0, eq), s.type, s.name)){
+                        rest = trim(text.substr(eq + 1));
+                        s.kind = statement::declaration;
+                    }
+                    s.expr = rest;
+
+                    if(rest.starts_with("co_await ")){
+                        s.expr = trim(rest.substr(9));
+                        if(co_.is_generator()){
+                            fail(line, "co_await in a generator");
+                        }
+
+                        const std::size_t paren = s.expr.find('('), brace = s.expr.find('{');
+                        if(paren != std::string::npos && (brace == std::string::npos || paren < brace) && awaitables_.contains(s.expr.substr(0, paren))){
+                            s.kind   = statement::await_task;
+                            s.callee = s.expr.substr(0, paren);
+                        }
+                        else if(brace != std::string::npos && s.expr.ends_with("}")){
+                            s.kind   = statement::await_value;
+                            s.callee = trim(std::string_view(s.expr).substr(0, brace));
+                        }
+                        else{
+                            fail(line, "co_await of `" + s.expr + "`: neither a declared coroutine nor Awaiter{...}");
+                        }
+                        return s;
+                    }
+                    if(text.find("co_await") != std::string_view::npos || text.find("co_yield") != std::string_view::npos){
+                        fail(line, "co_await and co_yield only as `[T v =] co_await x;` and `co_yield x;`");
+                    }
+                    return s;
+                }
+
+                //////////////////////
+                // Suspend-points, temporaries and locals
+
+                static bool suspends(const statement & s)
+                {
+                    switch(s.kind){
+                        case statement::await_task:
+                        case statement::await_value:
+                        case statement::yield:
+                            return true;
+                        case statement::block:
+                            return std::any_of(s.body.begin(), s.body.end(), suspends);
+                        default:
+                            return false;
+                    }
+                }
+
+                std::string tmp()
+                {
+                    return "__tmp" + std::to_string(++tmps_);
+                }
+
+                void analyse()
+                {
+                    scopes_.push_back({"initial suspend", {{"std::suspend_always", tmp(), true}}});
+                    sites_.emplace_back("initial suspend");
+                    awaiters_.emplace_back("std::suspend_always");
+
+                    analyse(body_);
+
+                    const std::string final_awaiter = co_.is_generator() ? "std::suspend_always" : co_.result + "::promise_type::final_awaiter";
+                    scopes_.push_back({"final suspend", {{final_awaiter, tmp(), true}}});
+                    sites_.emplace_back("final suspend");
+                    awaiters_.push_back(final_awaiter);
+
+                    members(body_);
+
+                    const bool returns = !body_.empty() && body_.back().kind == statement::return_;
+                    if(!returns && !co_.is_generator() && co_.value_type() != "void"){
+                        fail(end_line_, "flows off the end of a " + co_.result);
+                    }
+                }
+
+                void analyse(std::vector<statement> & block)
+                {
+                    for(std::size_t i = 0; i < block.size(); ++i){
+                        statement & s = block[i];
+
+                        switch(s.kind){
+                            case statement::block:
+                                analyse(s.body);
+                                break;
+
+                            case statement::await_task:
+                            {
+                                const coroutine & c = awaitables_.at(s.callee);
+                                if(c.is_generator()){
+                                    fail(s.line, "co_await of a generator");
+                                }
+                                s.suspend_point = ++suspend_points_;
+                                s.scope = scopes_.size();
+
+                                scope sc{s.source, {}};
+                                sc.slots.push_back({c.result, tmp(), true});
+                                sc.slots.push_back({c.result + "::awaiter", tmp(), true});
+                                if(embeds_.contains(s.callee)){
+                                    const int k = ++frames_[s.callee];
+                                    sc.slots.push_back({"frame_slot<__" + s.callee + "_state>", "__" + s.callee + "_frame" + (k > 1 ? std::to_string(k) : ""), false,
+                                                       "heap elision, see " + s.callee + ".hpp"});
+                                }
+                                scopes_.push_back(sc);
+                                sites_.push_back("co_await " + s.expr);
+                                awaiters_.push_back(c.result + "::awaiter");
+                                if(s.type == "auto"){
+                                    s.type = c.value_type();
+                                }
+                                break;
+                            }
+
+                            case statement::await_value:
+                            case statement::yield:
+                                s.suspend_point = ++suspend_points_;
+                                s.scope = scopes_.size();
+                                scopes_.push_back({s.source, {{s.kind == statement::yield ? "std::suspend_always" : s.callee, tmp(), true}}});
+                                sites_.push_back((s.kind == statement::yield ? "co_yield " : "co_await ") + s.expr);
+                                awaiters_.push_back(scopes_.back().slots.front().type);
+                                break;
+
+                            default:
+                                break;
+                        }
+
+                        if(!s.name.empty()){
+                            for(const param & p: co_.params){
+                                if(p.name == s.name){
+                                    fail(s.line, "local " + s.name + " hides the parameter");
+                                }
+                            }
+                            s.member = std::any_of(block.begin() + i + 1, block.end(), suspends);
+                        }
+                    }
+                }
+
+                void members(const std::vector<statement> & block)
+                {
+                    for(const statement & s: block){
+                        members(s.body);
+                        if(!s.member){
+                            continue;
+                        }
+                        if(s.type == "auto"){
+                            fail(s.line, "spell the type of " + s.name + ", it lives across a suspend-point");
+                        }
+
+                        auto same = std::find_if(locals_.begin(), locals_.end(), [&](const param & p){ return p.name == s.name; });
+                        if(same == locals_.end()){
+                            locals_.push_back({s.type, s.name});
+                        }
+                        else if(same->type != s.type){
+                            fail(s.line, "another local " + s.name + " of another type lives across a suspend-point");
+                        }
+                    }
+                }
+
+                //////////////////////
+                // Output
+
+                void line(std::string_view s = {})
+                {
+                    out_ += s;
+                    out_ += '\n';
+                }
+
+                void line(int indent, std::string_view s)
+                {
+                    out_.append(static_cast<std::size_t>(indent), ' ');
+                    line(s);
+                }
+
+                std::string take()
+                {
+                    return std::exchange(out_, {});
+                }
+
+                std::string state_t()   const { return "__" + co_.name + "_state";   }
+                std::string promise_t() const { return "__" + co_.name + "_promise_t"; }
+                std::string handle()    const { return "std::coroutine_handle<" + promise_t() + ">::from_promise(state->__promise)"; }
+
+                std::string free_state(int indent) const
+                {
+                    const std::string i(static_cast<std::size_t>(indent), ' ');
+                    return i + (placement_ ? "__delete_state(state);\n" : "delete state;\n");
+                }
+
+                std::string header()
+                {
+                    line("#pragma once");
+                    for(const std::string & i: includes_){
+                        line(i);
+                    }
+                    if(includes_.empty()){
+                        line(co_.is_generator() ? "#include \"generator.hpp\"" : "#include \"defs.hpp\"");
+                    }
+                    line("//////////////////////");
+                    line("// Coroutine-state of " + co_.name + "(" + co_.params_text + "), see " + co_.name + ".cpp for the lowering.");
+                    if(placement_){
+                        line("//");
+                        line("// Kept in a header so callers can embed the frame in their own storage,");
+                        line("// e.g. frame_slot<" + state_t() + ">, and start it through the placement ramp.");
+                    }
+                    line();
+
+                    if(!declared_){
+                        line(co_.result + " " + co_.name + "(" + co_.params_text + ");");
+                        if(placement_){
+                            line(co_.result + " " + co_.name + "(" + placement_params() + ");");
+                        }
+                        line();
+                    }
+
+                    std::string types = co_.result;
+                    for(const param & p: co_.params){
+                        types += ", " + p.type;
+                    }
+                    line("using " + promise_t() + " = std::coroutine_traits<" + types + ">::promise_type;");
+                    line();
+                    line("__coroutine_state * __" + co_.name + "_resume (__coroutine_state *);");
+                    line("void                __" + co_.name + "_destroy(__coroutine_state *);");
+                    line();
+                    line("/////");
+                    line("// The coroutine-state definition");
+                    line();
+                    line("struct " + state_t() + " : __coroutine_state_with_promise<" + promise_t() + ">");
+                    line("{");
+                    line(4, "__suspend_index_t<" + std::to_string(suspend_points_ + 2) + "> __suspend_point = 0;");
+                    line();
+                    if(placement_){
+                        line(4, "// Set by the placement ramp when the coroutine-state lives in storage owned by");
+                        line(4, "// the caller, the final suspend and destroy paths then skip the deallocation.");
+                        line(4, "bool __inline_frame = false;");
+                        line();
+                    }
+                    if(!co_.params.empty()){
+                        line(4, "// Argument copies");
+                        for(const param & p: co_.params){
+                            line(4, p.declaration() + ";");
+                        }
+                        line();
+                    }
+                    if(!locals_.empty()){
+                        line(4, "// Local variables that live across a suspend-point");
+                        for(const param & p: locals_){
+                            line(4, p.declaration() + ";");
+                        }
+                        line();
+                    }
+
+                    line(4, "// Temporaries, overlapped per scope by frame_storage");
+                    line(4, "using __frame_t = frame_storage<");
+                    for(std::size_t s = 0; s < scopes_.size(); ++s){
+                        const bool last = s + 1 == scopes_.size();
+                        const std::vector<slot> & slots = scopes_[s].slots;
+                        for(std::size_t k = 0; k < slots.size(); ++k){
+                            std::string code(k == 0 ? 8 : 20, ' ');
+                            code += k == 0 ? "frame_scope<" : "";
+                            code += slots[k].temporary ? "manual_lifetime<" + slots[k].type + ">" : slots[k].type;
+                            code += k + 1 < slots.size() ? "," : last ? ">>;" : ">,";
+
+                            const std::string & comment = k == 0 ? scopes_[s].comment : slots[k].comment;
+                            if(comment.empty()){
+                                line(code);
+                            }
+                            else{
+                                // The comments line up with the one of the final suspend,
+                                // whose line closes the frame_storage as well.
+                                line(pad(code, last ? 78 : 80) + "  // " + comment);
+                            }
+                        }
+                    }
+                    line();
+                    line(4, "__frame_t __frame;");
+                    line();
+
+                    std::size_t width = 0;
+                    for(const scope & s: scopes_){
+                        for(const slot & k: s.slots){
+                            width = std::max(width, k.accessor.size());
+                        }
+                    }
+                    for(std::size_t s = 0; s < scopes_.size(); ++s){
+                        for(std::size_t k = 0; k < scopes_[s].slots.size(); ++k){
+                            line(4, "auto & " + pad(scopes_[s].slots[k].accessor, width) + "() noexcept { return __frame.get<"
+                                    + std::to_string(s) + ", " + std::to_string(k) + ">(); }");
+                        }
+                    }
+                    line();
+
+                    std::string ctor_params, promise_args;
+                    for(const param & p: co_.params){
+                        ctor_params  += (ctor_params.empty()  ? "" : ", ") + p.rvalue_type() + " " + p.name;
+                        promise_args += (promise_args.empty() ? "" : ", ") + std::string("this->") + p.name;
+                    }
+                    line(4, state_t() + "(" + ctor_params + ")");
+                    for(std::size_t i = 0; i < co_.params.size(); ++i){
+                        const param & p = co_.params[i];
+                        line(8, (i == 0 ? ": " : ", ") + p.name + "(static_cast<" + p.rvalue_type() + ">(" + p.name + "))");
+                    }
+                    line(4, "{");
+                    line(12, "// Initialise the function-pointers used by coroutine_handle::resume/destroy/done().");
+                    line(12, "this-> __resume = & __" + co_.name + "_resume;");
+                    line(12, "this->__destroy = &__" + co_.name + "_destroy;");
+                    line();
+                    line(12, "// Use placement-new to initialise the promise object in the base-class");
+                    line(12, "// after we've initialised the argument copies.");
+                    line(12, "::new ((void *)std::addressof(this->__promise)) " + promise_t() + "(construct_promise<" + promise_t() + ">(" + promise_args + "));");
+                    line(4, "}");
+                    line();
+                    line(4, "~" + state_t() + "()");
+                    line(4, "{");
+                    line(8, "this->__promise.~" + promise_t() + "();");
+                    line(4, "}");
+                    line("};");
+
+                    if(!trailer_.empty()){
+                        line();
+                        for(const std::string & t: trailer_){
+                            line(t);
+                        }
+                    }
+                    return take();
+                }
+
+                std::string placement_params() const
+                {
+                    std::string s = "std::in_place_t, void *slot";
+                    for(const param & p: co_.params){
+                        s += ", " + p.declaration();
+                    }
+                    return s;
+                }
+
+                std::string source()
+                {
+                    line("#include \"" + co_.name + ".hpp\"");
+                    line("#include \"async_stack.hpp\"");
+                    line("//////////////////////");
+                    line("// Begin lowering of " + co_.name + "(" + co_.params_text + ")");
+                    line("//");
+                    for(const std::string & e: echo_){
+                        line(e.empty() ? "//" : "// " + e);
+                    }
+                    line();
+
+                    std::string params, args;
+                    for(const param & p: co_.params){
+                        params += (params.empty() ? "" : ", ") + p.declaration();
+                        args   += (args.empty()   ? "" : ", ") + std::string("static_cast<") + p.rvalue_type() + ">(" + p.name + ")";
+                    }
+
+                    line("/////");
+                    line("// The \"ramp\" function");
+                    line();
+                    line(co_.result + " " + co_.name + "(" + params + ")");
+                    line("{");
+                    if(co_.allocator_arg()){
+                        std::string names;
+                        for(const param & p: co_.params){
+                            names += (names.empty() ? "" : ", ") + p.name;
+                        }
+                        line(4, "std::unique_ptr<" + state_t() + "> state(new (" + names + ") " + state_t() + "(" + args + "));");
+                    }
+                    else{
+                        line(4, "std::unique_ptr<" + state_t() + "> state(new " + state_t() + "(" + args + "));");
+                    }
+                    ramp_body();
+
+                    if(placement_){
+                        line("/////");
+                        line("// The placement \"ramp\" function");
+                        line("//");
+                        line("// Same as above but the coroutine-state is constructed in `slot`, which must be");
+                        line("// suitably sized and aligned for " + state_t() + " (see frame_slot) and outlive the task.");
+                        line();
+                        line(co_.result + " " + co_.name + "(" + placement_params() + ")");
+                        line("{");
+                        line(4, "std::unique_ptr<" + state_t() + ", __inline_frame_deleter> state(::new (slot) " + state_t() + "(" + args + "));");
+                        line(4, "state->__inline_frame = true;");
+                        ramp_body();
+                    }
+
+                    resume();
+                    destroy();
+
+                    line("/////");
+                    line("// The async stack trace information, see async_stack.hpp");
+                    line();
+                    std::string sites;
+                    for(const std::string & s: sites_){
+                        sites += (sites.empty() ? "" : ", ") + quote(s);
+                    }
+                    line("static constexpr const char * __" + co_.name + "_sites[] = {" + sites + "};");
+                    line("static const lowered_frame_info<" + state_t() + "> __" + co_.name + "_frame_info{&__" + co_.name + "_destroy, "
+                         + quote(co_.name + "(" + co_.params_text + ")") + ", __" + co_.name + "_sites};");
+                    return take();
+                }
+
+                void ramp_body()
+                {
+                    line(4, "return __ramp(std::move(state), &__" + co_.name + "_resume);");
+                    line("}");
+                    line();
+                }
+
+                void resume()
+                {
+                    const std::string final_tmp = scopes_.back().slots.front().accessor;
+                    const std::string final_sp  = std::to_string(suspend_points_ + 1);
+
+                    if(!co_.is_generator()){
+                        std::string awaiters;
+                        for(const std::string & a: awaiters_){
+                            awaiters += (awaiters.empty() ? "" : ", ") + a;
+                        }
+                        line("/////");
+                        line("// The cancellation points, see \"Cancellation\" in defs.hpp");
+                        line();
+                        line("static constexpr auto & __" + co_.name + "_cancellable = __cancellation_points<" + awaiters + ">;");
+                        line();
+                    }
+                    line("/////");
+                    line("//  The \"resume\" function");
+                    line();
+                    line("__coroutine_state *__" + co_.name + "_resume(__coroutine_state *s)");
+                    line("{");
+                    line(4, "auto *state = static_cast<" + state_t() + " *>(s);");
+                    if(co_.is_generator()){
+                        line(4, "CORO_TRACE_EVENT(resume, state, state->__suspend_point);");
+                        line();
+                    }
+                    else{
+                        line(4, "__resume_scope resume_scope(state);");
+                        line();
+                        line(4, "if(auto *next = __cancellation_point(state, __" + co_.name + "_cancellable)) [[unlikely]] {");
+                        line(8, "return next;");
+                        line(4, "}");
+                        line();
+                    }
+                    line("#ifndef CORO_NO_EXCEPTIONS");
+                    line(4, "try{");
+                    line("#else");
+                    line(4, "{");
+                    line("#endif");
+                    line(8, "switch(state->__suspend_point){");
+                    for(int i = 0; i <= suspend_points_; ++i){
+                        line(12, "case " + std::to_string(i) + ": goto suspend_point_" + std::to_string(i) + ";");
+                    }
+                    line(12, "default: std::unreachable();");
+                    line(8, "}");
+                    line();
+                    line("suspend_point_0:");
+                    resume_value(8, "", scopes_.front());
+
+                    names_.assign(1, {});
+                    for(const param & p: co_.params){
+                        names_.front()[p.name] = true;
+                    }
+                    for(const statement & s: body_){
+                        line();
+                        emit(8, s);
+                    }
+                    if(body_.empty() || body_.back().kind != statement::return_){
+                        line();
+                        line(8, "//  flowing off the end");
+                        line(8, "state->__promise.return_void();");
+                        line(8, "goto final_suspend;");
+                    }
+
+                    line(4, "}");
+                    line("#ifndef CORO_NO_EXCEPTIONS");
+                    line(4, "catch(...){");
+                    line(8, "state->__promise.unhandled_exception();");
+                    line(8, "goto final_suspend;");
+                    line(4, "}");
+                    line("#endif");
+                    line();
+                    line("final_suspend:");
+                    line(4, "return __final_suspend(state, state->" + final_tmp + "(), " + final_sp + ");");
+                    line("}");
+                    line();
+                }
+
+                void destroy()
+                {
+                    line("/////");
+                    line("// The \"destroy\" function");
+                    line();
+                    line("void __" + co_.name + "_destroy(__coroutine_state *s)");
+                    line("{");
+                    line(4, "auto *state = static_cast<" + state_t() + " *>(s);");
+                    line(4, "CORO_TRACE_EVENT(destroy, state, state->__suspend_point);");
+                    line();
+                    line(4, "switch(state->__suspend_point){");
+                    for(std::size_t i = 0; i < scopes_.size(); ++i){
+                        line(8, "case " + std::to_string(i) + ": goto suspend_point_" + std::to_string(i) + ";");
+                    }
+                    line(8, "default: std::unreachable();");
+                    line(4, "}");
+                    line();
+                    for(std::size_t i = 0; i < scopes_.size(); ++i){
+                        line("suspend_point_" + std::to_string(i) + ":");
+                        const std::vector<slot> & slots = scopes_[i].slots;
+                        for(auto k = slots.rbegin(); k != slots.rend(); ++k){
+                            if(k->temporary){
+                                line(4, "state->" + k->accessor + "().destroy();");
+                            }
+                        }
+                        line(4, "goto destroy_state;");
+                        line();
+                    }
+                    line("destroy_state:");
+                    out_ += free_state(4);
+                    line("}");
+                    line();
+                }
+
+                //////////////////////
+                // The body
+
+                // Innermost scope last, true for the names spelled state->name.
+                std::vector<std::map<std::string, bool>> names_;
+
+                static std::string guard(const std::string & accessor)
+                {
+                    return accessor.substr(2) + "_dtor";
+                }
+
+                // Arguments and locals in the coroutine-state become state->name.
+                std::string rewrite(std::string_view expr) const
+                {
+                    std::string r;
+                    for(std::size_t i = 0; i < expr.size();){
+                        const char c = expr[i];
+                        if(c == '"' || c == '\''){
+                            std::size_t j = i + 1;
+                            while(j < expr.size() && expr[j] != c){
+                                j += expr[j] == '\\' ? 2 : 1;
+                            }
+                            j = std::min(j + 1, expr.size());
+                            r += expr.substr(i, j - i);
+                            i = j;
+                            continue;
+                        }
+                        if(!is_identifier_char(c) || std::isdigit(static_cast<unsigned char>(c))){
+                            // Numbers, with their suffixes, aren't names.
+                            std::size_t j = i + 1;
+                            if(std::isdigit(static_cast<unsigned char>(c))){
+                                while(j < expr.size() && (is_identifier_char(expr[j]) || expr[j] == '.' || expr[j] == '\'')){
+                                    ++j;
+                                }
+                            }
+                            r += expr.substr(i, j - i);
+                            i = j;
+                            continue;
+                        }
+
+                        std::size_t j = i;
+                        while(j < expr.size() && is_identifier_char(expr[j])){
+                            ++j;
+                        }
+                        const std::string_view id = expr.substr(i, j - i);
+                        const std::string_view before = trim(expr.substr(0, i));
+                        const std::string_view after  = trim(expr.substr(j));
+                        const bool qualified = before.ends_with(".") || before.ends_with("->") || before.ends_with("::") || after.starts_with("::");
+
+                        bool member = false;
+                        for(auto it = names_.rbegin(); it != names_.rend() && !qualified; ++it){
+                            if(auto f = it->find(std::string(id)); f != it->end()){
+                                member = f->second;
+                                break;
+                            }
+                        }
+                        if(member){
+                            r += "state->";
+                        }
+                        r += id;
+                        i = j;
+                    }
+                    return r;
+                }
+
+                void declare(const statement & s)
+                {
+                    if(!s.name.empty()){
+                        names_.back()[s.name] = s.member;
+                    }
+                }
+
+                // The left-hand side of an initialisation, if it declares a local.
+                std::string target(const statement & s) const
+                {
+                    if(s.name.empty()){
+                        return {};
+                    }
+                    return s.member ? "state->" + s.name + " = " : s.type + " " + s.name + " = ";
+                }
+
+                void emit(int indent, const statement & s)
+                {
+                    switch(s.kind){
+                        case statement::block:
+                        {
+                            line(indent, "{");
+                            names_.emplace_back();
+                            for(std::size_t i = 0; i < s.body.size(); ++i){
+                                if(i != 0){
+                                    line();
+                                }
+                                emit(indent + 4, s.body[i]);
+                            }
+                            names_.pop_back();
+                            line(indent, "}");
+                            break;
+                        }
+
+                        case statement::expression:
+                        case statement::declaration:
+                            line(indent, "//  " + s.source);
+                            line(indent, target(s) + rewrite(s.expr) + ";");
+                            declare(s);
+                            break;
+
+                        case statement::return_:
+                            line(indent, "//  " + s.source);
+                            if(s.expr.empty()){
+                                line(indent, "state->__promise.return_void();");
+                            }
+                            else{
+                                line(indent, "state->__promise.return_value(" + rewrite(s.expr) + ");");
+                            }
+                            line(indent, "goto final_suspend;");
+                            break;
+
+                        case statement::await_task:
+                            await_task(indent, s);
+                            declare(s);
+                            break;
+
+                        case statement::await_value:
+                        case statement::yield:
+                            await_value(indent, s);
+                            declare(s);
+                            break;
+                    }
+                }
+
+                void construct(int indent, const std::string & accessor, const std::string & value)
+                {
+                    line(indent, "state->" + accessor + "().construct_from([&]()");
+                    line(indent, "{");
+                    line(indent + 4, "return " + value + ";");
+                    line(indent, "});");
+                    line(indent, "destructor_guard " + guard(accessor) + "{state->" + accessor + "()};");
+                }
+
+                // After the suspend-point: the await_resume() of `sc`, the last
+                // temporary being the awaiter, under guards for all of them.
+                void resume_value(int indent, const std::string & target, const scope & sc)
+                {
+                    std::vector<std::string> temps;
+                    for(const slot & k: sc.slots){
+                        if(k.temporary){
+                            temps.push_back(k.accessor);
+                        }
+                    }
+                    const std::string awaiter = temps.back();
+
+                    if(target.empty()){
+                        line(indent, "{");
+                    }
+                    else{
+                        line(indent, target + "[&]() -> decltype(auto)");
+                        line(indent, "{");
+                    }
+                    for(const std::string & t: temps){
+                        line(indent + 4, "destructor_guard " + guard(t) + "{state->" + t + "()};");
+                    }
+                    line(indent + 4, std::string(target.empty() ? "" : "return ") + "state->" + awaiter + "().get().await_resume();");
+                    line(indent, target.empty() ? "}" : "}();");
+                }
+
+                void await_task(int indent, const statement & s)
+                {
+                    const scope &       sc      = scopes_[s.scope];
+                    const std::string & task    = sc.slots[0].accessor;
+                    const std::string & awaiter = sc.slots[1].accessor;
+                    const std::string   sp      = std::to_string(s.suspend_point);
+                    const coroutine &   c       = awaitables_.at(s.callee);
+
+                    std::string call = rewrite(s.expr);
+                    if(sc.slots.size() > 2){
+                        const std::string args = call.substr(s.callee.size() + 1);
+                        call = s.callee + "(std::in_place, &state->" + sc.slots[2].accessor + "()" + (trim(args) == ")" ? "" : ", ") + args;
+                    }
+
+                    line(indent, "//  " + s.source);
+                    line(indent, "{");
+                    construct(indent + 4, task, call);
+                    line();
+                    construct(indent + 4, awaiter, "static_cast<" + c.result + " &&>(state->" + task + "().get()).operator co_await()");
+                    line();
+                    line(indent + 4, "if(!state->" + awaiter + "().get().await_ready()){");
+                    line(indent + 8, "state->__suspend_point = " + sp + ";");
+                    line(indent + 8, "CORO_TRACE_EVENT(suspend, state, " + sp + ");");
+                    line(indent + 8, "__release_running_frame();");
+                    line(indent + 8, "auto h = state->" + awaiter + "().get().await_suspend(" + handle() + ");");
+                    line();
+                    line(indent + 8, "// A coroutine suspends without exiting scopes - so cancel the destructor-guards.");
+                    line(indent + 8, guard(awaiter) + ".cancel();");
+                    line(indent + 8, guard(task) + ".cancel();");
+                    line(indent + 8, "return static_cast<__coroutine_state *>(h.address());");
+                    line(indent + 4, "}");
+                    line();
+                    line(indent + 4, "// Don't exit the scope here.");
+                    line(indent + 4, "// We can't 'goto' a label that enters the scope of a variable with a non-trivial");
+                    line(indent + 4, "// destructor. So we have to exit the scope of the destructor guards here without");
+                    line(indent + 4, "// calling the destructors and then recreate them after the `suspend_point_" + sp + "` label.");
+                    line(indent + 4, guard(awaiter) + ".cancel();");
+                    line(indent + 4, guard(task) + ".cancel();");
+                    line(indent, "}");
+                    line();
+                    line("suspend_point_" + sp + ":");
+                    line(indent, "// The child was cancelled (through a token of its own, a shared one");
+                    line(indent, "// stops us at the cancellation point above): pass it on the same way.");
+                    line(indent, "if(state->" + awaiter + "().get().cancelled()) [[unlikely]] {");
+                    line(indent + 4, "return static_cast<__coroutine_state *>(state->__promise.cancel().address());");
+                    line(indent, "}");
+                    line("#ifdef CORO_NO_EXCEPTIONS");
+                    line(indent, "// The awaited task failed: take over its error and leave through the");
+                    line(indent, "// final suspend-point, destroying the temporaries of this scope on the way.");
+                    line(indent, "if(std::error_code ec = state->" + awaiter + "().get().error()) [[unlikely]] {");
+                    line(indent + 4, "state->" + awaiter + "().destroy();");
+                    line(indent + 4, "state->" + task + "().destroy();");
+                    line(indent + 4, "state->__promise.set_error(ec);");
+                    line(indent + 4, "goto final_suspend;");
+                    line(indent, "}");
+                    line("#endif");
+                    resume_value(indent, target(s), sc);
+                }
+
+                void await_value(int indent, const statement & s)
+                {
+                    const std::string & tmp = scopes_[s.scope].slots[0].accessor;
+                    const std::string   sp  = std::to_string(s.suspend_point);
+
+                    line(indent, "//  " + s.source);
+                    line(indent, "{");
+                    construct(indent + 4, tmp, s.kind == statement::yield ? "state->__promise.yield_value(" + rewrite(s.expr) + ")" : rewrite(s.expr));
+                    line();
+                    line(indent + 4, "if(!state->" + tmp + "().get().await_ready()){");
+                    line(indent + 8, "state->__suspend_point = " + sp + ";");
+                    line(indent + 8, "CORO_TRACE_EVENT(suspend, state, " + sp + ");");
+                    line(indent + 8, "__release_running_frame();");
+                    line(indent + 8, "state->" + tmp + "().get().await_suspend(" + handle() + ");");
+                    line();
+                    line(indent + 8, guard(tmp) + ".cancel();");
+                    line(indent + 8, "return static_cast<__coroutine_state *>(std::noop_coroutine().address());");
+                    line(indent + 4, "}");
+                    line(indent + 4, guard(tmp) + ".cancel();");
+                    line(indent, "}");
+                    line();
+                    line("suspend_point_" + sp + ":");
+                    resume_value(indent, target(s), scopes_[s.scope]);
+                }
+        };
+    }
+
+    output lower(std::string_view input, std::string_view file)
+    {
+        return lowering(file).run(input);
+    }
+}
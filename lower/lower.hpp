@@ -0,0 +1,67 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// lower: emits the hand-lowering of a restricted coroutine, as in f.cpp
+//
+//   build/lower/lower lower/g.co .           # writes ./g.hpp and ./g.cpp
+//
+// The input is one coroutine definition, task<T> or generator<T>, written one
+// statement per line:
+//
+//   #include "f.hpp"                  // included by the generated header
+//   #pragma lower placement           // also emit the placement ramp, see f.cpp
+//   #pragma lower declared            // the ramps are declared elsewhere (defs.hpp)
+//   #pragma lower embed f             // co_await f(...) builds f's frame in ours
+//   task<int> f(int x);               // a coroutine co_await'ed by the body
+//
+//   task<int> g(int x) {
+//     int fx = co_await f(x);
+//     co_return fx * fx;
+//   }
+//
+//   static_assert(...);               // anything after it goes to the header
+//
+// The body may contain
+//
+//   T v = expr;  expr;                a local, an expression statement
+//   { ... }                           a block, on lines of their own
+//   [T v =] co_await coro(args);      a declared task coroutine
+//   [T v =] co_await Awaiter{args};   an awaiter with a void await_suspend
+//   co_yield v;                       generator<T> only
+//   co_return [expr];
+//
+// and no other control flow. Suspend-points are numbered in source order after
+// the initial one, each co_await and co_yield gets a frame_scope of its own in
+// frame_storage, __tmpN counts the temporaries in the same order. A local is
+// moved into the coroutine-state if a suspend-point follows its declaration
+// in its scope (a co_yield'ed one always is), so that no goto to a later
+// suspend-point jumps over its initialisation; everything else stays a local
+// of the resume function. Arguments and moved locals are spelled state->name
+// in the body.
+//
+// The generated files are meant to be checked in and read, and come out in
+// exactly the shape of the hand-written lowerings (lower/test.cpp checks f and
+// g against f.hpp, f.cpp, g.hpp and g.cpp).
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+
+namespace lower
+{
+    struct output
+    {
+        std::string name;     // of the coroutine, and of the files
+        std::string header;   // <name>.hpp
+        std::string source;   // <name>.cpp
+    };
+
+    // An input the generator doesn't accept; what() is "<file>:<line>: <reason>".
+    class error : public std::runtime_error
+    {
+        public:
+            using std::runtime_error::runtime_error;
+    };
+
+    // `file` only names the input in errors.
+    output lower(std::string_view input, std::string_view file = "<input>");
+}
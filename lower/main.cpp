@@ -0,0 +1,50 @@
+// build/lower/lower <input.co> <output directory>
+//
+// Writes <name>.hpp and <name>.cpp of the coroutine defined in the input, see
+// lower.hpp for what it may contain.
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include "lower.hpp"
+
+namespace
+{
+    bool write(const std::string & path, const std::string & text)
+    {
+        std::ofstream out(path, std::ios::binary);
+        out << text;
+        out.close();
+        if(!out){
+            std::fprintf(stderr, "lower: can't write %s\n", path.c_str());
+            return false;
+        }
+        return true;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if(argc != 3){
+        std::fprintf(stderr, "usage: %s <input.co> <output directory>\n", argv[0]);
+        return 2;
+    }
+
+    std::ifstream in(argv[1], std::ios::binary);
+    if(!in){
+        std::fprintf(stderr, "lower: can't read %s\n", argv[1]);
+        return 1;
+    }
+    const std::string input{std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+
+    try{
+        const lower::output o = lower::lower(input, argv[1]);
+        const std::string dir = argv[2];
+        return write(dir + "/" + o.name + ".hpp", o.header) && write(dir + "/" + o.name + ".cpp", o.source) ? 0 : 1;
+    }
+    catch(const lower::error & e){
+        std::fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+}
@@ -0,0 +1,165 @@
+// Unit tests of the lowering generator, run from the top of the tree:
+//
+//   make lower-test
+//
+// The output for lower/f.co and lower/g.co must be the hand-written lowering
+// byte for byte; the other cases check the numbering and placement rules on
+// inputs of their own.
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include "lower.hpp"
+
+namespace
+{
+    int failures = 0;
+
+    void check(bool ok, std::string_view what)
+    {
+        if(!ok){
+            std::fprintf(stderr, "FAIL: %.*s\n", static_cast<int>(what.size()), what.data());
+            ++failures;
+        }
+    }
+
+    std::string read(const std::string & path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if(!in){
+            std::fprintf(stderr, "can't read %s\n", path.c_str());
+            ++failures;
+        }
+        return {std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>()};
+    }
+
+    // Reports the first line that differs.
+    void check_same(const std::string & path, const std::string & generated)
+    {
+        const std::string expected = read(path);
+        if(generated == expected){
+            return;
+        }
+
+        std::size_t line = 1, e = 0, g = 0;
+        while(true){
+            const std::size_t ee = expected.find('\n', e), ge = generated.find('\n', g);
+            const std::string_view el = std::string_view(expected).substr(e, ee - e);
+            const std::string_view gl = std::string_view(generated).substr(g, ge - g);
+            if(el != gl || ee == std::string::npos || ge == std::string::npos){
+                std::fprintf(stderr, "FAIL: %s:%zu differs from the generated lowering\n  expected: %.*s\n  generated: %.*s\n",
+                             path.c_str(), line, static_cast<int>(el.size()), el.data(), static_cast<int>(gl.size()), gl.data());
+                break;
+            }
+            e = ee + 1;
+            g = ge + 1;
+            ++line;
+        }
+        ++failures;
+    }
+
+    bool contains(const std::string & text, std::string_view part)
+    {
+        return text.find(part) != std::string::npos;
+    }
+
+    // The what() of the error lowering `input` throws, empty if it doesn't.
+    std::string rejected(std::string_view input)
+    {
+        try{
+            lower::lower(input, "t.co");
+        }
+        catch(const lower::error & e){
+            return e.what();
+        }
+        return {};
+    }
+
+    //////////////////////
+
+    void hand_written()
+    {
+        for(const char * name: {"f", "g"}){
+            const lower::output o = lower::lower(read(std::string("lower/") + name + ".co"), name);
+            check(o.name == name, "name of the lowered coroutine");
+            check_same(std::string(name) + ".hpp", o.header);
+            check_same(std::string(name) + ".cpp", o.source);
+        }
+    }
+
+    void numbering()
+    {
+        const lower::output o = lower::lower(
+            "task<int> leg(int x);\n"
+            "\n"
+            "task<int> walk(int x) {\n"
+            "  int a = co_await leg(x);\n"
+            "  {\n"
+            "    int b = a + 1;\n"
+            "    co_await persistent_park{};\n"
+            "    a = a + b;\n"
+            "  }\n"
+            "  int c = co_await leg(a);\n"
+            "  co_return a + c;\n"
+            "}\n");
+
+        // initial, three awaits, final
+        check(contains(o.header, "__suspend_index_t<5> __suspend_point = 0;"), "suspend-points counted");
+        check(contains(o.header, "auto & __tmp4() noexcept { return __frame.get<2, 0>(); }"), "one scope per await");
+        check(contains(o.header, "auto & __tmp7() noexcept { return __frame.get<4, 0>(); }"), "temporaries numbered in source order");
+        check(contains(o.source, "            case 3: goto suspend_point_3;\n            default:"), "jump table of resume");
+        check(contains(o.source, "suspend_point_4:\n    state->__tmp7().destroy();"), "final suspend-point of destroy");
+        check(contains(o.source, "suspend_point_3:\n    state->__tmp6().destroy();\n    state->__tmp5().destroy();"), "temporaries destroyed in reverse");
+
+        // a and b live across a suspend-point, c doesn't.
+        check(contains(o.header, "    // Local variables that live across a suspend-point\n    int a;\n    int b;\n\n"), "locals moved into the state");
+        check(contains(o.source, "state->b = state->a + 1;"), "moved locals spelled state->name");
+        check(contains(o.source, "int c = [&]() -> decltype(auto)"), "a local after the last suspend-point stays");
+        check(contains(o.source, "state->__promise.return_value(state->a + c);"), "co_return");
+        check(contains(o.source, "{\"initial suspend\", \"co_await leg(x)\", \"co_await persistent_park{}\", \"co_await leg(a)\", \"final suspend\"}"), "async stack sites");
+        check(contains(o.source, "__cancellation_points<std::suspend_always, task<int>::awaiter, persistent_park, task<int>::awaiter, task<int>::promise_type::final_awaiter>;"),
+              "the awaiter of every suspend-point for the cancellation point");
+    }
+
+    void generators()
+    {
+        const lower::output o = lower::lower(
+            "#include \"generator.hpp\"\n"
+            "generator<int> twice(int x) {\n"
+            "  co_yield x;\n"
+            "  int y = x * 2;\n"
+            "  co_yield y;\n"
+            "}\n");
+
+        check(contains(o.header, "    // Local variables that live across a suspend-point\n    int y;\n"), "a yielded local lives in the state");
+        check(contains(o.source, "return state->__promise.yield_value(state->y);"), "co_yield");
+        check(contains(o.source, "//  flowing off the end\n        state->__promise.return_void();"), "flowing off the end");
+        check(!contains(o.source, "cancellation_requested"), "a generator has no cancellation point");
+    }
+
+    void errors()
+    {
+        check(contains(rejected("task<int> h(int x) {\n  co_return co_await k(x);\n}\n"), "t.co:2:"), "co_await inside an expression");
+        check(contains(rejected("task<int> h(int x) {\n  int y = co_await k(x);\n  co_return y;\n}\n"), "neither a declared coroutine"), "co_await of an undeclared coroutine");
+        check(contains(rejected("task<int> h(int x) {\n  x = x + 1;\n}\n"), "flows off the end"), "task<int> without co_return");
+        check(contains(rejected("task<int> k(int x);\ntask<int> h(int x) {\n  auto y = x;\n  co_await k(y);\n  co_return y;\n}\n"), "spell the type"), "auto local in the state");
+        check(contains(rejected("task<int> h(int x) {\n  co_yield x;\n}\n"), "co_yield in a task"), "co_yield in a task");
+    }
+}
+
+int main()
+{
+    hand_written();
+    numbering();
+    generators();
+    errors();
+
+    if(failures != 0){
+        std::fprintf(stderr, "%d failed\n", failures);
+        return 1;
+    }
+    std::printf("lower: all tests passed\n");
+    return 0;
+}
@@ -1,8 +1,27 @@
 #include <iostream>
-#include "defs.hpp"
+#include "g.hpp"
+
+template<typename State> void print_frame_report(const char * name)
+{
+    using r = frame_report<State>;
+    std::cout << name << ": size " << r::size << ", align " << r::align
+              << ", promise " << r::promise_size << ", suspend index " << r::suspend_index_size
+              << ", temporaries " << r::temporaries_size << " (unoverlapped " << r::temporaries_unoverlapped_size << ")"
+              << std::endl;
+}
+
 int main()
 {
     auto t = g(2);
     std::cout << t.execute() << std::endl;
+
+    // Root coroutine-state in caller-provided stack storage, no allocation at all:
+    // the awaited f(x) is embedded in the g frame as well.
+    frame_slot<__g_state> storage;
+    auto s = g(std::in_place, &storage, 3);
+    std::cout << s.execute() << std::endl;
+
+    print_frame_report<__f_state>("__f_state");
+    print_frame_report<__g_state>("__g_state");
     return 0;
 }
@@ -0,0 +1,285 @@
+#include "nap.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of nap(timer_wheel & timers, int ms)
+//
+// task<int> nap(timer_wheel & timers, int ms) {
+//   co_await sleep_for(timers, std::chrono::milliseconds(ms));
+//   co_return ms;
+// }
+//
+// sleep_awaiter::await_suspend() returns void: the timer is armed and we return
+// to the resumer, timer_wheel::advance() resumes us at suspend-point 1. A frame
+// destroyed while asleep disarms the timer through ~sleep_awaiter().
+
+/////
+// The "ramp" function
+
+task<int> nap(timer_wheel & timers, int ms)
+{
+    std::unique_ptr<__nap_state> state(new __nap_state(timers, static_cast<int &&>(ms)));
+    return __ramp(std::move(state), &__nap_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __nap_cancellable = __cancellation_points<std::suspend_always, sleep_awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__nap_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__nap_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __nap_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  co_await sleep_for(timers, std::chrono::milliseconds(ms));
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return sleep_for(state->timers, std::chrono::milliseconds(state->ms));
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__nap_promise_t>::from_promise(state->__promise));
+
+                // void-returning await_suspend: suspend and return to whoever resumed us.
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  co_return ms;
+        state->__promise.return_value(state->ms);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __nap_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__nap_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __nap_sites[] = {"initial suspend", "co_await sleep_for(timers, ms)", "final suspend"};
+static const lowered_frame_info<__nap_state> __nap_frame_info{&__nap_destroy, "nap(timers, ms)", __nap_sites};
+
+//////////////////////
+// Begin lowering of nap_within(timer_wheel & timers, int ms, int limit_ms)
+//
+// task<int> nap_within(timer_wheel & timers, int ms, int limit_ms) {
+//   int slept = co_await with_timeout(nap(timers, ms), timers, std::chrono::milliseconds(limit_ms));
+//   co_return slept;
+// }
+//
+// timeout_awaiter::await_suspend() arms the timer and returns the nap task for
+// symmetric transfer. We are resumed by whichever comes first: nap() finishing
+// or the timer. In the latter case await_resume() throws (error() is set in
+// exception-free mode), and destroying the awaiter destroys the nap() frame,
+// which is still asleep, and disarms its timer.
+
+/////
+// The "ramp" function
+
+task<int> nap_within(timer_wheel & timers, int ms, int limit_ms)
+{
+    std::unique_ptr<__nap_within_state> state(new __nap_within_state(timers, static_cast<int &&>(ms), static_cast<int &&>(limit_ms)));
+    return __ramp(std::move(state), &__nap_within_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __nap_within_cancellable = __cancellation_points<std::suspend_always, timeout_awaiter<int>, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__nap_within_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__nap_within_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __nap_within_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  int slept = co_await with_timeout(nap(timers, ms), timers, std::chrono::milliseconds(limit_ms));
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return with_timeout(nap(state->timers, state->ms), state->timers, std::chrono::milliseconds(state->limit_ms));
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp2().get().await_suspend(std::coroutine_handle<__nap_within_promise_t>::from_promise(state->__promise));
+
+                // A coroutine suspends without exiting scopes - so cancel the destructor-guard.
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        // The nap was cancelled (not timed out, that's an error): pass it on.
+        if(state->__tmp2().get().cancelled()) [[unlikely]] {
+            return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+        }
+#ifdef CORO_NO_EXCEPTIONS
+        // Timed out, or the nap failed: take over the error and leave through
+        // the final suspend-point, destroying the awaiter on the way.
+        if(std::error_code ec = state->__tmp2().get().error()) [[unlikely]] {
+            state->__tmp2().destroy();
+            state->__promise.set_error(ec);
+            goto final_suspend;
+        }
+#endif
+        int slept = [&]() -> decltype(auto)
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            return state->__tmp2().get().await_resume();
+        }();
+
+        //  co_return slept;
+        state->__promise.return_value(slept);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __nap_within_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__nap_within_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __nap_within_sites[] = {"initial suspend", "co_await with_timeout(nap(timers, ms), timers, limit_ms)", "final suspend"};
+static const lowered_frame_info<__nap_within_state> __nap_within_frame_info{&__nap_within_destroy, "nap_within(timers, ms, limit_ms)", __nap_within_sites};
@@ -0,0 +1,100 @@
+#pragma once
+#include "timer.hpp"
+//////////////////////
+// Coroutine-states of nap(timers, ms) and nap_within(timers, ms, limit_ms),
+// see nap.cpp for the lowering. bench/timer.cpp runs them on a reactor.
+
+task<int> nap       (timer_wheel & timers, int ms);
+task<int> nap_within(timer_wheel & timers, int ms, int limit_ms);
+
+using __nap_promise_t        = std::coroutine_traits<task<int>, timer_wheel &, int>::promise_type;
+using __nap_within_promise_t = std::coroutine_traits<task<int>, timer_wheel &, int, int>::promise_type;
+
+__coroutine_state * __nap_resume (__coroutine_state *);
+void                __nap_destroy(__coroutine_state *);
+
+__coroutine_state * __nap_within_resume (__coroutine_state *);
+void                __nap_within_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definitions
+
+struct __nap_state : __coroutine_state_with_promise<__nap_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    timer_wheel & timers;
+    int ms;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                        // initial suspend
+        frame_scope<manual_lifetime<sleep_awaiter>>,                              // co_await sleep_for(timers, ...);
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __nap_state(timer_wheel & timers, int && ms)
+        : timers(timers)
+        , ms(static_cast<int &&>(ms))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __nap_resume;
+            this->__destroy = &__nap_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __nap_promise_t(construct_promise<__nap_promise_t>(this->timers, this->ms));
+    }
+
+    ~__nap_state()
+    {
+        this->__promise.~__nap_promise_t();
+    }
+};
+
+struct __nap_within_state : __coroutine_state_with_promise<__nap_within_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    timer_wheel & timers;
+    int ms;
+    int limit_ms;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                        // initial suspend
+        frame_scope<manual_lifetime<timeout_awaiter<int>>>,                       // int slept = co_await with_timeout(...);
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __nap_within_state(timer_wheel & timers, int && ms, int && limit_ms)
+        : timers(timers)
+        , ms(static_cast<int &&>(ms))
+        , limit_ms(static_cast<int &&>(limit_ms))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __nap_within_resume;
+            this->__destroy = &__nap_within_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __nap_within_promise_t(construct_promise<__nap_within_promise_t>(this->timers, this->ms, this->limit_ms));
+    }
+
+    ~__nap_within_state()
+    {
+        this->__promise.~__nap_within_promise_t();
+    }
+};
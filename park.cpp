@@ -0,0 +1,277 @@
+#include "park.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of park(async_event & e, int x)
+//
+// task<int> park(async_event & e, int x) {
+//   co_await e.wait();
+//   co_return x;
+// }
+//
+// wait_awaiter::await_suspend() returns bool, like lock_awaiter in contend.cpp:
+// false means the event was set while we were queueing.
+
+/////
+// The "ramp" function
+
+task<int> park(async_event & e, int x)
+{
+    std::unique_ptr<__park_state> state(new __park_state(e, static_cast<int &&>(x)));
+    return __ramp(std::move(state), &__park_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __park_cancellable = __cancellation_points<std::suspend_always, async_event::wait_awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__park_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__park_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __park_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  co_await e.wait();
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return state->e.wait();
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                if(state->__tmp2().get().await_suspend(std::coroutine_handle<__park_promise_t>::from_promise(state->__promise))){
+                    // bool-returning await_suspend: true means we are queued, return to whoever resumed us.
+                    tmp2_dtor.cancel();
+                    return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+                }
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  co_return x;
+        state->__promise.return_value(state->x);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __park_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__park_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __park_sites[] = {"initial suspend", "co_await e.wait()", "final suspend"};
+static const lowered_frame_info<__park_state> __park_frame_info{&__park_destroy, "park(e, x)", __park_sites};
+
+#ifdef CORO_COMPACT_FRAMES
+//////////////////////
+// Begin lowering of park_compact(async_event & e, int x)
+//
+// The same body as park(), in a compact frame, see "Compact frames" in
+// defs.hpp. What differs from the lowering above:
+//
+//   - the handle passed to and returned from the resume and destroy functions
+//     is one word before the state, __from_handle() / __handle() convert;
+//   - the suspend-point is read and written through the header word;
+//   - the final suspend-point sets the done bit, the vtable stays in place.
+//
+// coroutine_handle<__park_compact_promise_t>::from_promise() already yields
+// the handle, since the promise is 16 bytes past it in either layout.
+
+/////
+// The vtable
+
+const __coroutine_vtable __park_compact_vtable{&__park_compact_resume, &__park_compact_destroy, sizeof(__park_compact_state), "park_compact(e, x)"};
+
+/////
+// The "ramp" function
+
+task<int> park_compact(async_event & e, int x)
+{
+    std::unique_ptr<__park_compact_state> state(new __park_compact_state(e, static_cast<int &&>(x)));
+    return __ramp(std::move(state), &__park_compact_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __park_compact_cancellable = __cancellation_points<std::suspend_always, async_event::wait_awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__park_compact_resume(__coroutine_state *s)
+{
+    auto *state = __compact_coroutine_state::__from_handle<__park_compact_state>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __park_compact_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point()){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  co_await e.wait();
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return state->e.wait();
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__set_suspend_point(1);
+                CORO_TRACE_EVENT(suspend, s, 1);
+                __release_running_frame();
+                if(state->__tmp2().get().await_suspend(std::coroutine_handle<__park_compact_promise_t>::from_promise(state->__promise))){
+                    // bool-returning await_suspend: true means we are queued, return to whoever resumed us.
+                    tmp2_dtor.cancel();
+                    return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+                }
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  co_return x;
+        state->__promise.return_value(state->x);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __park_compact_destroy(__coroutine_state *s)
+{
+    auto *state = __compact_coroutine_state::__from_handle<__park_compact_state>(s);
+    CORO_TRACE_EVENT(destroy, s, state->__suspend_point());
+
+    switch(state->__suspend_point()){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __park_compact_sites[] = {"initial suspend", "co_await e.wait()", "final suspend"};
+static const lowered_frame_info<__park_compact_state> __park_compact_frame_info{&__park_compact_destroy, "park_compact(e, x)", __park_compact_sites};
+#endif
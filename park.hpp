@@ -0,0 +1,112 @@
+#pragma once
+#include "sync.hpp"
+//////////////////////
+// Coroutine-states of park(e, x) and park_compact(e, x), see park.cpp for the
+// lowering. The same coroutine lowered twice, once with the classic frame
+// header and once with the compact one ("Compact frames" in defs.hpp). A
+// million of each parked on an async_event make the frame layout benchmark
+// (bench/compact.cpp). park_compact() only exists with -DCORO_COMPACT_FRAMES.
+
+task<int> park        (async_event & e, int x);
+
+using __park_promise_t         = std::coroutine_traits<task<int>, async_event &, int>::promise_type;
+
+__coroutine_state * __park_resume (__coroutine_state *);
+void                __park_destroy(__coroutine_state *);
+
+#ifdef CORO_COMPACT_FRAMES
+task<int> park_compact(async_event & e, int x);
+
+using __park_compact_promise_t = std::coroutine_traits<task<int>, async_event &, int>::promise_type;
+
+__coroutine_state * __park_compact_resume (__coroutine_state *);
+void                __park_compact_destroy(__coroutine_state *);
+
+// The vtable the header of every park_compact frame points to.
+extern const __coroutine_vtable __park_compact_vtable;
+#endif
+
+/////
+// The coroutine-state definitions
+
+struct __park_state : __coroutine_state_with_promise<__park_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    async_event & e;
+    int x;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                          // initial suspend
+        frame_scope<manual_lifetime<async_event::wait_awaiter>>,                    // co_await e.wait();
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;      // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __park_state(async_event & e, int && x)
+        : e(e)
+        , x(static_cast<int &&>(x))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __park_resume;
+            this->__destroy = &__park_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __park_promise_t(construct_promise<__park_promise_t>(this->e, this->x));
+    }
+
+    ~__park_state()
+    {
+        this->__promise.~__park_promise_t();
+    }
+};
+
+#ifdef CORO_COMPACT_FRAMES
+// No __suspend_point member: the index lives in the header word.
+struct __park_compact_state : __coroutine_state_with_promise<__park_compact_promise_t, __compact_coroutine_state>
+{
+    // Argument copies
+    async_event & e;
+    int x;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                          // initial suspend
+        frame_scope<manual_lifetime<async_event::wait_awaiter>>,                    // co_await e.wait();
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;      // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __park_compact_state(async_event & e, int && x)
+        : e(e)
+        , x(static_cast<int &&>(x))
+    {
+            // Point the header at the vtable used by coroutine_handle::resume/destroy/done(),
+            // at suspend-point 0.
+            this->__header = __compact_coroutine_state::__make_header(__park_compact_vtable);
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __park_compact_promise_t(construct_promise<__park_compact_promise_t>(this->e, this->x));
+    }
+
+    ~__park_compact_state()
+    {
+        this->__promise.~__park_compact_promise_t();
+    }
+};
+
+// The header word takes the place of __resume, __destroy and __suspend_point.
+static_assert(sizeof(__park_compact_state) < sizeof(__park_state));
+#endif
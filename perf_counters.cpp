@@ -0,0 +1,363 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <ostream>
+#include <tuple>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "async_stack.hpp"
+#include "perf_counters.hpp"
+
+namespace
+{
+    using totals = perf_counters::totals;
+
+    // (registered type or function, call, point)
+    using row_key = std::tuple<const void *, perf_counters::call, std::uint32_t>;
+
+    struct event
+    {
+        std::uint32_t type;
+        std::uint64_t config;
+    };
+
+    constexpr event events[perf_counters::counters] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+        {PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    };
+
+    // The counters and rows of one thread. Never freed, so the rows of exited
+    // threads still show up in the report; the file descriptors are closed
+    // when the thread exits.
+    struct thread_counters
+    {
+        int                                        fds[perf_counters::counters];
+        std::uint64_t                              ids[perf_counters::counters] = {};
+        int                                        leader = -1;
+        int                                        error  = 0;
+
+        std::map<row_key, perf_counters::row>      rows;
+
+        // Of the calls nested in the one being counted, see counted().
+        totals                                     children;
+
+        thread_counters *                          next = nullptr;
+
+        thread_counters()
+        {
+            std::fill(std::begin(fds), std::end(fds), -1);
+        }
+
+        void open() noexcept
+        {
+            for(std::size_t c = 0; c < perf_counters::counters; ++c){
+                perf_event_attr a{};
+                a.size           = sizeof a;
+                a.type           = events[c].type;
+                a.config         = events[c].config;
+                a.exclude_kernel = 1;
+                a.exclude_hv     = 1;
+                a.read_format    = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+
+                const int fd = static_cast<int>(::syscall(SYS_perf_event_open, &a, 0, -1, leader, PERF_FLAG_FD_CLOEXEC));
+                if(fd < 0){
+                    if(leader < 0){
+                        error = errno;
+                    }
+                    continue;
+                }
+                if(::ioctl(fd, PERF_EVENT_IOC_ID, &ids[c]) < 0){
+                    ::close(fd);
+                    continue;
+                }
+                fds[c] = fd;
+                if(leader < 0){
+                    leader = fd;
+                    error  = 0;
+                }
+            }
+        }
+
+        void close() noexcept
+        {
+            for(int & fd: fds){
+                if(fd >= 0){
+                    ::close(fd);
+                    fd = -1;
+                }
+            }
+            leader = -1;
+        }
+
+        totals read() noexcept
+        {
+            totals t;
+            if(leader >= 0){
+                // {nr, {value, id}[nr]}
+                std::uint64_t values[1 + 2 * perf_counters::counters];
+                const ssize_t n = ::read(leader, values, sizeof values);
+                for(std::uint64_t i = 0; n > 0 && i < values[0]; ++i){
+                    for(std::size_t c = 0; c < perf_counters::counters; ++c){
+                        if(fds[c] >= 0 && ids[c] == values[2 + 2 * i]){
+                            t.values[c] = values[1 + 2 * i];
+                        }
+                    }
+                }
+            }
+            t.ns = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+            return t;
+        }
+    };
+
+    std::atomic<thread_counters *> threads {nullptr};
+
+    struct thread_registration
+    {
+        thread_counters * counters = nullptr;
+
+        ~thread_registration()
+        {
+            if(counters != nullptr){
+                counters->close();
+            }
+        }
+    };
+
+    thread_local thread_registration current;
+
+    thread_counters & this_thread() noexcept
+    {
+        if(current.counters == nullptr) [[unlikely]] {
+            auto * t = new thread_counters;
+            t->open();
+
+            t->next = threads.load(std::memory_order_relaxed);
+            while(!threads.compare_exchange_weak(t->next, t, std::memory_order_release, std::memory_order_relaxed)){
+            }
+            current.counters = t;
+        }
+        return *current.counters;
+    }
+
+    totals operator-(totals a, const totals & b) noexcept
+    {
+        a.ns -= b.ns;
+        for(std::size_t c = 0; c < perf_counters::counters; ++c){
+            a.values[c] -= b.values[c];
+        }
+        return a;
+    }
+
+    // Runs `fn` between two reads and books the difference, less that of the
+    // counted calls nested in it, on (frame's type, what, its suspend-point).
+    template<typename Fn> decltype(auto) counted(__coroutine_state * s, perf_counters::call what, Fn && fn)
+    {
+        thread_counters & t = this_thread();
+
+        // Before the call: the frame may not be there afterwards, nor __resume.
+        const async_frame_info * info = async_frame_info::find(s);
+        const void *             function = what == perf_counters::call::resume ? reinterpret_cast<const void *>(__resume_fn_of(s))
+                                                                                : reinterpret_cast<const void *>(__destroy_fn_of(s));
+        const std::uint32_t      point = info != nullptr && info->suspend_point != nullptr ? info->suspend_point(s) : 0;
+
+        const totals outer = std::exchange(t.children, totals{});
+        const totals start = t.read();
+
+        auto booked = [&]
+        {
+            const totals total = t.read() - start;
+            const totals self  = total - t.children;
+            t.children = outer;
+            t.children += total;
+
+            perf_counters::row & r = t.rows.try_emplace(row_key{info != nullptr ? static_cast<const void *>(info) : function, what, point},
+                                                        perf_counters::row{info, function, what, point, {}}).first->second;
+            r.sum += self;
+            r.sum.calls++;
+        };
+
+        if constexpr (std::is_void_v<decltype(fn())>){
+            fn();
+            booked();
+        }
+        else{
+            decltype(auto) result = fn();
+            booked();
+            return result;
+        }
+    }
+}
+
+#ifdef CORO_PERF_COUNTERS
+__coroutine_state * __perf_counted_resume(__coroutine_state *s)
+{
+    return counted(s, perf_counters::call::resume, [s]{ return __resume_fn_of(s)(s); });
+}
+
+void __perf_counted_destroy(__coroutine_state *s)
+{
+    counted(s, perf_counters::call::destroy, [s]{ __destroy_fn_of(s)(s); });
+}
+#endif
+
+//////////////////////
+// perf_counters
+
+perf_counters::totals & perf_counters::totals::operator+=(const totals & t) noexcept
+{
+    calls += t.calls;
+    ns    += t.ns;
+    for(std::size_t c = 0; c < counters; ++c){
+        values[c] += t.values[c];
+    }
+    return *this;
+}
+
+std::string perf_counters::row::coroutine() const
+{
+    if(info != nullptr){
+        return info->function;
+    }
+    char buf[32];
+    std::snprintf(buf, sizeof buf, "%p", function);
+    return buf;
+}
+
+std::string perf_counters::row::site() const
+{
+    if(info != nullptr && info->site(point) != nullptr){
+        return info->site(point);
+    }
+    return std::to_string(point);
+}
+
+bool perf_counters::available(counter c) noexcept
+{
+    return this_thread().fds[c] >= 0;
+}
+
+std::string_view perf_counters::unavailable_reason() noexcept
+{
+    const thread_counters & t = this_thread();
+    return t.leader >= 0 ? std::string_view() : std::string_view(std::strerror(t.error));
+}
+
+std::string_view perf_counters::name(counter c) noexcept
+{
+    switch(c){
+        case cycles       : return "cycles";
+        case instructions : return "instr";
+        case branch_misses: return "br-miss";
+        case l1d_misses   : return "L1D-miss";
+        case llc_misses   : return "LLC-miss";
+    }
+    return "unknown";
+}
+
+std::vector<perf_counters::row> perf_counters::collect()
+{
+    std::map<row_key, row> merged;
+    for(thread_counters * t = threads.load(std::memory_order_acquire); t != nullptr; t = t->next){
+        for(const auto & [key, r]: t->rows){
+            auto [it, inserted] = merged.try_emplace(key, r);
+            if(!inserted){
+                it->second.sum += r.sum;
+            }
+        }
+    }
+
+    std::vector<row> rows;
+    for(auto & [key, r]: merged){
+        rows.push_back(r);
+    }
+    std::stable_sort(rows.begin(), rows.end(), [](const row & a, const row & b)
+    {
+        return std::forward_as_tuple(a.coroutine(), a.what, a.point) < std::forward_as_tuple(b.coroutine(), b.what, b.point);
+    });
+    return rows;
+}
+
+void perf_counters::clear() noexcept
+{
+    for(thread_counters * t = threads.load(std::memory_order_acquire); t != nullptr; t = t->next){
+        t->rows.clear();
+    }
+}
+
+void perf_counters::write_report(std::ostream & out)
+{
+    const std::vector<row> rows = collect();
+
+    if(!unavailable_reason().empty()){
+        out << "# hardware counters unavailable (" << unavailable_reason() << "), only calls and ns/call\n";
+    }
+
+    std::size_t coroutine_width = 9, site_width = 4;
+    for(const row & r: rows){
+        coroutine_width = std::max(coroutine_width, r.coroutine().size());
+        site_width      = std::max(site_width,      r.site().size());
+    }
+
+    char buf[64];
+    auto cell = [&](std::string_view text, std::size_t width, bool left = false)
+    {
+        std::snprintf(buf, sizeof buf, left ? "%-*.*s" : "%*.*s", static_cast<int>(width), static_cast<int>(text.size()), text.data());
+        out << buf;
+    };
+    auto number = [&](double value, std::size_t width)
+    {
+        std::snprintf(buf, sizeof buf, "%*.2f", static_cast<int>(width), value);
+        out << buf;
+    };
+
+    cell("coroutine", coroutine_width, true);
+    out << "  ";
+    cell("call", 7, true);
+    out << "  ";
+    cell("from", site_width, true);
+    cell("calls", 12);
+    cell("ns/call", 10);
+    for(std::size_t c = 0; c < counters; ++c){
+        cell(name(static_cast<counter>(c)), 10);
+    }
+    cell("IPC", 7);
+    out << '\n';
+
+    for(const row & r: rows){
+        const double calls = static_cast<double>(std::max<std::uint64_t>(r.sum.calls, 1));
+
+        cell(r.coroutine(), coroutine_width, true);
+        out << "  ";
+        cell(r.what == call::resume ? "resume" : "destroy", 7, true);
+        out << "  ";
+        cell(r.site(), site_width, true);
+        cell(std::to_string(r.sum.calls), 12);
+        number(static_cast<double>(r.sum.ns) / calls, 10);
+        for(std::size_t c = 0; c < counters; ++c){
+            if(available(static_cast<counter>(c))){
+                number(static_cast<double>(r.sum.values[c]) / calls, 10);
+            }
+            else{
+                cell("-", 10);
+            }
+        }
+        if(available(cycles) && available(instructions) && r.sum.values[cycles] != 0){
+            number(static_cast<double>(r.sum.values[instructions]) / static_cast<double>(r.sum.values[cycles]), 7);
+        }
+        else{
+            cell("-", 7);
+        }
+        out << '\n';
+    }
+}
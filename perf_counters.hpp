@@ -0,0 +1,117 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Hardware performance counters per coroutine type and suspend-point
+//
+// Built with -DCORO_PERF_COUNTERS the trampoline in coroutine_handle<>::resume()
+// and coroutine_handle<>::destroy() read a group of counters around every call
+// of a frame's __resume and __destroy, and add the difference to a row per
+// coroutine type, function and suspend-point:
+//
+//   coroutine  call     from             calls  ns/call  cycles  instr  br-miss  L1D-miss  LLC-miss  IPC
+//   f(int x)   resume   initial suspend   2000    30.90     ...
+//   f(int x)   destroy  final suspend     2000    30.92     ...
+//   g(int x)   resume   initial suspend   2000    34.89     ...
+//   g(int x)   resume   co_await f(x)     2000   129.84     ...
+//
+// with the counters as averages per call.
+//
+// A resume row covers the body from the suspend-point it was resumed at to the
+// next one it suspends at (or to its end), a destroy row the destroy function
+// from the suspend-point it was destroyed at. Types and suspend-points are
+// named by the async_frame_info every lowering registers (async_stack.hpp), so
+// an unregistered frame type only gets its function address.
+//
+// Rows are exclusive: a resume or destroy nested in another (when_all starting
+// its children, a task destroying the one it awaited) is taken out of the outer
+// row and counted in its own. A ramp that runs a body without suspending first
+// calls __X_resume directly rather than through the trampoline, so that part
+// stays with whatever called the ramp.
+//
+// Each thread opens its own counters on its first counted call through
+// perf_event_open(2), user space only (exclude_kernel), so that
+// kernel.perf_event_paranoid <= 2 allows it. Counters the kernel or the machine
+// doesn't provide (a VM without a PMU, a container whose seccomp profile forbids
+// the call, an event missing on that CPU) are left out, the report prints "-"
+// for them and calls and ns/call are still measured with steady_clock.
+//
+// Reading the group is a read(2) per side of every call, around 300 ns of wall
+// time that is not in the rows but slows the program down as a whole: compare
+// the counters between builds, not the timings with an uncounted build. Like
+// tracer, read (or clear) the rows while the counted threads are idle.
+//
+// Without CORO_PERF_COUNTERS the trampoline is unchanged and nothing is
+// counted; the API is still there and reports no rows.
+
+#include<array>
+#include<cstdint>
+#include<iosfwd>
+#include<string>
+#include<string_view>
+#include<vector>
+#include "defs.hpp"
+
+class async_frame_info;
+
+class perf_counters
+{
+    public:
+        enum counter : std::uint8_t
+        {
+            cycles,
+            instructions,
+            branch_misses,
+            l1d_misses,     // L1 data cache read misses
+            llc_misses,     // last level cache misses
+        };
+
+        static constexpr std::size_t counters = 5;
+
+        enum class call : std::uint8_t
+        {
+            resume,
+            destroy,
+        };
+
+        struct totals
+        {
+            std::uint64_t                          calls = 0;
+            std::uint64_t                          ns    = 0;
+            std::array<std::uint64_t, counters>    values{};   // 0 for unavailable counters
+
+            totals & operator+=(const totals & t) noexcept;
+        };
+
+        struct row
+        {
+            const async_frame_info * info;      // null if the type isn't registered
+            const void *             function;  // __resume or __destroy, if it isn't
+            call                     what;
+            std::uint32_t            point;     // the call started at
+            totals                   sum;
+
+            // f(int x), or the function's address.
+            std::string coroutine() const;
+
+            // initial suspend, co_await f(x), ... or the number.
+            std::string site() const;
+        };
+
+    public:
+        // Whether `c` is counted on the calling thread, opening its counters if
+        // it hasn't yet.
+        static bool available(counter c) noexcept;
+
+        // Why no counter could be opened on the calling thread, empty if one could.
+        static std::string_view unavailable_reason() noexcept;
+
+        static std::string_view name(counter c) noexcept;
+
+        // The rows of all threads merged, ordered by coroutine, call and point.
+        static std::vector<row> collect();
+
+        // collect() as a text table, per call averages.
+        static void write_report(std::ostream & out);
+
+        // Drops all rows, e.g. after a warm-up.
+        static void clear() noexcept;
+};
@@ -0,0 +1,467 @@
+#include "pipeline.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of produce(pipe_channel & ch, std::atomic<int> & producers, long first, long n)
+//
+// task<long> produce(pipe_channel & ch, std::atomic<int> & producers, long first, long n) {
+//   for(long i = first; i < first + n; ++i) {
+//     co_await ch.send(i);
+//   }
+//   if(producers.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+//     ch.close();
+//   }
+//   co_return n;
+// }
+//
+// The channel awaiters' await_suspend() returns a handle, like handoff_awaiter
+// in contend.cpp: the consumer we woke, our own if the operation completed
+// after all, or the noop coroutine if we are parked.
+//
+// A consumer resumed by the channel already holds its value, and giving up
+// there would lose it: recv_awaiter and recv_many_awaiter are hands_over, so
+// the consumers have no cancellation point at suspend-point 1.
+
+/////
+// The "ramp" function
+
+task<long> produce(pipe_channel & ch, std::atomic<int> & producers, long first, long n)
+{
+    std::unique_ptr<__produce_state> state(new __produce_state(ch, producers, static_cast<long &&>(first), static_cast<long &&>(n)));
+    return __ramp(std::move(state), &__produce_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __produce_cancellable = __cancellation_points<std::suspend_always, pipe_channel::send_awaiter, task<long>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__produce_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__produce_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __produce_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  for(long i = first; i < first + n; ++i)
+        state->i = state->first;
+
+loop_condition:
+        if(!(state->i < state->first + state->n)){
+            goto loop_end;
+        }
+
+        //  co_await ch.send(i);
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return state->ch.send(state->i);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp2().get().await_suspend(std::coroutine_handle<__produce_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        ++state->i;
+        goto loop_condition;
+
+loop_end:
+        //  if(producers.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        if(state->producers.fetch_sub(1, std::memory_order_acq_rel) == 1){
+            state->ch.close();
+        }
+
+        //  co_return n;
+        state->__promise.return_value(state->n);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __produce_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__produce_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __produce_sites[] = {"initial suspend", "co_await ch.send(i)", "final suspend"};
+static const lowered_frame_info<__produce_state> __produce_frame_info{&__produce_destroy, "produce(ch, producers, first, n)", __produce_sites};
+
+//////////////////////
+// Begin lowering of consume(pipe_channel & ch, std::atomic<long> & total)
+//
+// task<long> consume(pipe_channel & ch, std::atomic<long> & total) {
+//   long sum = 0;
+//   for(;;) {
+//     std::optional<long> v = co_await ch.recv();
+//     if(!v) break;
+//     sum += *v;
+//   }
+//   total.fetch_add(sum, std::memory_order_relaxed);
+//   co_return sum;
+// }
+
+/////
+// The "ramp" function
+
+task<long> consume(pipe_channel & ch, std::atomic<long> & total)
+{
+    std::unique_ptr<__consume_state> state(new __consume_state(ch, total));
+    return __ramp(std::move(state), &__consume_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __consume_cancellable = __cancellation_points<std::suspend_always, pipe_channel::recv_awaiter, task<long>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__consume_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__consume_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __consume_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+loop_start:
+        //  std::optional<long> v = co_await ch.recv();
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return state->ch.recv();
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp2().get().await_suspend(std::coroutine_handle<__consume_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            std::optional<long> v = [&]() -> decltype(auto)
+            {
+                destructor_guard tmp2_dtor{state->__tmp2()};
+                return state->__tmp2().get().await_resume();
+            }();
+
+            //  if(!v) break;
+            if(!v){
+                goto loop_end;
+            }
+
+            //  sum += *v;
+            state->sum += *v;
+        }
+        goto loop_start;
+
+loop_end:
+        //  total.fetch_add(sum, std::memory_order_relaxed);
+        state->total.fetch_add(state->sum, std::memory_order_relaxed);
+
+        //  co_return sum;
+        state->__promise.return_value(state->sum);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __consume_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__consume_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __consume_sites[] = {"initial suspend", "co_await ch.recv()", "final suspend"};
+static const lowered_frame_info<__consume_state> __consume_frame_info{&__consume_destroy, "consume(ch, total)", __consume_sites};
+
+//////////////////////
+// Begin lowering of consume_batched(pipe_channel & ch, std::atomic<long> & total)
+//
+// task<long> consume_batched(pipe_channel & ch, std::atomic<long> & total) {
+//   long batch[16];
+//   long sum = 0;
+//   for(;;) {
+//     std::size_t n = co_await ch.recv_many(batch);
+//     if(n == 0) break;
+//     for(std::size_t j = 0; j < n; ++j) sum += batch[j];
+//   }
+//   total.fetch_add(sum, std::memory_order_relaxed);
+//   co_return sum;
+// }
+
+/////
+// The "ramp" function
+
+task<long> consume_batched(pipe_channel & ch, std::atomic<long> & total)
+{
+    std::unique_ptr<__consume_batched_state> state(new __consume_batched_state(ch, total));
+    return __ramp(std::move(state), &__consume_batched_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __consume_batched_cancellable = __cancellation_points<std::suspend_always, pipe_channel::recv_many_awaiter, task<long>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__consume_batched_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__consume_batched_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __consume_batched_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+loop_start:
+        //  std::size_t n = co_await ch.recv_many(batch);
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return state->ch.recv_many(state->batch);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp2().get().await_suspend(std::coroutine_handle<__consume_batched_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            std::size_t n = [&]() -> decltype(auto)
+            {
+                destructor_guard tmp2_dtor{state->__tmp2()};
+                return state->__tmp2().get().await_resume();
+            }();
+
+            //  if(n == 0) break;
+            if(n == 0){
+                goto loop_end;
+            }
+
+            //  for(std::size_t j = 0; j < n; ++j) sum += batch[j];
+            for(std::size_t j = 0; j < n; ++j){
+                state->sum += state->batch[j];
+            }
+        }
+        goto loop_start;
+
+loop_end:
+        //  total.fetch_add(sum, std::memory_order_relaxed);
+        state->total.fetch_add(state->sum, std::memory_order_relaxed);
+
+        //  co_return sum;
+        state->__promise.return_value(state->sum);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __consume_batched_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__consume_batched_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __consume_batched_sites[] = {"initial suspend", "co_await ch.recv_many(batch)", "final suspend"};
+static const lowered_frame_info<__consume_batched_state> __consume_batched_frame_info{&__consume_batched_destroy, "consume_batched(ch, total)", __consume_batched_sites};
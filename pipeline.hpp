@@ -0,0 +1,162 @@
+#pragma once
+#include<atomic>
+#include<optional>
+#include "channel.hpp"
+//////////////////////
+// Coroutine-states of the pipeline stages produce(ch, producers, first, n),
+// consume(ch, total) and consume_batched(ch, total), see pipeline.cpp for the
+// lowering. N producers and M consumers of them on a thread_pool make the
+// channel benchmark (bench/channel.cpp).
+
+using pipe_channel = channel<long, 64>;
+
+task<long> produce        (pipe_channel & ch, std::atomic<int> & producers, long first, long n);
+task<long> consume        (pipe_channel & ch, std::atomic<long> & total);
+task<long> consume_batched(pipe_channel & ch, std::atomic<long> & total);
+
+using __produce_promise_t         = std::coroutine_traits<task<long>, pipe_channel &, std::atomic<int> &, long, long>::promise_type;
+using __consume_promise_t         = std::coroutine_traits<task<long>, pipe_channel &, std::atomic<long> &>::promise_type;
+using __consume_batched_promise_t = std::coroutine_traits<task<long>, pipe_channel &, std::atomic<long> &>::promise_type;
+
+__coroutine_state * __produce_resume (__coroutine_state *);
+void                __produce_destroy(__coroutine_state *);
+
+__coroutine_state * __consume_resume (__coroutine_state *);
+void                __consume_destroy(__coroutine_state *);
+
+__coroutine_state * __consume_batched_resume (__coroutine_state *);
+void                __consume_batched_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definitions
+
+struct __produce_state : __coroutine_state_with_promise<__produce_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    pipe_channel & ch;
+    std::atomic<int> & producers;
+    long first;
+    long n;
+
+    // Local variables that live across a suspend-point
+    long i;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                          // initial suspend
+        frame_scope<manual_lifetime<pipe_channel::send_awaiter>>,                   // co_await ch.send(i);
+        frame_scope<manual_lifetime<task<long>::promise_type::final_awaiter>>>;     // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __produce_state(pipe_channel & ch, std::atomic<int> & producers, long && first, long && n)
+        : ch(ch)
+        , producers(producers)
+        , first(static_cast<long &&>(first))
+        , n(static_cast<long &&>(n))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __produce_resume;
+            this->__destroy = &__produce_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __produce_promise_t(construct_promise<__produce_promise_t>(this->ch, this->producers, this->first, this->n));
+    }
+
+    ~__produce_state()
+    {
+        this->__promise.~__produce_promise_t();
+    }
+};
+
+struct __consume_state : __coroutine_state_with_promise<__consume_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    pipe_channel & ch;
+    std::atomic<long> & total;
+
+    // Local variables that live across a suspend-point
+    long sum = 0;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                          // initial suspend
+        frame_scope<manual_lifetime<pipe_channel::recv_awaiter>>,                   // co_await ch.recv()
+        frame_scope<manual_lifetime<task<long>::promise_type::final_awaiter>>>;     // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __consume_state(pipe_channel & ch, std::atomic<long> & total)
+        : ch(ch)
+        , total(total)
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __consume_resume;
+            this->__destroy = &__consume_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __consume_promise_t(construct_promise<__consume_promise_t>(this->ch, this->total));
+    }
+
+    ~__consume_state()
+    {
+        this->__promise.~__consume_promise_t();
+    }
+};
+
+struct __consume_batched_state : __coroutine_state_with_promise<__consume_batched_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    pipe_channel & ch;
+    std::atomic<long> & total;
+
+    // Local variables that live across a suspend-point
+    long batch[16];
+    long sum = 0;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                          // initial suspend
+        frame_scope<manual_lifetime<pipe_channel::recv_many_awaiter>>,              // co_await ch.recv_many(batch)
+        frame_scope<manual_lifetime<task<long>::promise_type::final_awaiter>>>;     // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __consume_batched_state(pipe_channel & ch, std::atomic<long> & total)
+        : ch(ch)
+        , total(total)
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __consume_batched_resume;
+            this->__destroy = &__consume_batched_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __consume_batched_promise_t(construct_promise<__consume_batched_promise_t>(this->ch, this->total));
+    }
+
+    ~__consume_batched_state()
+    {
+        this->__promise.~__consume_batched_promise_t();
+    }
+};
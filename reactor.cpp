@@ -0,0 +1,259 @@
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "reactor.hpp"
+
+namespace
+{
+    // Setup failures (no epoll, no eventfd, fd table full) can't be reported
+    // through io_result.
+    [[noreturn]] void fail(const char * what)
+    {
+#ifdef CORO_NO_EXCEPTIONS
+        std::perror(what);
+        std::abort();
+#else
+        throw std::system_error(errno, std::system_category(), what);
+#endif
+    }
+
+    std::error_code last_error() noexcept
+    {
+        return std::error_code(errno, std::system_category());
+    }
+
+    bool would_block() noexcept
+    {
+        return errno == EAGAIN || errno == EWOULDBLOCK;
+    }
+}
+
+//////////////////////
+// reactor
+
+reactor::reactor()
+{
+    epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if(epoll_fd_ < 0){
+        fail("epoll_create1");
+    }
+
+    wake_fd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if(wake_fd_ < 0){
+        fail("eventfd");
+    }
+
+    epoll_event ev{};
+    ev.events  = EPOLLIN;
+    ev.data.fd = wake_fd_;
+    if(::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &ev) < 0){
+        fail("epoll_ctl");
+    }
+}
+
+reactor::~reactor()
+{
+    ::close(wake_fd_);
+    ::close(epoll_fd_);
+}
+
+void reactor::run()
+{
+    stop_ = false;
+    while(spawned_ != 0 && !stop_){
+        run_once();
+    }
+}
+
+std::size_t reactor::run_once(int timeout_ms)
+{
+    std::array<epoll_event, max_events> events;
+
+    // Don't sleep past the next timer, rounding up: the wheel only expires
+    // timers whose deadline has passed.
+    if(timers_.size() != 0){
+        const auto until = std::chrono::ceil<std::chrono::milliseconds>(timers_.next_deadline() - timer_wheel::clock::now()).count();
+        const int  ms    = static_cast<int>(std::clamp<decltype(until)>(until, 0, std::numeric_limits<int>::max()));
+        if(timeout_ms < 0 || ms < timeout_ms){
+            timeout_ms = ms;
+        }
+    }
+
+    int n = ::epoll_wait(epoll_fd_, events.data(), max_events, timeout_ms);
+    if(n < 0){
+        if(errno == EINTR){
+            return 0;
+        }
+        fail("epoll_wait");
+    }
+
+    // Finish every operation the edges allow first and resume afterwards, so a
+    // resumed coroutine can't re-park on a descriptor we haven't looked at yet.
+    std::array<std::coroutine_handle<>, 2 * max_events> ready;
+    std::size_t count = 0;
+
+    for(int i = 0; i < n; ++i){
+        const int fd = events[i].data.fd;
+        const std::uint32_t what = events[i].events;
+
+        if(fd == wake_fd_){
+            std::uint64_t value;
+            [[maybe_unused]] auto r = ::read(wake_fd_, &value, sizeof value);
+            stop_ = true;
+            continue;
+        }
+
+        fd_state & state = fds_[fd];
+        if((what & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && state.reader != nullptr){
+            if(state.reader->perform(state.reader)){
+                ready[count++] = std::exchange(state.reader, nullptr)->waiter;
+            }
+        }
+        if((what & (EPOLLOUT | EPOLLHUP | EPOLLERR)) && state.writer != nullptr){
+            if(state.writer->perform(state.writer)){
+                ready[count++] = std::exchange(state.writer, nullptr)->waiter;
+            }
+        }
+    }
+
+    for(std::size_t i = 0; i < count; ++i){
+        ready[i].resume();
+    }
+
+    if(timers_.size() != 0){
+        count += timers_.advance(timer_wheel::clock::now());
+    }
+    return count;
+}
+
+void reactor::stop() noexcept
+{
+    const std::uint64_t one = 1;
+    [[maybe_unused]] auto r = ::write(wake_fd_, &one, sizeof one);
+}
+
+void reactor::add(int fd)
+{
+    if(static_cast<std::size_t>(fd) >= fds_.size()){
+        fds_.resize(static_cast<std::size_t>(fd) + 1);
+    }
+
+    struct stat st;
+    fds_[fd] = fd_state{};
+    fds_[fd].socket = ::fstat(fd, &st) == 0 && S_ISSOCK(st.st_mode);
+
+    epoll_event ev{};
+    ev.events  = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.fd = fd;
+    if(::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0){
+        fail("epoll_ctl");
+    }
+}
+
+void reactor::remove(int fd) noexcept
+{
+    ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    fds_[fd] = fd_state{};
+}
+
+//////////////////////
+// async_fd
+
+async_fd::async_fd(reactor & r, int fd)
+    : reactor_(&r)
+    , fd_(fd)
+{
+    const int flags = ::fcntl(fd, F_GETFL);
+    if(flags < 0 || ::fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0){
+        fail("fcntl");
+    }
+    r.add(fd);
+}
+
+void async_fd::close() noexcept
+{
+    if(fd_ >= 0){
+        reactor_->remove(fd_);
+        ::close(std::exchange(fd_, -1));
+    }
+}
+
+//////////////////////
+// Operations
+
+bool read_awaiter::do_read(io_operation * op) noexcept
+{
+    auto * self = static_cast<read_awaiter *>(op);
+
+    const ssize_t n = ::read(self->fd_.get(), self->buffer_, self->size_);
+    if(n >= 0){
+        self->result_.bytes = static_cast<std::size_t>(n);
+        return true;
+    }
+    if(would_block()){
+        return false;
+    }
+    if(errno == EINTR){
+        return do_read(op);
+    }
+    self->result_.error = last_error();
+    return true;
+}
+
+bool write_awaiter::do_write(io_operation * op) noexcept
+{
+    auto * self = static_cast<write_awaiter *>(op);
+    const int fd = self->fd_.get();
+
+    // Sockets use send() so a closed peer is an EPIPE error instead of SIGPIPE.
+    const bool socket = self->fd_.context().is_socket(fd);
+
+    while(self->result_.bytes < self->size_){
+        const char * p    = self->buffer_ + self->result_.bytes;
+        const std::size_t left = self->size_ - self->result_.bytes;
+
+        const ssize_t n = socket ? ::send (fd, p, left, MSG_NOSIGNAL)
+                                 : ::write(fd, p, left);
+        if(n >= 0){
+            self->result_.bytes += static_cast<std::size_t>(n);
+        }
+        else if(would_block()){
+            return false;
+        }
+        else if(errno != EINTR){
+            self->result_.error = last_error();
+            return true;
+        }
+    }
+    return true;
+}
+
+bool accept_awaiter::do_accept(io_operation * op) noexcept
+{
+    auto * self = static_cast<accept_awaiter *>(op);
+
+    int fd;
+    do{
+        fd = ::accept4(self->listener_.get(), nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+    }
+    while(fd < 0 && errno == EINTR);
+
+    if(fd >= 0){
+        self->result_.socket = async_fd(self->listener_.context(), fd);
+        return true;
+    }
+    if(would_block()){
+        return false;
+    }
+    self->result_.error = last_error();
+    return true;
+}
@@ -0,0 +1,402 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// epoll-based I/O reactor
+//
+// A reactor owns an epoll instance. Every file descriptor wrapped in an
+// async_fd is registered once, edge-triggered, for both directions, and
+// coroutines wait on it with
+//
+//   io_result     r = co_await async_read  (fd, buf, size);   // reads some bytes, 0 at EOF
+//   io_result     w = co_await async_write (fd, buf, size);   // writes all `size` bytes
+//   accept_result a = co_await async_accept(listener);
+//
+// This works the same for sockets and pipes. Each awaiter first attempts the
+// operation directly and only parks on the reactor if it would block. The
+// operation state (an io_operation) lives in the awaiter, i.e. in the
+// coroutine frame, so waiting allocates nothing, and destroying a suspended
+// coroutine takes its parked operation off the reactor. The reactor keeps one
+// reader and one writer slot per descriptor. On an edge it retries the parked
+// operation, and it resumes the completed ones in a batch after each
+// epoll_wait.
+//
+// The reactor is single-threaded: run() and every coroutine waiting on it run
+// on the same thread, only stop() may be called from elsewhere. Errors are
+// returned in io_result, never thrown.
+//
+// It also owns a timer_wheel (timer.hpp): epoll_wait sleeps no longer than until
+// the wheel's next deadline, and the wheel is advanced after the I/O is done,
+// so coroutines on the reactor can sleep_for(r.timers(), ...) and time out.
+
+#include<cstddef>
+#include<cstdint>
+#include<system_error>
+#include<vector>
+#include "async_stack.hpp"
+#include "timer.hpp"
+
+class async_fd;
+
+struct io_result
+{
+    std::size_t     bytes = 0;
+    std::error_code error;
+};
+
+// State of one pending operation, embedded in its awaiter.
+struct io_operation
+{
+    // Attempts the operation. Returns false if it would block, true once it has
+    // a result (success or error).
+    bool (*perform)(io_operation *) noexcept;
+
+    std::coroutine_handle<> waiter;
+};
+
+//////////////////////
+// The reactor
+
+class reactor
+{
+    private:
+        struct fd_state
+        {
+            io_operation * reader = nullptr;
+            io_operation * writer = nullptr;
+            bool           socket = false;
+        };
+
+        template<typename T> struct detached_state;
+
+        static constexpr int max_events = 256;
+
+    private:
+        int epoll_fd_ = -1;
+        int  wake_fd_ = -1;     // eventfd used by stop()
+
+        std::vector<fd_state> fds_;     // indexed by file descriptor
+
+        timer_wheel timers_;
+
+        // Number of spawned tasks that have not finished yet, see run().
+        std::size_t spawned_ = 0;
+        bool        stop_    = false;
+
+    public:
+        reactor();
+        ~reactor();
+
+        reactor            (const reactor &) = delete;
+        reactor & operator=(const reactor &) = delete;
+
+    public:
+        // Process I/O until every spawned task has finished or stop() is called.
+        void run();
+
+        // Wait up to `timeout_ms` (-1: forever) for I/O or the next timer and
+        // resume whatever completed or expired. Returns the number of
+        // coroutines resumed.
+        std::size_t run_once(int timeout_ms = -1);
+
+        // Make run() return, callable from any thread.
+        void stop() noexcept;
+
+        // Start `t` on the calling thread up to its first suspend-point, its frame
+        // is destroyed when it finishes.
+        template<typename T> void spawn(task<T> t);
+
+        // The timers of coroutines running on this reactor.
+        timer_wheel & timers() noexcept
+        {
+            return timers_;
+        }
+
+    private:
+        friend class async_fd;
+        friend class read_awaiter;
+        friend class write_awaiter;
+        friend class accept_awaiter;
+
+        void add   (int fd);
+        void remove(int fd) noexcept;
+
+        bool is_socket(int fd) const noexcept
+        {
+            return fds_[fd].socket;
+        }
+
+        void park_reader(int fd, io_operation * op) noexcept
+        {
+            fds_[fd].reader = op;
+        }
+
+        void park_writer(int fd, io_operation * op) noexcept
+        {
+            fds_[fd].writer = op;
+        }
+
+        // Forget `op` if it is still parked, i.e. its awaiter is destroyed
+        // because the suspended coroutine was.
+        void unpark(int fd, io_operation * op) noexcept
+        {
+            if(fds_[fd].reader == op){
+                fds_[fd].reader = nullptr;
+            }
+            if(fds_[fd].writer == op){
+                fds_[fd].writer = nullptr;
+            }
+        }
+};
+
+//////////////////////
+// An owned, non-blocking file descriptor registered with a reactor
+
+class async_fd
+{
+    private:
+        reactor * reactor_ = nullptr;
+        int       fd_      = -1;
+
+    public:
+        async_fd() noexcept = default;
+
+        // Takes ownership of `fd`, switches it to non-blocking mode and registers it.
+        async_fd(reactor & r, int fd);
+
+        async_fd(async_fd && other) noexcept
+            : reactor_(std::exchange(other.reactor_, nullptr))
+            , fd_     (std::exchange(other.fd_, -1))
+        {}
+
+        async_fd & operator=(async_fd && other) noexcept
+        {
+            async_fd tmp = std::move(other);
+            std::swap(reactor_, tmp.reactor_);
+            std::swap(fd_,      tmp.fd_);
+            return *this;
+        }
+
+        ~async_fd()
+        {
+            close();
+        }
+
+    public:
+        int get() const noexcept
+        {
+            return fd_;
+        }
+
+        explicit operator bool() const noexcept
+        {
+            return fd_ >= 0;
+        }
+
+        reactor & context() const noexcept
+        {
+            return *reactor_;
+        }
+
+        void close() noexcept;
+};
+
+//////////////////////
+// Awaitables
+
+class read_awaiter : private io_operation
+{
+    private:
+        async_fd &   fd_;
+        void *       buffer_;
+        std::size_t  size_;
+        io_result    result_;
+
+    public:
+        read_awaiter(async_fd & fd, void * buffer, std::size_t size) noexcept
+            : io_operation{&do_read, {}}
+            , fd_(fd)
+            , buffer_(buffer)
+            , size_(size)
+        {}
+
+        ~read_awaiter()
+        {
+            if(waiter && fd_){
+                fd_.context().unpark(fd_.get(), this);
+            }
+        }
+
+        bool await_ready() noexcept
+        {
+            return perform(this);
+        }
+
+        void await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            waiter = h;
+            fd_.context().park_reader(fd_.get(), this);
+        }
+
+        io_result await_resume() noexcept
+        {
+            return result_;
+        }
+
+    private:
+        static bool do_read(io_operation * op) noexcept;
+};
+
+class write_awaiter : private io_operation
+{
+    private:
+        async_fd &   fd_;
+        const char * buffer_;
+        std::size_t  size_;
+        io_result    result_;
+
+    public:
+        write_awaiter(async_fd & fd, const void * buffer, std::size_t size) noexcept
+            : io_operation{&do_write, {}}
+            , fd_(fd)
+            , buffer_(static_cast<const char *>(buffer))
+            , size_(size)
+        {}
+
+        ~write_awaiter()
+        {
+            if(waiter && fd_){
+                fd_.context().unpark(fd_.get(), this);
+            }
+        }
+
+        bool await_ready() noexcept
+        {
+            return perform(this);
+        }
+
+        void await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            waiter = h;
+            fd_.context().park_writer(fd_.get(), this);
+        }
+
+        io_result await_resume() noexcept
+        {
+            return result_;
+        }
+
+    private:
+        static bool do_write(io_operation * op) noexcept;
+};
+
+struct accept_result
+{
+    async_fd        socket;
+    std::error_code error;
+};
+
+class accept_awaiter : private io_operation
+{
+    private:
+        async_fd &    listener_;
+        accept_result result_;
+
+    public:
+        explicit accept_awaiter(async_fd & listener) noexcept
+            : io_operation{&do_accept, {}}
+            , listener_(listener)
+        {}
+
+        ~accept_awaiter()
+        {
+            if(waiter && listener_){
+                listener_.context().unpark(listener_.get(), this);
+            }
+        }
+
+        bool await_ready() noexcept
+        {
+            return perform(this);
+        }
+
+        void await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            waiter = h;
+            listener_.context().park_reader(listener_.get(), this);
+        }
+
+        accept_result await_resume() noexcept
+        {
+            return std::move(result_);
+        }
+
+    private:
+        static bool do_accept(io_operation * op) noexcept;
+};
+
+// Read at least one byte (0 means end of file) and at most `size`.
+inline read_awaiter async_read(async_fd & fd, void * buffer, std::size_t size) noexcept
+{
+    return read_awaiter{fd, buffer, size};
+}
+
+// Write all `size` bytes, suspending as often as needed.
+inline write_awaiter async_write(async_fd & fd, const void * buffer, std::size_t size) noexcept
+{
+    return write_awaiter{fd, buffer, size};
+}
+
+// Accept one connection, the new socket is registered with the listener's reactor.
+inline accept_awaiter async_accept(async_fd & listener) noexcept
+{
+    return accept_awaiter{listener};
+}
+
+//////////////////////
+// Continuation of a spawned task, see thread_pool::detached_state
+
+template<typename T> struct reactor::detached_state : __coroutine_state
+{
+    reactor                   & r;
+    task<T>                     t;
+    typename task<T>::awaiter   awaiter;
+
+    detached_state(reactor & r, task<T> && t)
+        : r(r)
+        , t(std::move(t))
+        , awaiter(std::move(this->t).operator co_await())
+    {
+        this-> __resume = & resume;
+        this->__destroy = &destroy;
+        static_cast<void>(frame_info); // instantiates, and so registers, it
+    }
+
+    static __coroutine_state * resume(__coroutine_state * s) noexcept
+    {
+        auto * state = static_cast<detached_state *>(s);
+        reactor & r = state->r;
+
+        __release_running_frame();
+        delete state;
+        r.spawned_--;
+        return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+    }
+
+    static void destroy(__coroutine_state * s) noexcept
+    {
+        delete static_cast<detached_state *>(s);
+    }
+
+    // The bottom of a spawned task's async stack, see async_stack.hpp.
+    static inline const async_frame_info frame_info {"reactor::spawn", {}, &destroy, nullptr, nullptr, nullptr};
+
+    static void * operator new   (std::size_t size)                     { return __allocate_frame(size); }
+    static void   operator delete(void *ptr, std::size_t size) noexcept { __deallocate_frame(ptr, size); }
+};
+
+template<typename T> void reactor::spawn(task<T> t)
+{
+    auto * state = new detached_state<T>(*this, std::move(t));
+    spawned_++;
+
+    state->awaiter.await_suspend(std::coroutine_handle<>::from_address(state)).resume();
+}
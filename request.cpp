@@ -0,0 +1,178 @@
+#include "request.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of request(std::allocator_arg_t, std::pmr::memory_resource *resource, int n)
+//
+// task<int> request(std::allocator_arg_t, std::pmr::memory_resource *resource, int n) {
+//   int sum = 0;
+//   for(int i = 0; i < n; ++i) {
+//     sum += co_await chain(i);
+//   }
+//   co_return sum;
+// }
+//
+// The leading (std::allocator_arg, resource) parameters select the promise's
+// operator new(size, std::allocator_arg, resource, ...), so the ramp passes the
+// parameters to the new-expression, see "Frame allocation" in defs.hpp. The
+// chain(i) frames come from the same resource through __frame_resource_scope.
+
+/////
+// The "ramp" function
+
+task<int> request(std::allocator_arg_t alloc_tag, std::pmr::memory_resource *resource, int n)
+{
+    std::unique_ptr<__request_state> state(new (alloc_tag, resource, n) __request_state(static_cast<std::allocator_arg_t &&>(alloc_tag), static_cast<std::pmr::memory_resource *&&>(resource), static_cast<int &&>(n)));
+    return __ramp(std::move(state), &__request_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __request_cancellable = __cancellation_points<std::suspend_always, task<int>::awaiter, task<int>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__request_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__request_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __request_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  int sum = 0;
+        state->sum = 0;
+
+        //  for(int i = 0; i < n; ++i)
+        state->i = 0;
+
+loop_condition:
+        if(!(state->i < state->n)){
+            goto loop_end;
+        }
+
+        //  sum += co_await chain(i);
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return chain(state->i);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            state->__tmp3().construct_from([&]()
+            {
+                return static_cast<task<int> &&>(state->__tmp2().get()).operator co_await();
+            });
+            destructor_guard tmp3_dtor{state->__tmp3()};
+
+            if(!state->__tmp3().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp3().get().await_suspend(std::coroutine_handle<__request_promise_t>::from_promise(state->__promise));
+
+                tmp3_dtor.cancel();
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+
+            tmp3_dtor.cancel();
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        // The child was cancelled, see g.cpp.
+        if(state->__tmp3().get().cancelled()) [[unlikely]] {
+            return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+        }
+#ifdef CORO_NO_EXCEPTIONS
+        // The awaited task failed, see g.cpp.
+        if(std::error_code ec = state->__tmp3().get().error()) [[unlikely]] {
+            state->__tmp3().destroy();
+            state->__tmp2().destroy();
+            state->__promise.set_error(ec);
+            goto final_suspend;
+        }
+#endif
+        state->sum += [&]() -> decltype(auto)
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            destructor_guard tmp3_dtor{state->__tmp3()};
+            return state->__tmp3().get().await_resume();
+        }();
+
+        ++state->i;
+        goto loop_condition;
+
+loop_end:
+        //  co_return sum;
+        state->__promise.return_value(state->sum);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp4(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __request_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__request_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp3().destroy();
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp4().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __request_sites[] = {"initial suspend", "co_await chain(i)", "final suspend"};
+static const lowered_frame_info<__request_state> __request_frame_info{&__request_destroy, "request(std::allocator_arg, resource, n)", __request_sites};
@@ -0,0 +1,63 @@
+#pragma once
+#include "chain.hpp"
+//////////////////////
+// Coroutine-state of request(std::allocator_arg, resource, n), see request.cpp
+// for the lowering. Every frame of one request, its own and those of the
+// chains it awaits, comes from `resource` (bench/arena.cpp).
+
+task<int> request(std::allocator_arg_t, std::pmr::memory_resource *resource, int n);
+
+using __request_promise_t = std::coroutine_traits<task<int>, std::allocator_arg_t, std::pmr::memory_resource *, int>::promise_type;
+
+__coroutine_state * __request_resume (__coroutine_state *);
+void                __request_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definition
+
+struct __request_state : __coroutine_state_with_promise<__request_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    std::allocator_arg_t alloc_tag;
+    std::pmr::memory_resource *resource;
+    int n;
+
+    // Local variables that live across a suspend-point
+    int sum;
+    int i;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                       // initial suspend
+        frame_scope<manual_lifetime<task<int>>,                                  // sum += co_await chain(i);
+                    manual_lifetime<task<int>::awaiter>>,
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<1, 1>(); }
+    auto & __tmp4() noexcept { return __frame.get<2, 0>(); }
+
+    __request_state(std::allocator_arg_t && alloc_tag, std::pmr::memory_resource *&& resource, int && n)
+        : alloc_tag(static_cast<std::allocator_arg_t &&>(alloc_tag))
+        , resource(static_cast<std::pmr::memory_resource *&&>(resource))
+        , n(static_cast<int &&>(n))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __request_resume;
+            this->__destroy = &__request_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __request_promise_t(construct_promise<__request_promise_t>(this->alloc_tag, this->resource, this->n));
+    }
+
+    ~__request_state()
+    {
+        this->__promise.~__request_promise_t();
+    }
+};
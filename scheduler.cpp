@@ -0,0 +1,174 @@
+#include <algorithm>
+#include <climits>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "scheduler.hpp"
+
+namespace
+{
+    static_assert(sizeof(std::atomic<std::uint32_t>) == sizeof(std::uint32_t));
+    static_assert(std::atomic<std::uint32_t>::is_always_lock_free);
+
+    void futex_wait(std::atomic<std::uint32_t> & word, std::uint32_t expected) noexcept
+    {
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAIT_PRIVATE, expected, nullptr, nullptr, 0);
+    }
+
+    void futex_wake(std::atomic<std::uint32_t> & word, int count) noexcept
+    {
+        ::syscall(SYS_futex, reinterpret_cast<std::uint32_t *>(&word), FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+    }
+}
+
+thread_pool::thread_pool(unsigned thread_count)
+{
+    thread_count = std::max(thread_count, 1u);
+
+    workers_.reserve(thread_count);
+    for(unsigned i = 0; i < thread_count; ++i){
+        workers_.push_back(std::make_unique<worker>());
+        workers_.back()->rng = 0x9e3779b97f4a7c15ull * (i + 1);
+    }
+
+    threads_.reserve(thread_count);
+    for(unsigned i = 0; i < thread_count; ++i){
+        threads_.emplace_back([this, i]
+        {
+            run(*workers_[i]);
+        });
+    }
+}
+
+thread_pool::~thread_pool()
+{
+    // Workers only exit once they find no more work, so everything that was
+    // enqueued before this point still runs to its next suspend point.
+    stop_.store(true, std::memory_order_seq_cst);
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    futex_wake(epoch_, INT_MAX);
+
+    for(auto & t: threads_){
+        t.join();
+    }
+}
+
+void thread_pool::enqueue(std::coroutine_handle<> h)
+{
+    if(current_pool_ == this){
+        current_worker_->deque.push(h.address());
+    }
+    else{
+        std::lock_guard<std::mutex> lock(inject_lock_);
+        inject_.push_back(h.address());
+        inject_empty_.store(false, std::memory_order_relaxed);
+    }
+
+    // Pairs with the fence after the sleepers_ increment in run(): either the
+    // parking worker sees the new work on its re-check, or we see it parking.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if(sleepers_.load(std::memory_order_relaxed) != 0){
+        wake_one();
+    }
+}
+
+void thread_pool::spawned_done() noexcept
+{
+    if(spawned_.fetch_sub(1, std::memory_order_acq_rel) == 1){
+        futex_wake(spawned_, INT_MAX);
+    }
+}
+
+void thread_pool::wait_idle() noexcept
+{
+    for(std::uint32_t n = spawned_.load(std::memory_order_acquire); n != 0; n = spawned_.load(std::memory_order_acquire)){
+        futex_wait(spawned_, n);
+    }
+}
+
+void thread_pool::run(worker & self)
+{
+    current_pool_   = this;
+    current_worker_ = &self;
+
+    void * h = nullptr;
+    while(true){
+        if(find_work(self, h)){
+            std::coroutine_handle<>::from_address(h).resume();
+            continue;
+        }
+
+        // Nothing to do: announce that we're about to sleep, look once more and
+        // then park on the epoch futex until an enqueue bumps it.
+        const std::uint32_t epoch = epoch_.load(std::memory_order_seq_cst);
+        sleepers_.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if(find_work(self, h)){
+            sleepers_.fetch_sub(1, std::memory_order_relaxed);
+            std::coroutine_handle<>::from_address(h).resume();
+            continue;
+        }
+
+        if(stop_.load(std::memory_order_seq_cst)){
+            sleepers_.fetch_sub(1, std::memory_order_relaxed);
+            break;
+        }
+
+        futex_wait(epoch_, epoch);
+        sleepers_.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    current_pool_   = nullptr;
+    current_worker_ = nullptr;
+}
+
+bool thread_pool::find_work(worker & self, void * & h)
+{
+    if(self.deque.pop(h) || pop_injected(h)){
+        return true;
+    }
+
+    const std::size_t n = workers_.size();
+    if(n == 1){
+        return false;
+    }
+
+    // xorshift64 to pick where to start looking, so thieves don't all pile
+    // onto the same victim.
+    self.rng ^= self.rng << 13;
+    self.rng ^= self.rng >> 7;
+    self.rng ^= self.rng << 17;
+
+    const std::size_t start = self.rng % n;
+    for(std::size_t i = 0; i < n; ++i){
+        worker & victim = *workers_[(start + i) % n];
+        if(&victim != &self && victim.deque.steal(h)){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool thread_pool::pop_injected(void * & h)
+{
+    if(inject_empty_.load(std::memory_order_relaxed)){
+        return false;
+    }
+
+    std::lock_guard<std::mutex> lock(inject_lock_);
+    if(inject_.empty()){
+        return false;
+    }
+
+    h = inject_.front();
+    inject_.pop_front();
+    inject_empty_.store(inject_.empty(), std::memory_order_relaxed);
+    return true;
+}
+
+void thread_pool::wake_one() noexcept
+{
+    epoch_.fetch_add(1, std::memory_order_seq_cst);
+    futex_wake(epoch_, 1);
+}
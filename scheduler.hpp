@@ -0,0 +1,301 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Work-stealing multi-threaded scheduler for coroutines
+//
+// Each worker thread owns a Chase-Lev deque of suspended coroutines. A worker
+// pushes and pops at the bottom of its own deque, idle workers steal from the
+// top of the others. Coroutines enqueued from outside the pool go through a
+// shared injection queue. Workers with nothing to run park on a futex and are
+// woken by the next enqueue.
+//
+// A coroutine moves onto the pool with
+//
+//   co_await pool.schedule();
+//
+// and a task is started detached (its result is discarded and its frame is
+// destroyed when it completes) with
+//
+//   pool.spawn(g(x));
+
+#include<atomic>
+#include<cstdint>
+#include<deque>
+#include<memory>
+#include<mutex>
+#include<thread>
+#include<vector>
+#include "async_stack.hpp"
+
+//////////////////////
+// Chase-Lev work-stealing deque
+//
+// "Correct and Efficient Work-Stealing for Weak Memory Models", Lê et al. 2013.
+// push() and pop() may only be called by the owning thread, steal() by any thread.
+// The ring grows on demand, retired rings are kept until the deque is destroyed
+// because a concurrent steal() may still be reading from them.
+
+template<typename T> class work_stealing_deque
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    private:
+        struct ring
+        {
+            std::int64_t            mask;
+            std::unique_ptr<ring>   prev;
+            std::unique_ptr<std::atomic<T>[]> slots;
+
+            explicit ring(std::int64_t capacity)
+                : mask(capacity - 1)
+                , slots(new std::atomic<T>[capacity])
+            {}
+
+            std::int64_t capacity() const noexcept
+            {
+                return mask + 1;
+            }
+
+            T get(std::int64_t i) const noexcept
+            {
+                return slots[i & mask].load(std::memory_order_relaxed);
+            }
+
+            void put(std::int64_t i, T x) noexcept
+            {
+                slots[i & mask].store(x, std::memory_order_relaxed);
+            }
+        };
+
+    private:
+        alignas(64) std::atomic<std::int64_t> top_    {0};
+        alignas(64) std::atomic<std::int64_t> bottom_ {0};
+        alignas(64) std::atomic<ring *>       ring_;
+
+        std::unique_ptr<ring> owned_;
+
+    public:
+        explicit work_stealing_deque(std::int64_t capacity = 256)
+            : owned_(std::make_unique<ring>(capacity))
+        {
+            ring_.store(owned_.get(), std::memory_order_relaxed);
+        }
+
+        work_stealing_deque            (const work_stealing_deque &) = delete;
+        work_stealing_deque & operator=(const work_stealing_deque &) = delete;
+
+    public:
+        void push(T x)
+        {
+            const std::int64_t b = bottom_.load(std::memory_order_relaxed);
+            const std::int64_t t = top_.load(std::memory_order_acquire);
+            ring * r = ring_.load(std::memory_order_relaxed);
+
+            if(b - t > r->capacity() - 1){
+                r = grow(r, t, b);
+            }
+
+            r->put(b, x);
+            bottom_.store(b + 1, std::memory_order_release);
+        }
+
+        bool pop(T & x) noexcept
+        {
+            const std::int64_t b = bottom_.load(std::memory_order_relaxed) - 1;
+            ring * r = ring_.load(std::memory_order_relaxed);
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            std::int64_t t = top_.load(std::memory_order_relaxed);
+
+            if(t > b){
+                // Empty, restore bottom.
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            x = r->get(b);
+            if(t == b){
+                // Last element, race against thieves for it.
+                const bool won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+            return true;
+        }
+
+        bool steal(T & x) noexcept
+        {
+            std::int64_t t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const std::int64_t b = bottom_.load(std::memory_order_acquire);
+
+            if(t >= b){
+                return false;
+            }
+
+            ring * r = ring_.load(std::memory_order_acquire);
+            x = r->get(t);
+            return top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        bool empty() const noexcept
+        {
+            return bottom_.load(std::memory_order_relaxed) <= top_.load(std::memory_order_relaxed);
+        }
+
+    private:
+        ring * grow(ring * r, std::int64_t t, std::int64_t b)
+        {
+            auto bigger = std::make_unique<ring>(r->capacity() * 2);
+            for(std::int64_t i = t; i < b; ++i){
+                bigger->put(i, r->get(i));
+            }
+
+            bigger->prev = std::move(owned_);
+            owned_ = std::move(bigger);
+
+            ring_.store(owned_.get(), std::memory_order_release);
+            return owned_.get();
+        }
+};
+
+//////////////////////
+// The thread pool
+
+class thread_pool
+{
+    private:
+        struct worker
+        {
+            work_stealing_deque<void *> deque;
+            std::uint64_t               rng;
+        };
+
+        template<typename T> struct detached_state;
+
+    private:
+        std::vector<std::unique_ptr<worker>> workers_;
+        std::vector<std::thread>             threads_;
+
+        std::mutex           inject_lock_;
+        std::deque<void *>   inject_;
+        std::atomic<bool>    inject_empty_ {true};
+
+        // Futex word the idle workers park on, bumped by every wake-up.
+        alignas(64) std::atomic<std::uint32_t> epoch_    {0};
+        alignas(64) std::atomic<std::uint32_t> sleepers_ {0};
+
+        // Number of spawned tasks that have not finished yet, see wait_idle().
+        alignas(64) std::atomic<std::uint32_t> spawned_  {0};
+
+        std::atomic<bool> stop_ {false};
+
+        // The pool and worker the calling thread belongs to, if any.
+        static inline thread_local thread_pool * current_pool_   = nullptr;
+        static inline thread_local worker      * current_worker_ = nullptr;
+
+    public:
+        explicit thread_pool(unsigned thread_count = std::thread::hardware_concurrency());
+        ~thread_pool();
+
+        thread_pool            (const thread_pool &) = delete;
+        thread_pool & operator=(const thread_pool &) = delete;
+
+    public:
+        class schedule_awaiter
+        {
+            private:
+                thread_pool & pool_;
+
+            public:
+                explicit schedule_awaiter(thread_pool & pool) noexcept
+                    : pool_(pool)
+                {}
+
+                bool await_ready  ()                          noexcept { return false;     }
+                void await_suspend(std::coroutine_handle<> h)          { pool_.enqueue(h); }
+                void await_resume ()                          noexcept {}
+        };
+
+        // Awaitable that suspends the current coroutine and resumes it on a worker.
+        schedule_awaiter schedule() noexcept
+        {
+            return schedule_awaiter{*this};
+        }
+
+        // Make `h` runnable on the pool. From a worker thread of this pool the
+        // handle goes to the worker's own deque, otherwise to the injection queue.
+        void enqueue(std::coroutine_handle<> h);
+
+        // Start `t` on the pool and forget about it, the frame is destroyed when it finishes.
+        template<typename T> void spawn(task<T> t);
+
+        // Block the calling (non-worker) thread until every spawned task has finished.
+        void wait_idle() noexcept;
+
+        unsigned thread_count() const noexcept
+        {
+            return static_cast<unsigned>(workers_.size());
+        }
+
+    private:
+        void spawned_done() noexcept;
+
+        void run(worker & self);
+        bool find_work(worker & self, void * & h);
+        bool pop_injected(void * & h);
+        void wake_one() noexcept;
+};
+
+//////////////////////
+// Continuation of a spawned task
+//
+// A hand-written coroutine-state, like __coroutine_state::__noop_coroutine, that
+// owns the spawned task and is installed as its continuation. When the task
+// reaches its final suspend point it transfers here and we destroy both frames.
+
+template<typename T> struct thread_pool::detached_state : __coroutine_state
+{
+    thread_pool               & pool;
+    task<T>                     t;
+    typename task<T>::awaiter   awaiter;
+
+    detached_state(thread_pool & pool, task<T> && t)
+        : pool(pool)
+        , t(std::move(t))
+        , awaiter(std::move(this->t).operator co_await())
+    {
+        this-> __resume = & resume;
+        this->__destroy = &destroy;
+        static_cast<void>(frame_info); // instantiates, and so registers, it
+    }
+
+    static __coroutine_state * resume(__coroutine_state * s) noexcept
+    {
+        auto * state = static_cast<detached_state *>(s);
+        thread_pool & pool = state->pool;
+
+        __release_running_frame();
+        delete state;
+        pool.spawned_done();
+        return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+    }
+
+    static void destroy(__coroutine_state * s) noexcept
+    {
+        delete static_cast<detached_state *>(s);
+    }
+
+    // The bottom of a spawned task's async stack, see async_stack.hpp.
+    static inline const async_frame_info frame_info {"thread_pool::spawn", {}, &destroy, nullptr, nullptr, nullptr};
+
+    static void * operator new   (std::size_t size)                     { return __allocate_frame(size); }
+    static void   operator delete(void *ptr, std::size_t size) noexcept { __deallocate_frame(ptr, size); }
+};
+
+template<typename T> void thread_pool::spawn(task<T> t)
+{
+    auto * state = new detached_state<T>(*this, std::move(t));
+    spawned_.fetch_add(1, std::memory_order_relaxed);
+
+    enqueue(state->awaiter.await_suspend(std::coroutine_handle<>::from_address(state)));
+}
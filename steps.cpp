@@ -0,0 +1,565 @@
+#include "steps.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of steps(int x, std::coroutine_handle<> *slot)
+//
+// task<int> steps(int x, std::coroutine_handle<> *slot) {
+//   x = x * 3 + 1;     co_await park{slot};
+//   x ^= x >> 2;       co_await park{slot};
+//   x += 3;            co_await park{slot};
+//   x = x * 5 - 4;     co_await park{slot};
+//   x = x * 3 + 5;     co_await park{slot};
+//   x ^= x >> 6;       co_await park{slot};
+//   x += 7;            co_await park{slot};
+//   x = x * 5 - 8;     co_await park{slot};
+//   x = x * 3 + 9;     co_await park{slot};
+//   x ^= x >> 10;      co_await park{slot};
+//   x += 11;           co_await park{slot};
+//   x = x * 5 - 12;    co_await park{slot};
+//   x = x * 3 + 13;    co_await park{slot};
+//   x ^= x >> 14;      co_await park{slot};
+//   x += 15;           co_await park{slot};
+//   x = x * 5 - 16;    co_await park{slot};
+//   co_return x;
+// }
+//
+// A coroutine with 16 suspend-points (plus the initial and final ones), lowered
+// like f and g: every resume re-dispatches on __suspend_point through a switch.
+// steps_direct.cpp is the same coroutine lowered with one resume function per
+// suspend-point instead. Neither has a cancellation point, see "Cancellation" in
+// defs.hpp.
+
+/////
+// The "ramp" function
+
+task<int> steps(int x, std::coroutine_handle<> *slot)
+{
+    std::unique_ptr<__steps_state> state(new __steps_state(static_cast<int &&>(x), static_cast<std::coroutine_handle<> *&&>(slot)));
+    return __ramp(std::move(state), &__steps_resume);
+}
+
+/////
+//  The "resume" function
+
+__coroutine_state *__steps_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__steps_state *>(s);
+    __resume_scope resume_scope(state);
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            case 2: goto suspend_point_2;
+            case 3: goto suspend_point_3;
+            case 4: goto suspend_point_4;
+            case 5: goto suspend_point_5;
+            case 6: goto suspend_point_6;
+            case 7: goto suspend_point_7;
+            case 8: goto suspend_point_8;
+            case 9: goto suspend_point_9;
+            case 10: goto suspend_point_10;
+            case 11: goto suspend_point_11;
+            case 12: goto suspend_point_12;
+            case 13: goto suspend_point_13;
+            case 14: goto suspend_point_14;
+            case 15: goto suspend_point_15;
+            case 16: goto suspend_point_16;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  x = x * 3 + 1; co_await park{slot};
+        state->x = state->x * 3 + 1;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x ^= x >> 2; co_await park{slot};
+        state->x ^= state->x >> 2;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 2;
+                CORO_TRACE_EVENT(suspend, state, 2);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_2:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x += 3; co_await park{slot};
+        state->x += 3;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 3;
+                CORO_TRACE_EVENT(suspend, state, 3);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_3:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 5 - 4; co_await park{slot};
+        state->x = state->x * 5 - 4;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 4;
+                CORO_TRACE_EVENT(suspend, state, 4);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_4:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 3 + 5; co_await park{slot};
+        state->x = state->x * 3 + 5;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 5;
+                CORO_TRACE_EVENT(suspend, state, 5);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_5:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x ^= x >> 6; co_await park{slot};
+        state->x ^= state->x >> 6;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 6;
+                CORO_TRACE_EVENT(suspend, state, 6);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_6:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x += 7; co_await park{slot};
+        state->x += 7;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 7;
+                CORO_TRACE_EVENT(suspend, state, 7);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_7:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 5 - 8; co_await park{slot};
+        state->x = state->x * 5 - 8;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 8;
+                CORO_TRACE_EVENT(suspend, state, 8);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_8:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 3 + 9; co_await park{slot};
+        state->x = state->x * 3 + 9;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 9;
+                CORO_TRACE_EVENT(suspend, state, 9);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_9:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x ^= x >> 10; co_await park{slot};
+        state->x ^= state->x >> 10;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 10;
+                CORO_TRACE_EVENT(suspend, state, 10);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_10:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x += 11; co_await park{slot};
+        state->x += 11;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 11;
+                CORO_TRACE_EVENT(suspend, state, 11);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_11:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 5 - 12; co_await park{slot};
+        state->x = state->x * 5 - 12;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 12;
+                CORO_TRACE_EVENT(suspend, state, 12);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_12:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 3 + 13; co_await park{slot};
+        state->x = state->x * 3 + 13;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 13;
+                CORO_TRACE_EVENT(suspend, state, 13);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_13:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x ^= x >> 14; co_await park{slot};
+        state->x ^= state->x >> 14;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 14;
+                CORO_TRACE_EVENT(suspend, state, 14);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_14:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x += 15; co_await park{slot};
+        state->x += 15;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 15;
+                CORO_TRACE_EVENT(suspend, state, 15);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_15:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 5 - 16; co_await park{slot};
+        state->x = state->x * 5 - 16;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state->__suspend_point = 16;
+                CORO_TRACE_EVENT(suspend, state, 16);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_16:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  co_return x;
+        state->__promise.return_value(state->x);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp3(), 17);
+}
+
+/////
+// The "destroy" function
+
+void __steps_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__steps_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: case 2: case 3: case 4:
+        case 5: case 6: case 7: case 8:
+        case 9: case 10: case 11: case 12:
+        case 13: case 14: case 15: case 16: goto suspend_point_1_to_16;
+        case 17: goto suspend_point_17;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1_to_16:
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_17:
+    state->__tmp3().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static const lowered_frame_info<__steps_state> __steps_frame_info{&__steps_destroy, "steps(x, slot)", __steps_sites};
@@ -0,0 +1,89 @@
+#pragma once
+#include "defs.hpp"
+//////////////////////
+// Coroutine-state of steps(int x, std::coroutine_handle<> *slot), see steps.cpp for the lowering.
+
+// Awaitable used at every suspend-point of steps(): stores the awaiting coroutine
+// in `*slot` and returns to whoever resumed it, so that a driver can keep many of
+// these coroutines suspended at different points and resume them in any order.
+struct park
+{
+    std::coroutine_handle<> *slot;
+
+    bool await_ready  ()                          noexcept { return false; }
+    void await_suspend(std::coroutine_handle<> h) noexcept { *slot = h;    }
+    void await_resume ()                          noexcept {}
+};
+
+task<int> steps(int x, std::coroutine_handle<> *slot);
+
+using __steps_promise_t = std::coroutine_traits<task<int>, int, std::coroutine_handle<> *>::promise_type;
+
+__coroutine_state * __steps_resume (__coroutine_state *);
+void                __steps_destroy(__coroutine_state *);
+
+// Names of the suspend-points for async stack traces (async_stack.hpp), shared
+// with steps_direct(): the same coroutine, lowered differently.
+inline constexpr const char * __steps_sites[] = {
+    "initial suspend",
+    "x = x * 3 + 1; co_await park{slot}",
+    "x ^= x >> 2; co_await park{slot}",
+    "x += 3; co_await park{slot}",
+    "x = x * 5 - 4; co_await park{slot}",
+    "x = x * 3 + 5; co_await park{slot}",
+    "x ^= x >> 6; co_await park{slot}",
+    "x += 7; co_await park{slot}",
+    "x = x * 5 - 8; co_await park{slot}",
+    "x = x * 3 + 9; co_await park{slot}",
+    "x ^= x >> 10; co_await park{slot}",
+    "x += 11; co_await park{slot}",
+    "x = x * 5 - 12; co_await park{slot}",
+    "x = x * 3 + 13; co_await park{slot}",
+    "x ^= x >> 14; co_await park{slot}",
+    "x += 15; co_await park{slot}",
+    "x = x * 5 - 16; co_await park{slot}",
+    "final suspend",
+};
+
+/////
+// The coroutine-state definition
+
+struct __steps_state : __coroutine_state_with_promise<__steps_promise_t>
+{
+    __suspend_index_t<18> __suspend_point = 0;
+
+    // Argument copies
+    int x;
+    std::coroutine_handle<> *slot;
+
+    // Temporaries, overlapped per scope by frame_storage. The park temporaries
+    // of the 16 co_await expressions never overlap, so they share scope 1.
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                          // initial suspend
+        frame_scope<manual_lifetime<park>>,                                         // co_await park{slot}; x 16
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;      // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __steps_state(int && x, std::coroutine_handle<> *&& slot)
+        : x(static_cast<int &&>(x))
+        , slot(static_cast<std::coroutine_handle<> *&&>(slot))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __steps_resume;
+            this->__destroy = &__steps_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __steps_promise_t(construct_promise<__steps_promise_t>(this->x, this->slot));
+    }
+
+    ~__steps_state()
+    {
+        this->__promise.~__steps_promise_t();
+    }
+};
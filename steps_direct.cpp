@@ -0,0 +1,741 @@
+#include "steps_direct.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of steps_direct(int x, std::coroutine_handle<> *slot)
+//
+// task<int> steps_direct(int x, std::coroutine_handle<> *slot) {
+//   x = x * 3 + 1;     co_await park{slot};
+//   x ^= x >> 2;       co_await park{slot};
+//   x += 3;            co_await park{slot};
+//   x = x * 5 - 4;     co_await park{slot};
+//   x = x * 3 + 5;     co_await park{slot};
+//   x ^= x >> 6;       co_await park{slot};
+//   x += 7;            co_await park{slot};
+//   x = x * 5 - 8;     co_await park{slot};
+//   x = x * 3 + 9;     co_await park{slot};
+//   x ^= x >> 10;      co_await park{slot};
+//   x += 11;           co_await park{slot};
+//   x = x * 5 - 12;    co_await park{slot};
+//   x = x * 3 + 13;    co_await park{slot};
+//   x ^= x >> 14;      co_await park{slot};
+//   x += 15;           co_await park{slot};
+//   x = x * 5 - 16;    co_await park{slot};
+//   co_return x;
+// }
+//
+// The same coroutine as steps.cpp, lowered without the __suspend_point switch.
+// Every suspend-point N gets its own entry points __steps_direct_resume_N and
+// __steps_direct_destroy_N, which are stored into the frame's __resume and
+// __destroy when suspending there. coroutine_handle::resume() then jumps straight
+// to the code following the suspend-point with a single indirect call, and
+// destroy() straight to the cleanup of the temporaries live at that point. The
+// resume functions are one body instantiated per entry label, see below.
+
+/////
+// The "ramp" function
+
+task<int> steps_direct(int x, std::coroutine_handle<> *slot)
+{
+    std::unique_ptr<__steps_direct_state> state(new __steps_direct_state(static_cast<int &&>(x), static_cast<std::coroutine_handle<> *&&>(slot)));
+    return __ramp(std::move(state), &__steps_direct_resume_0);
+}
+
+/////
+// The final suspend-point, shared by every resume function
+
+static __coroutine_state *__steps_direct_final_suspend(__steps_direct_state *state)
+{
+    // co_await promise.final_suspend
+    {
+        state->__tmp3().construct_from([&]() noexcept
+        {
+            return state->__promise.final_suspend();
+        });
+        destructor_guard tmp3_dtor{state->__tmp3()};
+
+        if(!state->__tmp3().get().await_ready()){
+            state->__destroy = &__steps_direct_destroy_17;
+            state->__resume = nullptr; // mark as final suspend-point
+            CORO_TRACE_EVENT(final_suspend, state, 17);
+            __release_running_frame();
+
+            auto h = state->__tmp3().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+            tmp3_dtor.cancel();
+            return static_cast<__coroutine_state *>(h.address());
+        }
+        state->__tmp3().get().await_resume();
+    }
+
+    //  Destroy coroutine-state if execution flows off end of coroutine
+    CORO_TRACE_EVENT(destroy, state, 17);
+    __release_running_frame();
+    delete state;
+
+    return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+}
+
+/////
+// The body, shared by every resume function
+//
+// __steps_direct_resume_N is this inlined with From = N: the switch folds into
+// a direct jump to suspend_point_N, and the code before it is dropped. A
+// co_await that doesn't suspend carries on to the next label in the same call,
+// so a resume has one trace event, one resource scope and one try block however
+// many suspend-points it passes, and never nests a call.
+
+template<int From>
+[[gnu::always_inline]] static inline __coroutine_state *__steps_direct_body(__steps_direct_state *state)
+{
+    CORO_TRACE_EVENT(resume, state, From);
+
+    // Ramps called from here allocate from our memory resource, see "Frame allocation" in defs.hpp.
+    __frame_resource_scope resource_scope(state->__promise);
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(From){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            case 2: goto suspend_point_2;
+            case 3: goto suspend_point_3;
+            case 4: goto suspend_point_4;
+            case 5: goto suspend_point_5;
+            case 6: goto suspend_point_6;
+            case 7: goto suspend_point_7;
+            case 8: goto suspend_point_8;
+            case 9: goto suspend_point_9;
+            case 10: goto suspend_point_10;
+            case 11: goto suspend_point_11;
+            case 12: goto suspend_point_12;
+            case 13: goto suspend_point_13;
+            case 14: goto suspend_point_14;
+            case 15: goto suspend_point_15;
+            case 16: goto suspend_point_16;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  x = x * 3 + 1; co_await park{slot};
+        state->x = state->x * 3 + 1;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_1;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x ^= x >> 2; co_await park{slot};
+        state->x ^= state->x >> 2;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_2;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 2);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_2:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x += 3; co_await park{slot};
+        state->x += 3;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_3;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 3);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_3:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 5 - 4; co_await park{slot};
+        state->x = state->x * 5 - 4;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_4;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 4);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_4:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 3 + 5; co_await park{slot};
+        state->x = state->x * 3 + 5;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_5;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 5);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_5:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x ^= x >> 6; co_await park{slot};
+        state->x ^= state->x >> 6;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_6;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 6);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_6:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x += 7; co_await park{slot};
+        state->x += 7;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_7;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 7);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_7:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 5 - 8; co_await park{slot};
+        state->x = state->x * 5 - 8;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_8;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 8);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_8:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 3 + 9; co_await park{slot};
+        state->x = state->x * 3 + 9;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_9;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 9);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_9:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x ^= x >> 10; co_await park{slot};
+        state->x ^= state->x >> 10;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_10;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 10);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_10:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x += 11; co_await park{slot};
+        state->x += 11;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_11;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 11);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_11:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 5 - 12; co_await park{slot};
+        state->x = state->x * 5 - 12;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_12;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 12);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_12:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 3 + 13; co_await park{slot};
+        state->x = state->x * 3 + 13;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_13;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 13);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_13:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x ^= x >> 14; co_await park{slot};
+        state->x ^= state->x >> 14;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_14;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 14);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_14:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x += 15; co_await park{slot};
+        state->x += 15;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_15;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 15);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_15:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  x = x * 5 - 16; co_await park{slot};
+        state->x = state->x * 5 - 16;
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return park{state->slot};
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            if(!state->__tmp2().get().await_ready()){
+                state-> __resume = & __steps_direct_resume_16;
+                state->__destroy = &__steps_direct_destroy_1_to_16;
+                CORO_TRACE_EVENT(suspend, state, 16);
+                __release_running_frame();
+                state->__tmp2().get().await_suspend(std::coroutine_handle<__steps_direct_promise_t>::from_promise(state->__promise));
+
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_16:
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            state->__tmp2().get().await_resume();
+        }
+
+        //  co_return x;
+        state->__promise.return_value(state->x);
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+    }
+#endif
+    return __steps_direct_final_suspend(state);
+}
+
+/////
+//  The resume functions, one per suspend-point
+
+__coroutine_state *__steps_direct_resume_0(__coroutine_state *s)
+{
+    return __steps_direct_body<0>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_1(__coroutine_state *s)
+{
+    return __steps_direct_body<1>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_2(__coroutine_state *s)
+{
+    return __steps_direct_body<2>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_3(__coroutine_state *s)
+{
+    return __steps_direct_body<3>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_4(__coroutine_state *s)
+{
+    return __steps_direct_body<4>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_5(__coroutine_state *s)
+{
+    return __steps_direct_body<5>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_6(__coroutine_state *s)
+{
+    return __steps_direct_body<6>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_7(__coroutine_state *s)
+{
+    return __steps_direct_body<7>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_8(__coroutine_state *s)
+{
+    return __steps_direct_body<8>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_9(__coroutine_state *s)
+{
+    return __steps_direct_body<9>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_10(__coroutine_state *s)
+{
+    return __steps_direct_body<10>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_11(__coroutine_state *s)
+{
+    return __steps_direct_body<11>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_12(__coroutine_state *s)
+{
+    return __steps_direct_body<12>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_13(__coroutine_state *s)
+{
+    return __steps_direct_body<13>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_14(__coroutine_state *s)
+{
+    return __steps_direct_body<14>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_15(__coroutine_state *s)
+{
+    return __steps_direct_body<15>(static_cast<__steps_direct_state *>(s));
+}
+
+__coroutine_state *__steps_direct_resume_16(__coroutine_state *s)
+{
+    return __steps_direct_body<16>(static_cast<__steps_direct_state *>(s));
+}
+
+/////
+// The "destroy" functions
+
+void __steps_direct_destroy_0(__coroutine_state *s)
+{
+    auto *state = static_cast<__steps_direct_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, 0);
+    state->__tmp1().destroy();
+    delete state;
+}
+
+// Suspend-points 1 to 16 all have the same live temporaries.
+void __steps_direct_destroy_1_to_16(__coroutine_state *s)
+{
+    auto *state = static_cast<__steps_direct_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, 1); // which of 1 to 16 isn't stored
+    state->__tmp2().destroy();
+    delete state;
+}
+
+void __steps_direct_destroy_17(__coroutine_state *s)
+{
+    auto *state = static_cast<__steps_direct_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, 17);
+    state->__tmp3().destroy();
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+//
+// There's no __suspend_point to read, so the suspend-point is looked up from
+// __resume, which is cleared at the final one. Each of the three destroy
+// functions identifies the coroutine.
+
+static std::uint32_t __steps_direct_suspend_point(const __coroutine_state *s) noexcept
+{
+    static constexpr __coroutine_state::__resume_fn *resume_fns[] = {
+    &__steps_direct_resume_0,
+    &__steps_direct_resume_1,
+    &__steps_direct_resume_2,
+    &__steps_direct_resume_3,
+    &__steps_direct_resume_4,
+    &__steps_direct_resume_5,
+    &__steps_direct_resume_6,
+    &__steps_direct_resume_7,
+    &__steps_direct_resume_8,
+    &__steps_direct_resume_9,
+    &__steps_direct_resume_10,
+    &__steps_direct_resume_11,
+    &__steps_direct_resume_12,
+    &__steps_direct_resume_13,
+    &__steps_direct_resume_14,
+    &__steps_direct_resume_15,
+    &__steps_direct_resume_16,
+    };
+
+    for(std::uint32_t i = 0; i < std::size(resume_fns); ++i){
+        if(s->__resume == resume_fns[i]){
+            return i;
+        }
+    }
+    return 17;
+}
+
+static const lowered_frame_info<__steps_direct_state> __steps_direct_frame_info_0       {&__steps_direct_destroy_0,       "steps_direct(x, slot)", __steps_sites, &__steps_direct_suspend_point};
+static const lowered_frame_info<__steps_direct_state> __steps_direct_frame_info_1_to_16 {&__steps_direct_destroy_1_to_16, "steps_direct(x, slot)", __steps_sites, &__steps_direct_suspend_point};
+static const lowered_frame_info<__steps_direct_state> __steps_direct_frame_info_17      {&__steps_direct_destroy_17,      "steps_direct(x, slot)", __steps_sites, &__steps_direct_suspend_point};
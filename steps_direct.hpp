@@ -0,0 +1,77 @@
+#pragma once
+#include "steps.hpp"
+//////////////////////
+// Coroutine-state of steps_direct(int x, std::coroutine_handle<> *slot),
+// see steps_direct.cpp for the lowering.
+
+task<int> steps_direct(int x, std::coroutine_handle<> *slot);
+
+using __steps_direct_promise_t = std::coroutine_traits<task<int>, int, std::coroutine_handle<> *>::promise_type;
+
+// One resume entry point per suspend-point...
+__coroutine_state * __steps_direct_resume_0 (__coroutine_state *);
+__coroutine_state * __steps_direct_resume_1 (__coroutine_state *);
+__coroutine_state * __steps_direct_resume_2 (__coroutine_state *);
+__coroutine_state * __steps_direct_resume_3 (__coroutine_state *);
+__coroutine_state * __steps_direct_resume_4 (__coroutine_state *);
+__coroutine_state * __steps_direct_resume_5 (__coroutine_state *);
+__coroutine_state * __steps_direct_resume_6 (__coroutine_state *);
+__coroutine_state * __steps_direct_resume_7 (__coroutine_state *);
+__coroutine_state * __steps_direct_resume_8 (__coroutine_state *);
+__coroutine_state * __steps_direct_resume_9 (__coroutine_state *);
+__coroutine_state * __steps_direct_resume_10(__coroutine_state *);
+__coroutine_state * __steps_direct_resume_11(__coroutine_state *);
+__coroutine_state * __steps_direct_resume_12(__coroutine_state *);
+__coroutine_state * __steps_direct_resume_13(__coroutine_state *);
+__coroutine_state * __steps_direct_resume_14(__coroutine_state *);
+__coroutine_state * __steps_direct_resume_15(__coroutine_state *);
+__coroutine_state * __steps_direct_resume_16(__coroutine_state *);
+
+// ...and one destroy entry point per set of temporaries live at a suspend-point.
+void __steps_direct_destroy_0      (__coroutine_state *);
+void __steps_direct_destroy_1_to_16(__coroutine_state *);
+void __steps_direct_destroy_17     (__coroutine_state *);
+
+/////
+// The coroutine-state definition
+//
+// There's no __suspend_point: the current suspend-point is implied by which
+// function __resume and __destroy point to.
+
+struct __steps_direct_state : __coroutine_state_with_promise<__steps_direct_promise_t>
+{
+    // Argument copies
+    int x;
+    std::coroutine_handle<> *slot;
+
+    // Temporaries, overlapped per scope by frame_storage. The park temporaries
+    // of the 16 co_await expressions never overlap, so they share scope 1.
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                          // initial suspend
+        frame_scope<manual_lifetime<park>>,                                         // co_await park{slot}; x 16
+        frame_scope<manual_lifetime<task<int>::promise_type::final_awaiter>>>;      // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<2, 0>(); }
+
+    __steps_direct_state(int && x, std::coroutine_handle<> *&& slot)
+        : x(static_cast<int &&>(x))
+        , slot(static_cast<std::coroutine_handle<> *&&>(slot))
+    {
+            // Initialise the function-pointers for the initial suspend-point.
+            this-> __resume = & __steps_direct_resume_0;
+            this->__destroy = &__steps_direct_destroy_0;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __steps_direct_promise_t(construct_promise<__steps_direct_promise_t>(this->x, this->slot));
+    }
+
+    ~__steps_direct_state()
+    {
+        this->__promise.~__steps_direct_promise_t();
+    }
+};
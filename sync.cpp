@@ -0,0 +1,210 @@
+#include "sync.hpp"
+
+//////////////////////
+// async_mutex
+
+bool async_mutex::lock_awaiter::await_suspend(std::coroutine_handle<> h) noexcept
+{
+    coro_ = h;
+
+    std::uintptr_t old = mutex_.state_.load(std::memory_order_relaxed);
+    for(;;){
+        if(old == not_locked){
+            if(mutex_.state_.compare_exchange_weak(old, locked_no_waiters, std::memory_order_acquire, std::memory_order_relaxed)){
+                return false;
+            }
+        }
+        else{
+            next_ = reinterpret_cast<lock_awaiter *>(old);
+            if(mutex_.state_.compare_exchange_weak(old, reinterpret_cast<std::uintptr_t>(this), std::memory_order_release, std::memory_order_relaxed)){
+                return true;
+            }
+        }
+    }
+}
+
+std::coroutine_handle<> async_mutex::unlock() noexcept
+{
+    lock_awaiter * next = waiters_;
+    if(next == nullptr){
+        std::uintptr_t old = locked_no_waiters;
+        if(state_.compare_exchange_strong(old, not_locked, std::memory_order_release, std::memory_order_relaxed)){
+            return std::noop_coroutine();
+        }
+
+        // Take every waiter queued since, newest first, and reverse them.
+        old = state_.exchange(locked_no_waiters, std::memory_order_acquire);
+        for(auto * w = reinterpret_cast<lock_awaiter *>(old); w != nullptr;){
+            lock_awaiter * following = w->next_;
+            w->next_ = next;
+            next = w;
+            w = following;
+        }
+    }
+
+    // The lock stays held and passes to `next`.
+    waiters_ = next->next_;
+    return next->coro_;
+}
+
+//////////////////////
+// async_semaphore
+
+bool async_semaphore::try_acquire() noexcept
+{
+    std::uintptr_t old = state_.load(std::memory_order_relaxed);
+    while(old & 1){
+        if(state_.compare_exchange_weak(old, permits((old >> 1) - 1), std::memory_order_acquire, std::memory_order_relaxed)){
+            return true;
+        }
+    }
+    return false;
+}
+
+bool async_semaphore::acquire_awaiter::await_suspend(std::coroutine_handle<> h) noexcept
+{
+    coro_ = h;
+
+    std::uintptr_t old = semaphore_.state_.load(std::memory_order_relaxed);
+    for(;;){
+        if(old & 1){
+            if(semaphore_.state_.compare_exchange_weak(old, permits((old >> 1) - 1), std::memory_order_acquire, std::memory_order_relaxed)){
+                return false;
+            }
+        }
+        else{
+            next_ = reinterpret_cast<acquire_awaiter *>(old);
+            if(semaphore_.state_.compare_exchange_weak(old, reinterpret_cast<std::uintptr_t>(this), std::memory_order_release, std::memory_order_relaxed)){
+                return true;
+            }
+        }
+    }
+}
+
+// Unlinks and returns the oldest (last) waiter of a non-empty newest-first list.
+async_semaphore::acquire_awaiter * async_semaphore::pop_oldest(acquire_awaiter * & list) noexcept
+{
+    acquire_awaiter ** link = &list;
+    while((*link)->next_ != nullptr){
+        link = &(*link)->next_;
+    }
+    acquire_awaiter * oldest = *link;
+    *link = nullptr;
+    return oldest;
+}
+
+async_semaphore::woken async_semaphore::release() noexcept
+{
+    std::uintptr_t old = state_.load(std::memory_order_relaxed);
+    for(;;){
+        if(old == 0 || (old & 1)){
+            if(state_.compare_exchange_weak(old, permits((old >> 1) + 1), std::memory_order_release, std::memory_order_relaxed)){
+                return woken{nullptr};
+            }
+        }
+        else if(state_.compare_exchange_weak(old, 0, std::memory_order_acquire, std::memory_order_relaxed)){
+            break;
+        }
+    }
+
+    // We own every waiter that was queued: the oldest gets the permit, the
+    // others go back.
+    auto * waiters = reinterpret_cast<acquire_awaiter *>(old);
+    acquire_awaiter * oldest = pop_oldest(waiters);
+    oldest->next_ = requeue(waiters);
+    return woken{oldest};
+}
+
+handoff_awaiter async_semaphore::release(thread_pool & pool)
+{
+    woken w = release();
+    if(w.empty()){
+        return handoff_awaiter{pool, std::noop_coroutine()};
+    }
+
+    std::coroutine_handle<> next = w.pop();
+    while(!w.empty()){
+        pool.enqueue(w.pop());
+    }
+    return handoff_awaiter{pool, next};
+}
+
+// Puts waiters taken off state_ back underneath any that queued since. Permits
+// released in the meantime go to the oldest of them, which are returned oldest
+// first, linked through next_, for the caller to schedule.
+async_semaphore::acquire_awaiter * async_semaphore::requeue(acquire_awaiter * waiters) noexcept
+{
+    acquire_awaiter *  owners = nullptr;
+    acquire_awaiter ** owners_tail = &owners;
+
+    std::uintptr_t old = state_.load(std::memory_order_relaxed);
+    while(waiters != nullptr){
+        if(old & 1){
+            if(state_.compare_exchange_weak(old, permits((old >> 1) - 1), std::memory_order_acquire, std::memory_order_relaxed)){
+                acquire_awaiter * w = pop_oldest(waiters);
+                *owners_tail = w;
+                owners_tail = &w->next_;
+                old = state_.load(std::memory_order_relaxed);
+            }
+        }
+        else if(old == 0){
+            if(state_.compare_exchange_weak(old, reinterpret_cast<std::uintptr_t>(waiters), std::memory_order_release, std::memory_order_relaxed)){
+                break;
+            }
+        }
+        else if(state_.compare_exchange_weak(old, 0, std::memory_order_acquire, std::memory_order_relaxed)){
+            // Newer waiters arrived, take them too and put ours below them.
+            auto * newer = reinterpret_cast<acquire_awaiter *>(old);
+            acquire_awaiter * last = newer;
+            while(last->next_ != nullptr){
+                last = last->next_;
+            }
+            last->next_ = waiters;
+            waiters = newer;
+            old = 0;
+        }
+    }
+    return owners;
+}
+
+//////////////////////
+// async_event
+
+bool async_event::wait_awaiter::await_suspend(std::coroutine_handle<> h) noexcept
+{
+    coro_ = h;
+
+    std::uintptr_t old = event_.state_.load(std::memory_order_acquire);
+    do{
+        if(old == is_set_){
+            return false;
+        }
+        next_ = reinterpret_cast<wait_awaiter *>(old);
+    }
+    while(!event_.state_.compare_exchange_weak(old, reinterpret_cast<std::uintptr_t>(this), std::memory_order_acq_rel, std::memory_order_acquire));
+    return true;
+}
+
+void async_event::set() noexcept
+{
+    const std::uintptr_t old = state_.exchange(is_set_, std::memory_order_acq_rel);
+    if(old == is_set_){
+        return;
+    }
+
+    // Reverse the newest-first list, then resume oldest first.
+    wait_awaiter * waiters = nullptr;
+    for(auto * w = reinterpret_cast<wait_awaiter *>(old); w != nullptr;){
+        wait_awaiter * following = w->next_;
+        w->next_ = waiters;
+        waiters = w;
+        w = following;
+    }
+
+    while(waiters != nullptr){
+        // The waiter's frame (and the node in it) may be gone once it resumed.
+        wait_awaiter * following = waiters->next_;
+        waiters->coro_.resume();
+        waiters = following;
+    }
+}
@@ -0,0 +1,347 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Coroutine synchronisation primitives: async_mutex, async_semaphore, async_event
+//
+// Waiting suspends the coroutine instead of blocking its thread. Each primitive
+// is a single atomic word that holds either its state or the newest waiter of
+// an intrusive list. The list nodes are the awaiters themselves, which are
+// temporaries of the co_await expression and so live in the waiting
+// coroutine's frame. Neither waiting nor waking allocates anything.
+//
+// Releasing the mutex or a permit of the semaphore hands it straight to the
+// oldest waiter. unlock() returns that waiter's handle, already the owner, for
+// the caller to resume or schedule (the noop coroutine if nobody was waiting).
+// Inside a coroutine, `co_await m.unlock(pool)` does the handoff by symmetric
+// transfer, the way final_awaiter::await_suspend() hands over to the
+// continuation: the thread carries on with the new owner and the unlocking
+// coroutine is enqueued on `pool`. If nobody was waiting it does not suspend.
+// release() does the same for a permit, but permits that others released while
+// it held the waiters can pass to more of them: it returns every waiter that
+// got one (async_semaphore::woken). `co_await s.release(pool)` hands over to the
+// first and enqueues the others on `pool`. Nothing is resumed inside unlock()
+// or release(), and dropping what they return strands an owner, so all of
+// these are [[nodiscard]].
+//
+// A coroutine must not be destroyed while it waits in one of these lists. One
+// resumed by lock() or acquire() already owns the mutex or the permit, so it
+// doesn't stop at its cancellation point there (lock_awaiter::hands_over, see
+// "Cancellation" in defs.hpp). A coroutine that holds the lock across some
+// other co_await can still stop there with the lock held, so it shouldn't be
+// given a token that can be cancelled.
+
+#include<atomic>
+#include<cstdint>
+#include "scheduler.hpp"
+
+// Returned by unlock(pool) / release(pool), see above.
+class [[nodiscard]] handoff_awaiter
+{
+    private:
+        thread_pool &           pool_;
+        std::coroutine_handle<> next_;
+
+    public:
+        handoff_awaiter(thread_pool & pool, std::coroutine_handle<> next) noexcept
+            : pool_(pool)
+            , next_(next)
+        {}
+
+    public:
+        bool await_ready() noexcept
+        {
+            return next_ == std::noop_coroutine();
+        }
+
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<> h)
+        {
+            // `this` is in h's frame, which another worker may resume (and
+            // destroy) as soon as it is enqueued.
+            std::coroutine_handle<> next = next_;
+            pool_.enqueue(h);
+            return next;
+        }
+
+        void await_resume() noexcept {}
+};
+
+//////////////////////
+// async_mutex
+//
+//   co_await m.lock();
+//   ...
+//   co_await m.unlock(pool);     // or m.unlock().resume()
+
+class async_mutex
+{
+    public:
+        class lock_awaiter;
+
+    private:
+        // not_locked, locked_no_waiters or the newest lock_awaiter.
+        static constexpr std::uintptr_t not_locked        = 1;
+        static constexpr std::uintptr_t locked_no_waiters = 0;
+
+        std::atomic<std::uintptr_t> state_ {not_locked};
+
+        // Waiters taken off state_ in FIFO order, only touched by the owner.
+        lock_awaiter * waiters_ = nullptr;
+
+    public:
+        async_mutex() noexcept = default;
+        ~async_mutex() = default;
+
+        async_mutex            (const async_mutex &) = delete;
+        async_mutex & operator=(const async_mutex &) = delete;
+
+    public:
+        bool try_lock() noexcept
+        {
+            std::uintptr_t expected = not_locked;
+            return state_.compare_exchange_strong(expected, locked_no_waiters, std::memory_order_acquire, std::memory_order_relaxed);
+        }
+
+        lock_awaiter lock() noexcept;
+
+        // Releases the lock, or passes it to the oldest waiter and returns it.
+        [[nodiscard]] std::coroutine_handle<> unlock() noexcept;
+
+        [[nodiscard]] handoff_awaiter unlock(thread_pool & pool) noexcept
+        {
+            return handoff_awaiter{pool, unlock()};
+        }
+};
+
+class async_mutex::lock_awaiter
+{
+    private:
+        friend class async_mutex;
+
+        async_mutex &           mutex_;
+        lock_awaiter *          next_ = nullptr;
+        std::coroutine_handle<> coro_;
+
+    public:
+        // Resumed owning the mutex, so not cancelled there, see "Cancellation" in defs.hpp.
+        static constexpr bool hands_over = true;
+
+    public:
+        explicit lock_awaiter(async_mutex & mutex) noexcept
+            : mutex_(mutex)
+        {}
+
+        lock_awaiter            (const lock_awaiter &) = delete;
+        lock_awaiter & operator=(const lock_awaiter &) = delete;
+
+    public:
+        bool await_ready() noexcept
+        {
+            return mutex_.try_lock();
+        }
+
+        // False if the mutex was released in the meantime and we took it.
+        bool await_suspend(std::coroutine_handle<> h) noexcept;
+
+        void await_resume() noexcept {}
+};
+
+inline async_mutex::lock_awaiter async_mutex::lock() noexcept
+{
+    return lock_awaiter{*this};
+}
+
+//////////////////////
+// async_semaphore
+//
+// Counting semaphore. Waiters are woken oldest first; a contended release()
+// walks the waiter list, so it is meant for bounding a few dozen waiters
+// rather than thousands.
+
+class async_semaphore
+{
+    public:
+        class acquire_awaiter;
+        class woken;
+
+    private:
+        // Either `permits << 1 | 1` (at least one permit, nobody waiting), 0 (no
+        // permit, nobody waiting) or the newest acquire_awaiter.
+        std::atomic<std::uintptr_t> state_;
+
+        static constexpr std::uintptr_t permits(std::uintptr_t n) noexcept
+        {
+            return n == 0 ? 0 : n << 1 | 1;
+        }
+
+        static acquire_awaiter * pop_oldest(acquire_awaiter * & list) noexcept;
+        acquire_awaiter * requeue(acquire_awaiter * waiters) noexcept;
+
+    public:
+        explicit async_semaphore(std::uintptr_t initial) noexcept
+            : state_(permits(initial))
+        {}
+
+        async_semaphore            (const async_semaphore &) = delete;
+        async_semaphore & operator=(const async_semaphore &) = delete;
+
+    public:
+        bool try_acquire() noexcept;
+
+        acquire_awaiter acquire() noexcept;
+
+        // Adds a permit, or passes it to the oldest waiter and returns it, with
+        // any others that got a permit in the meantime.
+        [[nodiscard]] woken release() noexcept;
+
+        [[nodiscard]] handoff_awaiter release(thread_pool & pool);
+};
+
+// The waiters a release() passed a permit to, oldest first, each already the
+// owner. Resume or schedule all of them:
+//
+//   for(auto w = s.release(); !w.empty();){
+//       w.pop().resume();
+//   }
+class [[nodiscard]] async_semaphore::woken
+{
+    private:
+        acquire_awaiter * first_;
+
+    public:
+        explicit woken(acquire_awaiter * first) noexcept
+            : first_(first)
+        {}
+
+    public:
+        bool empty() const noexcept
+        {
+            return first_ == nullptr;
+        }
+
+        // Only call when !empty().
+        std::coroutine_handle<> pop() noexcept;
+};
+
+class async_semaphore::acquire_awaiter
+{
+    private:
+        friend class async_semaphore;
+        friend class async_semaphore::woken;
+
+        async_semaphore &       semaphore_;
+        acquire_awaiter *       next_ = nullptr;
+        std::coroutine_handle<> coro_;
+
+    public:
+        // Resumed owning a permit, so not cancelled there, see "Cancellation" in defs.hpp.
+        static constexpr bool hands_over = true;
+
+    public:
+        explicit acquire_awaiter(async_semaphore & semaphore) noexcept
+            : semaphore_(semaphore)
+        {}
+
+        acquire_awaiter            (const acquire_awaiter &) = delete;
+        acquire_awaiter & operator=(const acquire_awaiter &) = delete;
+
+    public:
+        bool await_ready() noexcept
+        {
+            return semaphore_.try_acquire();
+        }
+
+        // False if a permit was released in the meantime and we took it.
+        bool await_suspend(std::coroutine_handle<> h) noexcept;
+
+        void await_resume() noexcept {}
+};
+
+inline async_semaphore::acquire_awaiter async_semaphore::acquire() noexcept
+{
+    return acquire_awaiter{*this};
+}
+
+inline std::coroutine_handle<> async_semaphore::woken::pop() noexcept
+{
+    // The waiter's frame (and the node in it) may be gone once it resumed.
+    acquire_awaiter * w = first_;
+    first_ = w->next_;
+    return w->coro_;
+}
+
+//////////////////////
+// async_event
+//
+// Manual-reset event: co_await e.wait() completes once set() was called and
+// until reset() is. set() resumes every waiter on the calling thread, oldest
+// first.
+
+class async_event
+{
+    public:
+        class wait_awaiter;
+
+    private:
+        // is_set, not_set or the newest wait_awaiter.
+        static constexpr std::uintptr_t is_set_ = 1;
+        static constexpr std::uintptr_t not_set = 0;
+
+        std::atomic<std::uintptr_t> state_;
+
+    public:
+        explicit async_event(bool set = false) noexcept
+            : state_(set ? is_set_ : not_set)
+        {}
+
+        async_event            (const async_event &) = delete;
+        async_event & operator=(const async_event &) = delete;
+
+    public:
+        bool is_set() const noexcept
+        {
+            return state_.load(std::memory_order_acquire) == is_set_;
+        }
+
+        void set() noexcept;
+
+        void reset() noexcept
+        {
+            std::uintptr_t expected = is_set_;
+            state_.compare_exchange_strong(expected, not_set, std::memory_order_relaxed);
+        }
+
+        wait_awaiter wait() noexcept;
+};
+
+class async_event::wait_awaiter
+{
+    private:
+        friend class async_event;
+
+        async_event &           event_;
+        wait_awaiter *          next_ = nullptr;
+        std::coroutine_handle<> coro_;
+
+    public:
+        explicit wait_awaiter(async_event & event) noexcept
+            : event_(event)
+        {}
+
+        wait_awaiter            (const wait_awaiter &) = delete;
+        wait_awaiter & operator=(const wait_awaiter &) = delete;
+
+    public:
+        bool await_ready() noexcept
+        {
+            return event_.is_set();
+        }
+
+        // False if the event was set in the meantime.
+        bool await_suspend(std::coroutine_handle<> h) noexcept;
+
+        void await_resume() noexcept {}
+};
+
+inline async_event::wait_awaiter async_event::wait() noexcept
+{
+    return wait_awaiter{*this};
+}
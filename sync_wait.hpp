@@ -0,0 +1,135 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// sync_wait: block the calling thread until a task has finished
+//
+//   int n = sync_wait(hop(pool, 64));     // finishes on a worker of `pool`
+//
+// task::execute() installs the noop coroutine as continuation and returns after
+// one resume(), so it only works for tasks that finish on the calling thread.
+// sync_wait() installs a sync_wait_frame instead: a hand-written
+// coroutine-state, like thread_pool::detached_state, with nothing in it but a
+// futex word. Whichever thread runs the task's final suspend-point transfers
+// to it, it sets the word and wakes the caller, which sleeps in
+// std::atomic::wait() meanwhile. A task that finishes synchronously sets the
+// word before sync_wait() would wait, then it doesn't sleep at all.
+//
+// The frame lives on the caller's stack, nothing is allocated. A thread that
+// bridges into coroutines over and over can also keep one and pass it in,
+// sync_wait(t, frame), one call at a time.
+//
+// Errors and cancellation are reported as by execute(). Don't call it from a
+// worker of a thread_pool the task needs to make progress: the worker blocks.
+
+#include<atomic>
+#include<cstdint>
+#include<thread>
+#include "async_stack.hpp"
+#include "eager_task.hpp"
+
+class sync_wait_frame : public __coroutine_state
+{
+    private:
+        // released is only stored once the waker is done with the frame:
+        // notify_one() still uses it after signalled is visible.
+        enum : std::uint32_t { waiting, signalled, released };
+
+        std::atomic<std::uint32_t> state_ {waiting};
+
+        static __coroutine_state * resume(__coroutine_state * s) noexcept
+        {
+            auto * frame = static_cast<sync_wait_frame *>(s);
+
+            // The waiting thread frees the frame once it sees signalled.
+            __release_running_frame();
+            frame->state_.store(signalled, std::memory_order_release);
+            frame->state_.notify_one();
+            frame->state_.store(released, std::memory_order_release);
+            return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+        }
+
+        static void destroy(__coroutine_state *) noexcept {}
+
+        // The bottom of the awaited task's async stack, see async_stack.hpp.
+        static inline const async_frame_info frame_info {"sync_wait", {}, &destroy, nullptr, nullptr, nullptr};
+
+    public:
+        sync_wait_frame() noexcept
+        {
+            this-> __resume = & resume;
+            this->__destroy = &destroy;
+            static_cast<void>(frame_info); // instantiates, and so registers, it
+        }
+
+        sync_wait_frame            (const sync_wait_frame &) = delete;
+        sync_wait_frame & operator=(const sync_wait_frame &) = delete;
+
+    public:
+        // The continuation for the next wait(), the previous one must have returned.
+        std::coroutine_handle<> arm() noexcept
+        {
+            state_.store(waiting, std::memory_order_relaxed);
+            return std::coroutine_handle<>::from_address(this);
+        }
+
+        // Returns once the continuation has run and let go of the frame. Checks
+        // first: atomic::wait() costs more than the load even when it needn't
+        // sleep, and a task that finished on this thread is released already.
+        void wait() noexcept
+        {
+            for(std::uint32_t s; (s = state_.load(std::memory_order_acquire)) != released;){
+                if(s == waiting){
+                    state_.wait(waiting, std::memory_order_acquire);
+                }
+                else{
+                    std::this_thread::yield(); // notify_one() is still running
+                }
+            }
+        }
+};
+
+// The result of a finished task for sync_wait(), reported as task::execute() does.
+template<typename Awaiter> decltype(auto) __sync_wait_result(Awaiter & awaiter)
+{
+#ifdef CORO_NO_EXCEPTIONS
+    if(awaiter.cancelled() || awaiter.error()) [[unlikely]] {
+        std::abort();
+    }
+#else
+    if(awaiter.cancelled()) [[unlikely]] {
+        throw std::system_error(std::make_error_code(std::errc::operation_canceled));
+    }
+#endif
+    return awaiter.await_resume();
+}
+
+template<typename T> T sync_wait(task<T> t, sync_wait_frame & frame)
+{
+    auto awaiter = std::move(t).operator co_await();
+
+    awaiter.await_suspend(frame.arm()).resume();
+    frame.wait();
+    return __sync_wait_result(awaiter);
+}
+
+// An eager task may have finished in its ramp already, then nothing waits.
+template<typename T> T sync_wait(eager_task<T> t, sync_wait_frame & frame)
+{
+    auto awaiter = std::move(t).operator co_await();
+
+    if(!awaiter.await_ready() && awaiter.await_suspend(frame.arm())){
+        frame.wait();
+    }
+    return __sync_wait_result(awaiter);
+}
+
+template<typename T> T sync_wait(task<T> t)
+{
+    sync_wait_frame frame;
+    return sync_wait(std::move(t), frame);
+}
+
+template<typename T> T sync_wait(eager_task<T> t)
+{
+    sync_wait_frame frame;
+    return sync_wait(std::move(t), frame);
+}
@@ -0,0 +1,166 @@
+#include "tagged.hpp"
+#include "async_stack.hpp"
+//////////////////////
+// Begin lowering of tagged(int n)
+//
+// task<std::uint64_t> tagged(int n) {
+//   if(n == 0) {
+//     co_return context()->request_id;
+//   }
+//   co_return co_await tagged(n - 1);
+// }
+//
+// chain(n) with the leaf reading the request id from the coroutine-local
+// context, see context.hpp. `context()` stands for the promise's context():
+// the root's pointer, handed down one level per co_await by task::awaiter.
+
+/////
+// The "ramp" function
+
+task<std::uint64_t> tagged(int n)
+{
+    std::unique_ptr<__tagged_state> state(new __tagged_state(static_cast<int &&>(n)));
+    return __ramp(std::move(state), &__tagged_resume);
+}
+
+/////
+// The cancellation points, see "Cancellation" in defs.hpp
+
+static constexpr auto & __tagged_cancellable = __cancellation_points<std::suspend_always, task<std::uint64_t>::awaiter, task<std::uint64_t>::promise_type::final_awaiter>;
+
+/////
+//  The "resume" function
+
+__coroutine_state *__tagged_resume(__coroutine_state *s)
+{
+    auto *state = static_cast<__tagged_state *>(s);
+    __resume_scope resume_scope(state);
+
+    if(auto *next = __cancellation_point(state, __tagged_cancellable)) [[unlikely]] {
+        return next;
+    }
+
+#ifndef CORO_NO_EXCEPTIONS
+    try{
+#else
+    {
+#endif
+        switch(state->__suspend_point){
+            case 0: goto suspend_point_0;
+            case 1: goto suspend_point_1;
+            default: std::unreachable();
+        }
+
+suspend_point_0:
+        {
+            destructor_guard tmp1_dtor{state->__tmp1()};
+            state->__tmp1().get().await_resume();
+        }
+
+        //  if(n == 0) co_return context()->request_id;
+        if(state->n == 0){
+            state->__promise.return_value(state->__promise.context()->request_id);
+            goto final_suspend;
+        }
+
+        //  co_return co_await tagged(n - 1);
+        {
+            state->__tmp2().construct_from([&]()
+            {
+                return tagged(state->n - 1);
+            });
+            destructor_guard tmp2_dtor{state->__tmp2()};
+
+            state->__tmp3().construct_from([&]()
+            {
+                return static_cast<task<std::uint64_t> &&>(state->__tmp2().get()).operator co_await();
+            });
+            destructor_guard tmp3_dtor{state->__tmp3()};
+
+            if(!state->__tmp3().get().await_ready()){
+                state->__suspend_point = 1;
+                CORO_TRACE_EVENT(suspend, state, 1);
+                __release_running_frame();
+                auto h = state->__tmp3().get().await_suspend(std::coroutine_handle<__tagged_promise_t>::from_promise(state->__promise));
+
+                tmp3_dtor.cancel();
+                tmp2_dtor.cancel();
+                return static_cast<__coroutine_state *>(h.address());
+            }
+
+            tmp3_dtor.cancel();
+            tmp2_dtor.cancel();
+        }
+
+suspend_point_1:
+        // The child was cancelled, see g.cpp.
+        if(state->__tmp3().get().cancelled()) [[unlikely]] {
+            return static_cast<__coroutine_state *>(state->__promise.cancel().address());
+        }
+#ifdef CORO_NO_EXCEPTIONS
+        // The awaited task failed, see g.cpp.
+        if(std::error_code ec = state->__tmp3().get().error()) [[unlikely]] {
+            state->__tmp3().destroy();
+            state->__tmp2().destroy();
+            state->__promise.set_error(ec);
+            goto final_suspend;
+        }
+#endif
+        std::uint64_t r = [&]() -> decltype(auto)
+        {
+            destructor_guard tmp2_dtor{state->__tmp2()};
+            destructor_guard tmp3_dtor{state->__tmp3()};
+            return state->__tmp3().get().await_resume();
+        }();
+
+        state->__promise.return_value(r);
+        goto final_suspend;
+    }
+#ifndef CORO_NO_EXCEPTIONS
+    catch(...){
+        state->__promise.unhandled_exception();
+        goto final_suspend;
+    }
+#endif
+
+final_suspend:
+    return __final_suspend(state, state->__tmp4(), 2);
+}
+
+/////
+// The "destroy" function
+
+void __tagged_destroy(__coroutine_state *s)
+{
+    auto *state = static_cast<__tagged_state *>(s);
+    CORO_TRACE_EVENT(destroy, state, state->__suspend_point);
+
+    switch(state->__suspend_point){
+        case 0: goto suspend_point_0;
+        case 1: goto suspend_point_1;
+        case 2: goto suspend_point_2;
+        default: std::unreachable();
+    }
+
+suspend_point_0:
+    state->__tmp1().destroy();
+    goto destroy_state;
+
+suspend_point_1:
+    state->__tmp3().destroy();
+    state->__tmp2().destroy();
+    goto destroy_state;
+
+suspend_point_2:
+    state->__tmp4().destroy();
+    goto destroy_state;
+
+destroy_state:
+    delete state;
+}
+
+/////
+// The async stack trace information, see async_stack.hpp
+
+static constexpr const char * __tagged_sites[] = {"initial suspend", "co_await tagged(n - 1)", "final suspend"};
+static const lowered_frame_info<__tagged_state> __tagged_frame_info{&__tagged_destroy, "tagged(int n)", __tagged_sites};
@@ -0,0 +1,53 @@
+#pragma once
+#include "defs.hpp"
+//////////////////////
+// Coroutine-state of tagged(int n), see tagged.cpp for the lowering.
+
+task<std::uint64_t> tagged(int n);
+
+using __tagged_promise_t = std::coroutine_traits<task<std::uint64_t>, int>::promise_type;
+
+__coroutine_state * __tagged_resume (__coroutine_state *);
+void                __tagged_destroy(__coroutine_state *);
+
+/////
+// The coroutine-state definition
+
+struct __tagged_state : __coroutine_state_with_promise<__tagged_promise_t>
+{
+    __suspend_index_t<3> __suspend_point = 0;
+
+    // Argument copies
+    int n;
+
+    // Temporaries, overlapped per scope by frame_storage
+    using __frame_t = frame_storage<
+        frame_scope<manual_lifetime<std::suspend_always>>,                                // initial suspend
+        frame_scope<manual_lifetime<task<std::uint64_t>>,                                 // co_return co_await tagged(n - 1);
+                    manual_lifetime<task<std::uint64_t>::awaiter>>,
+        frame_scope<manual_lifetime<task<std::uint64_t>::promise_type::final_awaiter>>>;  // final suspend
+
+    __frame_t __frame;
+
+    auto & __tmp1() noexcept { return __frame.get<0, 0>(); }
+    auto & __tmp2() noexcept { return __frame.get<1, 0>(); }
+    auto & __tmp3() noexcept { return __frame.get<1, 1>(); }
+    auto & __tmp4() noexcept { return __frame.get<2, 0>(); }
+
+    __tagged_state(int && n)
+        : n(static_cast<int &&>(n))
+    {
+            // Initialise the function-pointers used by coroutine_handle::resume/destroy/done().
+            this-> __resume = & __tagged_resume;
+            this->__destroy = &__tagged_destroy;
+
+            // Use placement-new to initialise the promise object in the base-class
+            // after we've initialised the argument copies.
+            ::new ((void *)std::addressof(this->__promise)) __tagged_promise_t(construct_promise<__tagged_promise_t>(this->n));
+    }
+
+    ~__tagged_state()
+    {
+        this->__promise.~__tagged_promise_t();
+    }
+};
@@ -0,0 +1,84 @@
+#include "timer.hpp"
+
+//////////////////////
+// timer_wheel
+
+std::uint64_t timer_wheel::due(int level) const noexcept
+{
+    const int shift = level * slot_bits;
+    const int above = shift + slot_bits;
+    const auto slot = static_cast<std::uint64_t>(std::countr_zero(occupied_[level]));
+
+    // The current tick with the digit of this level replaced by the slot and
+    // the ones below cleared. Level 0 only holds slots at or after the current
+    // tick's, the others only slots after it, so this is never in the past.
+    const std::uint64_t prefix = above < 64 ? now_ >> above << above : 0;
+    return prefix | slot << shift;
+}
+
+void timer_wheel::take(std::uint32_t index, timer_node *& list) noexcept
+{
+    list = std::exchange(slots_[index], nullptr);
+    if(list != nullptr){
+        list->pprev_ = &list;
+    }
+    occupied_[index / slots] &= ~(std::uint64_t(1) << (index % slots));
+}
+
+std::size_t timer_wheel::advance(clock::time_point now)
+{
+    const clock::duration since  = now - origin_;
+    const std::uint64_t   target = since <= clock::duration::zero() ? 0 : static_cast<std::uint64_t>(since / tick_);
+
+    std::size_t expired = 0;
+    for(;;){
+        const int level = lowest_level();
+        const std::uint64_t tick = level < levels ? due(level) : ~std::uint64_t(0);
+
+        if(tick > target){
+            // Nothing happens in between, and jumping there keeps every timer
+            // in a valid slot: none of the digits it was placed by changes.
+            if(target > now_){
+                now_ = target;
+            }
+            return expired;
+        }
+
+        now_ = tick;
+        const auto index = static_cast<std::uint32_t>(level * slots + static_cast<int>(tick >> (level * slot_bits) & (slots - 1)));
+
+        timer_node * list;
+        take(index, list);
+
+        if(level == 0){
+            // A waiter may cancel (or destroy) other timers of the list, so
+            // always continue with whatever is at its head now.
+            while(list != nullptr){
+                timer_node & node = *list;
+                unlink(node);
+                --size_;
+
+                node.waiter.resume();
+                ++expired;
+            }
+        }
+        else{
+            // Cascade: relative to the new current tick they all belong to a
+            // lower level.
+            while(list != nullptr){
+                timer_node & node = *list;
+                list = node.next_;
+                insert(node);
+            }
+        }
+    }
+}
+
+timer_wheel::clock::time_point timer_wheel::next_deadline() const noexcept
+{
+    const int level = lowest_level();
+    if(level == levels){
+        return clock::time_point::max();
+    }
+    return origin_ + tick_ * static_cast<clock::rep>(due(level));
+}
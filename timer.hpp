@@ -0,0 +1,404 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Timers: a hierarchical timing wheel, sleep_for / sleep_until and with_timeout
+//
+//   co_await sleep_for(r.timers(), std::chrono::milliseconds(100));
+//   int n = co_await with_timeout(read_request(conn), r.timers(), std::chrono::seconds(30));
+//
+// A timer_wheel counts time in ticks (1 ms by default) and keeps its timers in
+// 11 levels of 64 slots. Level L holds the timers whose expiry first differs
+// from the current tick in the L-th group of 6 bits, i.e. level 0 the ones due
+// within the current 64 ticks, level 1 within the current 4096, and so on; a
+// slot is a doubly-linked list. Arming computes the slot from the XOR of expiry
+// and current tick and pushes onto its list, cancelling unlinks, both O(1) and
+// without allocating: the timer_node lives in the awaiter, which is a
+// temporary in the waiting coroutine's frame, the same way the reactor's
+// io_operation does.
+//
+// advance(now) jumps from one occupied slot to the next, a 64-bit mask per
+// level finds it without scanning empty slots. A level-0 slot is due: its
+// waiters are resumed. A higher one has reached the current tick: its timers
+// are re-armed, which moves them down at least one level. So a timer is
+// touched at most once per level on its way down, and a timer cancelled
+// before its slot comes up, which is most timeouts, never costs more than
+// arming and unlinking it.
+//
+// Like the reactor a wheel belongs to one thread: the reactor owns one and
+// advances it after every epoll_wait (see reactor::timers()). Deadlines are
+// rounded up to the next tick, a timer never expires early.
+//
+// with_timeout(t, timers, d) awaits t, but resumes the awaiting coroutine once
+// d has passed even if t hasn't finished. t then counts as failed with
+// std::errc::timed_out (thrown from await_resume(), or reported by error() in
+// exception-free mode) and is destroyed, still suspended, with the co_await
+// expression. That requires t to be suspended on the wheel's thread when the
+// timer expires, e.g. waiting on the reactor, which is the case for anything
+// that runs on a reactor.
+
+#include<array>
+#include<bit>
+#include<chrono>
+#include<cstdint>
+#include "defs.hpp"
+
+class timer_wheel;
+
+// One timer, embedded in whatever waits for it. Must stay where it is while armed.
+class timer_node
+{
+    private:
+        friend class timer_wheel;
+
+        timer_node *  next_   = nullptr;
+        timer_node ** pprev_  = nullptr;    // the pointer pointing at us, null while not armed
+        std::uint64_t expiry_ = 0;          // in ticks
+        std::uint32_t slot_   = 0;          // index into timer_wheel::slots_
+
+    public:
+        // Resumed by timer_wheel::advance() once the timer expired.
+        std::coroutine_handle<> waiter;
+
+    public:
+        timer_node() noexcept = default;
+
+        timer_node            (const timer_node &) = delete;
+        timer_node & operator=(const timer_node &) = delete;
+
+        bool armed() const noexcept
+        {
+            return pprev_ != nullptr;
+        }
+};
+
+//////////////////////
+// The timing wheel
+
+class timer_wheel
+{
+    public:
+        using clock = std::chrono::steady_clock;
+
+        static constexpr int slot_bits = 6;
+        static constexpr int slots     = 1 << slot_bits;                   // per level
+        static constexpr int levels    = (64 + slot_bits - 1) / slot_bits; // enough for any tick count
+
+    private:
+        std::array<timer_node *,  levels * slots> slots_    {};
+        std::array<std::uint64_t, levels>         occupied_ {};   // bit s: slot s of the level is non-empty
+
+        clock::time_point origin_;
+        clock::duration   tick_;
+        std::uint64_t     now_  = 0;    // ticks since origin_, every timer before has expired
+        std::size_t       size_ = 0;
+
+    public:
+        explicit timer_wheel(clock::duration tick = std::chrono::milliseconds(1), clock::time_point origin = clock::now()) noexcept
+            : origin_(origin)
+            , tick_(tick)
+        {}
+
+        timer_wheel            (const timer_wheel &) = delete;
+        timer_wheel & operator=(const timer_wheel &) = delete;
+
+    public:
+        // Resume node.waiter at `deadline`. A deadline that has passed already
+        // expires at the next advance().
+        void arm(timer_node & node, clock::time_point deadline) noexcept
+        {
+            node.expiry_ = to_ticks(deadline);
+            insert(node);
+            ++size_;
+        }
+
+        // Does nothing if `node` isn't armed, e.g. it has expired.
+        void cancel(timer_node & node) noexcept
+        {
+            if(node.armed()){
+                unlink(node);
+                --size_;
+            }
+        }
+
+        // Resume the waiters of every timer due at `now` or before, in no
+        // particular order. Returns their number.
+        std::size_t advance(clock::time_point now);
+
+        // When advance() next has something to do, clock::time_point::max()
+        // if no timer is armed. Possibly earlier than the first expiry: the
+        // wheel may have to move timers down a level then.
+        clock::time_point next_deadline() const noexcept;
+
+        // The time advance() last moved the wheel to.
+        clock::time_point now() const noexcept
+        {
+            return origin_ + tick_ * static_cast<clock::rep>(now_);
+        }
+
+        // Number of armed timers.
+        std::size_t size() const noexcept
+        {
+            return size_;
+        }
+
+    private:
+        // Rounded up, and never before the current tick.
+        std::uint64_t to_ticks(clock::time_point t) const noexcept
+        {
+            const clock::duration since = t - origin_;
+            if(since <= clock::duration::zero()){
+                return now_;
+            }
+            const auto ticks = static_cast<std::uint64_t>((since + tick_ - clock::duration(1)) / tick_);
+            return ticks > now_ ? ticks : now_;
+        }
+
+        void insert(timer_node & node) noexcept
+        {
+            const std::uint64_t diff  = node.expiry_ ^ now_;
+            const int           level = diff == 0 ? 0 : (std::bit_width(diff) - 1) / slot_bits;
+            const int           slot  = static_cast<int>(node.expiry_ >> (level * slot_bits)) & (slots - 1);
+
+            node.slot_ = static_cast<std::uint32_t>(level * slots + slot);
+
+            timer_node *& head = slots_[node.slot_];
+            node.next_  = head;
+            node.pprev_ = &head;
+            if(head != nullptr){
+                head->pprev_ = &node.next_;
+            }
+            head = &node;
+
+            occupied_[level] |= std::uint64_t(1) << slot;
+        }
+
+        // Also unlinks from the list advance() took the node's slot to.
+        void unlink(timer_node & node) noexcept
+        {
+            *node.pprev_ = node.next_;
+            if(node.next_ != nullptr){
+                node.next_->pprev_ = node.pprev_;
+            }
+            node.pprev_ = nullptr;
+
+            if(slots_[node.slot_] == nullptr){
+                occupied_[node.slot_ / slots] &= ~(std::uint64_t(1) << (node.slot_ % slots));
+            }
+        }
+
+        // The lowest level with an armed timer, `levels` if there is none.
+        int lowest_level() const noexcept
+        {
+            for(int level = 0; level < levels; ++level){
+                if(occupied_[level] != 0){
+                    return level;
+                }
+            }
+            return levels;
+        }
+
+        // The tick at which the first occupied slot of `level` comes up.
+        std::uint64_t due(int level) const noexcept;
+
+        // Moves the list of slot `index` to `list`.
+        void take(std::uint32_t index, timer_node *& list) noexcept;
+};
+
+//////////////////////
+// sleep_for / sleep_until
+
+class sleep_awaiter : private timer_node
+{
+    private:
+        timer_wheel &                  timers_;
+        timer_wheel::clock::time_point deadline_;
+
+    public:
+        sleep_awaiter(timer_wheel & timers, timer_wheel::clock::time_point deadline) noexcept
+            : timers_(timers)
+            , deadline_(deadline)
+        {}
+
+        // The suspended coroutine was destroyed.
+        ~sleep_awaiter()
+        {
+            timers_.cancel(*this);
+        }
+
+    public:
+        bool await_ready() noexcept
+        {
+            return deadline_ <= timers_.now();
+        }
+
+        void await_suspend(std::coroutine_handle<> h) noexcept
+        {
+            waiter = h;
+            timers_.arm(*this, deadline_);
+        }
+
+        void await_resume() noexcept {}
+};
+
+inline sleep_awaiter sleep_until(timer_wheel & timers, timer_wheel::clock::time_point deadline) noexcept
+{
+    return sleep_awaiter{timers, deadline};
+}
+
+// A duration of zero or less doesn't suspend.
+inline sleep_awaiter sleep_for(timer_wheel & timers, timer_wheel::clock::duration duration) noexcept
+{
+    return sleep_awaiter{timers, duration <= timer_wheel::clock::duration::zero() ? timers.now() : timer_wheel::clock::now() + duration};
+}
+
+//////////////////////
+// with_timeout
+
+class __timeout_state;
+
+// The two continuations of with_timeout, see below.
+struct __timeout_frame : __coroutine_state
+{
+    __timeout_state * state;
+};
+
+// The part of timeout_awaiter that doesn't depend on T. Whichever comes first,
+// the task finishing (it transfers to completion_) or the timer expiring (it
+// resumes expiry_), resumes the parent; both happen on the wheel's thread.
+class __timeout_state
+{
+    protected:
+        timer_wheel &                  timers_;
+        timer_wheel::clock::time_point deadline_;
+        timer_node                     timer_;
+        __timeout_frame                completion_;
+        __timeout_frame                expiry_;
+        std::coroutine_handle<>        parent_;
+        bool                           timed_out_ = false;
+
+    protected:
+        __timeout_state(timer_wheel & timers, timer_wheel::clock::time_point deadline) noexcept
+            : timers_(timers)
+            , deadline_(deadline)
+        {}
+
+        // The awaiting coroutine was destroyed, or the task finished first.
+        ~__timeout_state()
+        {
+            timers_.cancel(timer_);
+        }
+
+        __timeout_state            (const __timeout_state &) = delete;
+        __timeout_state & operator=(const __timeout_state &) = delete;
+
+        // Arms the timer. Returns the continuation for the task.
+        std::coroutine_handle<> prepare(std::coroutine_handle<> parent) noexcept
+        {
+            parent_ = parent;
+
+            completion_.__resume  = &resume_completion;
+            completion_.__destroy = &__coroutine_state::__noop_destroy;
+            completion_.state     = this;
+
+            expiry_.__resume  = &resume_expiry;
+            expiry_.__destroy = &__coroutine_state::__noop_destroy;
+            expiry_.state     = this;
+
+            timer_.waiter = std::coroutine_handle<>::from_address(static_cast<__coroutine_state *>(&expiry_));
+            timers_.arm(timer_, deadline_);
+
+            return std::coroutine_handle<>::from_address(static_cast<__coroutine_state *>(&completion_));
+        }
+
+    public:
+        std::coroutine_handle<> parent() const noexcept
+        {
+            return parent_;
+        }
+
+        // completion_'s __resume: the task finished.
+        static __coroutine_state * resume_completion(__coroutine_state * s) noexcept
+        {
+            __timeout_state * self = static_cast<__timeout_frame *>(s)->state;
+            if(self->timed_out_){
+                // Too late, the parent was resumed already. It only gets here
+                // if the parent stopped at a cancellation point instead of
+                // destroying the task.
+                return static_cast<__coroutine_state *>(std::noop_coroutine().address());
+            }
+            self->timers_.cancel(self->timer_);
+            return static_cast<__coroutine_state *>(self->parent_.address());
+        }
+
+        // expiry_'s __resume: the timer expired first.
+        static __coroutine_state * resume_expiry(__coroutine_state * s) noexcept
+        {
+            __timeout_state * self = static_cast<__timeout_frame *>(s)->state;
+            self->timed_out_ = true;
+            return static_cast<__coroutine_state *>(self->parent_.address());
+        }
+};
+
+template<typename T> class timeout_awaiter : private __timeout_state
+{
+    private:
+        task<T>                   task_;
+        typename task<T>::awaiter child_;
+
+    public:
+        timeout_awaiter(task<T> && t, timer_wheel & timers, timer_wheel::clock::time_point deadline) noexcept
+            : __timeout_state(timers, deadline)
+            , task_(std::move(t))
+            , child_(std::move(task_).operator co_await())
+        {}
+
+    public:
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        // The task shares the awaiting task's token, context and memory
+        // resource, as with a plain co_await.
+        template<typename Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            cancellation_token          token;
+            const task_context *        context  = nullptr;
+            std::pmr::memory_resource * resource = nullptr;
+            if constexpr (std::derived_from<Promise, __task_promise_base>){
+                token    = h.promise().token();
+                context  = h.promise().context();
+                resource = h.promise().resource();
+            }
+            return child_.start(prepare(h), token, context, resource);
+        }
+
+        T await_resume()
+        {
+#ifndef CORO_NO_EXCEPTIONS
+            if(timed_out_) [[unlikely]] {
+                throw std::system_error(std::make_error_code(std::errc::timed_out));
+            }
+#endif
+            return child_.await_resume();
+        }
+
+        // Checked by the lowering before await_resume(), as for a task.
+        bool cancelled() const noexcept
+        {
+            return !timed_out_ && child_.cancelled();
+        }
+
+#ifdef CORO_NO_EXCEPTIONS
+        // Checked by the lowering before await_resume(), as for a task.
+        std::error_code error() const noexcept
+        {
+            return timed_out_ ? std::make_error_code(std::errc::timed_out) : child_.error();
+        }
+#endif
+};
+
+template<typename T> timeout_awaiter<T> with_timeout(task<T> t, timer_wheel & timers, timer_wheel::clock::duration timeout)
+{
+    return timeout_awaiter<T>{std::move(t), timers, timer_wheel::clock::now() + timeout};
+}
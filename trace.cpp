@@ -0,0 +1,141 @@
+#include <cinttypes>
+#include <cstdio>
+#include <ostream>
+#include <vector>
+#include "trace.hpp"
+
+tracer::buffer * tracer::attach()
+{
+    static std::atomic<std::uint32_t> threads {0};
+
+    auto * b = new buffer;
+    b->thread = threads.fetch_add(1, std::memory_order_relaxed) + 1;
+
+    b->next = buffers_.load(std::memory_order_relaxed);
+    while(!buffers_.compare_exchange_weak(b->next, b, std::memory_order_release, std::memory_order_relaxed)){
+    }
+
+    current_ = b;
+    return b;
+}
+
+void tracer::clear() noexcept
+{
+    for(buffer * b = buffers_.load(std::memory_order_acquire); b != nullptr; b = b->next){
+        b->written.store(0, std::memory_order_relaxed);
+    }
+}
+
+namespace
+{
+    const char * event_name(tracer::event what) noexcept
+    {
+        switch(what){
+            case tracer::event::ramp           : return "ramp";
+            case tracer::event::initial_suspend: return "initial_suspend";
+            case tracer::event::suspend        : return "suspend";
+            case tracer::event::resume         : return "resume";
+            case tracer::event::final_suspend  : return "final_suspend";
+            case tracer::event::destroy        : return "destroy";
+        }
+        return "unknown";
+    }
+
+    // Chrome wants microseconds, keep the nanoseconds as decimals.
+    void write_ts(std::ostream & out, std::uint64_t ns)
+    {
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "%" PRIu64 ".%03u", ns / 1000, static_cast<unsigned>(ns % 1000));
+        out << buf;
+    }
+
+    void write_frame(std::ostream & out, const void * frame)
+    {
+        char buf[32];
+        std::snprintf(buf, sizeof buf, "\"0x%" PRIxPTR "\"", reinterpret_cast<std::uintptr_t>(frame));
+        out << buf;
+    }
+}
+
+void tracer::write_chrome_json(std::ostream & out)
+{
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    const char * sep = "";
+
+    auto header = [&](const char * ph, const char * name, std::uint32_t tid, std::uint64_t ns)
+    {
+        out << sep << "{\"ph\":\"" << ph << "\",\"name\":\"" << name << "\",\"pid\":1,\"tid\":" << tid << ",\"ts\":";
+        write_ts(out, ns);
+        sep = ",\n";
+    };
+
+    for(buffer * b = buffers_.load(std::memory_order_acquire); b != nullptr; b = b->next){
+        const std::uint64_t written = b->written.load(std::memory_order_acquire);
+        const std::uint64_t first   = written > capacity ? written - capacity : 0;
+
+        out << sep << "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":" << b->thread
+            << ",\"args\":{\"name\":\"thread " << b->thread << "\"}}";
+        sep = ",\n";
+
+        // Resume functions nest when one resumes another directly (e.g. when_all
+        // starting its children), so the open slices form a stack. A slice ends
+        // at the next suspend of its frame; one left without suspending (a
+        // cancelled coroutine) ends with the slice it was nested in.
+        std::vector<record> open;
+
+        auto close = [&](const record & start, const record & end)
+        {
+            header("X", "resume", b->thread, start.ns);
+            out << ",\"dur\":";
+            write_ts(out, end.ns - start.ns);
+            out << ",\"args\":{\"frame\":";
+            write_frame(out, start.frame);
+            out << ",\"from\":" << start.point << ",\"to\":" << end.point << ",\"until\":\"" << event_name(end.what) << "\"}}";
+        };
+
+        for(std::uint64_t i = first; i < written; ++i){
+            const record & r = b->records[i & (capacity - 1)];
+            switch(r.what){
+                case event::resume:
+                    open.push_back(r);
+                    break;
+
+                case event::suspend:
+                case event::final_suspend:
+                    for(std::size_t j = open.size(); j-- > 0;){
+                        if(open[j].frame == r.frame){
+                            while(open.size() > j){
+                                close(open.back(), r);
+                                open.pop_back();
+                            }
+                            break;
+                        }
+                    }
+                    break;
+
+                case event::ramp:
+                case event::destroy:
+                    header(r.what == event::ramp ? "b" : "e", "frame", b->thread, r.ns);
+                    out << ",\"cat\":\"frame\",\"id\":";
+                    write_frame(out, r.frame);
+                    out << ",\"args\":{\"point\":" << r.point << "}}";
+                    break;
+
+                case event::initial_suspend:
+                    header("i", event_name(r.what), b->thread, r.ns);
+                    out << ",\"s\":\"t\",\"args\":{\"frame\":";
+                    write_frame(out, r.frame);
+                    out << "}}";
+                    break;
+            }
+        }
+
+        // Still running when the buffer was read.
+        while(!open.empty()){
+            close(open.back(), open.back());
+            open.pop_back();
+        }
+    }
+
+    out << "\n]}\n";
+}
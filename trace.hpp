@@ -0,0 +1,109 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// Coroutine lifecycle tracing
+//
+// Built with -DCORO_TRACE, every lowered coroutine reports its lifecycle
+// through the CORO_TRACE_EVENT(event, frame, point) hooks:
+//
+//   ramp             the ramp created the coroutine-state
+//   initial_suspend  the ramp suspended at the initial suspend-point
+//   suspend          the body stored __suspend_point N and is about to suspend
+//   resume           a resume function was entered at suspend-point N
+//   final_suspend    the body reached its final suspend-point N
+//   destroy          the coroutine-state is destroyed at suspend-point N
+//
+// Each hook appends {timestamp, frame address, suspend-point, event} to a ring
+// buffer owned by the calling thread: a plain store of the record and a
+// release store of the write count, no locks and no read-modify-write. Once a
+// buffer is full the oldest records are overwritten. Reading steady_clock is
+// most of the cost of a hook (bench/lowered.cpp, lowered-traced).
+//
+// tracer::write_chrome_json() converts the buffers of every thread into the
+// Chrome trace-event format, which ui.perfetto.dev (or chrome://tracing) opens
+// directly: a "resume" slice per resume on the thread that ran it, and a
+// "frame" async track per coroutine-state from ramp to destroy. Only export (or
+// clear) while the traced threads are idle, e.g. after thread_pool::wait_idle().
+//
+// Without CORO_TRACE the hooks expand to nothing, the lowering is unchanged.
+
+#include<atomic>
+#include<chrono>
+#include<cstdint>
+#include<iosfwd>
+#include<memory>
+
+#ifndef CORO_TRACE_CAPACITY
+#define CORO_TRACE_CAPACITY (1u << 16)  // records per thread, a power of two
+#endif
+
+class tracer
+{
+    public:
+        enum class event : std::uint8_t
+        {
+            ramp,
+            initial_suspend,
+            suspend,
+            resume,
+            final_suspend,
+            destroy,
+        };
+
+        struct record
+        {
+            std::uint64_t  ns;      // steady_clock
+            const void   * frame;
+            std::uint32_t  point;
+            event          what;
+        };
+
+        static constexpr std::size_t capacity = CORO_TRACE_CAPACITY;
+        static_assert((capacity & (capacity - 1)) == 0, "CORO_TRACE_CAPACITY must be a power of two");
+
+    private:
+        // Never freed, so the records of exited threads can still be exported.
+        struct buffer
+        {
+            std::unique_ptr<record[]>  records {new record[capacity]};
+            std::atomic<std::uint64_t> written {0};
+            std::uint32_t              thread  = 0;
+            buffer *                   next    = nullptr;
+        };
+
+        static inline std::atomic<buffer *>  buffers_ {nullptr};
+        static inline thread_local buffer * current_ = nullptr;
+
+        static buffer * attach();
+
+    public:
+        static void emit(event what, const void * frame, std::uint32_t point) noexcept
+        {
+            buffer * b = current_;
+            if(b == nullptr) [[unlikely]] {
+                b = attach();
+            }
+
+            const std::uint64_t n = b->written.load(std::memory_order_relaxed);
+            b->records[n & (capacity - 1)] = record{now(), frame, point, what};
+            b->written.store(n + 1, std::memory_order_release);
+        }
+
+        // Chrome trace-event JSON of everything recorded so far.
+        static void write_chrome_json(std::ostream & out);
+
+        // Drops all records, e.g. after a warm-up.
+        static void clear() noexcept;
+
+    private:
+        static std::uint64_t now() noexcept
+        {
+            return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count());
+        }
+};
+
+#ifdef CORO_TRACE
+#define CORO_TRACE_EVENT(what, frame, point) tracer::emit(tracer::event::what, (frame), static_cast<std::uint32_t>(point))
+#else
+#define CORO_TRACE_EVENT(what, frame, point) ((void)0)
+#endif
@@ -0,0 +1,547 @@
+#pragma once
+////////////////////////////////////////////////////////////////////////
+// when_all / when_any: await several tasks concurrently
+//
+//   auto [a, b] = co_await when_all(f(1), g(2));               // std::tuple<int, int>
+//   std::vector<int> v = co_await when_all(std::move(calls));  // std::vector<task<int>>
+//   auto [i, x] = co_await when_any(std::move(calls));         // the first to finish
+//
+// The awaiter returned by when_all() / when_any() is all the state there is.
+// It is the temporary of the co_await expression, so it lives in the awaiting
+// coroutine's frame together with the tasks, a countdown and one
+// __when_all_slot per task. The std::vector overloads move the tasks out of the
+// vector into one block that holds them and their slots. A slot is a coroutine-state with nothing in it but a pointer to
+// the countdown: every child gets its slot as continuation, and the slot's
+// resume function counts down and returns the awaiting coroutine once the
+// count reaches zero. So the last child to finish transfers straight into the
+// parent from its final suspend-point, on whichever thread it finished.
+//
+// The countdown starts at one more than the number of children. The extra
+// count belongs to await_suspend(), which starts the children one after the
+// other and only then arrives itself, so children completing synchronously
+// can't resume the parent while it is still starting the others.
+//
+// when_all hands the awaiting coroutine's cancellation token down to every
+// child. when_any gives them the token of a cancellation_source of its own
+// instead, and cancels it as soon as the first child finishes. It still waits
+// for the others to reach a cancellation point and unwind before resuming the
+// parent, so no child frame is destroyed while it is running. A parent
+// cancelled before when_any starts cancels the children right away; a later
+// request only takes effect once the winner is in.
+
+#include<array>
+#include<atomic>
+#include<memory>
+#include<span>
+#include<tuple>
+#include<variant>
+#include<vector>
+#include "defs.hpp"
+
+class __when_all_counter;
+
+// The continuation of one child, see above.
+struct __when_all_slot : __coroutine_state
+{
+    __when_all_counter * counter;
+};
+
+class __when_all_counter
+{
+    protected:
+        std::atomic<std::size_t> count_;
+        std::coroutine_handle<>  parent_;
+        __when_all_slot        * slots_ = nullptr;
+
+    public:
+        explicit __when_all_counter(std::size_t children) noexcept
+            : count_(children + 1)
+        {}
+
+        __when_all_counter            (const __when_all_counter &) = delete;
+        __when_all_counter & operator=(const __when_all_counter &) = delete;
+
+    public:
+        // Points every slot at this counter, before any child is started.
+        void prepare(std::span<__when_all_slot> slots, __coroutine_state::__resume_fn * resume, std::coroutine_handle<> parent) noexcept
+        {
+            parent_ = parent;
+            slots_  = slots.data();
+
+            for(__when_all_slot & slot: slots){
+                slot.__resume  = resume;
+                slot.__destroy = &__coroutine_state::__noop_destroy;
+                slot.counter   = this;
+            }
+        }
+
+        std::coroutine_handle<> parent() const noexcept
+        {
+            return parent_;
+        }
+
+        // A child (or the starting await_suspend) is done. Returns the parent
+        // for the last one to arrive, the noop coroutine for everybody else.
+        std::coroutine_handle<> arrive() noexcept
+        {
+            if(count_.fetch_sub(1, std::memory_order_acq_rel) == 1){
+                return parent_;
+            }
+            return std::noop_coroutine();
+        }
+
+        // The slots' __resume for when_all.
+        static __coroutine_state * resume_slot(__coroutine_state * s) noexcept
+        {
+            auto * slot = static_cast<__when_all_slot *>(s);
+
+            // Once we arrived, the last child to arrive may resume the parent, which frees the slot.
+            __release_running_frame();
+            return static_cast<__coroutine_state *>(slot->counter->arrive().address());
+        }
+};
+
+class __when_any_counter : public __when_all_counter
+{
+    private:
+        static constexpr std::size_t none = static_cast<std::size_t>(-1);
+
+        std::atomic<std::size_t> winner_ {none};
+        cancellation_source      losers_;
+
+    public:
+        using __when_all_counter::__when_all_counter;
+
+    public:
+        cancellation_token token() const noexcept
+        {
+            return losers_.token();
+        }
+
+        void cancel_all() noexcept
+        {
+            losers_.request_cancellation();
+        }
+
+        // Index of the first child that finished, valid once the parent resumed.
+        std::size_t winner() const noexcept
+        {
+            return winner_.load(std::memory_order_relaxed);
+        }
+
+        // The slots' __resume for when_any: the first to arrive cancels the rest.
+        static __coroutine_state * resume_slot(__coroutine_state * s) noexcept
+        {
+            auto * slot = static_cast<__when_all_slot *>(s);
+            auto * self = static_cast<__when_any_counter *>(slot->counter);
+
+            std::size_t expected = none;
+            if(self->winner_.compare_exchange_strong(expected, static_cast<std::size_t>(slot - self->slots_), std::memory_order_relaxed)){
+                self->cancel_all();
+            }
+            __release_running_frame();
+            return static_cast<__coroutine_state *>(self->arrive().address());
+        }
+};
+
+// The token children inherit from the coroutine awaiting the combinator.
+template<typename Promise> cancellation_token __parent_token(std::coroutine_handle<Promise> h) noexcept
+{
+    if constexpr (std::derived_from<Promise, __task_promise_base>){
+        return h.promise().token();
+    }
+    else{
+        return {};
+    }
+}
+
+// Likewise the context, see context.hpp.
+template<typename Promise> const task_context * __parent_context(std::coroutine_handle<Promise> h) noexcept
+{
+    if constexpr (std::derived_from<Promise, __task_promise_base>){
+        return h.promise().context();
+    }
+    else{
+        return nullptr;
+    }
+}
+
+// And the memory resource, see "Frame allocation" in defs.hpp.
+template<typename Promise> std::pmr::memory_resource * __parent_resource(std::coroutine_handle<Promise> h) noexcept
+{
+    if constexpr (std::derived_from<Promise, __task_promise_base>){
+        return h.promise().resource();
+    }
+    else{
+        return nullptr;
+    }
+}
+
+// Tasks of the same type and their slots: both inline for a fixed number of
+// tasks, moved out of the std::vector into one block together otherwise.
+template<typename T, std::size_t N> struct __when_task_storage
+{
+    using tasks_t = std::array<task<T>, N>;
+
+    tasks_t                        tasks;
+    std::array<__when_all_slot, N> slots;
+
+    explicit __when_task_storage(tasks_t && t) noexcept
+        : tasks(std::move(t))
+    {}
+
+    std::size_t size() const noexcept
+    {
+        return N;
+    }
+
+    task<T> & task_at(std::size_t i) noexcept
+    {
+        return tasks[i];
+    }
+
+    std::span<__when_all_slot> slot_span() noexcept
+    {
+        return slots;
+    }
+};
+
+template<typename T> class __when_task_storage<T, std::dynamic_extent>
+{
+    public:
+        using tasks_t = std::vector<task<T>>;
+
+    private:
+        // The slots first, the tasks right behind them.
+        static_assert(alignof(task<T>) <= alignof(__when_all_slot) && sizeof(__when_all_slot) % alignof(task<T>) == 0);
+
+        std::size_t       size_;
+        __when_all_slot * slots_;
+
+        task<T> * tasks() const noexcept
+        {
+            return reinterpret_cast<task<T> *>(slots_ + size_);
+        }
+
+    public:
+        explicit __when_task_storage(tasks_t && t)
+            : size_(t.size())
+            , slots_(static_cast<__when_all_slot *>(::operator new(size_ * (sizeof(__when_all_slot) + sizeof(task<T>)))))
+        {
+            std::uninitialized_default_construct_n(slots_, size_);
+            std::uninitialized_move_n(t.begin(), size_, tasks());
+        }
+
+        ~__when_task_storage()
+        {
+            std::destroy_n(tasks(), size_);
+            std::destroy_n(slots_, size_);
+            ::operator delete(slots_);
+        }
+
+        __when_task_storage            (const __when_task_storage &) = delete;
+        __when_task_storage & operator=(const __when_task_storage &) = delete;
+
+    public:
+        std::size_t size() const noexcept
+        {
+            return size_;
+        }
+
+        task<T> & task_at(std::size_t i) noexcept
+        {
+            return tasks()[i];
+        }
+
+        std::span<__when_all_slot> slot_span() noexcept
+        {
+            return {slots_, size_};
+        }
+};
+
+template<typename T, std::size_t N> struct __when_tasks : __when_task_storage<T, N>
+{
+    using __when_task_storage<T, N>::__when_task_storage;
+    using __when_task_storage<T, N>::size;
+    using __when_task_storage<T, N>::slot_span;
+
+    typename task<T>::awaiter awaiter(std::size_t i) noexcept
+    {
+        return std::move(this->task_at(i)).operator co_await();
+    }
+
+    // Runs every child up to its first suspend-point (or to completion).
+    void start(const cancellation_token & token, const task_context * context, std::pmr::memory_resource * resource) noexcept
+    {
+        std::span<__when_all_slot> s = slot_span();
+        for(std::size_t i = 0; i < size(); ++i){
+            awaiter(i).start(std::coroutine_handle<>::from_address(&s[i]), token, context, resource).resume();
+        }
+    }
+
+    bool cancelled() noexcept
+    {
+        for(std::size_t i = 0; i < size(); ++i){
+            if(awaiter(i).cancelled()){
+                return true;
+            }
+        }
+        return false;
+    }
+
+#ifdef CORO_NO_EXCEPTIONS
+    std::error_code error() noexcept
+    {
+        for(std::size_t i = 0; i < size(); ++i){
+            if(std::error_code ec = awaiter(i).error()){
+                return ec;
+            }
+        }
+        return {};
+    }
+#endif
+};
+
+//////////////////////
+// when_all(task<Ts>...) -> std::tuple<Ts...>, std::monostate for a task<void>
+
+template<typename T> using __when_all_value_t = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+template<typename... Ts> class when_all_awaiter
+{
+    private:
+        static constexpr std::size_t N = sizeof...(Ts);
+
+        std::tuple<task<Ts>...>        tasks_;
+        std::array<__when_all_slot, N> slots_;
+        __when_all_counter             counter_ {N};
+
+        template<std::size_t I> auto awaiter() noexcept
+        {
+            return std::move(std::get<I>(tasks_)).operator co_await();
+        }
+
+        template<std::size_t I> __when_all_value_t<std::tuple_element_t<I, std::tuple<Ts...>>> result()
+        {
+            if constexpr (std::is_void_v<std::tuple_element_t<I, std::tuple<Ts...>>>){
+                awaiter<I>().await_resume();
+                return {};
+            }
+            else{
+                return awaiter<I>().await_resume();
+            }
+        }
+
+    public:
+        explicit when_all_awaiter(task<Ts>... tasks) noexcept
+            : tasks_(std::move(tasks)...)
+        {}
+
+    public:
+        bool await_ready() noexcept
+        {
+            return N == 0;
+        }
+
+        template<typename Promise> std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            counter_.prepare(slots_, &__when_all_counter::resume_slot, h);
+
+            const cancellation_token    token    = __parent_token(h);
+            const task_context *        context  = __parent_context(h);
+            std::pmr::memory_resource * resource = __parent_resource(h);
+            [&]<std::size_t... I>(std::index_sequence<I...>)
+            {
+                (awaiter<I>().start(std::coroutine_handle<>::from_address(&slots_[I]), token, context, resource).resume(), ...);
+            }(std::index_sequence_for<Ts...>{});
+
+            return counter_.arrive();
+        }
+
+        // Rethrows the exception of the first child (in argument order) that failed.
+        std::tuple<__when_all_value_t<Ts>...> await_resume()
+        {
+            return [&]<std::size_t... I>(std::index_sequence<I...>)
+            {
+                return std::tuple<__when_all_value_t<Ts>...>{result<I>()...};
+            }(std::index_sequence_for<Ts...>{});
+        }
+
+        // Checked by the lowering before await_resume(), as for task::awaiter.
+        bool cancelled() noexcept
+        {
+            return [&]<std::size_t... I>(std::index_sequence<I...>)
+            {
+                return (awaiter<I>().cancelled() || ...);
+            }(std::index_sequence_for<Ts...>{});
+        }
+
+#ifdef CORO_NO_EXCEPTIONS
+        std::error_code error() noexcept
+        {
+            std::error_code ec;
+            [&]<std::size_t... I>(std::index_sequence<I...>)
+            {
+                (void)((ec = awaiter<I>().error()) || ...);
+            }(std::index_sequence_for<Ts...>{});
+            return ec;
+        }
+#endif
+};
+
+template<typename... Ts> when_all_awaiter<Ts...> when_all(task<Ts>... tasks)
+{
+    return when_all_awaiter<Ts...>(std::move(tasks)...);
+}
+
+//////////////////////
+// when_all(std::vector<task<T>>) -> std::vector<T>, void for task<void>
+
+template<typename T>
+    requires (!std::is_reference_v<T>)
+class when_all_range_awaiter
+{
+    private:
+        __when_tasks<T, std::dynamic_extent> tasks_;
+        __when_all_counter                   counter_;
+
+    public:
+        explicit when_all_range_awaiter(std::vector<task<T>> tasks)
+            : tasks_(std::move(tasks))
+            , counter_(tasks_.size())
+        {}
+
+    public:
+        bool await_ready() noexcept
+        {
+            return tasks_.size() == 0;
+        }
+
+        template<typename Promise> std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            counter_.prepare(tasks_.slot_span(), &__when_all_counter::resume_slot, h);
+            tasks_.start(__parent_token(h), __parent_context(h), __parent_resource(h));
+            return counter_.arrive();
+        }
+
+        auto await_resume()
+        {
+            if constexpr (std::is_void_v<T>){
+                for(std::size_t i = 0; i < tasks_.size(); ++i){
+                    tasks_.awaiter(i).await_resume();
+                }
+            }
+            else{
+                std::vector<T> results;
+                results.reserve(tasks_.size());
+
+                for(std::size_t i = 0; i < tasks_.size(); ++i){
+                    results.push_back(tasks_.awaiter(i).await_resume());
+                }
+                return results;
+            }
+        }
+
+        bool cancelled() noexcept
+        {
+            return tasks_.cancelled();
+        }
+
+#ifdef CORO_NO_EXCEPTIONS
+        std::error_code error() noexcept
+        {
+            return tasks_.error();
+        }
+#endif
+};
+
+template<typename T> when_all_range_awaiter<T> when_all(std::vector<task<T>> tasks)
+{
+    return when_all_range_awaiter<T>(std::move(tasks));
+}
+
+//////////////////////
+// when_any(task<T>...) / when_any(std::vector<task<T>>) -> when_any_result<T>
+//
+// The result of the first child to finish, and its position. The results of
+// the others are dropped with their frames. At least one task is required.
+
+template<typename T> struct when_any_result
+{
+    std::size_t index;
+    T           value;
+};
+
+template<> struct when_any_result<void>
+{
+    std::size_t index;
+};
+
+template<typename T, std::size_t N = std::dynamic_extent>
+    requires (N > 0)
+class when_any_awaiter
+{
+    private:
+        __when_tasks<T, N> tasks_;
+        __when_any_counter counter_;
+
+    public:
+        explicit when_any_awaiter(typename __when_tasks<T, N>::tasks_t tasks)
+            : tasks_(std::move(tasks))
+            , counter_(tasks_.size())
+        {}
+
+    public:
+        bool await_ready() noexcept
+        {
+            return false;
+        }
+
+        template<typename Promise> std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+        {
+            if(__parent_token(h).is_cancellation_requested()){
+                counter_.cancel_all();
+            }
+
+            counter_.prepare(tasks_.slot_span(), &__when_any_counter::resume_slot, h);
+            tasks_.start(counter_.token(), __parent_context(h), __parent_resource(h));
+            return counter_.arrive();
+        }
+
+        when_any_result<T> await_resume()
+        {
+            const std::size_t i = counter_.winner();
+            if constexpr (std::is_void_v<T>){
+                tasks_.awaiter(i).await_resume();
+                return {i};
+            }
+            else{
+                return {i, tasks_.awaiter(i).await_resume()};
+            }
+        }
+
+        // The losers are cancelled on purpose, only the winner counts.
+        bool cancelled() noexcept
+        {
+            return tasks_.awaiter(counter_.winner()).cancelled();
+        }
+
+#ifdef CORO_NO_EXCEPTIONS
+        std::error_code error() noexcept
+        {
+            return tasks_.awaiter(counter_.winner()).error();
+        }
+#endif
+};
+
+template<typename T, typename... Ts>
+    requires (std::same_as<T, Ts> && ...)
+when_any_awaiter<T, 1 + sizeof...(Ts)> when_any(task<T> first, task<Ts>... rest)
+{
+    return when_any_awaiter<T, 1 + sizeof...(Ts)>({std::move(first), std::move(rest)...});
+}
+
+template<typename T> when_any_awaiter<T> when_any(std::vector<task<T>> tasks)
+{
+    return when_any_awaiter<T>(std::move(tasks));
+}